@@ -188,6 +188,8 @@ index_opts_decode(struct index_opts *opts, const char *map,
 		}
 		opts->sql = sql;
 	}
+	if (opts->filter != NULL && index_filter_check(opts->filter) != 0)
+		diag_raise();
 	if (opts->range_size <= 0) {
 		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS,
 			  BOX_INDEX_FIELD_OPTS,
@@ -266,9 +268,15 @@ index_def_new_from_tuple(struct tuple *tuple, struct space *space)
 		free(part_def);
 		free(key_def);
 	});
+	/*
+	 * Parts of a functional index describe the key returned
+	 * by the function, so they can't inherit properties of
+	 * the space fields.
+	 */
+	bool is_func_index = opts.func_id != 0;
 	if (key_def_decode_parts(part_def, part_count, &parts,
-				 space->def->fields,
-				 space->def->field_count) != 0)
+				 is_func_index ? NULL : space->def->fields,
+				 is_func_index ? 0 : space->def->field_count) != 0)
 		diag_raise();
 	key_def = key_def_new_with_parts(part_def, part_count);
 	if (key_def == NULL)
@@ -2159,6 +2167,20 @@ func_cache_replace_func(struct trigger * /* trigger */, void *event)
 	def_guard.is_active = false;
 }
 
+/** space_foreach() visitor looking for a functional index. */
+static int
+space_find_func_index(struct space *space, void *udata)
+{
+	uint32_t *fid = (uint32_t *)udata;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (space->index[i]->def->opts.func_id == *fid) {
+			*fid = 0;
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /**
  * A trigger invoked on replace in a space containing
  * functions on which there were defined any grants.
@@ -2199,6 +2221,15 @@ on_replace_dd_func(struct trigger * /* trigger */, void *event)
 				  (unsigned) old_func->def->uid,
 				  "function has grants");
 		}
+		/* Can only delete func if no index uses it. */
+		uint32_t func_id = old_func->def->fid;
+		if (space_foreach(space_find_func_index, &func_id) != 0) {
+			if (func_id != 0)
+				diag_raise();
+			tnt_raise(ClientError, ER_DROP_FUNCTION,
+				  (unsigned) old_func->def->fid,
+				  "function is used by an index");
+		}
 		struct trigger *on_commit =
 			txn_alter_trigger_new(func_cache_remove_func, NULL);
 		txn_on_commit(txn, on_commit);
@@ -2207,6 +2238,18 @@ on_replace_dd_func(struct trigger * /* trigger */, void *event)
 		auto def_guard = make_scoped_guard([=] { free(def); });
 		access_check_ddl(def->name, def->uid, SC_FUNCTION, PRIV_A,
 				 true);
+		/*
+		 * Keys of a functional index were computed by
+		 * the function, so it can't be changed while an
+		 * index uses it.
+		 */
+		uint32_t func_id = old_func->def->fid;
+		if (space_foreach(space_find_func_index, &func_id) != 0) {
+			if (func_id != 0)
+				diag_raise();
+			tnt_raise(ClientError, ER_UNSUPPORTED,
+				  "Function used by an index", "alter");
+		}
 		struct trigger *on_commit =
 			txn_alter_trigger_new(func_cache_replace_func, NULL);
 		txn_on_commit(txn, on_commit);
@@ -44,6 +44,7 @@
 #include "relay.h"
 #include "applier.h"
 #include <rmean.h>
+#include <zstd.h>
 #include "main.h"
 #include "tuple.h"
 #include "session.h"
@@ -73,6 +74,7 @@
 #include "call.h"
 #include "func.h"
 #include "sequence.h"
+#include "xlog_readahead.h"
 
 static char status[64] = "unknown";
 
@@ -460,6 +462,35 @@ box_check_readahead(int readahead)
 	}
 }
 
+static void
+box_check_iproto_threads(int iproto_threads)
+{
+	if (iproto_threads <= 0 || iproto_threads > IPROTO_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "iproto_threads",
+			  "specified value is out of bounds");
+	}
+}
+
+static enum iproto_io_backend
+box_check_io_backend(const char *backend_name)
+{
+	assert(backend_name != NULL); /* checked in Lua */
+	int backend = strindex(iproto_io_backend_strs, backend_name,
+			       iproto_io_backend_MAX);
+	if (backend == iproto_io_backend_MAX)
+		tnt_raise(ClientError, ER_CFG, "io_backend", backend_name);
+	return (enum iproto_io_backend) backend;
+}
+
+static void
+box_check_iproto_compression_threshold(int64_t threshold)
+{
+	if (threshold < 0 || threshold > UINT32_MAX) {
+		tnt_raise(ClientError, ER_CFG, "iproto_compression_threshold",
+			  "specified value is out of bounds");
+	}
+}
+
 static void
 box_check_checkpoint_count(int checkpoint_count)
 {
@@ -491,6 +522,112 @@ box_check_wal_max_size(int64_t wal_max_size)
 	return wal_max_size;
 }
 
+static double
+box_check_wal_commit_delay(int64_t commit_delay_us)
+{
+	if (commit_delay_us < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_commit_delay_us",
+			  "the value must not be negative");
+	}
+	return commit_delay_us / 1e6;
+}
+
+static int
+box_check_wal_prealloc_count(int prealloc_count)
+{
+	if (prealloc_count < 0 || prealloc_count > WAL_PREALLOC_MAX) {
+		tnt_raise(ClientError, ER_CFG, "wal_prealloc_count",
+			  tt_sprintf("the value must be in range [0, %d]",
+				     WAL_PREALLOC_MAX));
+	}
+	return prealloc_count;
+}
+
+static int
+box_check_memtx_build_threads(int threads)
+{
+	if (threads < 1 || threads > MEMTX_BUILD_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_build_threads",
+			  tt_sprintf("the value must be in range [1, %d]",
+				     MEMTX_BUILD_THREADS_MAX));
+	}
+	return threads;
+}
+
+static int
+box_check_memtx_checkpoint_threads(int threads)
+{
+	if (threads < 1 || threads > MEMTX_CHECKPOINT_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_checkpoint_threads",
+			  tt_sprintf("the value must be in range [1, %d]",
+				     MEMTX_CHECKPOINT_THREADS_MAX));
+	}
+	return threads;
+}
+
+static int
+box_check_memtx_incremental_checkpoints(int count)
+{
+	if (count < 0 || count > MEMTX_INCREMENTAL_CHECKPOINTS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_incremental_checkpoints",
+			  tt_sprintf("the value must be in range [0, %d]",
+				     MEMTX_INCREMENTAL_CHECKPOINTS_MAX));
+	}
+	return count;
+}
+
+static int
+box_check_recovery_read_threads(int threads)
+{
+	if (threads < 0 || threads > XLOG_READAHEAD_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "recovery_read_threads",
+			  tt_sprintf("the value must be in range [0, %d]",
+				     XLOG_READAHEAD_THREADS_MAX));
+	}
+	return threads;
+}
+
+static int64_t
+box_check_wal_group_max_bytes(int64_t group_max_bytes)
+{
+	if (group_max_bytes <= 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_group_max_bytes",
+			  "the value must be greater than zero");
+	}
+	return group_max_bytes;
+}
+
+static int64_t
+box_check_wal_async_max_bytes(int64_t max_bytes)
+{
+	if (max_bytes <= 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_async_max_bytes",
+			  "the value must be greater than zero");
+	}
+	return max_bytes;
+}
+
+static double
+box_check_wal_async_max_lag(double max_lag)
+{
+	if (max_lag <= 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_async_max_lag",
+			  "the value must be greater than zero");
+	}
+	return max_lag;
+}
+
+static int
+box_check_xlog_compression_level(int level)
+{
+	if (level < 1 || level > ZSTD_maxCLevel()) {
+		tnt_raise(ClientError, ER_CFG, "xlog_compression_level",
+			  tt_sprintf("the value must be in range [1, %d]",
+				     ZSTD_maxCLevel()));
+	}
+	return level;
+}
+
 static void
 box_check_vinyl_options(void)
 {
@@ -548,10 +685,25 @@ box_check_config()
 	box_check_replication_connect_quorum();
 	box_check_replication_sync_lag();
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_iproto_threads(cfg_geti("iproto_threads"));
+	box_check_io_backend(cfg_gets("io_backend"));
+	box_check_iproto_compression_threshold(
+		cfg_geti64("iproto_compression_threshold"));
 	box_check_checkpoint_count(cfg_geti("checkpoint_count"));
 	box_check_wal_max_rows(cfg_geti64("rows_per_wal"));
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
+	box_check_wal_commit_delay(cfg_geti64("wal_commit_delay_us"));
+	box_check_wal_group_max_bytes(cfg_geti64("wal_group_max_bytes"));
+	box_check_wal_async_max_bytes(cfg_geti64("wal_async_max_bytes"));
+	box_check_wal_async_max_lag(cfg_getd("wal_async_max_lag"));
+	box_check_wal_prealloc_count(cfg_geti("wal_prealloc_count"));
+	box_check_xlog_compression_level(cfg_geti("xlog_compression_level"));
+	box_check_recovery_read_threads(cfg_geti("recovery_read_threads"));
+	box_check_memtx_build_threads(cfg_geti("memtx_build_threads"));
+	box_check_memtx_checkpoint_threads(cfg_geti("memtx_checkpoint_threads"));
+	box_check_memtx_incremental_checkpoints(
+		cfg_geti("memtx_incremental_checkpoints"));
 	box_check_memtx_min_tuple_size(cfg_geti64("memtx_min_tuple_size"));
 	box_check_vinyl_options();
 }
@@ -657,7 +809,7 @@ box_bind(void)
 {
 	const char *uri = cfg_gets("listen");
 	box_check_uri(uri, "listen");
-	iproto_bind(uri);
+	iproto_bind(uri, cfg_geti("iproto_reuseport"));
 }
 
 void
@@ -695,6 +847,37 @@ box_set_snap_io_rate_limit(void)
 			cfg_getd("snap_io_rate_limit"));
 }
 
+void
+box_set_snap_direct_io(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_snap_direct_io(memtx, cfg_geti("snap_direct_io"));
+}
+
+void
+box_set_memtx_checkpoint_threads(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	int threads = box_check_memtx_checkpoint_threads(
+		cfg_geti("memtx_checkpoint_threads"));
+	memtx_engine_set_checkpoint_threads(memtx, threads);
+}
+
+void
+box_set_memtx_incremental_checkpoints(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	int count = box_check_memtx_incremental_checkpoints(
+		cfg_geti("memtx_incremental_checkpoints"));
+	memtx_engine_set_incremental_checkpoints(memtx, count);
+}
+
 void
 box_set_memtx_max_tuple_size(void)
 {
@@ -724,6 +907,14 @@ box_set_readahead(void)
 	iproto_readahead = readahead;
 }
 
+void
+box_set_iproto_compression_threshold(void)
+{
+	int64_t threshold = cfg_geti64("iproto_compression_threshold");
+	box_check_iproto_compression_threshold(threshold);
+	iproto_compression_threshold = threshold;
+}
+
 void
 box_set_checkpoint_count(void)
 {
@@ -1095,6 +1286,24 @@ box_truncate(uint32_t space_id)
 	}
 }
 
+int
+box_begin_bulk_load(uint32_t space_id)
+{
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return -1;
+	return space_begin_bulk_load(space);
+}
+
+int
+box_end_bulk_load(uint32_t space_id)
+{
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return -1;
+	return space_end_bulk_load(space);
+}
+
 /** Update a record in _sequence_data space. */
 static int
 sequence_data_update(uint32_t seq_id, int64_t value)
@@ -1540,9 +1749,15 @@ engine_init()
 				    cfg_geti("force_recovery"),
 				    cfg_getd("memtx_memory"),
 				    cfg_geti("memtx_min_tuple_size"),
-				    cfg_getd("slab_alloc_factor"));
+				    cfg_getd("slab_alloc_factor"),
+				    box_check_memtx_build_threads(
+					cfg_geti("memtx_build_threads")));
 	engine_register((struct engine *)memtx);
 	box_set_memtx_max_tuple_size();
+	memtx_engine_set_compression(memtx,
+		box_check_xlog_compression_level(
+			cfg_geti("xlog_compression_level")),
+		cfg_geti("xlog_compression_dict"));
 
 	struct sysview_engine *sysview = sysview_engine_new_xc();
 	engine_register((struct engine *)sysview);
@@ -1730,7 +1945,8 @@ box_cfg_xc(void)
 	schema_init();
 	replication_init();
 	port_init();
-	iproto_init();
+	iproto_init(cfg_geti("iproto_threads"),
+		    box_check_io_backend(cfg_gets("io_backend")));
 	wal_thread_start();
 
 	title("loading");
@@ -1784,6 +2000,18 @@ box_cfg_xc(void)
 					&last_checkpoint_vclock);
 		auto guard = make_scoped_guard([=]{ recovery_delete(recovery); });
 
+		/*
+		 * Read and decompress the snapshot and WALs
+		 * in background threads while recovering.
+		 */
+		int read_threads = box_check_recovery_read_threads(
+			cfg_geti("recovery_read_threads"));
+		if (read_threads > 0)
+			xlog_readahead_init(read_threads);
+		auto readahead_guard = make_scoped_guard([]{
+			xlog_readahead_free();
+		});
+
 		/*
 		 * recovery->vclock is needed by Vinyl to filter
 		 * WAL rows that were dumped before restart.
@@ -1836,6 +2064,7 @@ box_cfg_xc(void)
 			box_bind();
 		}
 		recovery_finalize(recovery, &wal_stream.base);
+		xlog_readahead_free();
 		engine_end_recovery_xc();
 
 		/* Check replica set and instance UUID. */
@@ -1910,8 +2139,24 @@ box_cfg_xc(void)
 	int64_t wal_max_rows = box_check_wal_max_rows(cfg_geti64("rows_per_wal"));
 	int64_t wal_max_size = box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	enum wal_mode wal_mode = box_check_wal_mode(cfg_gets("wal_mode"));
+	double commit_delay =
+		box_check_wal_commit_delay(cfg_geti64("wal_commit_delay_us"));
+	int64_t group_max_bytes =
+		box_check_wal_group_max_bytes(cfg_geti64("wal_group_max_bytes"));
+	int prealloc_count =
+		box_check_wal_prealloc_count(cfg_geti("wal_prealloc_count"));
+	int64_t async_max_bytes =
+		box_check_wal_async_max_bytes(cfg_geti64("wal_async_max_bytes"));
+	double async_max_lag =
+		box_check_wal_async_max_lag(cfg_getd("wal_async_max_lag"));
 	wal_init(wal_mode, cfg_gets("wal_dir"), &INSTANCE_UUID,
-		 &replicaset.vclock, wal_max_rows, wal_max_size);
+		 &replicaset.vclock, wal_max_rows, wal_max_size,
+		 commit_delay, group_max_bytes, prealloc_count,
+		 cfg_geti("wal_prealloc_zero_fill"),
+		 cfg_geti("wal_direct_io"), async_max_bytes, async_max_lag,
+		 box_check_xlog_compression_level(
+			cfg_geti("xlog_compression_level")),
+		 cfg_geti("xlog_compression_dict"));
 
 	rmean_cleanup(rmean_box);
 
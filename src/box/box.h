@@ -172,8 +172,12 @@ void box_set_log_level(void);
 void box_set_log_format(void);
 void box_set_io_collect_interval(void);
 void box_set_snap_io_rate_limit(void);
+void box_set_snap_direct_io(void);
+void box_set_memtx_checkpoint_threads(void);
+void box_set_memtx_incremental_checkpoints(void);
 void box_set_too_long_threshold(void);
 void box_set_readahead(void);
+void box_set_iproto_compression_threshold(void);
 void box_set_checkpoint_count(void);
 void box_set_memtx_max_tuple_size(void);
 void box_set_vinyl_max_tuple_size(void);
@@ -388,6 +392,17 @@ box_sequence_reset(uint32_t seq_id);
 int
 box_process1(struct request *request, box_tuple_t **result);
 
+/**
+ * Begin loading a batch of tuples into a space in the current
+ * transaction, see space:bulk_load().
+ */
+int
+box_begin_bulk_load(uint32_t space_id);
+
+/** Finish the bulk load started by box_begin_bulk_load(). */
+int
+box_end_bulk_load(uint32_t space_id);
+
 int
 boxk(int type, uint32_t space_id, const char *format, ...);
 
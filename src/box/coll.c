@@ -92,7 +92,25 @@ coll_icu_hash(const char *s, size_t s_len, uint32_t *ph, uint32_t *pcarry,
 }
 
 /**
- * Set up ICU collator and init cmp and hash members of collation.
+ * Get a prefix of the sort key of a string using ICU collation.
+ */
+static size_t
+coll_icu_hint(const char *s, size_t s_len, char *buf, size_t buf_len,
+	      const struct coll *coll)
+{
+	assert(coll->icu.collator != NULL);
+	UCharIterator itr;
+	uiter_setUTF8(&itr, s, s_len);
+	uint32_t state[2] = {0, 0};
+	UErrorCode status = U_ZERO_ERROR;
+	int32_t got = ucol_nextSortKeyPart(coll->icu.collator, &itr, state,
+					   (uint8_t *)buf, buf_len, &status);
+	assert(!U_FAILURE(status));
+	return got;
+}
+
+/**
+ * Set up ICU collator and init cmp, hash and hint members of collation.
  * @param coll - collation to set up.
  * @param def - collation definition.
  * @return 0 on success, -1 on error.
@@ -220,6 +238,7 @@ coll_icu_init_cmp(struct coll *coll, const struct coll_def *def)
 
 	coll->cmp = coll_icu_cmp;
 	coll->hash = coll_icu_hash;
+	coll->hint = coll_icu_hint;
 	return 0;
 }
 
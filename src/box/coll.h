@@ -49,6 +49,10 @@ typedef uint32_t (*coll_hash_f)(const char *s, size_t s_len,
 				uint32_t *ph, uint32_t *pcarry,
 				struct coll *coll);
 
+typedef size_t (*coll_hint_f)(const char *s, size_t s_len,
+			      char *buf, size_t buf_len,
+			      const struct coll *coll);
+
 /**
  * ICU collation specific data.
  */
@@ -73,6 +77,13 @@ struct coll {
 	/** String comparator. */
 	coll_cmp_f cmp;
 	coll_hash_f hash;
+	/**
+	 * Write at most buf_len first bytes of the sort key of
+	 * a string to buf. Sort keys of two strings compared
+	 * with memcmp() are ordered the same way as the strings
+	 * compared with cmp. Returns the number of bytes written.
+	 */
+	coll_hint_f hint;
 	/** Collation name. */
 	size_t name_len;
 	char name[0];
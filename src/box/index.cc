@@ -164,6 +164,11 @@ box_tuple_extract_key(const box_tuple_t *tuple, uint32_t space_id,
 	struct index *index = index_find(space, index_id);
 	if (index == NULL)
 		return NULL;
+	if (index->def->opts.func_id != 0) {
+		diag_set(UnsupportedIndexFeature, index->def,
+			 "key extraction");
+		return NULL;
+	}
 	return tuple_extract_key(tuple, index->def->key_def, key_size);
 }
 
@@ -36,6 +36,8 @@ const char *index_type_strs[] = { "HASH", "TREE", "BITSET", "RTREE" };
 
 const char *rtree_index_distance_type_strs[] = { "EUCLID", "MANHATTAN" };
 
+const char *index_filter_op_strs[] = { "=", "!=", "<", "<=", ">", ">=" };
+
 const struct index_opts index_opts_default = {
 	/* .unique              = */ true,
 	/* .dimension           = */ 2,
@@ -47,6 +49,8 @@ const struct index_opts index_opts_default = {
 	/* .bloom_fpr           = */ 0.05,
 	/* .lsn                 = */ 0,
 	/* .sql                 = */ NULL,
+	/* .func_id             = */ 0,
+	/* .filter              = */ NULL,
 };
 
 const struct opt_def index_opts_reg[] = {
@@ -61,9 +65,79 @@ const struct opt_def index_opts_reg[] = {
 	OPT_DEF("bloom_fpr", OPT_FLOAT, struct index_opts, bloom_fpr),
 	OPT_DEF("lsn", OPT_INT64, struct index_opts, lsn),
 	OPT_DEF("sql", OPT_STRPTR, struct index_opts, sql),
+	OPT_DEF("func", OPT_UINT32, struct index_opts, func_id),
+	OPT_DEF("filter", OPT_ARRAY, struct index_opts, filter),
 	OPT_END,
 };
 
+uint32_t
+index_filter_size(const char *filter)
+{
+	const char *end = filter;
+	mp_next(&end);
+	return end - filter;
+}
+
+int
+index_filter_check(const char *filter)
+{
+	assert(mp_typeof(*filter) == MP_ARRAY);
+	uint32_t count = mp_decode_array(&filter);
+	for (uint32_t i = 0; i < count; i++) {
+		if (mp_typeof(*filter) != MP_ARRAY ||
+		    mp_decode_array(&filter) != 3 ||
+		    mp_typeof(*filter) != MP_UINT)
+			goto err_format;
+		if (mp_decode_uint(&filter) > BOX_INDEX_FIELD_MAX) {
+			diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+				 BOX_INDEX_FIELD_OPTS,
+				 "filter field no is too big");
+			return -1;
+		}
+		if (mp_typeof(*filter) != MP_STR)
+			goto err_format;
+		uint32_t len;
+		const char *str = mp_decode_str(&filter, &len);
+		enum index_filter_op op = STRN2ENUM(index_filter_op, str, len);
+		if (op == index_filter_op_MAX) {
+			diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+				 BOX_INDEX_FIELD_OPTS,
+				 tt_sprintf("unknown filter operator '%.*s'",
+					    (int) len, str));
+			return -1;
+		}
+		switch (mp_typeof(*filter)) {
+		case MP_NIL:
+			if (op != INDEX_FILTER_EQ && op != INDEX_FILTER_NE) {
+				diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+					 BOX_INDEX_FIELD_OPTS, "only '=' and "
+					 "'!=' filter operators accept nil");
+				return -1;
+			}
+			break;
+		case MP_BOOL:
+		case MP_UINT:
+		case MP_INT:
+		case MP_FLOAT:
+		case MP_DOUBLE:
+		case MP_STR:
+		case MP_BIN:
+			break;
+		default:
+			diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+				 BOX_INDEX_FIELD_OPTS,
+				 "filter value must be scalar");
+			return -1;
+		}
+		mp_next(&filter);
+	}
+	return 0;
+err_format:
+	diag_set(ClientError, ER_WRONG_INDEX_OPTIONS, BOX_INDEX_FIELD_OPTS,
+		 "filter conditions must be [field, operator, value]");
+	return -1;
+}
+
 struct index_def *
 index_def_new(uint32_t space_id, uint32_t iid, const char *name,
 	      uint32_t name_len, enum index_type type,
@@ -88,8 +162,13 @@ index_def_new(uint32_t space_id, uint32_t iid, const char *name,
 		return NULL;
 	}
 	def->key_def = key_def_dup(key_def);
+	if (def->key_def == NULL) {
+		index_def_delete(def);
+		return NULL;
+	}
+	def->key_def->for_func_index = opts->func_id != 0;
 	if (pk_def != NULL) {
-		def->cmp_def = key_def_merge(key_def, pk_def);
+		def->cmp_def = key_def_merge(def->key_def, pk_def);
 		if (! opts->is_unique) {
 			def->cmp_def->unique_part_count =
 				def->cmp_def->part_count;
@@ -98,9 +177,9 @@ index_def_new(uint32_t space_id, uint32_t iid, const char *name,
 				def->key_def->part_count;
 		}
 	} else {
-		def->cmp_def = key_def_dup(key_def);
+		def->cmp_def = key_def_dup(def->key_def);
 	}
-	if (def->key_def == NULL || def->cmp_def == NULL) {
+	if (def->cmp_def == NULL) {
 		index_def_delete(def);
 		return NULL;
 	}
@@ -108,6 +187,7 @@ index_def_new(uint32_t space_id, uint32_t iid, const char *name,
 	def->space_id = space_id;
 	def->iid = iid;
 	def->opts = *opts;
+	def->opts.filter = NULL;
 	if (opts->sql != NULL) {
 		def->opts.sql = strdup(opts->sql);
 		if (def->opts.sql == NULL) {
@@ -117,6 +197,17 @@ index_def_new(uint32_t space_id, uint32_t iid, const char *name,
 			return NULL;
 		}
 	}
+	if (opts->filter != NULL) {
+		uint32_t size = index_filter_size(opts->filter);
+		def->opts.filter = (char *) malloc(size);
+		if (def->opts.filter == NULL) {
+			diag_set(OutOfMemory, size, "malloc",
+				 "def->opts.filter");
+			index_def_delete(def);
+			return NULL;
+		}
+		memcpy(def->opts.filter, opts->filter, size);
+	}
 	return def;
 }
 
@@ -145,6 +236,7 @@ index_def_dup(const struct index_def *def)
 	}
 	rlist_create(&dup->link);
 	dup->opts = def->opts;
+	dup->opts.filter = NULL;
 	if (def->opts.sql != NULL) {
 		dup->opts.sql = strdup(def->opts.sql);
 		if (dup->opts.sql == NULL) {
@@ -154,6 +246,17 @@ index_def_dup(const struct index_def *def)
 			return NULL;
 		}
 	}
+	if (def->opts.filter != NULL) {
+		uint32_t size = index_filter_size(def->opts.filter);
+		dup->opts.filter = (char *) malloc(size);
+		if (dup->opts.filter == NULL) {
+			diag_set(OutOfMemory, size, "malloc",
+				 "dup->opts.filter");
+			index_def_delete(dup);
+			return NULL;
+		}
+		memcpy(dup->opts.filter, def->opts.filter, size);
+	}
 	return dup;
 }
 
@@ -191,6 +294,11 @@ index_def_change_requires_rebuild(const struct index_def *old_index_def,
 					  new_index_def->key_def->part_count)) {
 		return true;
 	}
+	if (old_index_def->opts.func_id != new_index_def->opts.func_id)
+		return true;
+	if (index_filter_cmp(old_index_def->opts.filter,
+			     new_index_def->opts.filter) != 0)
+		return true;
 	if (old_index_def->type == RTREE) {
 		if (old_index_def->opts.dimension != new_index_def->opts.dimension
 		    || old_index_def->opts.distance != new_index_def->opts.distance)
@@ -240,6 +348,41 @@ index_def_is_valid(struct index_def *index_def, const char *space_name)
 			 space_name, "too many key parts");
 		return false;
 	}
+	if (index_def->opts.func_id != 0) {
+		if (index_def->iid == 0) {
+			diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+				 space_name, "primary key can not be functional");
+			return false;
+		}
+		if (index_def->key_def->is_multikey) {
+			diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+				 space_name,
+				 "functional index can not be multikey");
+			return false;
+		}
+	}
+	if (index_def->opts.filter != NULL && index_def->iid == 0) {
+		diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+			 space_name, "primary key can not be partial");
+		return false;
+	}
+	if (index_def->key_def->is_multikey) {
+		if (index_def->iid == 0) {
+			diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+				 space_name, "primary key can not be multikey");
+			return false;
+		}
+		uint32_t multikey_part_count = 0;
+		for (uint32_t i = 0; i < index_def->key_def->part_count; i++) {
+			if (index_def->key_def->parts[i].is_multikey)
+				multikey_part_count++;
+		}
+		if (multikey_part_count > 1) {
+			diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+				 space_name, "only one part can be multikey");
+			return false;
+		}
+	}
 	for (uint32_t i = 0; i < index_def->key_def->part_count; i++) {
 		assert(index_def->key_def->parts[i].type < field_type_MAX);
 		if (index_def->key_def->parts[i].fieldno > BOX_INDEX_FIELD_MAX) {
@@ -58,6 +58,18 @@ enum rtree_index_distance_type {
 };
 extern const char *rtree_index_distance_type_strs[];
 
+/** Comparison operators of partial index filter conditions. */
+enum index_filter_op {
+	INDEX_FILTER_EQ,
+	INDEX_FILTER_NE,
+	INDEX_FILTER_LT,
+	INDEX_FILTER_LE,
+	INDEX_FILTER_GT,
+	INDEX_FILTER_GE,
+	index_filter_op_MAX
+};
+extern const char *index_filter_op_strs[];
+
 /** Index options */
 struct index_opts {
 	/**
@@ -99,6 +111,17 @@ struct index_opts {
 	 * SQL statement that produced this index.
 	 */
 	char *sql;
+	/**
+	 * Identifier of the function computing keys of a
+	 * functional index, 0 for an index over tuple fields.
+	 */
+	uint32_t func_id;
+	/**
+	 * Filter of a partial index: MsgPack array of conditions
+	 * [fieldno, operator, value] a tuple must satisfy to be
+	 * indexed. NULL for an index over all tuples.
+	 */
+	char *filter;
 };
 
 extern const struct index_opts index_opts_default;
@@ -120,9 +143,33 @@ static inline void
 index_opts_destroy(struct index_opts *opts)
 {
 	free(opts->sql);
+	free(opts->filter);
 	TRASH(opts);
 }
 
+/** Size of a MsgPack encoded partial index filter. */
+uint32_t
+index_filter_size(const char *filter);
+
+/**
+ * Check that a partial index filter is well-formed.
+ * @retval 0 on success, -1 with diag set otherwise.
+ */
+int
+index_filter_check(const char *filter);
+
+static inline int
+index_filter_cmp(const char *f1, const char *f2)
+{
+	if (f1 == NULL || f2 == NULL)
+		return (f1 != NULL) - (f2 != NULL);
+	uint32_t size1 = index_filter_size(f1);
+	uint32_t size2 = index_filter_size(f2);
+	if (size1 != size2)
+		return size1 < size2 ? -1 : 1;
+	return memcmp(f1, f2, size1);
+}
+
 static inline int
 index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 {
@@ -143,7 +190,9 @@ index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 		return o1->run_size_ratio < o2->run_size_ratio ? -1 : 1;
 	if (o1->bloom_fpr != o2->bloom_fpr)
 		return o1->bloom_fpr < o2->bloom_fpr ? -1 : 1;
-	return 0;
+	if (o1->func_id != o2->func_id)
+		return o1->func_id < o2->func_id ? -1 : 1;
+	return index_filter_cmp(o1->filter, o2->filter);
 }
 
 /* Definition of an index. */
@@ -36,6 +36,7 @@
 #include <msgpuck.h>
 #include <small/ibuf.h>
 #include <small/obuf.h>
+#include <zstd.h>
 #include "third_party/base64.h"
 
 #include "version.h"
@@ -44,11 +45,15 @@
 #include "say.h"
 #include "sio.h"
 #include "evio.h"
+#include "uring.h"
 #include "coio.h"
 #include "scoped_guard.h"
 #include "memory.h"
+#include "clock.h"
+#include "histogram.h"
 
 #include "port.h"
+#include "tuple.h"
 #include "box.h"
 #include "call.h"
 #include "tuple_convert.h"
@@ -59,10 +64,20 @@
 #include "iproto_constants.h"
 #include "rmean.h"
 #include "execute.h"
+#include "txn.h"
 
 /* The number of iproto messages in flight */
 enum { IPROTO_MSG_MAX = 768 };
 
+/**
+ * The minimal number of iproto messages in flight per network
+ * thread. Limits the number of threads sharing IPROTO_MSG_MAX.
+ */
+enum { IPROTO_THREAD_MSG_MIN = 64 };
+
+static_assert(IPROTO_MSG_MAX / IPROTO_THREADS_MAX >= IPROTO_THREAD_MSG_MIN,
+	      "too many network threads to share IPROTO_MSG_MAX");
+
 /**
  * Network readahead. A signed integer to avoid
  * automatic type coercion to an unsigned type.
@@ -80,6 +95,65 @@ enum { IPROTO_MSG_MAX = 768 };
  */
 unsigned iproto_readahead = 16320;
 
+const char *iproto_io_backend_strs[] = { "evio", "uring", NULL };
+
+/** I/O backend of the network threads, set at start. */
+static enum iproto_io_backend iproto_io_backend = IPROTO_IO_EVIO;
+
+/**
+ * Max number of socket operations submitted at once with
+ * the io_uring backend.
+ */
+enum { IPROTO_URING_BATCH = 128 };
+
+const char *iproto_latency_stage_strs[] = {
+	"queue", "tx", "wal", "net", "flush", "total", NULL
+};
+
+/** Request types with latency statistics. */
+enum iproto_latency_type {
+	IPROTO_LATENCY_SELECT,
+	IPROTO_LATENCY_INSERT,
+	IPROTO_LATENCY_REPLACE,
+	IPROTO_LATENCY_UPDATE,
+	IPROTO_LATENCY_DELETE,
+	IPROTO_LATENCY_UPSERT,
+	IPROTO_LATENCY_CALL,
+	IPROTO_LATENCY_EVAL,
+	IPROTO_LATENCY_EXECUTE,
+	IPROTO_LATENCY_AUTH,
+	IPROTO_LATENCY_PING,
+	IPROTO_LATENCY_CURSOR,
+	IPROTO_LATENCY_BATCH,
+	IPROTO_LATENCY_OTHER,
+	iproto_latency_type_MAX
+};
+
+static const char *iproto_latency_type_strs[] = {
+	"SELECT", "INSERT", "REPLACE", "UPDATE", "DELETE", "UPSERT",
+	"CALL", "EVAL", "EXECUTE", "AUTH", "PING", "CURSOR", "BATCH",
+	"OTHER",
+};
+
+static_assert(lengthof(iproto_latency_type_strs) == iproto_latency_type_MAX,
+	      "iproto_latency_type_strs must match iproto_latency_type");
+
+/**
+ * Bucket boundaries of latency histograms, in microseconds:
+ * 1, 2, ... 9 of each decade from 1 microsecond to 1 second,
+ * and 10 seconds.
+ */
+static int64_t iproto_latency_buckets[7 * 9 + 1];
+
+/** Min size of a reply to compress, see IPROTO_COMPRESS. */
+unsigned iproto_compression_threshold = 1024;
+
+/**
+ * Compression level of replies. The fastest one, so that a
+ * network thread keeps up with the replies it compresses.
+ */
+enum { IPROTO_COMPRESSION_LEVEL = 1 };
+
 /**
  * How big is a buffer which needs to be shrunk before
  * it is put back into buffer cache.
@@ -90,22 +164,11 @@ iproto_max_input_size(void)
 	return 18 * iproto_readahead;
 }
 
-void
-iproto_reset_input(struct ibuf *ibuf)
-{
-	/*
-	 * If we happen to have fully processed the input,
-	 * move the pos to the start of the input buffer.
-	 */
-	assert(ibuf_used(ibuf) == 0);
-	if (ibuf_capacity(ibuf) < iproto_max_input_size()) {
-		ibuf_reset(ibuf);
-	} else {
-		struct slab_cache *slabc = ibuf->slabc;
-		ibuf_destroy(ibuf);
-		ibuf_create(ibuf, slabc, iproto_readahead);
-	}
-}
+/**
+ * The smallest input buffer of a connection, see
+ * iproto_connection::readahead.
+ */
+enum { IPROTO_READAHEAD_MIN = 4032 };
 
 /**
  * This structure represents a position in the output.
@@ -125,6 +188,279 @@ iproto_wpos_create(struct iproto_wpos *wpos, struct obuf *out)
 	wpos->svp = obuf_create_svp(out);
 }
 
+/**
+ * Tuples of a SELECT reply which are too large to be copied to
+ * the output buffer. Only the reply header goes to the buffer,
+ * while the tuple data is written to the socket right from
+ * tuple memory when the flush position reaches @a wpos. Tuples
+ * are referenced until the data has been sent, and since
+ * reference counters are not atomic, the splice is sent back
+ * to the tx thread to release them.
+ */
+struct iproto_splice {
+	/** Message to return the splice to the tx thread. */
+	struct cmsg base;
+	/** Link in iproto_connection::splices. */
+	struct rlist in_connection;
+	/** Position in the output to insert tuple data at. */
+	struct iproto_wpos wpos;
+	/** Total size of tuple data. */
+	size_t size;
+	/** Index of the first iovec which is not fully sent. */
+	int iov_pos;
+	/** Number of tuples and iovecs. */
+	int count;
+	/**
+	 * Referenced tuples, or NULL if the splice is a reply
+	 * compressed by the network thread, which is written
+	 * in place of the output from @a wpos up to @a end.
+	 */
+	struct tuple **tuples;
+	/** End of the output replaced by a compressed reply. */
+	struct obuf_svp end;
+	/** Data of the tuples, adjusted on partial write. */
+	struct iovec iov[0];
+};
+
+/**
+ * Minimal size of a SELECT result set which is spliced into
+ * the output instead of being copied to the output buffer.
+ * Smaller replies are copied, since a copy is cheaper than
+ * a writev() of an iovec per tuple.
+ */
+enum { IPROTO_SPLICE_MIN = 16384 };
+
+/**
+ * A reply handed over to the network thread, kept till it is
+ * written to the socket to time the flush stage of the request,
+ * see iproto_connection_collect_flushed().
+ */
+struct iproto_flush_mark {
+	/** Link in iproto_connection::flush_marks. */
+	struct stailq_entry in_connection;
+	/** End of the reply in the output. */
+	struct iproto_wpos wpos;
+	/** Request type, enum iproto_latency_type. */
+	int type;
+	/** Time the request was decoded. */
+	double decode_time;
+	/** Time the reply was handed over to the network thread. */
+	double send_time;
+};
+
+static void
+iproto_splice_delete(struct iproto_splice *splice);
+
+/**
+ * A server-side cursor. Keeps an index iterator open between
+ * requests of a connection, so that a client can read a large
+ * result set in batches of a bounded size. Cursors are owned
+ * by the tx thread and closed on disconnect.
+ */
+struct iproto_cursor {
+	/** Link in iproto_connection::tx.cursors. */
+	struct rlist in_connection;
+	/** Id of the cursor, unique within the connection. */
+	uint64_t id;
+	/** Index iterator. */
+	struct iterator *it;
+	/**
+	 * Set while a FETCH request reads from the iterator:
+	 * an iterator may yield and must not be used or freed
+	 * by another request meanwhile.
+	 */
+	bool is_busy;
+};
+
+enum {
+	/** Max number of open cursors per connection. */
+	IPROTO_CURSOR_MAX = 64,
+	/**
+	 * Max number of tuples returned by a FETCH request,
+	 * so that a reply is never the whole result set.
+	 */
+	IPROTO_CURSOR_FETCH_MAX = 1000,
+};
+
+/** Cursors of all connections. */
+static struct mempool iproto_cursor_pool;
+
+struct iproto_connection;
+
+static void
+iproto_cursor_delete(struct iproto_connection *con,
+		     struct iproto_cursor *cursor);
+
+/* {{{ iproto_queue - declaration */
+
+/**
+ * Request classes. Requests of each class are queued separately
+ * in the network thread and dispatched to tx in weighted round
+ * robin, and each class has its own limit on requests in flight.
+ * This way a storm of expensive requests, such as CALL, does not
+ * delay cheap point lookups queued behind it.
+ */
+enum iproto_class {
+	IPROTO_CLASS_READ,
+	IPROTO_CLASS_WRITE,
+	IPROTO_CLASS_CALL,
+	IPROTO_CLASS_ADMIN,
+	iproto_class_MAX
+};
+
+static const char *iproto_class_strs[iproto_class_MAX] = {
+	"read", "write", "call", "admin"
+};
+
+/** Max number of requests dispatched from a queue per round. */
+static const int iproto_class_weight[iproto_class_MAX] = { 4, 2, 1, 4 };
+
+/** Percent of iproto_thread_msg_max a class may have in flight. */
+static const int iproto_class_limit[iproto_class_MAX] = { 100, 100, 75, 100 };
+
+/** Requests of one class waiting to be dispatched to tx. */
+struct iproto_queue {
+	/** Queued messages, linked by cmsg::fifo. */
+	struct stailq msgs;
+	/** Number of queued messages. */
+	size_t depth;
+	/** Number of dispatched requests not completed yet. */
+	size_t in_flight;
+	/** Max number of requests in flight. */
+	size_t limit;
+	/** Number of dispatched requests. */
+	int64_t total;
+	/** Total time the dispatched requests spent queued. */
+	double wait_time;
+};
+
+/* }}} */
+
+/* {{{ iproto_thread - declaration */
+
+/**
+ * A network thread. Each thread runs its own event loop, accepts
+ * and serves its own subset of client connections and talks to
+ * the tx thread over its own pair of pipes. This lets request
+ * decoding, output flushing and handshakes scale across several
+ * cores while the transaction processor stays single-threaded.
+ */
+struct iproto_thread {
+	/** Ordinal number of the thread. */
+	int id;
+	/** Network thread. */
+	struct cord net_cord;
+	/**
+	 * A single queue for all requests in all connections of
+	 * the thread, used by the network thread only. All
+	 * requests from all connections are processed concurrently.
+	 * Is also used as a queue for just established connections
+	 * and to execute disconnect triggers. A few notes about
+	 * these triggers:
+	 * - they need to be run in a fiber
+	 * - unlike an ordinary request failure, on_connect trigger
+	 *   failure must lead to connection close.
+	 * - on_connect trigger must be processed before any other
+	 *   request on this connection.
+	 */
+	struct cpipe tx_pipe;
+	/**
+	 * A pipe from tx to the network thread. Used by
+	 * the tx thread only.
+	 */
+	struct cpipe net_pipe;
+	/**
+	 * Slab cache used for allocating memory for output network
+	 * buffers in the tx thread.
+	 */
+	struct slab_cache net_slabc;
+	/**
+	 * Pool of input buffers shared by all connections of
+	 * the thread. A connection takes buffers from the pool
+	 * when there is input to read and returns them as soon
+	 * as it becomes idle, so that mostly idle connections
+	 * don't pin readahead memory. Used by the network
+	 * thread only.
+	 */
+	struct slab_cache ibuf_slabc;
+	/** Messages of connections served by this thread. */
+	struct mempool iproto_msg_pool;
+	/** Replies waiting to be flushed, see iproto_flush_mark. */
+	struct mempool iproto_flush_mark_pool;
+	/** Connections served by this thread. */
+	struct mempool iproto_connection_pool;
+	/** Connections with input stopped by throttling. */
+	struct rlist stopped_connections;
+	/** iproto binary listener */
+	struct evio_service binary;
+	/** Network statistics of this thread. */
+	struct rmean *rmean;
+	/** Request queues, one per request class. */
+	struct iproto_queue queues[iproto_class_MAX];
+	/** Context for decompression of requests. */
+	ZSTD_DCtx *zdctx;
+	/** Context for compression of replies. */
+	ZSTD_CCtx *zcctx;
+	/** Statistics of compression of requests and replies. */
+	struct iproto_compression_stat compression_stat;
+	/**
+	 * Latency histograms of each stage of each request type,
+	 * in microseconds, see iproto_msg_collect_latency().
+	 */
+	struct histogram *latency[iproto_latency_type_MAX]
+				 [iproto_latency_stage_MAX];
+	/**
+	 * Ring used to batch socket reads and writes of all
+	 * connections of the thread with the io_uring backend.
+	 * The ring fd is -1 with the evio backend.
+	 */
+	struct uring uring;
+	/** Operations of the current batch, see iproto_uring_op. */
+	struct iproto_uring_op *uring_ops;
+	/** Connections with operations scheduled for the next batch. */
+	struct rlist uring_queue;
+	/**
+	 * Submits the next batch. An idle watcher of the highest
+	 * priority is invoked at the start of each event loop
+	 * iteration while there is something to submit, so the
+	 * batch gathers all socket events of the previous
+	 * iteration.
+	 */
+	struct ev_idle uring_idle;
+	/*
+	 * Message routes. Every route which returns a message
+	 * back to the network thread goes through net_pipe of
+	 * the thread which owns the message, that's why the
+	 * routes can not be shared among threads.
+	 */
+	struct cmsg_hop disconnect_route[2];
+	struct cmsg_hop misc_route[2];
+	struct cmsg_hop call_route[2];
+	struct cmsg_hop select_route[2];
+	struct cmsg_hop process1_route[2];
+	struct cmsg_hop sql_route[2];
+	struct cmsg_hop cursor_route[2];
+	struct cmsg_hop batch_route[2];
+	struct cmsg_hop join_route[2];
+	struct cmsg_hop subscribe_route[2];
+	struct cmsg_hop error_route[2];
+	struct cmsg_hop connect_route[2];
+	const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX];
+};
+
+/** Network threads. */
+static struct iproto_thread *iproto_threads;
+/** Number of network threads. */
+static int iproto_threads_count;
+/**
+ * The number of iproto messages in flight per network thread.
+ * IPROTO_MSG_MAX is shared among all threads to not deplete
+ * the fiber pool in the tx thread.
+ */
+static size_t iproto_thread_msg_max = IPROTO_MSG_MAX;
+
+/* }}} */
+
 /* {{{ iproto_msg - declaration */
 
 /**
@@ -149,6 +485,10 @@ struct iproto_msg
 		struct auth_request auth;
 		/* SQL request, if this is the EXECUTE request. */
 		struct sql_request sql;
+		/** Cursor request, if this is a CURSOR_* request. */
+		struct cursor_request cursor;
+		/** Batch of DML requests, if this is a BATCH. */
+		struct batch_request batch;
 		/** In case of iproto parse error, saved diagnostics. */
 		struct diag diag;
 	};
@@ -173,12 +513,48 @@ struct iproto_msg
 	 * more output to flush.
 	 */
 	struct iproto_wpos wpos;
+	/**
+	 * Tuples of the reply which are not copied to the output
+	 * buffer, set by the tx thread for large SELECT replies.
+	 */
+	struct iproto_splice *splice;
+	/**
+	 * Set by the tx thread if the reply, which starts at
+	 * @a reply_svp and ends at @a wpos, is to be compressed
+	 * by the network thread, see IPROTO_COMPRESS.
+	 */
+	bool compress_reply;
+	struct obuf_svp reply_svp;
+	/** Queue the request was dispatched from, if any. */
+	struct iproto_queue *queue;
+	/** Time the request was queued at. */
+	ev_tstamp queue_time;
 	/**
 	 * Message sent by the tx thread to notify iproto that input has
 	 * been processed and can be discarded before request completion.
 	 * Used by long (yielding) CALL/EVAL requests.
 	 */
 	struct cmsg discard_input;
+	/**
+	 * Decompressed request body if the request was sent
+	 * compressed, see IPROTO_COMPRESSION.
+	 */
+	char *body;
+	/**
+	 * Time the request was decoded by the network thread,
+	 * and the time tx started and finished executing it.
+	 * Taken with clock_monotonic() to be comparable across
+	 * threads.
+	 */
+	double decode_time;
+	double tx_start;
+	double tx_end;
+	/**
+	 * Time tx spent waiting for WAL writes of the request,
+	 * accumulated by txn_write_to_wal() via the fiber key
+	 * FIBER_KEY_WAL_WAIT.
+	 */
+	double wal_wait;
 	/**
 	 * Used in "connect" msgs, true if connect trigger failed
 	 * and the connection must be closed.
@@ -186,60 +562,24 @@ struct iproto_msg
 	bool close_connection;
 };
 
-static struct mempool iproto_msg_pool;
-
 static struct iproto_msg *
-iproto_msg_new(struct iproto_connection *con)
-{
-	struct iproto_msg *msg =
-		(struct iproto_msg *) mempool_alloc_xc(&iproto_msg_pool);
-	msg->connection = con;
-	return msg;
-}
+iproto_msg_new(struct iproto_connection *con);
 
 /**
  * Resume stopped connections, if any.
  */
 static void
-iproto_resume();
+iproto_resume(struct iproto_thread *iproto_thread);
 
 static void
 iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input);
 
-static inline void
-iproto_msg_delete(struct iproto_msg *msg)
-{
-	mempool_free(&iproto_msg_pool, msg);
-	iproto_resume();
-}
-
-/**
- * A single global queue for all requests in all connections. All
- * requests from all connections are processed concurrently.
- * Is also used as a queue for just established connections and to
- * execute disconnect triggers. A few notes about these triggers:
- * - they need to be run in a fiber
- * - unlike an ordinary request failure, on_connect trigger
- *   failure must lead to connection close.
- * - on_connect trigger must be processed before any other
- *   request on this connection.
- */
-static struct cpipe tx_pipe;
-static struct cpipe net_pipe;
-
-/**
- * Network thread.
- */
-static struct cord net_cord;
-
-/**
- * Slab cache used for allocating memory for output network buffers
- * in the tx thread.
- */
-static struct slab_cache net_slabc;
+static void
+iproto_msg_delete(struct iproto_msg *msg);
 
-struct rmean *rmean_net;
+static void
+iproto_thread_dispatch(struct iproto_thread *iproto_thread);
 
 enum rmean_net_name {
 	IPROTO_SENT,
@@ -249,17 +589,6 @@ enum rmean_net_name {
 
 const char *rmean_net_strings[IPROTO_LAST] = { "SENT", "RECEIVED" };
 
-static void
-tx_process_disconnect(struct cmsg *m);
-
-static void
-net_finish_disconnect(struct cmsg *m);
-
-static const struct cmsg_hop disconnect_route[] = {
-	{ tx_process_disconnect, &net_pipe },
-	{ net_finish_disconnect, NULL },
-};
-
 /* }}} */
 
 /* {{{ iproto_connection - declaration and definition */
@@ -330,6 +659,17 @@ struct iproto_connection
 	 * output is available (see iproto_msg::wpos).
 	 */
 	struct iproto_wpos wend;
+	/**
+	 * Pending splices of the output, ordered by the output
+	 * position. Accessed by the net thread only.
+	 */
+	struct rlist splices;
+	/**
+	 * Replies handed over to the network thread but not
+	 * written to the socket yet, ordered by the output
+	 * position, see iproto_flush_mark.
+	 */
+	struct stailq flush_marks;
 	/*
 	 * Size of readahead which is not parsed yet, i.e. size of
 	 * a piece of request which is not fully read. Is always
@@ -348,14 +688,42 @@ struct iproto_connection
 	 * connections.
 	 */
 	int long_poll_requests;
+	/**
+	 * Size of an input buffer allocated for the connection.
+	 * Starts at IPROTO_READAHEAD_MIN, doubles every time
+	 * a read fills up the whole buffer, i.e. the client
+	 * streams requests, up to iproto_readahead, and halves
+	 * every time the connection becomes idle without having
+	 * filled up a buffer since it was idle last time.
+	 */
+	size_t readahead;
+	/** Set if a read filled up an input buffer. */
+	bool is_input_full;
 	struct ev_io input;
 	struct ev_io output;
 	/** Logical session. */
 	struct session *session;
 	ev_loop *loop;
+	/** Network thread serving the connection. */
+	struct iproto_thread *iproto_thread;
+	/**
+	 * Number of requests of the connection waiting in a
+	 * request queue, and the queue. While there are such
+	 * requests, all new requests of the connection are put
+	 * into the same queue so as not to reorder them.
+	 */
+	int n_queued;
+	struct iproto_queue *queue;
 	/* Pre-allocated disconnect msg. */
 	struct iproto_msg *disconnect;
 	struct rlist in_stop_list;
+	/**
+	 * Operations scheduled for the next batch of the io_uring
+	 * backend, a mask of enum iproto_uring_op_type.
+	 */
+	unsigned uring_ops;
+	/** Link in iproto_thread::uring_queue. */
+	struct rlist in_uring_queue;
 	/**
 	 * The following fields are used exclusively by the tx thread.
 	 * Align them to prevent false-sharing.
@@ -364,11 +732,313 @@ struct iproto_connection
 		alignas(CACHELINE_SIZE)
 		/** Pointer to the current output buffer. */
 		struct obuf *p_obuf;
+		/** Open server-side cursors, see iproto_cursor. */
+		struct rlist cursors;
+		/** Number of open cursors. */
+		int cursor_count;
+		/** Id of the next cursor to open. */
+		uint64_t next_cursor_id;
+		/** Compression of replies, enum iproto_compression. */
+		uint32_t compression;
 	} tx;
 };
 
-static struct mempool iproto_connection_pool;
-static RLIST_HEAD(stopped_connections);
+/** Socket operations batched with the io_uring backend. */
+enum iproto_uring_op_type {
+	IPROTO_URING_RECV = 1 << 0,
+	IPROTO_URING_SEND = 1 << 1,
+};
+
+/**
+ * A socket operation of a batch submitted to the ring. Holds
+ * everything the kernel and the completion handler need until
+ * the batch is complete.
+ */
+struct iproto_uring_op {
+	struct iproto_connection *con;
+	enum iproto_uring_op_type type;
+	/** Result of the operation, bytes or -errno. */
+	int res;
+	/** Input buffer read to, for IPROTO_URING_RECV. */
+	struct ibuf *ibuf;
+	/** End of the output written, for IPROTO_URING_SEND. */
+	struct obuf_svp end;
+	struct msghdr msg;
+	struct iovec iov[SMALL_OBUF_IOV_MAX + 1];
+};
+
+static inline bool
+iproto_thread_has_uring(struct iproto_thread *iproto_thread)
+{
+	return iproto_thread->uring.fd >= 0;
+}
+
+/**
+ * Schedule an operation of the connection for the next
+ * batch of the io_uring backend.
+ */
+static void
+iproto_uring_schedule(struct iproto_connection *con,
+		      enum iproto_uring_op_type type)
+{
+	struct iproto_thread *iproto_thread = con->iproto_thread;
+	assert(iproto_thread_has_uring(iproto_thread));
+	if (con->uring_ops == 0) {
+		rlist_add_tail_entry(&iproto_thread->uring_queue, con,
+				     in_uring_queue);
+	}
+	con->uring_ops |= type;
+	ev_idle_start(con->loop, &iproto_thread->uring_idle);
+}
+
+/** Drop all operations scheduled for the connection. */
+static inline void
+iproto_uring_cancel(struct iproto_connection *con)
+{
+	rlist_del(&con->in_uring_queue);
+	con->uring_ops = 0;
+}
+
+static struct iproto_msg *
+iproto_msg_new(struct iproto_connection *con)
+{
+	struct mempool *pool = &con->iproto_thread->iproto_msg_pool;
+	struct iproto_msg *msg =
+		(struct iproto_msg *) mempool_alloc_xc(pool);
+	msg->connection = con;
+	msg->splice = NULL;
+	msg->compress_reply = false;
+	msg->queue = NULL;
+	msg->body = NULL;
+	msg->decode_time = clock_monotonic();
+	msg->tx_start = msg->tx_end = msg->decode_time;
+	msg->wal_wait = 0;
+	return msg;
+}
+
+static enum iproto_latency_type
+iproto_latency_type(uint32_t type)
+{
+	switch (type) {
+	case IPROTO_SELECT:
+		return IPROTO_LATENCY_SELECT;
+	case IPROTO_INSERT:
+		return IPROTO_LATENCY_INSERT;
+	case IPROTO_REPLACE:
+		return IPROTO_LATENCY_REPLACE;
+	case IPROTO_UPDATE:
+		return IPROTO_LATENCY_UPDATE;
+	case IPROTO_DELETE:
+		return IPROTO_LATENCY_DELETE;
+	case IPROTO_UPSERT:
+		return IPROTO_LATENCY_UPSERT;
+	case IPROTO_CALL_16:
+	case IPROTO_CALL:
+		return IPROTO_LATENCY_CALL;
+	case IPROTO_EVAL:
+		return IPROTO_LATENCY_EVAL;
+	case IPROTO_EXECUTE:
+		return IPROTO_LATENCY_EXECUTE;
+	case IPROTO_AUTH:
+		return IPROTO_LATENCY_AUTH;
+	case IPROTO_PING:
+		return IPROTO_LATENCY_PING;
+	case IPROTO_CURSOR_OPEN:
+	case IPROTO_CURSOR_FETCH:
+	case IPROTO_CURSOR_CLOSE:
+		return IPROTO_LATENCY_CURSOR;
+	case IPROTO_BATCH:
+		return IPROTO_LATENCY_BATCH;
+	default:
+		return IPROTO_LATENCY_OTHER;
+	}
+}
+
+/**
+ * Collect latency of each stage of a request the reply to
+ * which has been handed over to the network thread. The flush
+ * stage and the total are collected once the reply is written
+ * to the socket, see iproto_connection_collect_flushed().
+ */
+static void
+iproto_msg_collect_latency(struct iproto_msg *msg)
+{
+	struct iproto_connection *con = msg->connection;
+	struct iproto_thread *iproto_thread = con->iproto_thread;
+	int type = iproto_latency_type(msg->header.type);
+	struct histogram **latency = iproto_thread->latency[type];
+	double now = clock_monotonic();
+	double stage[IPROTO_LATENCY_NET + 1];
+	stage[IPROTO_LATENCY_QUEUE] = msg->tx_start - msg->decode_time;
+	stage[IPROTO_LATENCY_TX] = msg->tx_end - msg->tx_start - msg->wal_wait;
+	stage[IPROTO_LATENCY_WAL] = msg->wal_wait;
+	stage[IPROTO_LATENCY_NET] = now - msg->tx_end;
+	for (int i = 0; i <= IPROTO_LATENCY_NET; i++)
+		histogram_collect(latency[i], stage[i] * 1000000);
+	struct iproto_flush_mark *mark = NULL;
+	if (evio_has_fd(&con->output)) {
+		mark = (struct iproto_flush_mark *)
+			mempool_alloc(&iproto_thread->iproto_flush_mark_pool);
+	}
+	if (mark == NULL) {
+		/* The reply won't be timed, count the request. */
+		histogram_collect(latency[IPROTO_LATENCY_TOTAL],
+				  (now - msg->decode_time) * 1000000);
+		return;
+	}
+	mark->wpos = msg->wpos;
+	mark->type = type;
+	mark->decode_time = msg->decode_time;
+	mark->send_time = now;
+	stailq_add_tail_entry(&con->flush_marks, mark, in_connection);
+}
+
+/**
+ * Collect latency of the flush stage and the total latency of
+ * the requests the replies to which have been written to the
+ * socket. If @a is_drained is set, the current output buffer
+ * has been written entirely, and so has every reply in it.
+ */
+static void
+iproto_connection_collect_flushed(struct iproto_connection *con,
+				  bool is_drained)
+{
+	struct iproto_thread *iproto_thread = con->iproto_thread;
+	struct iproto_splice *splice = NULL;
+	if (! rlist_empty(&con->splices)) {
+		splice = rlist_first_entry(&con->splices,
+					   struct iproto_splice,
+					   in_connection);
+	}
+	double now = 0;
+	while (! stailq_empty(&con->flush_marks)) {
+		struct iproto_flush_mark *mark =
+			stailq_first_entry(&con->flush_marks,
+					   struct iproto_flush_mark,
+					   in_connection);
+		/* The reply is in the next output buffer. */
+		if (mark->wpos.obuf != con->wpos.obuf)
+			break;
+		if (! is_drained) {
+			if (mark->wpos.svp.used > con->wpos.svp.used)
+				break;
+			/* Tuple data is written after the header. */
+			if (splice != NULL &&
+			    splice->wpos.obuf == mark->wpos.obuf &&
+			    splice->wpos.svp.used <= mark->wpos.svp.used)
+				break;
+		}
+		if (now == 0)
+			now = clock_monotonic();
+		stailq_shift(&con->flush_marks);
+		struct histogram **latency = iproto_thread->latency[mark->type];
+		histogram_collect(latency[IPROTO_LATENCY_FLUSH],
+				  (now - mark->send_time) * 1000000);
+		histogram_collect(latency[IPROTO_LATENCY_TOTAL],
+				  (now - mark->decode_time) * 1000000);
+		mempool_free(&iproto_thread->iproto_flush_mark_pool, mark);
+	}
+}
+
+static void
+iproto_msg_delete(struct iproto_msg *msg)
+{
+	struct iproto_thread *iproto_thread = msg->connection->iproto_thread;
+	struct iproto_queue *queue = msg->queue;
+	free(msg->body);
+	mempool_free(&iproto_thread->iproto_msg_pool, msg);
+	if (queue != NULL) {
+		assert(queue->in_flight > 0);
+		queue->in_flight--;
+		if (! stailq_empty(&queue->msgs))
+			iproto_thread_dispatch(iproto_thread);
+	}
+	iproto_resume(iproto_thread);
+}
+
+/** Request class of a decoded message. */
+static enum iproto_class
+iproto_msg_class(struct iproto_msg *msg)
+{
+	switch (msg->header.type) {
+	case IPROTO_SELECT:
+	case IPROTO_CURSOR_OPEN:
+	case IPROTO_CURSOR_FETCH:
+	case IPROTO_CURSOR_CLOSE:
+		return IPROTO_CLASS_READ;
+	case IPROTO_INSERT:
+	case IPROTO_REPLACE:
+	case IPROTO_UPDATE:
+	case IPROTO_DELETE:
+	case IPROTO_UPSERT:
+	case IPROTO_EXECUTE:
+	case IPROTO_BATCH:
+		return IPROTO_CLASS_WRITE;
+	case IPROTO_CALL_16:
+	case IPROTO_CALL:
+	case IPROTO_EVAL:
+		return IPROTO_CLASS_CALL;
+	default:
+		return IPROTO_CLASS_ADMIN;
+	}
+}
+
+/** Put a decoded message into the queue of its class. */
+static void
+iproto_enqueue_msg(struct iproto_connection *con, struct iproto_msg *msg)
+{
+	struct iproto_queue *queue;
+	if (con->n_queued > 0) {
+		/*
+		 * Don't let the request overtake earlier
+		 * requests of the same connection.
+		 */
+		queue = con->queue;
+	} else {
+		queue = &con->iproto_thread->queues[iproto_msg_class(msg)];
+		con->queue = queue;
+	}
+	msg->queue = queue;
+	msg->queue_time = ev_monotonic_now(con->loop);
+	stailq_add_tail_entry(&queue->msgs, &msg->base, fifo);
+	queue->depth++;
+	con->n_queued++;
+}
+
+/**
+ * Move queued messages to the tx pipe. Every round takes up
+ * to the class weight messages from each queue, skipping the
+ * queues which have reached their limit on requests in flight.
+ */
+static void
+iproto_thread_dispatch(struct iproto_thread *iproto_thread)
+{
+	struct cpipe *tx_pipe = &iproto_thread->tx_pipe;
+	ev_tstamp now = ev_monotonic_now(loop());
+	bool progress;
+	do {
+		progress = false;
+		for (int c = 0; c < iproto_class_MAX; c++) {
+			struct iproto_queue *queue = &iproto_thread->queues[c];
+			for (int i = 0; i < iproto_class_weight[c]; i++) {
+				if (stailq_empty(&queue->msgs) ||
+				    queue->in_flight >= queue->limit)
+					break;
+				struct cmsg *m = stailq_shift_entry(&queue->msgs,
+							struct cmsg, fifo);
+				struct iproto_msg *msg = (struct iproto_msg *) m;
+				queue->depth--;
+				queue->in_flight++;
+				queue->total++;
+				queue->wait_time += now - msg->queue_time;
+				msg->connection->n_queued--;
+				cpipe_push_input(tx_pipe, m);
+				progress = true;
+			}
+		}
+	} while (progress);
+	cpipe_flush_input(tx_pipe);
+}
 
 /**
  * Return true if we have not enough spare messages
@@ -376,11 +1046,12 @@ static RLIST_HEAD(stopped_connections);
  * discounted: they are mostly reserved and idle.
  */
 static inline bool
-iproto_must_stop_input()
+iproto_must_stop_input(struct iproto_thread *iproto_thread)
 {
-	size_t connection_count = mempool_count(&iproto_connection_pool);
-	size_t request_count = mempool_count(&iproto_msg_pool);
-	return request_count > connection_count + IPROTO_MSG_MAX;
+	size_t connection_count =
+		mempool_count(&iproto_thread->iproto_connection_pool);
+	size_t request_count = mempool_count(&iproto_thread->iproto_msg_pool);
+	return request_count > connection_count + iproto_thread_msg_max;
 }
 
 /**
@@ -390,20 +1061,20 @@ iproto_must_stop_input()
  * object in the message pool.
  */
 static void
-iproto_resume()
+iproto_resume(struct iproto_thread *iproto_thread)
 {
 	/*
 	 * Most of the time we have nothing to do here: throttling
 	 * is not active.
 	 */
-	if (rlist_empty(&stopped_connections))
+	if (rlist_empty(&iproto_thread->stopped_connections))
 		return;
-	if (iproto_must_stop_input())
+	if (iproto_must_stop_input(iproto_thread))
 		return;
 
 	struct iproto_connection *con;
-	con = rlist_first_entry(&stopped_connections, struct iproto_connection,
-				in_stop_list);
+	con = rlist_first_entry(&iproto_thread->stopped_connections,
+				struct iproto_connection, in_stop_list);
 	ev_feed_event(con->loop, &con->input, EV_READ);
 }
 
@@ -430,6 +1101,78 @@ iproto_connection_is_idle(struct iproto_connection *con)
 	       ibuf_used(&con->ibuf[1]) == 0;
 }
 
+/**
+ * Input of a connection is drained when all read requests are
+ * processed or discarded (see net_discard_input()) and there is
+ * no partially read request. Requests waiting for a reply after
+ * having been discarded don't reference the input buffers.
+ */
+static inline bool
+iproto_connection_input_is_drained(struct iproto_connection *con)
+{
+	return con->parse_size == 0 &&
+	       ibuf_used(&con->ibuf[0]) == 0 &&
+	       ibuf_used(&con->ibuf[1]) == 0;
+}
+
+/**
+ * Current size of an input buffer of the connection, clipped
+ * by iproto_readahead, which can be changed in runtime.
+ */
+static inline size_t
+iproto_connection_readahead(struct iproto_connection *con)
+{
+	return MIN(con->readahead, (size_t) iproto_readahead);
+}
+
+/**
+ * Recycle a fully processed input buffer. The memory is kept
+ * unless the buffer is too big or too small for the current
+ * readahead of the connection.
+ */
+static void
+iproto_connection_reset_input(struct iproto_connection *con,
+			      struct ibuf *ibuf)
+{
+	/*
+	 * If we happen to have fully processed the input,
+	 * move the pos to the start of the input buffer.
+	 */
+	assert(ibuf_used(ibuf) == 0);
+	size_t readahead = iproto_connection_readahead(con);
+	size_t capacity = ibuf_capacity(ibuf);
+	if (capacity >= readahead && capacity < iproto_max_input_size()) {
+		ibuf_reset(ibuf);
+	} else {
+		ibuf_destroy(ibuf);
+		ibuf_create(ibuf, &con->iproto_thread->ibuf_slabc, readahead);
+	}
+}
+
+/**
+ * Return the input buffers of a connection with drained input
+ * to the pool of the thread and adjust the readahead of the
+ * connection to the traffic seen since it was drained last time.
+ */
+static void
+iproto_connection_release_input(struct iproto_connection *con)
+{
+	assert(iproto_connection_input_is_drained(con));
+	if (con->is_input_full) {
+		con->is_input_full = false;
+	} else if (con->readahead > IPROTO_READAHEAD_MIN) {
+		con->readahead = MAX(con->readahead / 2,
+				     (size_t) IPROTO_READAHEAD_MIN);
+	}
+	struct slab_cache *slabc = &con->iproto_thread->ibuf_slabc;
+	size_t readahead = iproto_connection_readahead(con);
+	for (int i = 0; i < 2; i++) {
+		ibuf_destroy(&con->ibuf[i]);
+		ibuf_create(&con->ibuf[i], slabc, readahead);
+	}
+	con->p_ibuf = &con->ibuf[0];
+}
+
 static inline void
 iproto_connection_stop(struct iproto_connection *con)
 {
@@ -437,7 +1180,32 @@ iproto_connection_stop(struct iproto_connection *con)
 		 sio_socketname(con->input.fd));
 	assert(rlist_empty(&con->in_stop_list));
 	ev_io_stop(con->loop, &con->input);
-	rlist_add_tail(&stopped_connections, &con->in_stop_list);
+	rlist_add_tail(&con->iproto_thread->stopped_connections,
+		       &con->in_stop_list);
+}
+
+static void
+tx_splice_release(struct cmsg *m);
+
+/**
+ * Remove a splice from the connection and send it back to
+ * the tx thread to release the tuples. A compressed reply
+ * is owned by the network thread and is freed right away.
+ */
+static void
+iproto_connection_release_splice(struct iproto_connection *con,
+				 struct iproto_splice *splice)
+{
+	static const struct cmsg_hop release_route[] = {
+		{ tx_splice_release, NULL },
+	};
+	rlist_del(&splice->in_connection);
+	if (splice->tuples == NULL) {
+		free(splice);
+		return;
+	}
+	cmsg_init(&splice->base, release_route);
+	cpipe_push(&con->iproto_thread->tx_pipe, &splice->base);
 }
 
 /**
@@ -457,6 +1225,16 @@ iproto_connection_close(struct iproto_connection *con)
 		/* Make evio_has_fd() happy */
 		con->input.fd = con->output.fd = -1;
 		close(fd);
+		iproto_uring_cancel(con);
+		/* Replies which haven't been written aren't timed. */
+		while (! stailq_empty(&con->flush_marks)) {
+			struct iproto_flush_mark *mark =
+				stailq_shift_entry(&con->flush_marks,
+						   struct iproto_flush_mark,
+						   in_connection);
+			mempool_free(&con->iproto_thread->iproto_flush_mark_pool,
+				     mark);
+		}
 		/*
 		 * Discard unparsed data, to recycle the
 		 * connection in net_send_msg() as soon as all
@@ -479,9 +1257,18 @@ iproto_connection_close(struct iproto_connection *con)
 	 */
 	if (iproto_connection_is_idle(con)) {
 		assert(con->disconnect != NULL);
+		/*
+		 * Release tuples of the replies which have
+		 * not been sent before the connection was
+		 * closed. No more replies can arrive.
+		 */
+		struct iproto_splice *splice, *tmp;
+		rlist_foreach_entry_safe(splice, &con->splices,
+					 in_connection, tmp)
+			iproto_connection_release_splice(con, splice);
 		struct iproto_msg *msg = con->disconnect;
 		con->disconnect = NULL;
-		cpipe_push(&tx_pipe, &msg->base);
+		cpipe_push(&con->iproto_thread->tx_pipe, &msg->base);
 	}
 	rlist_del(&con->in_stop_list);
 }
@@ -549,6 +1336,7 @@ iproto_connection_input_buffer(struct iproto_connection *con)
 		return NULL;
 	}
 
+	iproto_connection_reset_input(con, new_ibuf);
 	ibuf_reserve_xc(new_ibuf, to_read + con->parse_size);
 	/*
 	 * Discard unparsed data in the old buffer, otherwise it
@@ -565,7 +1353,7 @@ iproto_connection_input_buffer(struct iproto_connection *con)
 		 * them.
 		 */
 		if (ibuf_used(old_ibuf) == 0)
-			iproto_reset_input(old_ibuf);
+			iproto_connection_reset_input(con, old_ibuf);
 	}
 	/*
 	 * Rotate buffers. Not strictly necessary, but
@@ -579,6 +1367,7 @@ iproto_connection_input_buffer(struct iproto_connection *con)
 static inline void
 iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 {
+	struct iproto_thread *iproto_thread = con->iproto_thread;
 	int n_requests = 0;
 	bool stop_input = false;
 	while (con->parse_size && stop_input == false) {
@@ -586,7 +1375,7 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		const char *pos = reqstart;
 		/* Read request length. */
 		if (mp_typeof(*pos) != MP_UINT) {
-			cpipe_flush_input(&tx_pipe);
+			iproto_thread_dispatch(iproto_thread);
 			tnt_raise(ClientError, ER_INVALID_MSGPACK,
 				  "packet length");
 		}
@@ -607,7 +1396,7 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 * This can't throw, but should not be
 		 * done in case of exception.
 		 */
-		cpipe_push_input(&tx_pipe, &msg->base);
+		iproto_enqueue_msg(con, msg);
 		n_requests++;
 		/* Request is parsed */
 		assert(reqend > reqstart);
@@ -625,6 +1414,7 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 */
 		ev_io_stop(con->loop, &con->output);
 		ev_io_stop(con->loop, &con->input);
+		iproto_uring_cancel(con);
 	} else if (n_requests != 1 || con->parse_size != 0) {
 		assert(rlist_empty(&con->in_stop_list));
 		/*
@@ -646,7 +1436,53 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 */
 		ev_feed_event(con->loop, &con->input, EV_READ);
 	}
-	cpipe_flush_input(&tx_pipe);
+	iproto_thread_dispatch(iproto_thread);
+}
+
+/**
+ * Handle the result of a read of at most @a size bytes into
+ * the input buffer @a in: -1 if the socket is not ready,
+ * 0 on EOF, the number of bytes read otherwise.
+ */
+static void
+iproto_connection_on_read(struct iproto_connection *con, struct ibuf *in,
+			  size_t size, ssize_t nrd)
+{
+	if (nrd < 0) {                  /* Socket is not ready. */
+		ev_io_start(con->loop, &con->input);
+		return;
+	}
+	if (nrd == 0) {                 /* EOF */
+		iproto_connection_close(con);
+		return;
+	}
+	/* Count statistics */
+	rmean_collect(con->iproto_thread->rmean, IPROTO_RECEIVED, nrd);
+	/*
+	 * The client sends more than fits in the buffer,
+	 * let the next buffers be bigger.
+	 */
+	if ((size_t) nrd == size) {
+		con->is_input_full = true;
+		con->readahead = MIN(con->readahead * 2,
+				     (size_t) iproto_readahead);
+	}
+
+	/* Update the read position and connection state. */
+	in->wpos += nrd;
+	con->parse_size += nrd;
+	/* Enqueue all requests which are fully read up. */
+	iproto_enqueue_batch(con, in);
+}
+
+static void
+iproto_connection_on_input_error(struct iproto_connection *con,
+				 Exception *e)
+{
+	/* Best effort at sending the error message to the client. */
+	iproto_write_error(con->input.fd, e, ::schema_version, 0);
+	e->log();
+	iproto_connection_close(con);
 }
 
 static void
@@ -665,7 +1501,7 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 		 * resume one more connection which might have
 		 * input.
 		 */
-		iproto_resume();
+		iproto_resume(con->iproto_thread);
 	}
 	/*
 	 * Throttle if there are too many pending requests,
@@ -674,11 +1510,22 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	 * another fiber waiting for write to complete).
 	 * Ignore iproto_connection->disconnect messages.
 	 */
-	if (iproto_must_stop_input()) {
+	if (iproto_must_stop_input(con->iproto_thread)) {
 		iproto_connection_stop(con);
 		return;
 	}
 
+	if (iproto_thread_has_uring(con->iproto_thread)) {
+		/*
+		 * Read in the next batch. Stop the watcher
+		 * meanwhile, the socket stays readable until
+		 * then.
+		 */
+		ev_io_stop(loop, &con->input);
+		iproto_uring_schedule(con, IPROTO_URING_RECV);
+		return;
+	}
+
 	try {
 		/* Ensure we have sufficient space for the next round.  */
 		struct ibuf *in = iproto_connection_input_buffer(con);
@@ -687,47 +1534,83 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 			return;
 		}
 		/* Read input. */
-		int nrd = sio_read(fd, in->wpos, ibuf_unused(in));
-		if (nrd < 0) {                  /* Socket is not ready. */
-			ev_io_start(loop, &con->input);
-			return;
-		}
-		if (nrd == 0) {                 /* EOF */
-			iproto_connection_close(con);
-			return;
-		}
-		/* Count statistics */
-		rmean_collect(rmean_net, IPROTO_RECEIVED, nrd);
-
-		/* Update the read position and connection state. */
-		in->wpos += nrd;
-		con->parse_size += nrd;
-		/* Enqueue all requests which are fully read up. */
-		iproto_enqueue_batch(con, in);
+		size_t unused = ibuf_unused(in);
+		int nrd = sio_read(fd, in->wpos, unused);
+		iproto_connection_on_read(con, in, unused, nrd);
 	} catch (Exception *e) {
-		/* Best effort at sending the error message to the client. */
-		iproto_write_error(fd, e, ::schema_version, 0);
-		e->log();
-		iproto_connection_close(con);
+		iproto_connection_on_input_error(con, e);
 	}
 }
 
-/** writev() to the socket and handle the result. */
+/** writev() tuple data of a splice to the socket. */
+static int
+iproto_flush_splice(struct iproto_connection *con,
+		    struct iproto_splice *splice)
+{
+	struct iovec *iov = splice->iov + splice->iov_pos;
+	int iovcnt = MIN(splice->count - splice->iov_pos, IOV_MAX);
+
+	ssize_t nwr = sio_writev(con->output.fd, iov, iovcnt);
+
+	if (nwr <= 0)
+		return -1;
+	rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+	size_t offset = 0;
+	int advance = sio_move_iov(iov, nwr, &offset);
+	splice->iov_pos += advance;
+	if (splice->iov_pos == splice->count) {
+		/* Skip the reply the compressed data replaces. */
+		if (splice->tuples == NULL)
+			con->wpos.svp = splice->end;
+		/* All data is sent, release the tuples. */
+		iproto_connection_release_splice(con, splice);
+		iproto_connection_collect_flushed(con, false);
+		return 0;
+	}
+	if (offset == 0 && advance == iovcnt)
+		return 0;
+	/* Adjust the iovec to the partial write. */
+	sio_add_to_iov(&iov[advance], -offset);
+	return -1;
+}
 
+/**
+ * Collect the next piece of output to write into @a iov,
+ * ending at @a end_svp. Return the number of iovecs, 0 if
+ * there is nothing to write, or -1 if tuple data of a splice
+ * @a p_splice must be written first.
+ */
 static int
-iproto_flush(struct iproto_connection *con)
+iproto_flush_iov(struct iproto_connection *con, struct iovec *iov,
+		 struct obuf_svp *end_svp, struct iproto_splice **p_splice)
 {
-	int fd = con->output.fd;
 	struct obuf *obuf = con->wpos.obuf;
 	struct obuf_svp obuf_end = obuf_create_svp(obuf);
 	struct obuf_svp *begin = &con->wpos.svp;
 	struct obuf_svp *end = &con->wend.svp;
+	struct iproto_splice *splice = NULL;
+	if (! rlist_empty(&con->splices)) {
+		splice = rlist_first_entry(&con->splices,
+					   struct iproto_splice,
+					   in_connection);
+		/*
+		 * Tuple data must be sent before anything
+		 * that follows it, including rotation of the
+		 * output buffer.
+		 */
+		if (splice->wpos.obuf == obuf &&
+		    splice->wpos.svp.used == begin->used) {
+			*p_splice = splice;
+			return -1;
+		}
+	}
 	if (con->wend.obuf != obuf) {
 		/*
 		 * Flush the current buffer before
 		 * advancing to the next one.
 		 */
 		if (begin->used == obuf_end.used) {
+			iproto_connection_collect_flushed(con, true);
 			obuf = con->wpos.obuf = con->wend.obuf;
 			obuf_svp_reset(begin);
 		} else {
@@ -736,10 +1619,14 @@ iproto_flush(struct iproto_connection *con)
 	}
 	if (begin->used == end->used) {
 		/* Nothing to do. */
-		return 1;
+		return 0;
 	}
 	assert(begin->used < end->used);
-	struct iovec iov[SMALL_OBUF_IOV_MAX+1];
+	if (splice != NULL && splice->wpos.obuf == obuf &&
+	    splice->wpos.svp.used < end->used) {
+		/* Stop at the splice, it is written next. */
+		end = &splice->wpos.svp;
+	}
 	struct iovec *src = obuf->iov;
 	int iovcnt = end->pos - begin->pos + 1;
 	/*
@@ -750,14 +1637,26 @@ iproto_flush(struct iproto_connection *con)
 	sio_add_to_iov(iov, -begin->iov_len);
 	/* *Overwrite* iov_len of the last pos as it may be garbage. */
 	iov[iovcnt-1].iov_len = end->iov_len - begin->iov_len * (iovcnt == 1);
+	*end_svp = *end;
+	return iovcnt;
+}
 
-	ssize_t nwr = sio_writev(fd, iov, iovcnt);
-
+/**
+ * Advance the output position by @a nwr bytes written from
+ * @a iov. Return 0 if all output up to @a end is written,
+ * -1 otherwise.
+ */
+static int
+iproto_flush_advance(struct iproto_connection *con, struct iovec *iov,
+		     ssize_t nwr, const struct obuf_svp *end)
+{
+	struct obuf_svp *begin = &con->wpos.svp;
 	/* Count statistics */
-	rmean_collect(rmean_net, IPROTO_SENT, nwr);
+	rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
 	if (nwr > 0) {
 		if (begin->used + nwr == end->used) {
 			*begin = *end;
+			iproto_connection_collect_flushed(con, false);
 			return 0;
 		}
 		size_t offset = 0;
@@ -767,60 +1666,338 @@ iproto_flush(struct iproto_connection *con)
 		begin->iov_len = advance == 0 ? begin->iov_len + offset: offset;
 		begin->pos += advance;
 		assert(begin->pos <= end->pos);
+		iproto_connection_collect_flushed(con, false);
 	}
 	return -1;
 }
 
+/** writev() to the socket and handle the result. */
+
+static int
+iproto_flush(struct iproto_connection *con)
+{
+	struct iovec iov[SMALL_OBUF_IOV_MAX+1];
+	struct obuf_svp end;
+	struct iproto_splice *splice;
+	int iovcnt = iproto_flush_iov(con, iov, &end, &splice);
+	if (iovcnt == 0)
+		return 1;
+	if (iovcnt < 0)
+		return iproto_flush_splice(con, splice);
+
+	ssize_t nwr = sio_writev(con->output.fd, iov, iovcnt);
+
+	return iproto_flush_advance(con, iov, nwr, &end);
+}
+
+/**
+ * Resume input stopped because all input buffers were in use,
+ * now that output is flushed and the buffers may be recycled.
+ */
+static inline void
+iproto_connection_resume_input(struct iproto_connection *con)
+{
+	if (! ev_is_active(&con->input) &&
+	    rlist_empty(&con->in_stop_list)) {
+		ev_feed_event(con->loop, &con->input, EV_READ);
+	}
+}
+
+/** Write out as much output as the socket accepts. */
+static void
+iproto_connection_flush(struct iproto_connection *con)
+{
+	int rc;
+	while ((rc = iproto_flush(con)) <= 0) {
+		if (rc != 0) {
+			ev_io_start(con->loop, &con->output);
+			return;
+		}
+		iproto_connection_resume_input(con);
+	}
+	if (ev_is_active(&con->output))
+		ev_io_stop(con->loop, &con->output);
+}
+
 static void
 iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 			    int /* revents */)
 {
 	struct iproto_connection *con = (struct iproto_connection *) watcher->data;
 
+	if (iproto_thread_has_uring(con->iproto_thread)) {
+		/* Write in the next batch. */
+		ev_io_stop(loop, &con->output);
+		iproto_uring_schedule(con, IPROTO_URING_SEND);
+		return;
+	}
+
 	try {
-		int rc;
-		while ((rc = iproto_flush(con)) <= 0) {
-			if (rc != 0) {
-				ev_io_start(loop, &con->output);
-				return;
-			}
-			if (! ev_is_active(&con->input) &&
-			    rlist_empty(&con->in_stop_list)) {
-				ev_feed_event(loop, &con->input, EV_READ);
-			}
-		}
-		if (ev_is_active(&con->output))
-			ev_io_stop(con->loop, &con->output);
+		iproto_connection_flush(con);
 	} catch (Exception *e) {
 		e->log();
 		iproto_connection_close(con);
 	}
 }
 
+/* {{{ io_uring backend */
+
+/**
+ * Prepare a read of the connection input. Return the number
+ * of operations prepared.
+ */
+static int
+iproto_uring_prep_recv(struct iproto_connection *con,
+		       struct iproto_uring_op *op, uint64_t id)
+{
+	/* Ensure we have sufficient space for the next round.  */
+	struct ibuf *in = iproto_connection_input_buffer(con);
+	if (in == NULL) {
+		/* Input is resumed when output is flushed. */
+		return 0;
+	}
+	op->con = con;
+	op->type = IPROTO_URING_RECV;
+	op->ibuf = in;
+	op->iov[0].iov_base = in->wpos;
+	op->iov[0].iov_len = ibuf_unused(in);
+	memset(&op->msg, 0, sizeof(op->msg));
+	op->msg.msg_iov = op->iov;
+	op->msg.msg_iovlen = 1;
+	int rc = uring_prep_recvmsg(&con->iproto_thread->uring,
+				    con->input.fd, &op->msg, id);
+	assert(rc == 0);
+	(void) rc;
+	return 1;
+}
+
+/**
+ * Prepare a write of the connection output. Return the number
+ * of operations prepared.
+ */
+static int
+iproto_uring_prep_send(struct iproto_connection *con,
+		       struct iproto_uring_op *op, uint64_t id)
+{
+	struct iproto_splice *splice;
+	int iovcnt = iproto_flush_iov(con, op->iov, &op->end, &splice);
+	if (iovcnt == 0)
+		return 0;
+	if (iovcnt < 0) {
+		/*
+		 * Tuple data of splices and compressed replies
+		 * are big enough to be worth a system call of
+		 * their own.
+		 */
+		iproto_connection_flush(con);
+		return 0;
+	}
+	op->con = con;
+	op->type = IPROTO_URING_SEND;
+	memset(&op->msg, 0, sizeof(op->msg));
+	op->msg.msg_iov = op->iov;
+	op->msg.msg_iovlen = iovcnt;
+	int rc = uring_prep_sendmsg(&con->iproto_thread->uring,
+				    con->output.fd, &op->msg, id);
+	assert(rc == 0);
+	(void) rc;
+	return 1;
+}
+
+/** Handle the result of a completed operation. */
+static void
+iproto_uring_complete(struct iproto_uring_op *op)
+{
+	struct iproto_connection *con = op->con;
+	ssize_t n = op->res;
+	if (n < 0) {
+		errno = -n;
+		if (errno == EAGAIN || errno == EWOULDBLOCK ||
+		    errno == EINTR) {
+			n = -1;
+		} else if (op->type == IPROTO_URING_RECV &&
+			   errno == ECONNRESET) {
+			/* Same as EOF, see sio_read(). */
+			n = 0;
+		} else if (op->type == IPROTO_URING_RECV) {
+			tnt_raise(SocketError, con->input.fd, "recvmsg(%zu)",
+				  op->iov[0].iov_len);
+		} else {
+			tnt_raise(SocketError, con->output.fd, "sendmsg(%zu)",
+				  (size_t) op->msg.msg_iovlen);
+		}
+	}
+	if (op->type == IPROTO_URING_RECV) {
+		ev_io_start(con->loop, &con->input);
+		iproto_connection_on_read(con, op->ibuf, op->iov[0].iov_len, n);
+	} else if (iproto_flush_advance(con, op->iov, n, &op->end) == 0) {
+		/* Look for more output in the next batch. */
+		iproto_connection_resume_input(con);
+		iproto_uring_schedule(con, IPROTO_URING_SEND);
+	} else {
+		ev_io_start(con->loop, &con->output);
+	}
+}
+
+/**
+ * Submit socket operations scheduled by all connections of
+ * the thread at once and handle their results.
+ */
+static void
+iproto_uring_on_idle(ev_loop *loop, struct ev_idle *watcher,
+		     int /* revents */)
+{
+	struct iproto_thread *iproto_thread =
+		(struct iproto_thread *) watcher->data;
+	struct iproto_uring_op *ops = iproto_thread->uring_ops;
+	int count = 0;
+	while (! rlist_empty(&iproto_thread->uring_queue) &&
+	       count + 2 <= IPROTO_URING_BATCH) {
+		struct iproto_connection *con =
+			rlist_first_entry(&iproto_thread->uring_queue,
+					  struct iproto_connection,
+					  in_uring_queue);
+		unsigned types = con->uring_ops;
+		iproto_uring_cancel(con);
+		/*
+		 * Flush output before reading more input, so
+		 * that input buffers may be recycled.
+		 */
+		try {
+			if (types & IPROTO_URING_SEND) {
+				count += iproto_uring_prep_send(con,
+							&ops[count], count);
+			}
+		} catch (Exception *e) {
+			e->log();
+			iproto_connection_close(con);
+			continue;
+		}
+		try {
+			if (types & IPROTO_URING_RECV) {
+				count += iproto_uring_prep_recv(con,
+							&ops[count], count);
+			}
+		} catch (Exception *e) {
+			iproto_connection_on_input_error(con, e);
+		}
+	}
+	if (rlist_empty(&iproto_thread->uring_queue))
+		ev_idle_stop(loop, watcher);
+	if (count == 0)
+		return;
+	for (int i = 0; i < count; i++)
+		ops[i].res = -EAGAIN;
+	if (uring_submit(&iproto_thread->uring) != 0) {
+		/*
+		 * The operations which weren't submitted look
+		 * as if their sockets weren't ready, so the
+		 * connections wait for them and retry in a later
+		 * batch.
+		 */
+		diag_log();
+	}
+	uint64_t id;
+	int res;
+	while (uring_next(&iproto_thread->uring, &id, &res)) {
+		assert(id < (uint64_t) count);
+		ops[id].res = res;
+	}
+	for (int i = 0; i < count; i++) {
+		struct iproto_uring_op *op = &ops[i];
+		/* The connection may be closed by a previous op. */
+		if (! evio_has_fd(&op->con->input))
+			continue;
+		try {
+			iproto_uring_complete(op);
+		} catch (Exception *e) {
+			if (op->type == IPROTO_URING_RECV) {
+				iproto_connection_on_input_error(op->con, e);
+			} else {
+				e->log();
+				iproto_connection_close(op->con);
+			}
+		}
+	}
+}
+
+/**
+ * Set up the io_uring backend of a network thread. Leaves
+ * the thread with the evio backend if io_uring is not
+ * supported.
+ */
+static void
+iproto_thread_create_uring(struct iproto_thread *iproto_thread)
+{
+	if (uring_create(&iproto_thread->uring, IPROTO_URING_BATCH) != 0) {
+		if (iproto_thread->id == 0) {
+			say_warn("io_uring is not available, falling back "
+				 "to evio: %s",
+				 diag_last_error(diag_get())->errmsg);
+		}
+		return;
+	}
+	iproto_thread->uring_ops = (struct iproto_uring_op *)
+		calloc(IPROTO_URING_BATCH, sizeof(struct iproto_uring_op));
+	if (iproto_thread->uring_ops == NULL)
+		panic("failed to allocate io_uring operations");
+	ev_idle_init(&iproto_thread->uring_idle, iproto_uring_on_idle);
+	ev_set_priority(&iproto_thread->uring_idle, EV_MAXPRI);
+	iproto_thread->uring_idle.data = iproto_thread;
+}
+
+static void
+iproto_thread_destroy_uring(struct iproto_thread *iproto_thread)
+{
+	if (! iproto_thread_has_uring(iproto_thread))
+		return;
+	ev_idle_stop(loop(), &iproto_thread->uring_idle);
+	uring_destroy(&iproto_thread->uring);
+	free(iproto_thread->uring_ops);
+	iproto_thread->uring_ops = NULL;
+}
+
+/* }}} io_uring backend */
+
 static struct iproto_connection *
-iproto_connection_new(int fd)
+iproto_connection_new(struct iproto_thread *iproto_thread, int fd)
 {
 	struct iproto_connection *con = (struct iproto_connection *)
-		mempool_alloc_xc(&iproto_connection_pool);
+		mempool_alloc_xc(&iproto_thread->iproto_connection_pool);
 	con->input.data = con->output.data = con;
 	con->loop = loop();
+	con->iproto_thread = iproto_thread;
+	con->n_queued = 0;
+	con->queue = NULL;
 	ev_io_init(&con->input, iproto_connection_on_input, fd, EV_READ);
 	ev_io_init(&con->output, iproto_connection_on_output, fd, EV_WRITE);
-	ibuf_create(&con->ibuf[0], cord_slab_cache(), iproto_readahead);
-	ibuf_create(&con->ibuf[1], cord_slab_cache(), iproto_readahead);
-	obuf_create(&con->obuf[0], &net_slabc, iproto_readahead);
-	obuf_create(&con->obuf[1], &net_slabc, iproto_readahead);
+	con->readahead = IPROTO_READAHEAD_MIN;
+	con->is_input_full = false;
+	ibuf_create(&con->ibuf[0], &iproto_thread->ibuf_slabc,
+		    iproto_connection_readahead(con));
+	ibuf_create(&con->ibuf[1], &iproto_thread->ibuf_slabc,
+		    iproto_connection_readahead(con));
+	obuf_create(&con->obuf[0], &iproto_thread->net_slabc, iproto_readahead);
+	obuf_create(&con->obuf[1], &iproto_thread->net_slabc, iproto_readahead);
 	con->p_ibuf = &con->ibuf[0];
 	con->tx.p_obuf = &con->obuf[0];
+	rlist_create(&con->tx.cursors);
+	con->tx.cursor_count = 0;
+	con->tx.next_cursor_id = 1;
+	con->tx.compression = IPROTO_COMPRESSION_NONE;
 	iproto_wpos_create(&con->wpos, con->tx.p_obuf);
 	iproto_wpos_create(&con->wend, con->tx.p_obuf);
+	rlist_create(&con->splices);
+	stailq_create(&con->flush_marks);
 	con->parse_size = 0;
 	con->long_poll_requests = 0;
 	con->session = NULL;
 	rlist_create(&con->in_stop_list);
+	con->uring_ops = 0;
+	rlist_create(&con->in_uring_queue);
 	/* It may be very awkward to allocate at close. */
 	con->disconnect = iproto_msg_new(con);
-	cmsg_init(&con->disconnect->base, disconnect_route);
+	cmsg_init(&con->disconnect->base, iproto_thread->disconnect_route);
 	return con;
 }
 
@@ -844,7 +2021,7 @@ iproto_connection_delete(struct iproto_connection *con)
 	       con->obuf[1].iov[0].iov_base == NULL);
 	if (con->disconnect)
 		iproto_msg_delete(con->disconnect);
-	mempool_free(&iproto_connection_pool, con);
+	mempool_free(&con->iproto_thread->iproto_connection_pool, con);
 }
 
 /* }}} iproto_connection */
@@ -866,6 +2043,12 @@ tx_process_select(struct cmsg *msg);
 static void
 tx_process_sql(struct cmsg *msg);
 
+static void
+tx_process_cursor(struct cmsg *msg);
+
+static void
+tx_process_batch(struct cmsg *msg);
+
 static void
 tx_reply_error(struct iproto_msg *msg);
 
@@ -887,71 +2070,66 @@ net_end_join(struct cmsg *msg);
 static void
 net_end_subscribe(struct cmsg *msg);
 
-static const struct cmsg_hop misc_route[] = {
-	{ tx_process_misc, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop call_route[] = {
-	{ tx_process_call, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop select_route[] = {
-	{ tx_process_select, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop process1_route[] = {
-	{ tx_process1, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop sql_route[] = {
-	{ tx_process_sql, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX] = {
-	NULL,                                   /* IPROTO_OK */
-	select_route,                           /* IPROTO_SELECT */
-	process1_route,                         /* IPROTO_INSERT */
-	process1_route,                         /* IPROTO_REPLACE */
-	process1_route,                         /* IPROTO_UPDATE */
-	process1_route,                         /* IPROTO_DELETE */
-	call_route,                             /* IPROTO_CALL_16 */
-	misc_route,                             /* IPROTO_AUTH */
-	call_route,                             /* IPROTO_EVAL */
-	process1_route,                         /* IPROTO_UPSERT */
-	call_route,                             /* IPROTO_CALL */
-	sql_route,                              /* IPROTO_EXECUTE */
-	NULL,                                   /* IPROTO_NOP */
-};
-
-static const struct cmsg_hop join_route[] = {
-	{ tx_process_join_subscribe, &net_pipe },
-	{ net_end_join, NULL },
-};
-
-static const struct cmsg_hop subscribe_route[] = {
-	{ tx_process_join_subscribe, &net_pipe },
-	{ net_end_subscribe, NULL },
-};
-
-static const struct cmsg_hop error_route[] = {
-	{ tx_reply_iproto_error, &net_pipe },
-	{ net_send_error, NULL },
-};
+/**
+ * Decompress the body of a request sent compressed. The
+ * decompressed body is owned by the message and lives as long
+ * as the request input.
+ */
+static int
+iproto_msg_decompress(struct iproto_msg *msg)
+{
+	struct iproto_thread *iproto_thread = msg->connection->iproto_thread;
+	struct xrow_header *header = &msg->header;
+	const char *body = (const char *) header->body[0].iov_base;
+	const char *end = body + header->body[0].iov_len;
+	ssize_t size = xrow_decompressed_size(body, end);
+	if (size < 0)
+		return -1;
+	msg->body = (char *) malloc(size);
+	if (msg->body == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "msg->body");
+		return -1;
+	}
+	if (xrow_decompress_body(iproto_thread->zdctx, body, end,
+				 msg->body, size) != 0)
+		return -1;
+	header->body[0].iov_base = msg->body;
+	header->body[0].iov_len = size;
+	iproto_thread->compression_stat.requests++;
+	iproto_thread->compression_stat.saved += size - (end - body);
+	return 0;
+}
 
 static void
 iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input)
 {
+	struct iproto_thread *iproto_thread = msg->connection->iproto_thread;
 	uint8_t type;
 
 	if (xrow_header_decode(&msg->header, pos, reqend))
 		goto error;
 	assert(*pos == reqend);
+	if (msg->header.bodycnt > 0) {
+		const char *body = (const char *) msg->header.body[0].iov_base;
+		switch (msg->header.compression) {
+		case IPROTO_COMPRESSION_NONE:
+			if (mp_typeof(*body) != MP_MAP) {
+				diag_set(ClientError, ER_INVALID_MSGPACK,
+					 "packet body");
+				goto error;
+			}
+			break;
+		case IPROTO_COMPRESSION_ZSTD:
+			if (iproto_msg_decompress(msg) != 0)
+				goto error;
+			break;
+		default:
+			diag_set(ClientError, ER_ILLEGAL_PARAMS,
+				 "unknown compression algorithm");
+			goto error;
+		}
+	}
 
 	type = msg->header.type;
 
@@ -970,39 +2148,53 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		if (xrow_decode_dml(&msg->header, &msg->dml,
 				    dml_request_key_map(type)))
 			goto error;
-		assert(type < sizeof(dml_route)/sizeof(*dml_route));
-		cmsg_init(&msg->base, dml_route[type]);
+		assert(type < sizeof(iproto_thread->dml_route) /
+		       sizeof(*iproto_thread->dml_route));
+		cmsg_init(&msg->base, iproto_thread->dml_route[type]);
 		break;
 	case IPROTO_CALL_16:
 	case IPROTO_CALL:
 	case IPROTO_EVAL:
 		if (xrow_decode_call(&msg->header, &msg->call))
 			goto error;
-		cmsg_init(&msg->base, call_route);
+		cmsg_init(&msg->base, iproto_thread->call_route);
 		break;
 	case IPROTO_EXECUTE:
 		if (xrow_decode_sql(&msg->header, &msg->sql, &fiber()->gc))
 			goto error;
-		cmsg_init(&msg->base, sql_route);
+		cmsg_init(&msg->base, iproto_thread->sql_route);
+		break;
+	case IPROTO_CURSOR_OPEN:
+	case IPROTO_CURSOR_FETCH:
+	case IPROTO_CURSOR_CLOSE:
+		if (xrow_decode_cursor(&msg->header, &msg->cursor))
+			goto error;
+		cmsg_init(&msg->base, iproto_thread->cursor_route);
+		break;
+	case IPROTO_BATCH:
+		if (xrow_decode_batch(&msg->header, &msg->batch))
+			goto error;
+		cmsg_init(&msg->base, iproto_thread->batch_route);
 		break;
 	case IPROTO_PING:
-		cmsg_init(&msg->base, misc_route);
+	case IPROTO_COMPRESS:
+		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
 	case IPROTO_JOIN:
-		cmsg_init(&msg->base, join_route);
+		cmsg_init(&msg->base, iproto_thread->join_route);
 		*stop_input = true;
 		break;
 	case IPROTO_SUBSCRIBE:
-		cmsg_init(&msg->base, subscribe_route);
+		cmsg_init(&msg->base, iproto_thread->subscribe_route);
 		*stop_input = true;
 		break;
 	case IPROTO_REQUEST_VOTE:
-		cmsg_init(&msg->base, misc_route);
+		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
 	case IPROTO_AUTH:
 		if (xrow_decode_auth(&msg->header, &msg->auth))
 			goto error;
-		cmsg_init(&msg->base, misc_route);
+		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
 	default:
 		diag_set(ClientError, ER_UNKNOWN_REQUEST_TYPE,
@@ -1015,7 +2207,7 @@ error:
 	diag_log();
 	diag_create(&msg->diag);
 	diag_move(&fiber()->diag, &msg->diag);
-	cmsg_init(&msg->base, error_route);
+	cmsg_init(&msg->base, iproto_thread->error_route);
 }
 
 static void
@@ -1058,6 +2250,10 @@ tx_process_disconnect(struct cmsg *m)
 		session_destroy(con->session);
 		con->session = NULL; /* safety */
 	}
+	/* Close cursors left open by the client. */
+	struct iproto_cursor *cursor, *next;
+	rlist_foreach_entry_safe(cursor, &con->tx.cursors, in_connection, next)
+		iproto_cursor_delete(con, cursor);
 	/*
 	 * Got to be done in iproto thread since
 	 * that's where the memory is allocated.
@@ -1074,9 +2270,10 @@ static void
 net_finish_disconnect(struct cmsg *m)
 {
 	struct iproto_msg *msg = (struct iproto_msg *) m;
-	/* Runs the trigger, which may yield. */
-	iproto_connection_delete(msg->connection);
+	struct iproto_connection *con = msg->connection;
 	iproto_msg_delete(msg);
+	/* Runs the trigger, which may yield. */
+	iproto_connection_delete(con);
 }
 
 
@@ -1096,10 +2293,15 @@ net_discard_input(struct cmsg *m)
 {
 	struct iproto_msg *msg = container_of(m, struct iproto_msg,
 					      discard_input);
+	struct iproto_connection *con = msg->connection;
 	msg->p_ibuf->rpos += msg->len;
 	msg->len = 0;
-	msg->connection->long_poll_requests++;
-	iproto_resume();
+	con->long_poll_requests++;
+	/* Don't pin input buffers while waiting for the reply. */
+	if (evio_has_fd(&con->output) &&
+	    iproto_connection_input_is_drained(con))
+		iproto_connection_release_input(con);
+	iproto_resume(con->iproto_thread);
 }
 
 static void
@@ -1109,7 +2311,8 @@ tx_discard_input(struct iproto_msg *msg)
 		{ net_discard_input, NULL },
 	};
 	cmsg_init(&msg->discard_input, discard_input_route);
-	cpipe_push(&net_pipe, &msg->discard_input);
+	cpipe_push(&msg->connection->iproto_thread->net_pipe,
+		   &msg->discard_input);
 }
 
 /**
@@ -1129,6 +2332,9 @@ tx_accept_msg(struct cmsg *m)
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	struct iproto_connection *con = msg->connection;
 
+	msg->tx_start = clock_monotonic();
+	fiber_set_key(fiber(), FIBER_KEY_WAL_WAIT, &msg->wal_wait);
+
 	struct obuf *prev = &con->obuf[con->tx.p_obuf == con->obuf];
 	if (msg->wpos.obuf == con->tx.p_obuf) {
 		/*
@@ -1151,6 +2357,18 @@ tx_accept_msg(struct cmsg *m)
 	return msg;
 }
 
+/**
+ * Finish processing of a message in tx: let iproto know the
+ * reply ends at the current end of the output buffer @a out.
+ */
+static inline void
+tx_end_msg(struct iproto_msg *msg, struct obuf *out)
+{
+	iproto_wpos_create(&msg->wpos, out);
+	msg->tx_end = clock_monotonic();
+	fiber_set_key(fiber(), FIBER_KEY_WAL_WAIT, NULL);
+}
+
 /**
  * Write error message to the output buffer and advance
  * write position. Doesn't throw.
@@ -1161,7 +2379,7 @@ tx_reply_error(struct iproto_msg *msg)
 	struct obuf *out = msg->connection->tx.p_obuf;
 	iproto_reply_error(out, diag_last_error(&fiber()->diag),
 			   msg->header.sync, ::schema_version);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 }
 
 /**
@@ -1175,72 +2393,455 @@ tx_reply_iproto_error(struct cmsg *m)
 	struct obuf *out = msg->connection->tx.p_obuf;
 	iproto_reply_error(out, diag_last_error(&msg->diag),
 			   msg->header.sync, ::schema_version);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
+}
+
+/**
+ * Have the network thread compress the reply written to the
+ * output since @a svp if the client has enabled compression
+ * and the reply is large enough. Must be called right before
+ * tx_end_msg(), so that the reply ends at the message wpos.
+ */
+static void
+tx_compress_reply(struct iproto_msg *msg, struct obuf *out,
+		  struct obuf_svp *svp)
+{
+	if (msg->connection->tx.compression == IPROTO_COMPRESSION_NONE)
+		return;
+	if (obuf_size(out) - svp->used < iproto_compression_threshold)
+		return;
+	msg->compress_reply = true;
+	msg->reply_svp = *svp;
+}
+
+static void
+tx_process1(struct cmsg *m)
+{
+	struct iproto_msg *msg = tx_accept_msg(m);
+	struct obuf *out = msg->connection->tx.p_obuf;
+
+	tx_fiber_init(msg->connection->session, msg->header.sync);
+	if (tx_check_schema(msg->header.schema_version))
+		goto error;
+
+	struct tuple *tuple;
+	struct obuf_svp svp;
+	if (box_process1(&msg->dml, &tuple) ||
+	    iproto_prepare_select(out, &svp))
+		goto error;
+	if (tuple && tuple_to_obuf(tuple, out))
+		goto error;
+	iproto_reply_select(out, &svp, msg->header.sync, ::schema_version,
+			    tuple != 0);
+	tx_compress_reply(msg, out, &svp);
+	tx_end_msg(msg, out);
+	return;
+error:
+	tx_reply_error(msg);
+}
+
+/**
+ * Execute all statements of a BATCH request in one transaction,
+ * so that they are written to WAL with a single write. The batch
+ * is atomic: if any statement fails, the whole transaction is
+ * rolled back and the error of that statement is returned.
+ * Otherwise the reply contains one entry per statement: the
+ * result tuple or nil.
+ */
+static void
+tx_process_batch(struct cmsg *m)
+{
+	struct iproto_msg *msg = tx_accept_msg(m);
+	struct batch_request *batch = &msg->batch;
+	const char *pos = batch->requests;
+	struct tuple **result;
+	struct obuf *out;
+	struct obuf_svp svp;
+	uint32_t i, n_done = 0;
+
+	tx_fiber_init(msg->connection->session, msg->header.sync);
+	if (tx_check_schema(msg->header.schema_version))
+		goto error;
+	/*
+	 * Result tuples must survive commit, which frees the
+	 * fiber region, so they are kept referenced in a heap
+	 * array until the reply is encoded.
+	 */
+	result = (struct tuple **) calloc(batch->count + 1, sizeof(*result));
+	if (result == NULL) {
+		diag_set(OutOfMemory, (batch->count + 1) * sizeof(*result),
+			 "calloc", "result");
+		goto error;
+	}
+	if (box_txn_begin() != 0)
+		goto error_free;
+	for (; n_done < batch->count; n_done++) {
+		/*
+		 * The statement header is written to WAL as is,
+		 * so it must live as long as the transaction.
+		 */
+		struct xrow_header *row = (struct xrow_header *)
+			region_alloc(&fiber()->gc, sizeof(*row));
+		if (row == NULL) {
+			diag_set(OutOfMemory, sizeof(*row), "region_alloc",
+				 "row");
+			goto error_rollback;
+		}
+		struct request request;
+		struct tuple *tuple;
+		if (xrow_decode_batch_stmt(&pos, row, &request) != 0 ||
+		    box_process1(&request, &tuple) != 0)
+			goto error_rollback;
+		if (tuple != NULL && tuple_ref(tuple) != 0)
+			goto error_rollback;
+		result[n_done] = tuple;
+	}
+	assert(pos == batch->requests_end);
+	/* A single journal entry for all statements. */
+	if (box_txn_commit() != 0)
+		goto error_unref;
+
+	out = msg->connection->tx.p_obuf;
+	if (iproto_prepare_select(out, &svp) != 0)
+		goto error_unref;
+	for (i = 0; i < batch->count; i++) {
+		if (result[i] == NULL) {
+			if (obuf_dup(out, "\xc0", 1) != 1) {
+				diag_set(OutOfMemory, 1, "obuf_dup", "nil");
+				goto error_svp;
+			}
+		} else if (tuple_to_obuf(result[i], out) != 0) {
+			goto error_svp;
+		}
+	}
+	iproto_reply_select(out, &svp, msg->header.sync, ::schema_version,
+			    batch->count);
+	tx_compress_reply(msg, out, &svp);
+	tx_end_msg(msg, out);
+	for (i = 0; i < n_done; i++) {
+		if (result[i] != NULL)
+			tuple_unref(result[i]);
+	}
+	free(result);
+	return;
+error_svp:
+	obuf_rollback_to_svp(out, &svp);
+	goto error_unref;
+error_rollback:
+	box_txn_rollback();
+error_unref:
+	for (i = 0; i < n_done; i++) {
+		if (result[i] != NULL)
+			tuple_unref(result[i]);
+	}
+error_free:
+	free(result);
+error:
+	tx_reply_error(msg);
+}
+
+/** Size of tuple data of a SELECT result set. */
+static size_t
+tx_select_bsize(struct port *base)
+{
+	struct port_tuple *port = port_tuple(base);
+	size_t size = 0;
+	for (struct port_tuple_entry *pe = port->first; pe != NULL;
+	     pe = pe->next)
+		size += pe->tuple->bsize;
+	return size;
+}
+
+/**
+ * Reference tuples of a SELECT result set to splice them into
+ * the output at the current position of @a out.
+ * On failure sets diag and returns NULL.
+ */
+static struct iproto_splice *
+iproto_splice_new(struct port *base, struct obuf *out)
+{
+	struct port_tuple *port = port_tuple(base);
+	size_t size = sizeof(struct iproto_splice) + port->size *
+		      (sizeof(struct iovec) + sizeof(struct tuple *));
+	struct iproto_splice *splice = (struct iproto_splice *) malloc(size);
+	if (splice == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "struct iproto_splice");
+		return NULL;
+	}
+	iproto_wpos_create(&splice->wpos, out);
+	splice->tuples = (struct tuple **) (splice->iov + port->size);
+	splice->size = 0;
+	splice->iov_pos = 0;
+	splice->count = 0;
+	for (struct port_tuple_entry *pe = port->first; pe != NULL;
+	     pe = pe->next) {
+		if (tuple_ref(pe->tuple) != 0) {
+			iproto_splice_delete(splice);
+			return NULL;
+		}
+		uint32_t bsize;
+		const char *data = tuple_data_range(pe->tuple, &bsize);
+		splice->tuples[splice->count] = pe->tuple;
+		splice->iov[splice->count].iov_base = (void *) data;
+		splice->iov[splice->count].iov_len = bsize;
+		splice->size += bsize;
+		splice->count++;
+	}
+	return splice;
+}
+
+/** Release tuples of a splice and free it. */
+static void
+iproto_splice_delete(struct iproto_splice *splice)
+{
+	for (int i = 0; i < splice->count; i++)
+		tuple_unref(splice->tuples[i]);
+	free(splice);
+}
+
+/** Free a splice sent back by the net thread. */
+static void
+tx_splice_release(struct cmsg *m)
+{
+	iproto_splice_delete((struct iproto_splice *) m);
+}
+
+/**
+ * Write a SELECT reply with tuples of @a port to the output
+ * buffer and destroy the port. Doesn't throw.
+ * On failure sets diag and returns -1.
+ */
+static int
+tx_reply_select(struct iproto_msg *msg, struct port *port)
+{
+	struct obuf *out = msg->connection->tx.p_obuf;
+	struct obuf_svp svp;
+	int count;
+	if (iproto_prepare_select(out, &svp) != 0) {
+		port_destroy(port);
+		return -1;
+	}
+	if (msg->connection->tx.compression == IPROTO_COMPRESSION_NONE &&
+	    tx_select_bsize(port) >= IPROTO_SPLICE_MIN) {
+		/*
+		 * Send the tuples without copying them. Not used
+		 * with compression, which needs the whole reply
+		 * in the output buffer.
+		 */
+		msg->splice = iproto_splice_new(port, out);
+		count = msg->splice != NULL ? msg->splice->count : -1;
+	} else {
+		/*
+		 * SELECT output format has not changed since
+		 * Tarantool 1.6
+		 */
+		count = port_dump_16(port, out);
+	}
+	port_destroy(port);
+	if (count < 0) {
+		/* Discard the prepared select. */
+		obuf_rollback_to_svp(out, &svp);
+		return -1;
+	}
+	iproto_reply_select_spliced(out, &svp, msg->header.sync,
+				    ::schema_version, count,
+				    msg->splice != NULL ? msg->splice->size : 0);
+	tx_compress_reply(msg, out, &svp);
+	tx_end_msg(msg, out);
+	return 0;
 }
 
 static void
-tx_process1(struct cmsg *m)
+tx_process_select(struct cmsg *m)
 {
 	struct iproto_msg *msg = tx_accept_msg(m);
-	struct obuf *out = msg->connection->tx.p_obuf;
+	struct port port;
+	int rc;
+	struct request *req = &msg->dml;
 
 	tx_fiber_init(msg->connection->session, msg->header.sync);
+
 	if (tx_check_schema(msg->header.schema_version))
 		goto error;
 
-	struct tuple *tuple;
-	struct obuf_svp svp;
-	if (box_process1(&msg->dml, &tuple) ||
-	    iproto_prepare_select(out, &svp))
+	rc = box_select(req->space_id, req->index_id,
+			req->iterator, req->offset, req->limit,
+			req->key, req->key_end, &port);
+	if (rc < 0)
 		goto error;
-	if (tuple && tuple_to_obuf(tuple, out))
+	if (tx_reply_select(msg, &port) != 0)
 		goto error;
-	iproto_reply_select(out, &svp, msg->header.sync, ::schema_version,
-			    tuple != 0);
-	iproto_wpos_create(&msg->wpos, out);
 	return;
 error:
 	tx_reply_error(msg);
 }
 
+static struct iproto_cursor *
+iproto_cursor_new(struct iproto_connection *con,
+		  const struct cursor_request *req)
+{
+	if (con->tx.cursor_count >= IPROTO_CURSOR_MAX) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 "too many open cursors");
+		return NULL;
+	}
+	struct space *space = space_cache_find(req->space_id);
+	if (space == NULL || access_check_space(space, PRIV_R) != 0)
+		return NULL;
+	struct iterator *it = box_index_iterator(req->space_id, req->index_id,
+						 req->iterator, req->key,
+						 req->key_end);
+	if (it == NULL)
+		return NULL;
+	struct tuple *tuple;
+	for (uint32_t i = 0; i < req->offset; i++) {
+		if (iterator_next(it, &tuple) != 0) {
+			iterator_delete(it);
+			return NULL;
+		}
+		if (tuple == NULL)
+			break;
+	}
+	struct iproto_cursor *cursor = (struct iproto_cursor *)
+		mempool_alloc(&iproto_cursor_pool);
+	if (cursor == NULL) {
+		iterator_delete(it);
+		diag_set(OutOfMemory, sizeof(*cursor), "mempool_alloc",
+			 "struct iproto_cursor");
+		return NULL;
+	}
+	cursor->id = con->tx.next_cursor_id++;
+	cursor->it = it;
+	cursor->is_busy = false;
+	rlist_add_tail_entry(&con->tx.cursors, cursor, in_connection);
+	con->tx.cursor_count++;
+	return cursor;
+}
+
 static void
-tx_process_select(struct cmsg *m)
+iproto_cursor_delete(struct iproto_connection *con,
+		     struct iproto_cursor *cursor)
+{
+	assert(!cursor->is_busy);
+	rlist_del_entry(cursor, in_connection);
+	con->tx.cursor_count--;
+	iterator_delete(cursor->it);
+	mempool_free(&iproto_cursor_pool, cursor);
+}
+
+static struct iproto_cursor *
+iproto_cursor_find(struct iproto_connection *con, uint64_t id)
+{
+	struct iproto_cursor *cursor;
+	rlist_foreach_entry(cursor, &con->tx.cursors, in_connection) {
+		if (cursor->id != id)
+			continue;
+		if (cursor->is_busy) {
+			diag_set(ClientError, ER_ILLEGAL_PARAMS,
+				 "cursor is in use by another request");
+			return NULL;
+		}
+		return cursor;
+	}
+	diag_set(ClientError, ER_ILLEGAL_PARAMS, "unknown cursor id");
+	return NULL;
+}
+
+/** Read up to @a limit tuples from a cursor to a port. */
+static int
+iproto_cursor_fetch(struct iproto_cursor *cursor, uint32_t limit,
+		    struct port *port)
+{
+	int rc = 0;
+	struct tuple *tuple;
+	port_tuple_create(port);
+	cursor->is_busy = true;
+	for (uint32_t found = 0; found < limit; found++) {
+		rc = iterator_next(cursor->it, &tuple);
+		if (rc != 0 || tuple == NULL)
+			break;
+		rc = port_tuple_add(port, tuple);
+		if (rc != 0)
+			break;
+	}
+	cursor->is_busy = false;
+	if (rc != 0) {
+		port_destroy(port);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * CURSOR_OPEN replies with [cursor id], CURSOR_FETCH with
+ * the next batch of tuples, an empty batch meaning the end
+ * of the result set, and CURSOR_CLOSE with an empty array.
+ */
+static void
+tx_process_cursor(struct cmsg *m)
 {
 	struct iproto_msg *msg = tx_accept_msg(m);
-	struct obuf *out = msg->connection->tx.p_obuf;
+	struct iproto_connection *con = msg->connection;
+	struct obuf *out = con->tx.p_obuf;
+	struct cursor_request *req = &msg->cursor;
+	struct iproto_cursor *cursor;
 	struct obuf_svp svp;
 	struct port port;
-	int count;
-	int rc;
-	struct request *req = &msg->dml;
 
-	tx_fiber_init(msg->connection->session, msg->header.sync);
+	tx_fiber_init(con->session, msg->header.sync);
 
 	if (tx_check_schema(msg->header.schema_version))
 		goto error;
 
-	rc = box_select(req->space_id, req->index_id,
-			req->iterator, req->offset, req->limit,
-			req->key, req->key_end, &port);
-	if (rc < 0)
-		goto error;
-	if (iproto_prepare_select(out, &svp) != 0) {
-		port_destroy(&port);
-		goto error;
+	switch (msg->header.type) {
+	case IPROTO_CURSOR_OPEN: {
+		cursor = iproto_cursor_new(con, req);
+		if (cursor == NULL)
+			goto error;
+		char *pos;
+		if (iproto_prepare_select(out, &svp) != 0 ||
+		    (pos = (char *) obuf_alloc(out,
+				mp_sizeof_uint(cursor->id))) == NULL) {
+			iproto_cursor_delete(con, cursor);
+			goto error;
+		}
+		mp_encode_uint(pos, cursor->id);
+		iproto_reply_select(out, &svp, msg->header.sync,
+				    ::schema_version, 1);
+		tx_end_msg(msg, out);
+		break;
 	}
-	/*
-	 * SELECT output format has not changed since Tarantool 1.6
-	 */
-	count = port_dump_16(&port, out);
-	port_destroy(&port);
-	if (count < 0) {
-		/* Discard the prepared select. */
-		obuf_rollback_to_svp(out, &svp);
-		goto error;
+	case IPROTO_CURSOR_FETCH:
+		cursor = iproto_cursor_find(con, req->cursor_id);
+		if (cursor == NULL)
+			goto error;
+		if (iproto_cursor_fetch(cursor, MIN(req->limit,
+						    IPROTO_CURSOR_FETCH_MAX),
+					&port) != 0 ||
+		    tx_reply_select(msg, &port) != 0) {
+			/*
+			 * The tuples taken from the iterator are
+			 * lost, so the cursor can't go on from
+			 * where the client expects it to.
+			 */
+			iproto_cursor_delete(con, cursor);
+			goto error;
+		}
+		break;
+	case IPROTO_CURSOR_CLOSE:
+		cursor = iproto_cursor_find(con, req->cursor_id);
+		if (cursor == NULL)
+			goto error;
+		iproto_cursor_delete(con, cursor);
+		if (iproto_prepare_select(out, &svp) != 0)
+			goto error;
+		iproto_reply_select(out, &svp, msg->header.sync,
+				    ::schema_version, 0);
+		tx_end_msg(msg, out);
+		break;
+	default:
+		unreachable();
 	}
-	iproto_reply_select(out, &svp, msg->header.sync,
-			    ::schema_version, count);
-	iproto_wpos_create(&msg->wpos, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1332,7 +2933,8 @@ tx_process_call(struct cmsg *m)
 
 	iproto_reply_select(out, &svp, msg->header.sync,
 			    ::schema_version, count);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_compress_reply(msg, out, &svp);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1360,6 +2962,16 @@ tx_process_misc(struct cmsg *m)
 			iproto_reply_ok_xc(out, msg->header.sync,
 					   ::schema_version);
 			break;
+		case IPROTO_COMPRESS: {
+			uint32_t compression;
+			if (xrow_decode_compress(&msg->header,
+						 &compression) != 0)
+				diag_raise();
+			msg->connection->tx.compression = compression;
+			iproto_reply_ok_xc(out, msg->header.sync,
+					   ::schema_version);
+			break;
+		}
 		case IPROTO_REQUEST_VOTE:
 			iproto_reply_vclock_xc(out, msg->header.sync,
 					       ::schema_version,
@@ -1368,7 +2980,7 @@ tx_process_misc(struct cmsg *m)
 		default:
 			unreachable();
 		}
-		iproto_wpos_create(&msg->wpos, out);
+		tx_end_msg(msg, out);
 	} catch (Exception *e) {
 		tx_reply_error(msg);
 	}
@@ -1390,7 +3002,7 @@ tx_process_sql(struct cmsg *m)
 	assert(msg->header.type == IPROTO_EXECUTE);
 	if (sql_prepare_and_execute(&msg->sql, out, &fiber()->gc) != 0)
 		goto error;
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1401,6 +3013,8 @@ tx_process_join_subscribe(struct cmsg *m)
 {
 	struct iproto_msg *msg = tx_accept_msg(m);
 	struct iproto_connection *con = msg->connection;
+	/* Replication requests are long-lived and not timed. */
+	fiber_set_key(fiber(), FIBER_KEY_WAL_WAIT, NULL);
 
 	tx_fiber_init(con->session, msg->header.sync);
 
@@ -1434,6 +3048,87 @@ tx_process_join_subscribe(struct cmsg *m)
 	}
 }
 
+/**
+ * Compress the reply of @a msg, see tx_compress_reply(). The
+ * compressed reply is written to the socket in place of the
+ * reply in the output buffer, which the tx thread may go on
+ * appending to meanwhile, so it is kept in a splice. The reply
+ * is sent as is if compression doesn't pay off or fails.
+ */
+static void
+iproto_msg_compress_reply(struct iproto_msg *msg)
+{
+	struct iproto_connection *con = msg->connection;
+	struct iproto_thread *iproto_thread = con->iproto_thread;
+	struct obuf *out = msg->wpos.obuf;
+	const struct obuf_svp *begin = &msg->reply_svp;
+	const struct obuf_svp *end = &msg->wpos.svp;
+	size_t size = end->used - begin->used;
+	size_t zsize_max = xrow_compress_bound(size);
+	size_t splice_size = sizeof(struct iproto_splice) +
+			     sizeof(struct iovec) + zsize_max;
+	struct iproto_splice *splice =
+		(struct iproto_splice *) malloc(splice_size);
+	if (splice == NULL) {
+		diag_set(OutOfMemory, splice_size, "malloc",
+			 "struct iproto_splice");
+		diag_log();
+		return;
+	}
+	char *zpacket = (char *) (splice->iov + 1);
+	char *copy = NULL;
+	const char *packet = (char *) out->iov[begin->pos].iov_base +
+			     begin->iov_len;
+	if (begin->pos != end->pos) {
+		/* The reply spans several obuf chunks. */
+		copy = (char *) malloc(size);
+		if (copy == NULL) {
+			diag_set(OutOfMemory, size, "malloc", "reply");
+			diag_log();
+			free(splice);
+			return;
+		}
+		char *pos = copy;
+		size_t offset = begin->iov_len;
+		for (int i = begin->pos; i <= end->pos; i++) {
+			/*
+			 * iov_len of the last position may be
+			 * changed by the tx thread concurrently.
+			 */
+			size_t len = (i == end->pos ? end->iov_len :
+				      out->iov[i].iov_len) - offset;
+			memcpy(pos, (char *) out->iov[i].iov_base + offset,
+			       len);
+			pos += len;
+			offset = 0;
+		}
+		assert(pos == copy + size);
+		packet = copy;
+	}
+	ssize_t zsize = xrow_compress_packet(iproto_thread->zcctx, packet,
+					     size, zpacket,
+					     IPROTO_COMPRESSION_LEVEL);
+	free(copy);
+	if (zsize < 0)
+		diag_log();
+	if (zsize <= 0) {
+		free(splice);
+		return;
+	}
+	splice->wpos.obuf = out;
+	splice->wpos.svp = *begin;
+	splice->end = *end;
+	splice->tuples = NULL;
+	splice->size = zsize;
+	splice->iov_pos = 0;
+	splice->count = 1;
+	splice->iov[0].iov_base = zpacket;
+	splice->iov[0].iov_len = zsize;
+	rlist_add_tail_entry(&con->splices, splice, in_connection);
+	iproto_thread->compression_stat.replies++;
+	iproto_thread->compression_stat.saved += size - zsize;
+}
+
 static void
 net_send_msg(struct cmsg *m)
 {
@@ -1448,9 +3143,17 @@ net_send_msg(struct cmsg *m)
 		assert(con->long_poll_requests > 0);
 		con->long_poll_requests--;
 	}
+	if (msg->splice != NULL)
+		rlist_add_tail_entry(&con->splices, msg->splice, in_connection);
+	if (msg->compress_reply)
+		iproto_msg_compress_reply(msg);
 	con->wend = msg->wpos;
+	iproto_msg_collect_latency(msg);
 
 	if (evio_has_fd(&con->output)) {
+		/* Don't pin input buffers while there is no input. */
+		if (iproto_connection_input_is_drained(con))
+			iproto_connection_release_input(con);
 		if (! ev_is_active(&con->output))
 			ev_feed_event(con->loop, &con->output, EV_WRITE);
 	} else if (iproto_connection_is_idle(con)) {
@@ -1478,15 +3181,19 @@ net_end_join(struct cmsg *m)
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	struct iproto_connection *con = msg->connection;
 
-	msg->p_ibuf->rpos += msg->len;
+	struct ibuf *in = msg->p_ibuf;
+	in->rpos += msg->len;
 	iproto_msg_delete(msg);
 
 	assert(! ev_is_active(&con->input));
+	/* Don't pin input buffers while there is no input. */
+	if (iproto_connection_input_is_drained(con))
+		iproto_connection_release_input(con);
 	/*
 	 * Enqueue any messages if they are in the readahead
 	 * queue. Will simply start input otherwise.
 	 */
-	iproto_enqueue_batch(con, msg->p_ibuf);
+	iproto_enqueue_batch(con, in);
 }
 
 static void
@@ -1552,7 +3259,8 @@ net_send_greeting(struct cmsg *m)
 						 obuf_iovcnt(out));
 
 			/* Count statistics */
-			rmean_collect(rmean_net, IPROTO_SENT, nwr);
+			rmean_collect(con->iproto_thread->rmean,
+				      IPROTO_SENT, nwr);
 		} catch (Exception *e) {
 			e->log();
 		}
@@ -1573,98 +3281,213 @@ net_send_greeting(struct cmsg *m)
 	iproto_msg_delete(msg);
 }
 
-static const struct cmsg_hop connect_route[] = {
-	{ tx_process_connect, &net_pipe },
-	{ net_send_greeting, NULL },
-};
-
 /** }}} */
 
 /**
  * Create a connection and start input.
  */
 static void
-iproto_on_accept(struct evio_service * /* service */, int fd,
+iproto_on_accept(struct evio_service *service, int fd,
 		 struct sockaddr *addr, socklen_t addrlen)
 {
 	(void) addr;
 	(void) addrlen;
+	struct iproto_thread *iproto_thread =
+		(struct iproto_thread *) service->on_accept_param;
 	struct iproto_connection *con;
 
-	con = iproto_connection_new(fd);
+	con = iproto_connection_new(iproto_thread, fd);
 	/*
 	 * Ignore msg allocation failure - the queue size is
 	 * fixed so there is a limited number of msgs in
 	 * use, all stored in just a few blocks of the memory pool.
 	 */
 	struct iproto_msg *msg = iproto_msg_new(con);
-	cmsg_init(&msg->base, connect_route);
+	cmsg_init(&msg->base, iproto_thread->connect_route);
 	msg->p_ibuf = con->p_ibuf;
 	msg->wpos = con->wpos;
 	msg->close_connection = false;
-	cpipe_push(&tx_pipe, &msg->base);
+	cpipe_push(&iproto_thread->tx_pipe, &msg->base);
 }
 
-static struct evio_service binary; /* iproto binary listener */
-
 /**
  * The network io thread main function:
  * begin serving the message bus.
  */
 static int
-net_cord_f(va_list /* ap */)
+net_cord_f(va_list ap)
 {
-	mempool_create(&iproto_msg_pool, &cord()->slabc,
+	struct iproto_thread *iproto_thread =
+		va_arg(ap, struct iproto_thread *);
+
+	mempool_create(&iproto_thread->iproto_msg_pool, &cord()->slabc,
 		       sizeof(struct iproto_msg));
-	mempool_create(&iproto_connection_pool, &cord()->slabc,
+	mempool_create(&iproto_thread->iproto_flush_mark_pool, &cord()->slabc,
+		       sizeof(struct iproto_flush_mark));
+	mempool_create(&iproto_thread->iproto_connection_pool, &cord()->slabc,
 		       sizeof(struct iproto_connection));
 
-	evio_service_init(loop(), &binary, "binary",
-			  iproto_on_accept, NULL);
+	slab_cache_create(&iproto_thread->ibuf_slabc, &runtime);
+	if (iproto_io_backend == IPROTO_IO_URING)
+		iproto_thread_create_uring(iproto_thread);
+	evio_service_init(loop(), &iproto_thread->binary, "binary",
+			  iproto_on_accept, iproto_thread);
+
 
+	iproto_thread->zdctx = ZSTD_createDCtx();
+	if (iproto_thread->zdctx == NULL)
+		panic("failed to create zstd decompression context");
+	iproto_thread->zcctx = ZSTD_createCCtx();
+	if (iproto_thread->zcctx == NULL)
+		panic("failed to create zstd compression context");
 
 	/* Init statistics counter */
-	rmean_net = rmean_new(rmean_net_strings, IPROTO_LAST);
+	iproto_thread->rmean = rmean_new(rmean_net_strings, IPROTO_LAST);
 
-	if (rmean_net == NULL) {
+	if (iproto_thread->rmean == NULL) {
 		tnt_raise(OutOfMemory, sizeof(struct rmean),
 			  "rmean", "struct rmean");
 	}
 
 	struct cbus_endpoint endpoint;
 	/* Create "net" endpoint. */
-	cbus_endpoint_create(&endpoint, "net", fiber_schedule_cb, fiber());
+	cbus_endpoint_create(&endpoint, cord_name(cord()),
+			     fiber_schedule_cb, fiber());
 	/* Create a pipe to "tx" thread. */
-	cpipe_create(&tx_pipe, "tx");
-	cpipe_set_max_input(&tx_pipe, IPROTO_MSG_MAX/2);
+	cpipe_create(&iproto_thread->tx_pipe, "tx");
+	cpipe_set_max_input(&iproto_thread->tx_pipe, IPROTO_MSG_MAX/2);
 	/* Process incomming messages. */
 	cbus_loop(&endpoint);
 
-	cpipe_destroy(&tx_pipe);
+	cpipe_destroy(&iproto_thread->tx_pipe);
 	/*
 	 * Nothing to do in the fiber so far, the service
 	 * will take care of creating events for incoming
 	 * connections.
 	 */
-	if (evio_service_is_active(&binary))
-		evio_service_stop(&binary);
+	if (evio_service_is_active(&iproto_thread->binary))
+		evio_service_stop(&iproto_thread->binary);
 
-	rmean_delete(rmean_net);
+	rmean_delete(iproto_thread->rmean);
+	ZSTD_freeDCtx(iproto_thread->zdctx);
+	ZSTD_freeCCtx(iproto_thread->zcctx);
+	iproto_thread_destroy_uring(iproto_thread);
 	return 0;
 }
 
-/** Initialize the iproto subsystem and start network io thread */
+/**
+ * Bind message routes of a network thread to its net_pipe.
+ */
+static void
+iproto_thread_init_routes(struct iproto_thread *iproto_thread)
+{
+	struct cpipe *net_pipe = &iproto_thread->net_pipe;
+
+	iproto_thread->disconnect_route[0] =
+		{ tx_process_disconnect, net_pipe };
+	iproto_thread->disconnect_route[1] =
+		{ net_finish_disconnect, NULL };
+	iproto_thread->misc_route[0] = { tx_process_misc, net_pipe };
+	iproto_thread->misc_route[1] = { net_send_msg, NULL };
+	iproto_thread->call_route[0] = { tx_process_call, net_pipe };
+	iproto_thread->call_route[1] = { net_send_msg, NULL };
+	iproto_thread->select_route[0] = { tx_process_select, net_pipe };
+	iproto_thread->select_route[1] = { net_send_msg, NULL };
+	iproto_thread->process1_route[0] = { tx_process1, net_pipe };
+	iproto_thread->process1_route[1] = { net_send_msg, NULL };
+	iproto_thread->sql_route[0] = { tx_process_sql, net_pipe };
+	iproto_thread->sql_route[1] = { net_send_msg, NULL };
+	iproto_thread->cursor_route[0] = { tx_process_cursor, net_pipe };
+	iproto_thread->cursor_route[1] = { net_send_msg, NULL };
+	iproto_thread->batch_route[0] = { tx_process_batch, net_pipe };
+	iproto_thread->batch_route[1] = { net_send_msg, NULL };
+	iproto_thread->join_route[0] =
+		{ tx_process_join_subscribe, net_pipe };
+	iproto_thread->join_route[1] = { net_end_join, NULL };
+	iproto_thread->subscribe_route[0] =
+		{ tx_process_join_subscribe, net_pipe };
+	iproto_thread->subscribe_route[1] = { net_end_subscribe, NULL };
+	iproto_thread->error_route[0] = { tx_reply_iproto_error, net_pipe };
+	iproto_thread->error_route[1] = { net_send_error, NULL };
+	iproto_thread->connect_route[0] = { tx_process_connect, net_pipe };
+	iproto_thread->connect_route[1] = { net_send_greeting, NULL };
+
+	const struct cmsg_hop **dml_route = iproto_thread->dml_route;
+	memset(dml_route, 0, sizeof(iproto_thread->dml_route));
+	dml_route[IPROTO_SELECT] = iproto_thread->select_route;
+	dml_route[IPROTO_INSERT] = iproto_thread->process1_route;
+	dml_route[IPROTO_REPLACE] = iproto_thread->process1_route;
+	dml_route[IPROTO_UPDATE] = iproto_thread->process1_route;
+	dml_route[IPROTO_DELETE] = iproto_thread->process1_route;
+	dml_route[IPROTO_CALL_16] = iproto_thread->call_route;
+	dml_route[IPROTO_AUTH] = iproto_thread->misc_route;
+	dml_route[IPROTO_EVAL] = iproto_thread->call_route;
+	dml_route[IPROTO_UPSERT] = iproto_thread->process1_route;
+	dml_route[IPROTO_CALL] = iproto_thread->call_route;
+	dml_route[IPROTO_EXECUTE] = iproto_thread->sql_route;
+}
+
+/** Initialize the iproto subsystem and start network io threads */
 void
-iproto_init()
+iproto_init(int threads_count, enum iproto_io_backend io_backend)
 {
-	slab_cache_create(&net_slabc, &runtime);
+	assert(threads_count > 0);
+	iproto_threads = (struct iproto_thread *)
+		calloc(threads_count, sizeof(*iproto_threads));
+	if (iproto_threads == NULL)
+		panic("failed to allocate iproto threads");
+	iproto_threads_count = threads_count;
+	iproto_io_backend = io_backend;
+	assert(threads_count <= IPROTO_THREADS_MAX);
+	iproto_thread_msg_max = IPROTO_MSG_MAX / threads_count;
+	mempool_create(&iproto_cursor_pool, &cord()->slabc,
+		       sizeof(struct iproto_cursor));
+	int64_t *bucket = iproto_latency_buckets;
+	for (int64_t decade = 1; decade < 10000000; decade *= 10) {
+		for (int64_t i = 1; i < 10; i++)
+			*bucket++ = i * decade;
+	}
+	*bucket++ = 10000000;
+	assert(bucket == iproto_latency_buckets +
+	       lengthof(iproto_latency_buckets));
+
+	for (int i = 0; i < threads_count; i++) {
+		struct iproto_thread *iproto_thread = &iproto_threads[i];
+		char name[FIBER_NAME_MAX];
+
+		iproto_thread->id = i;
+		rlist_create(&iproto_thread->stopped_connections);
+		iproto_thread->uring.fd = -1;
+		rlist_create(&iproto_thread->uring_queue);
+		for (int c = 0; c < iproto_class_MAX; c++) {
+			struct iproto_queue *queue = &iproto_thread->queues[c];
+			stailq_create(&queue->msgs);
+			queue->limit = MAX(iproto_thread_msg_max *
+					   iproto_class_limit[c] / 100, 1);
+		}
+		slab_cache_create(&iproto_thread->net_slabc, &runtime);
+		for (int t = 0; t < iproto_latency_type_MAX; t++) {
+			for (int s = 0; s < iproto_latency_stage_MAX; s++) {
+				struct histogram *hist = histogram_new(
+					iproto_latency_buckets,
+					lengthof(iproto_latency_buckets));
+				if (hist == NULL)
+					panic("failed to allocate histogram");
+				iproto_thread->latency[t][s] = hist;
+			}
+		}
+		iproto_thread_init_routes(iproto_thread);
 
-	if (cord_costart(&net_cord, "iproto", net_cord_f, NULL))
-		panic("failed to initialize iproto thread");
+		snprintf(name, sizeof(name), "iproto.%d", i);
+		if (cord_costart(&iproto_thread->net_cord, name,
+				 net_cord_f, iproto_thread))
+			panic("failed to initialize iproto thread");
 
-	/* Create a pipe to "net" thread. */
-	cpipe_create(&net_pipe, "net");
-	cpipe_set_max_input(&net_pipe, IPROTO_MSG_MAX/2);
+		/* Create a pipe to "net" thread. */
+		cpipe_create(&iproto_thread->net_pipe, name);
+		cpipe_set_max_input(&iproto_thread->net_pipe,
+				    IPROTO_MSG_MAX/2);
+	}
 }
 
 /**
@@ -1675,18 +3498,46 @@ iproto_init()
  */
 struct iproto_bind_msg: public cbus_call_msg
 {
+	struct iproto_thread *iproto_thread;
 	const char *uri;
+	bool reuseport;
 };
 
+static int
+iproto_do_stop(struct cbus_call_msg *m)
+{
+	struct iproto_thread *iproto_thread =
+		((struct iproto_bind_msg *) m)->iproto_thread;
+	if (evio_service_is_active(&iproto_thread->binary))
+		evio_service_stop(&iproto_thread->binary);
+	return 0;
+}
+
 static int
 iproto_do_bind(struct cbus_call_msg *m)
 {
+	struct iproto_thread *iproto_thread =
+		((struct iproto_bind_msg *) m)->iproto_thread;
 	const char *uri  = ((struct iproto_bind_msg *) m)->uri;
 	try {
-		if (evio_service_is_active(&binary))
-			evio_service_stop(&binary);
-		if (uri != NULL)
-			evio_service_bind(&binary, uri);
+		if (iproto_thread->id == 0) {
+			iproto_thread->binary.reuseport =
+				((struct iproto_bind_msg *) m)->reuseport;
+			evio_service_bind(&iproto_thread->binary, uri);
+		} else {
+			/*
+			 * The rest of the threads share the socket
+			 * bound by the first thread, the kernel
+			 * hands an accepted connection over to
+			 * a thread which happens to be the first
+			 * one to call accept(). With SO_REUSEPORT
+			 * each thread gets a socket of its own,
+			 * and the kernel balances connections
+			 * between them evenly.
+			 */
+			evio_service_attach(&iproto_thread->binary,
+					    &iproto_threads[0].binary);
+		}
 	} catch (Exception *e) {
 		return -1;
 	}
@@ -1696,44 +3547,288 @@ iproto_do_bind(struct cbus_call_msg *m)
 static int
 iproto_do_listen(struct cbus_call_msg *m)
 {
-	(void) m;
+	struct iproto_thread *iproto_thread =
+		((struct iproto_bind_msg *) m)->iproto_thread;
 	try {
-		if (evio_service_is_active(&binary))
-			evio_service_listen(&binary);
+		if (evio_service_is_active(&iproto_thread->binary))
+			evio_service_listen(&iproto_thread->binary);
 	} catch (Exception *e) {
 		return -1;
 	}
 	return 0;
 }
 
-void
-iproto_bind(const char *uri)
+/**
+ * Run a function in every network thread, starting from
+ * the first one.
+ */
+static void
+iproto_send_to_all(cbus_call_f func, const char *uri, bool reuseport)
 {
+	/* Declare static to avoid stack corruption on fiber cancel. */
 	static struct iproto_bind_msg m;
-	m.uri = uri;
-	if (cbus_call(&net_pipe, &tx_pipe, &m, iproto_do_bind,
-		      NULL, TIMEOUT_INFINITY))
-		diag_raise();
+	for (int i = 0; i < iproto_threads_count; i++) {
+		struct iproto_thread *iproto_thread = &iproto_threads[i];
+		m.iproto_thread = iproto_thread;
+		m.uri = uri;
+		m.reuseport = reuseport;
+		if (cbus_call(&iproto_thread->net_pipe,
+			      &iproto_thread->tx_pipe, &m, func,
+			      NULL, TIMEOUT_INFINITY))
+			diag_raise();
+	}
+}
+
+void
+iproto_bind(const char *uri, bool reuseport)
+{
+	/*
+	 * Stop all threads before binding: stopping a service
+	 * listening on a UNIX socket removes the socket file.
+	 */
+	iproto_send_to_all(iproto_do_stop, NULL, false);
+	if (uri != NULL)
+		iproto_send_to_all(iproto_do_bind, uri, reuseport);
 }
 
 void
 iproto_listen()
 {
-	/* Declare static to avoid stack corruption on fiber cancel. */
-	static struct cbus_call_msg m;
-	if (cbus_call(&net_pipe, &tx_pipe, &m, iproto_do_listen,
-		      NULL, TIMEOUT_INFINITY))
-		diag_raise();
+	iproto_send_to_all(iproto_do_listen, NULL, false);
 }
 
 size_t
 iproto_mem_used(void)
 {
-	return slab_cache_used(&net_cord.slabc) + slab_cache_used(&net_slabc);
+	size_t mem = 0;
+	for (int i = 0; i < iproto_threads_count; i++) {
+		struct iproto_thread *iproto_thread = &iproto_threads[i];
+		mem += slab_cache_used(&iproto_thread->net_cord.slabc) +
+		       slab_cache_used(&iproto_thread->ibuf_slabc) +
+		       slab_cache_used(&iproto_thread->net_slabc);
+	}
+	return mem;
+}
+
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx)
+{
+	for (int name = 0; name < IPROTO_LAST; name++) {
+		int64_t mean = 0;
+		int64_t total = 0;
+		for (int i = 0; i < iproto_threads_count; i++) {
+			struct rmean *rmean = iproto_threads[i].rmean;
+			mean += rmean_mean(rmean, name);
+			total += rmean_total(rmean, name);
+		}
+		int rc = cb(rmean_net_strings[name], mean, total, cb_ctx);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
+
+/**
+ * A message to a network thread to add up its statistics to
+ * the ones of the message or to reset them. The statistics of
+ * a thread are only accessed in the thread: the queue counters
+ * drive its dispatching.
+ */
+struct iproto_stat_msg: public cbus_call_msg
+{
+	struct iproto_thread *iproto_thread;
+	/** Latency histograms, NULL unless requested. */
+	struct histogram *latency[iproto_latency_type_MAX]
+				 [iproto_latency_stage_MAX];
+	struct iproto_queue_stat queues[iproto_class_MAX];
+	struct iproto_compression_stat compression;
+};
+
+static int
+iproto_stat_msg_delete(struct cbus_call_msg *m)
+{
+	struct iproto_stat_msg *msg = (struct iproto_stat_msg *) m;
+	for (int t = 0; t < iproto_latency_type_MAX; t++) {
+		for (int s = 0; s < iproto_latency_stage_MAX; s++) {
+			if (msg->latency[t][s] != NULL)
+				histogram_delete(msg->latency[t][s]);
+		}
+	}
+	free(msg);
+	return 0;
+}
+
+/**
+ * Allocate a statistics message, with empty latency
+ * histograms if @a with_histograms is set.
+ */
+static struct iproto_stat_msg *
+iproto_stat_msg_new(bool with_histograms)
+{
+	struct iproto_stat_msg *msg =
+		(struct iproto_stat_msg *) calloc(1, sizeof(*msg));
+	if (msg == NULL) {
+		diag_set(OutOfMemory, sizeof(*msg), "calloc",
+			 "iproto_stat_msg");
+		return NULL;
+	}
+	if (! with_histograms)
+		return msg;
+	for (int t = 0; t < iproto_latency_type_MAX; t++) {
+		for (int s = 0; s < iproto_latency_stage_MAX; s++) {
+			struct histogram *hist = histogram_new(
+				iproto_latency_buckets,
+				lengthof(iproto_latency_buckets));
+			if (hist == NULL) {
+				diag_set(OutOfMemory, sizeof(*hist),
+					 "malloc", "histogram");
+				iproto_stat_msg_delete(msg);
+				return NULL;
+			}
+			msg->latency[t][s] = hist;
+		}
+	}
+	return msg;
+}
+
+static int
+iproto_do_merge_stat(struct cbus_call_msg *m)
+{
+	struct iproto_stat_msg *msg = (struct iproto_stat_msg *) m;
+	struct iproto_thread *iproto_thread = msg->iproto_thread;
+	for (int t = 0; t < iproto_latency_type_MAX; t++) {
+		for (int s = 0; s < iproto_latency_stage_MAX; s++) {
+			if (msg->latency[t][s] == NULL)
+				continue;
+			histogram_add(msg->latency[t][s],
+				      iproto_thread->latency[t][s]);
+		}
+	}
+	for (int c = 0; c < iproto_class_MAX; c++) {
+		struct iproto_queue *queue = &iproto_thread->queues[c];
+		struct iproto_queue_stat *stat = &msg->queues[c];
+		stat->depth += queue->depth;
+		stat->in_flight += queue->in_flight;
+		stat->total += queue->total;
+		stat->wait_time += queue->wait_time;
+	}
+	msg->compression.requests += iproto_thread->compression_stat.requests;
+	msg->compression.replies += iproto_thread->compression_stat.replies;
+	msg->compression.saved += iproto_thread->compression_stat.saved;
+	return 0;
+}
+
+/**
+ * Reset the statistics of a network thread. The depth and the
+ * number of requests in flight of the queues are their state
+ * rather than statistics, so they are left alone.
+ */
+static int
+iproto_do_reset_stat(struct cbus_call_msg *m)
+{
+	struct iproto_thread *iproto_thread =
+		((struct iproto_stat_msg *) m)->iproto_thread;
+	for (int t = 0; t < iproto_latency_type_MAX; t++) {
+		for (int s = 0; s < iproto_latency_stage_MAX; s++)
+			histogram_reset(iproto_thread->latency[t][s]);
+	}
+	for (int c = 0; c < iproto_class_MAX; c++) {
+		iproto_thread->queues[c].total = 0;
+		iproto_thread->queues[c].wait_time = 0;
+	}
+	memset(&iproto_thread->compression_stat, 0,
+	       sizeof(iproto_thread->compression_stat));
+	return 0;
+}
+
+/**
+ * Run a function with a statistics message in every network
+ * thread. On failure the message is freed by cbus once the
+ * thread is done with it, the caller must not touch it.
+ */
+static int
+iproto_stat_call(struct iproto_stat_msg *msg, cbus_call_f func)
+{
+	for (int i = 0; i < iproto_threads_count; i++) {
+		struct iproto_thread *iproto_thread = &iproto_threads[i];
+		msg->iproto_thread = iproto_thread;
+		if (cbus_call(&iproto_thread->net_pipe,
+			      &iproto_thread->tx_pipe, msg, func,
+			      iproto_stat_msg_delete, TIMEOUT_INFINITY))
+			return -1;
+	}
+	return 0;
+}
+
+int
+iproto_queue_stat_foreach(iproto_queue_stat_cb cb, void *cb_ctx)
+{
+	struct iproto_stat_msg *msg = iproto_stat_msg_new(false);
+	if (msg == NULL)
+		return -1;
+	if (iproto_stat_call(msg, iproto_do_merge_stat) != 0)
+		return -1;
+	int rc = 0;
+	for (int c = 0; c < iproto_class_MAX && rc == 0; c++) {
+		struct iproto_queue_stat *stat = &msg->queues[c];
+		stat->name = iproto_class_strs[c];
+		rc = cb(stat, cb_ctx);
+	}
+	iproto_stat_msg_delete(msg);
+	return rc;
+}
+
+int
+iproto_compression_stat(struct iproto_compression_stat *stat)
+{
+	struct iproto_stat_msg *msg = iproto_stat_msg_new(false);
+	if (msg == NULL)
+		return -1;
+	if (iproto_stat_call(msg, iproto_do_merge_stat) != 0)
+		return -1;
+	*stat = msg->compression;
+	iproto_stat_msg_delete(msg);
+	return 0;
+}
+
+int
+iproto_latency_stat_foreach(iproto_latency_stat_cb cb, void *cb_ctx)
+{
+	struct iproto_stat_msg *msg = iproto_stat_msg_new(true);
+	if (msg == NULL)
+		return -1;
+	if (iproto_stat_call(msg, iproto_do_merge_stat) != 0)
+		return -1;
+	int rc = 0;
+	for (int t = 0; t < iproto_latency_type_MAX && rc == 0; t++) {
+		struct iproto_latency_stat stat;
+		stat.name = iproto_latency_type_strs[t];
+		stat.count = 0;
+		for (int s = 0; s < iproto_latency_stage_MAX; s++) {
+			struct histogram *hist = msg->latency[t][s];
+			if (s == IPROTO_LATENCY_TOTAL)
+				stat.count = hist->total;
+			stat.p50[s] = histogram_permille(hist, 500) / 1e6;
+			stat.p99[s] = histogram_permille(hist, 990) / 1e6;
+			stat.p999[s] = histogram_permille(hist, 999) / 1e6;
+		}
+		if (stat.count > 0)
+			rc = cb(&stat, cb_ctx);
+	}
+	iproto_stat_msg_delete(msg);
+	return rc;
 }
 
 void
 iproto_reset_stat(void)
 {
-	rmean_cleanup(rmean_net);
+	for (int i = 0; i < iproto_threads_count; i++)
+		rmean_cleanup(iproto_threads[i].rmean);
+	struct iproto_stat_msg *msg = iproto_stat_msg_new(false);
+	if (msg == NULL ||
+	    iproto_stat_call(msg, iproto_do_reset_stat) != 0) {
+		diag_log();
+		return;
+	}
+	iproto_stat_msg_delete(msg);
 }
@@ -33,11 +33,33 @@
 
 #include <stddef.h>
 
+#include "rmean.h"
+
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
 
 extern unsigned iproto_readahead;
+extern unsigned iproto_compression_threshold;
+
+/**
+ * The max number of network threads, box.cfg.iproto_threads.
+ * Each thread gets an equal share of the messages in flight,
+ * which must not be less than IPROTO_THREAD_MSG_MIN.
+ */
+enum { IPROTO_THREADS_MAX = 12 };
+
+/** I/O backend of the network threads, box.cfg.io_backend. */
+enum iproto_io_backend {
+	/** libev readiness events and a system call per read/write. */
+	IPROTO_IO_EVIO,
+	/** Socket reads and writes batched with io_uring. */
+	IPROTO_IO_URING,
+	iproto_io_backend_MAX
+};
+
+/** String constants for the supported I/O backends. */
+extern const char *iproto_io_backend_strs[];
 
 /**
  * Return size of memory used for storing network buffers.
@@ -46,19 +68,134 @@ size_t
 iproto_mem_used(void);
 
 /**
- * Reset network statistics.
+ * Reset network statistics. Yields until every network thread
+ * has reset its statistics.
  */
 void
 iproto_reset_stat(void);
 
+/**
+ * Invoke a callback for each network statistics counter,
+ * summed up over all network threads.
+ */
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx);
+
+/** Statistics of a request class queue. */
+struct iproto_queue_stat {
+	/** Request class name. */
+	const char *name;
+	/** Number of queued requests. */
+	size_t depth;
+	/** Number of requests being processed by tx. */
+	size_t in_flight;
+	/** Number of requests passed through the queue. */
+	int64_t total;
+	/** Total time the requests spent in the queue, seconds. */
+	double wait_time;
+};
+
+typedef int
+(*iproto_queue_stat_cb)(const struct iproto_queue_stat *stat, void *cb_ctx);
+
+/**
+ * Invoke a callback for each request class queue, with
+ * statistics summed up over all network threads. Yields
+ * while the statistics are collected from the threads.
+ */
+int
+iproto_queue_stat_foreach(iproto_queue_stat_cb cb, void *cb_ctx);
+
+/** Statistics of compression of iproto packets. */
+struct iproto_compression_stat {
+	/** Number of replies sent compressed. */
+	int64_t replies;
+	/** Number of requests received compressed. */
+	int64_t requests;
+	/** Number of bytes saved by compression. */
+	int64_t saved;
+};
+
+/**
+ * Get statistics of compression, summed up over all network
+ * threads. Yields while they are collected from the threads.
+ */
+int
+iproto_compression_stat(struct iproto_compression_stat *stat);
+
+/** Stages of processing of a request timed by iproto. */
+enum iproto_latency_stage {
+	/**
+	 * From decoding of the request in the network thread
+	 * till the start of its execution in tx.
+	 */
+	IPROTO_LATENCY_QUEUE,
+	/** Execution in tx, except for waiting for WAL. */
+	IPROTO_LATENCY_TX,
+	/** Waiting for WAL writes of the request in tx. */
+	IPROTO_LATENCY_WAL,
+	/**
+	 * From the end of execution in tx till the reply is
+	 * handed over to the network thread for sending.
+	 */
+	IPROTO_LATENCY_NET,
+	/**
+	 * From the hand-over till the reply has been written
+	 * to the socket.
+	 */
+	IPROTO_LATENCY_FLUSH,
+	/** The whole way from decoding to writing the reply. */
+	IPROTO_LATENCY_TOTAL,
+	iproto_latency_stage_MAX
+};
+
+/** String constants for the stages, lowercase. */
+extern const char *iproto_latency_stage_strs[];
+
+/** Latency statistics of a request type. */
+struct iproto_latency_stat {
+	/** Request type name. */
+	const char *name;
+	/** Number of timed requests. */
+	int64_t count;
+	/** Percentiles of latency of each stage, in seconds. */
+	double p50[iproto_latency_stage_MAX];
+	double p99[iproto_latency_stage_MAX];
+	double p999[iproto_latency_stage_MAX];
+};
+
+typedef int
+(*iproto_latency_stat_cb)(const struct iproto_latency_stat *stat,
+			  void *cb_ctx);
+
+/**
+ * Invoke a callback for each request type which has been
+ * timed, with statistics summed up over all network threads.
+ * Yields while the histograms are collected from the threads.
+ */
+int
+iproto_latency_stat_foreach(iproto_latency_stat_cb cb, void *cb_ctx);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 
+/**
+ * Initialize the iproto subsystem and start
+ * @a threads_count network threads using @a io_backend.
+ * The io_uring backend falls back to evio if io_uring
+ * is not supported by the system.
+ */
 void
-iproto_init();
+iproto_init(int threads_count, enum iproto_io_backend io_backend);
 
+/**
+ * Bind the network threads to @a uri. If @a reuseport is set,
+ * the listening sockets are bound with SO_REUSEPORT, so that
+ * each thread has a socket of its own and other processes may
+ * listen on the same port.
+ */
 void
-iproto_bind(const char *uri);
+iproto_bind(const char *uri, bool reuseport);
 
 void
 iproto_listen();
@@ -59,6 +59,12 @@ enum iproto_key {
 	IPROTO_TIMESTAMP = 0x04,
 	IPROTO_SCHEMA_VERSION = 0x05,
 	IPROTO_SERVER_VERSION = 0x06,
+	/**
+	 * Compression algorithm of the packet body, see
+	 * enum iproto_compression. A compressed body is MP_BIN
+	 * holding a compressed MessagePack map.
+	 */
+	IPROTO_COMPRESSION = 0x07,
 	/* Leave a gap for other keys in the header. */
 	IPROTO_SPACE_ID = 0x10,
 	IPROTO_INDEX_ID = 0x11,
@@ -66,6 +72,7 @@ enum iproto_key {
 	IPROTO_OFFSET = 0x13,
 	IPROTO_ITERATOR = 0x14,
 	IPROTO_INDEX_BASE = 0x15,
+	IPROTO_CURSOR_ID = 0x16,
 
 	/* Leave a gap between integer values and other keys */
 	IPROTO_KEY = 0x20,
@@ -88,6 +95,7 @@ enum iproto_key {
 	IPROTO_EXPR = 0x27, /* EVAL */
 	IPROTO_OPS = 0x28, /* UPSERT but not UPDATE ops, because of legacy */
 	IPROTO_FIELD_NAME = 0x29,
+	IPROTO_REQUESTS = 0x2a, /* BATCH */
 
 	/* Leave a gap between request keys and response keys */
 	IPROTO_DATA = 0x30,
@@ -189,6 +197,16 @@ enum iproto_type {
 	IPROTO_SUBSCRIBE = 66,
 	/** Vote request command for master election */
 	IPROTO_REQUEST_VOTE = 67,
+	/** Open a server-side cursor over an index */
+	IPROTO_CURSOR_OPEN = 68,
+	/** Fetch the next batch of tuples from a cursor */
+	IPROTO_CURSOR_FETCH = 69,
+	/** Close a server-side cursor */
+	IPROTO_CURSOR_CLOSE = 70,
+	/** Execute several DML requests in one transaction */
+	IPROTO_BATCH = 71,
+	/** Enable compression of replies on the connection */
+	IPROTO_COMPRESS = 72,
 
 	/** Vinyl run info stored in .index file */
 	VY_INDEX_RUN_INFO = 100,
@@ -203,6 +221,13 @@ enum iproto_type {
 	IPROTO_TYPE_ERROR = 1 << 15
 };
 
+/** Compression algorithms of iproto packet bodies. */
+enum iproto_compression {
+	IPROTO_COMPRESSION_NONE = 0,
+	IPROTO_COMPRESSION_ZSTD = 1,
+	iproto_compression_MAX
+};
+
 /** IPROTO type name by code */
 extern const char *iproto_type_strs[];
 
@@ -41,7 +41,8 @@ static const struct key_part_def key_part_def_default = {
 	field_type_MAX,
 	COLL_NONE,
 	false,
-	ON_CONFLICT_ACTION_ABORT
+	ON_CONFLICT_ACTION_ABORT,
+	false
 };
 
 static int64_t
@@ -55,6 +56,7 @@ part_type_by_name_wrapper(const char *str, uint32_t len)
 #define PART_OPT_COLLATION	 "collation"
 #define PART_OPT_NULLABILITY	 "is_nullable"
 #define PART_OPT_NULLABLE_ACTION "nullable_action"
+#define PART_OPT_MULTIKEY	 "is_multikey"
 
 const struct opt_def part_def_reg[] = {
 	OPT_DEF_ENUM(PART_OPT_TYPE, field_type, struct key_part_def, type,
@@ -65,6 +67,7 @@ const struct opt_def part_def_reg[] = {
 		is_nullable),
 	OPT_DEF_ENUM(PART_OPT_NULLABLE_ACTION, on_conflict_action,
 		     struct key_part_def, nullable_action, NULL),
+	OPT_DEF(PART_OPT_MULTIKEY, OPT_BOOL, struct key_part_def, is_multikey),
 	OPT_END,
 };
 
@@ -116,6 +119,7 @@ key_def_set_cmp(struct key_def *def)
 	def->tuple_compare = tuple_compare_create(def);
 	def->tuple_compare_with_key = tuple_compare_with_key_create(def);
 	tuple_hash_func_set(def);
+	tuple_hint_func_set(def);
 	tuple_extract_key_set(def);
 }
 
@@ -154,7 +158,8 @@ key_def_new_with_parts(struct key_part_def *parts, uint32_t part_count)
 			}
 		}
 		key_def_set_part(def, i, part->fieldno, part->type,
-				 part->nullable_action, coll);
+				 part->nullable_action, coll,
+				 part->is_multikey);
 	}
 	return def;
 }
@@ -171,6 +176,7 @@ key_def_dump_parts(const struct key_def *def, struct key_part_def *parts)
 		part_def->nullable_action = part->nullable_action;
 		part_def->coll_id = (part->coll != NULL ?
 				     part->coll->id : COLL_NONE);
+		part_def->is_multikey = part->is_multikey;
 	}
 }
 
@@ -184,7 +190,8 @@ box_key_def_new(uint32_t *fields, uint32_t *types, uint32_t part_count)
 	for (uint32_t item = 0; item < part_count; ++item) {
 		key_def_set_part(key_def, item, fields[item],
 				 (enum field_type)types[item],
-				 key_part_def_default.nullable_action, NULL);
+				 key_part_def_default.nullable_action, NULL,
+				 false);
 	}
 	return key_def;
 }
@@ -230,6 +237,8 @@ key_part_cmp(const struct key_part *parts1, uint32_t part_count1,
 		if (key_part_is_nullable(part1) != key_part_is_nullable(part2))
 			return key_part_is_nullable(part1) <
 			       key_part_is_nullable(part2) ? -1 : 1;
+		if (part1->is_multikey != part2->is_multikey)
+			return part1->is_multikey < part2->is_multikey ? -1 : 1;
 	}
 	return part_count1 < part_count2 ? -1 : part_count1 > part_count2;
 }
@@ -249,6 +258,8 @@ key_part_check_compatibility(const struct key_part *old_parts,
 			return false;
 		if (old_part->coll != new_part->coll)
 			return false;
+		if (old_part->is_multikey != new_part->is_multikey)
+			return false;
 	}
 	return true;
 }
@@ -256,12 +267,14 @@ key_part_check_compatibility(const struct key_part *old_parts,
 void
 key_def_set_part(struct key_def *def, uint32_t part_no, uint32_t fieldno,
 		 enum field_type type, enum on_conflict_action nullable_action,
-		 struct coll *coll)
+		 struct coll *coll, bool is_multikey)
 {
 	assert(part_no < def->part_count);
 	assert(type < field_type_MAX);
 	def->is_nullable |= (nullable_action == ON_CONFLICT_ACTION_NONE);
+	def->is_multikey |= is_multikey;
 	def->parts[part_no].nullable_action = nullable_action;
+	def->parts[part_no].is_multikey = is_multikey;
 	def->parts[part_no].fieldno = fieldno;
 	def->parts[part_no].type = type;
 	def->parts[part_no].coll = coll;
@@ -329,6 +342,8 @@ key_def_sizeof_parts(const struct key_part_def *parts, uint32_t part_count)
 			count++;
 		if (part->is_nullable)
 			count++;
+		if (part->is_multikey)
+			count++;
 		size += mp_sizeof_map(count);
 		size += mp_sizeof_str(strlen(PART_OPT_FIELD));
 		size += mp_sizeof_uint(part->fieldno);
@@ -343,6 +358,10 @@ key_def_sizeof_parts(const struct key_part_def *parts, uint32_t part_count)
 			size += mp_sizeof_str(strlen(PART_OPT_NULLABILITY));
 			size += mp_sizeof_bool(part->is_nullable);
 		}
+		if (part->is_multikey) {
+			size += mp_sizeof_str(strlen(PART_OPT_MULTIKEY));
+			size += mp_sizeof_bool(part->is_multikey);
+		}
 	}
 	return size;
 }
@@ -358,6 +377,8 @@ key_def_encode_parts(char *data, const struct key_part_def *parts,
 			count++;
 		if (part->is_nullable)
 			count++;
+		if (part->is_multikey)
+			count++;
 		data = mp_encode_map(data, count);
 		data = mp_encode_str(data, PART_OPT_FIELD,
 				     strlen(PART_OPT_FIELD));
@@ -377,6 +398,11 @@ key_def_encode_parts(char *data, const struct key_part_def *parts,
 					     strlen(PART_OPT_NULLABILITY));
 			data = mp_encode_bool(data, part->is_nullable);
 		}
+		if (part->is_multikey) {
+			data = mp_encode_str(data, PART_OPT_MULTIKEY,
+					     strlen(PART_OPT_MULTIKEY));
+			data = mp_encode_bool(data, part->is_multikey);
+		}
 	}
 	return data;
 }
@@ -514,6 +540,12 @@ key_def_decode_parts(struct key_part_def *parts, uint32_t part_count,
 				 "nullable action properties");
 			return -1;
 		}
+		if (part->is_multikey && part->is_nullable) {
+			diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+				 i + TUPLE_INDEX_BASE,
+				 "multikey part can't be nullable");
+			return -1;
+		}
 	}
 	return 0;
 }
@@ -553,7 +585,8 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 	const struct key_part *part = second->parts;
 	const struct key_part *end = part + second->part_count;
 	for (; part != end; part++) {
-		if (key_def_find(first, part->fieldno))
+		if (!first->for_func_index &&
+		    key_def_find(first, part->fieldno))
 			--new_part_count;
 	}
 
@@ -569,6 +602,7 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 	new_def->is_nullable = first->is_nullable || second->is_nullable;
 	new_def->has_optional_parts = first->has_optional_parts ||
 				      second->has_optional_parts;
+	new_def->for_func_index = first->for_func_index;
 	/* Write position in the new key def. */
 	uint32_t pos = 0;
 	/* Append first key def's parts to the new index_def. */
@@ -576,17 +610,20 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 	end = part + first->part_count;
 	for (; part != end; part++) {
 		key_def_set_part(new_def, pos++, part->fieldno, part->type,
-				 part->nullable_action, part->coll);
+				 part->nullable_action, part->coll,
+				 part->is_multikey);
 	}
 
 	/* Set-append second key def's part to the new key def. */
 	part = second->parts;
 	end = part + second->part_count;
 	for (; part != end; part++) {
-		if (key_def_find(first, part->fieldno))
+		if (!first->for_func_index &&
+		    key_def_find(first, part->fieldno))
 			continue;
 		key_def_set_part(new_def, pos++, part->fieldno, part->type,
-				 part->nullable_action, part->coll);
+				 part->nullable_action, part->coll,
+				 part->is_multikey);
 	}
 	return new_def;
 }
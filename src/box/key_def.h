@@ -56,6 +56,11 @@ struct key_part_def {
 	bool is_nullable;
 	/** Action to perform if NULL constraint failed. */
 	enum on_conflict_action nullable_action;
+	/**
+	 * True if the part indexes every element of an array
+	 * field rather than the field itself.
+	 */
+	bool is_multikey;
 };
 
 /**
@@ -74,11 +79,29 @@ struct key_part {
 	struct coll *coll;
 	/** Action to perform if NULL constraint failed. */
 	enum on_conflict_action nullable_action;
+	/** @copydoc key_part_def::is_multikey */
+	bool is_multikey;
 };
 
 struct key_def;
 struct tuple;
 
+/**
+ * Comparison hint of a tuple or a key - a number computed from
+ * the first key part so that if hint(a) < hint(b) then a < b.
+ * Comparing hints is cheap and lets a comparator skip decoding
+ * of tuples in most cases. Equal hints tell nothing and
+ * the full comparison is needed then.
+ */
+typedef uint64_t hint_t;
+
+/**
+ * The hint is unknown, for example, the key is empty or
+ * the first part value is of a type that has no hints.
+ * Such a hint must not be compared with other hints.
+ */
+#define HINT_NONE ((hint_t)UINT64_MAX)
+
 /**
  * Get is_nullable property of key_part.
  * @param key_part for which attribute is being fetched
@@ -115,6 +138,12 @@ typedef uint32_t (*tuple_hash_t)(const struct tuple *tuple,
 /** @copydoc key_hash() */
 typedef uint32_t (*key_hash_t)(const char *key,
 				const struct key_def *key_def);
+/** @copydoc tuple_hint() */
+typedef hint_t (*tuple_hint_t)(const struct tuple *tuple,
+			       const struct key_def *key_def);
+/** @copydoc key_hint() */
+typedef hint_t (*key_hint_t)(const char *key, uint32_t part_count,
+			     const struct key_def *key_def);
 
 /* Definition of a multipart key. */
 struct key_def {
@@ -130,6 +159,10 @@ struct key_def {
 	tuple_hash_t tuple_hash;
 	/** @see key_hash() */
 	key_hash_t key_hash;
+	/** @see tuple_hint() */
+	tuple_hint_t tuple_hint;
+	/** @see key_hint() */
+	key_hint_t key_hint;
 	/**
 	 * Minimal part count which always is unique. For example,
 	 * if a secondary index is unique, then
@@ -140,6 +173,20 @@ struct key_def {
 	uint32_t unique_part_count;
 	/** True, if at least one part can store NULL. */
 	bool is_nullable;
+	/**
+	 * True, if a part is multikey, so that a tuple produces
+	 * a key per element of its indexed array. Such key defs
+	 * are compared with tuple_compare_multikey().
+	 */
+	bool is_multikey;
+	/**
+	 * True, if the key def belongs to a functional index.
+	 * Parts of such key def refer to fields of the key
+	 * computed by the index function rather than to tuple
+	 * fields, so the key def is not used to build tuple
+	 * formats.
+	 */
+	bool for_func_index;
 	/**
 	 * True, if some key parts can be absent in a tuple. These
 	 * fields assumed to be MP_NIL.
@@ -250,7 +297,7 @@ key_def_dump_parts(const struct key_def *def, struct key_part_def *parts);
 void
 key_def_set_part(struct key_def *def, uint32_t part_no, uint32_t fieldno,
 		 enum field_type type, enum on_conflict_action nullable_action,
-		 struct coll *coll);
+		 struct coll *coll, bool is_multikey);
 
 /**
  * Update 'has_optional_parts' of @a key_def with correspondence
@@ -318,7 +365,10 @@ key_def_contains(const struct key_def *first, const struct key_def *second);
  * Allocate a new key_def with a set union of key parts from
  * first and second key defs. Parts of the new key_def consist
  * of the first key_def's parts and those parts of the second
- * key_def that were not among the first parts.
+ * key_def that were not among the first parts. If the first
+ * key_def belongs to a functional index, its parts don't refer
+ * to tuple fields, so all parts of the second key_def are
+ * appended.
  * @retval not NULL Ok.
  * @retval NULL     Memory error.
  */
@@ -517,6 +567,33 @@ tuple_compare_with_key(const struct tuple *tuple, const char *key,
 	return key_def->tuple_compare_with_key(tuple, key, part_count, key_def);
 }
 
+/**
+ * Compute the comparison hint of a tuple.
+ * @param tuple tuple
+ * @param key_def key definition
+ * @retval the hint of the first key part of @a tuple
+ * @sa hint_t
+ */
+static inline hint_t
+tuple_hint(const struct tuple *tuple, const struct key_def *key_def)
+{
+	return key_def->tuple_hint(tuple, key_def);
+}
+
+/**
+ * Compute the comparison hint of a key.
+ * @param key key parts without MessagePack array header
+ * @param part_count the number of parts in @a key
+ * @param key_def key definition
+ * @retval the hint of the first part of @a key or HINT_NONE
+ *         if @a key is empty
+ */
+static inline hint_t
+key_hint(const char *key, uint32_t part_count, const struct key_def *key_def)
+{
+	return key_def->key_hint(key, part_count, key_def);
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
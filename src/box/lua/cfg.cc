@@ -121,6 +121,17 @@ lbox_cfg_set_readahead(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_iproto_compression_threshold(struct lua_State *L)
+{
+	try {
+		box_set_iproto_compression_threshold();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_io_collect_interval(struct lua_State *L)
 {
@@ -154,6 +165,39 @@ lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_snap_direct_io(struct lua_State *L)
+{
+	try {
+		box_set_snap_direct_io();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_checkpoint_threads(struct lua_State *L)
+{
+	try {
+		box_set_memtx_checkpoint_threads();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_incremental_checkpoints(struct lua_State *L)
+{
+	try {
+		box_set_memtx_incremental_checkpoints();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_checkpoint_count(struct lua_State *L)
 {
@@ -263,9 +307,14 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_log_level", lbox_cfg_set_log_level},
 		{"cfg_set_log_format", lbox_cfg_set_log_format},
 		{"cfg_set_readahead", lbox_cfg_set_readahead},
+		{"cfg_set_iproto_compression_threshold",
+			lbox_cfg_set_iproto_compression_threshold},
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
 		{"cfg_set_snap_io_rate_limit", lbox_cfg_set_snap_io_rate_limit},
+		{"cfg_set_snap_direct_io", lbox_cfg_set_snap_direct_io},
+		{"cfg_set_memtx_checkpoint_threads", lbox_cfg_set_memtx_checkpoint_threads},
+		{"cfg_set_memtx_incremental_checkpoints", lbox_cfg_set_memtx_incremental_checkpoints},
 		{"cfg_set_checkpoint_count", lbox_cfg_set_checkpoint_count},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{"cfg_set_memtx_max_tuple_size", lbox_cfg_set_memtx_max_tuple_size},
@@ -294,6 +294,26 @@ lbox_truncate(struct lua_State *L)
 	return 0;
 }
 
+/** Begin loading a batch of tuples into a given space */
+static int
+lbox_begin_bulk_load(struct lua_State *L)
+{
+	uint32_t space_id = luaL_checkinteger(L, 1);
+	if (box_begin_bulk_load(space_id) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
+/** Finish loading a batch of tuples into a given space */
+static int
+lbox_end_bulk_load(struct lua_State *L)
+{
+	uint32_t space_id = luaL_checkinteger(L, 1);
+	if (box_end_bulk_load(space_id) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
 /* }}} */
 
 /* {{{ Introspection */
@@ -349,6 +369,8 @@ box_lua_index_init(struct lua_State *L)
 		{"iterator", lbox_index_iterator},
 		{"iterator_next", lbox_iterator_next},
 		{"truncate", lbox_truncate},
+		{"begin_bulk_load", lbox_begin_bulk_load},
+		{"end_bulk_load", lbox_end_bulk_load},
 		{"info", lbox_index_info},
 		{NULL, NULL}
 	};
@@ -12,6 +12,9 @@ local default_cfg = {
     memtx_memory        = 256 * 1024 *1024,
     memtx_min_tuple_size = 16,
     memtx_max_tuple_size = 1024 * 1024,
+    memtx_build_threads = 1,
+    memtx_checkpoint_threads = 1,
+    memtx_incremental_checkpoints = 0,
     slab_alloc_factor   = 1.05,
     work_dir            = nil,
     memtx_dir           = ".",
@@ -35,13 +38,28 @@ local default_cfg = {
     log_format          = "plain",
     io_collect_interval = nil,
     readahead           = 16320,
+    iproto_threads      = 1,
+    iproto_reuseport    = false,
+    io_backend          = "evio",
+    iproto_compression_threshold = 1024,
     snap_io_rate_limit  = nil, -- no limit
+    snap_direct_io      = false,
     too_long_threshold  = 0.5,
     wal_mode            = "write",
     rows_per_wal        = 500000,
     wal_max_size        = 256 * 1024 * 1024,
+    wal_commit_delay_us = 0,
+    wal_group_max_bytes = 1024 * 1024,
+    wal_async_max_bytes = 16 * 1024 * 1024,
+    wal_async_max_lag   = 0.1,
+    wal_prealloc_count  = 0,
+    wal_prealloc_zero_fill = false,
+    wal_direct_io       = false,
+    xlog_compression_level = 3,
+    xlog_compression_dict = false,
     wal_dir_rescan_delay= 2,
     force_recovery      = false,
+    recovery_read_threads = 0,
     replication         = nil,
     instance_uuid       = nil,
     replicaset_uuid     = nil,
@@ -68,6 +86,9 @@ local template_cfg = {
     memtx_memory        = 'number',
     memtx_min_tuple_size  = 'number',
     memtx_max_tuple_size  = 'number',
+    memtx_build_threads   = 'number',
+    memtx_checkpoint_threads = 'number',
+    memtx_incremental_checkpoints = 'number',
     slab_alloc_factor   = 'number',
     work_dir            = 'string',
     memtx_dir            = 'string',
@@ -91,13 +112,28 @@ local template_cfg = {
     log_format          = 'string',
     io_collect_interval = 'number',
     readahead           = 'number',
+    iproto_threads      = 'number',
+    iproto_reuseport    = 'boolean',
+    io_backend          = 'string',
+    iproto_compression_threshold = 'number',
     snap_io_rate_limit  = 'number',
+    snap_direct_io      = 'boolean',
     too_long_threshold  = 'number',
     wal_mode            = 'string',
     rows_per_wal        = 'number',
     wal_max_size        = 'number',
+    wal_commit_delay_us = 'number',
+    wal_group_max_bytes = 'number',
+    wal_async_max_bytes = 'number',
+    wal_async_max_lag   = 'number',
+    wal_prealloc_count  = 'number',
+    wal_prealloc_zero_fill = 'boolean',
+    wal_direct_io       = 'boolean',
+    xlog_compression_level = 'number',
+    xlog_compression_dict = 'boolean',
     wal_dir_rescan_delay= 'number',
     force_recovery      = 'boolean',
+    recovery_read_threads = 'number',
     replication         = 'string, number, table',
     instance_uuid       = 'string',
     replicaset_uuid     = 'string',
@@ -160,13 +196,18 @@ local log_cfg_option = {
 -- dynamically settable options
 local dynamic_cfg = {
     listen                  = private.cfg_set_listen,
+    iproto_reuseport        = private.cfg_set_listen,
     replication             = private.cfg_set_replication,
     log_level               = private.cfg_set_log_level,
     log_format              = private.cfg_set_log_format,
     io_collect_interval     = private.cfg_set_io_collect_interval,
     readahead               = private.cfg_set_readahead,
+    iproto_compression_threshold = private.cfg_set_iproto_compression_threshold,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
+    snap_direct_io          = private.cfg_set_snap_direct_io,
+    memtx_checkpoint_threads = private.cfg_set_memtx_checkpoint_threads,
+    memtx_incremental_checkpoints = private.cfg_set_memtx_incremental_checkpoints,
     read_only               = private.cfg_set_read_only,
     memtx_max_tuple_size    = private.cfg_set_memtx_max_tuple_size,
     vinyl_max_tuple_size    = private.cfg_set_vinyl_max_tuple_size,
@@ -188,6 +229,7 @@ local dynamic_cfg = {
 local dynamic_cfg_skip_at_load = {
     wal_mode                = true,
     listen                  = true,
+    iproto_reuseport        = true,
     replication             = true,
     replication_timeout     = true,
     replication_connect_quorum = true,
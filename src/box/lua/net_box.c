@@ -32,7 +32,9 @@
 #include <sys/socket.h>
 
 #include <small/ibuf.h>
+#include <small/region.h>
 #include <msgpuck.h> /* mp_store_u32() */
+#include <zstd.h>
 #include "scramble.h"
 
 #include "box/iproto_constants.h"
@@ -40,6 +42,7 @@
 #include "box/xrow.h"
 
 #include "lua/msgpack.h"
+#include "lua/utils.h"
 #include "third_party/base64.h"
 
 #include "coio.h"
@@ -48,6 +51,12 @@
 
 #define cfg luaL_msgpack_default
 
+/** Contexts for compression of requests and replies. */
+static ZSTD_CCtx *netbox_zctx;
+static ZSTD_DCtx *netbox_zdctx;
+
+enum { NETBOX_COMPRESSION_LEVEL = 1 };
+
 static inline size_t
 netbox_prepare_request(lua_State *L, struct mpstream *stream, uint32_t r_type)
 {
@@ -294,6 +303,93 @@ netbox_encode_insert_or_replace(lua_State *L, uint32_t reqtype)
 	return 0;
 }
 
+static int
+netbox_encode_cursor_open(lua_State *L)
+{
+	if (lua_gettop(L) < 8)
+		return luaL_error(L, "Usage netbox.encode_cursor_open(ibuf, "
+				  "sync, schema_version, space_id, index_id, "
+				  "iterator, offset, key)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_CURSOR_OPEN);
+
+	luamp_encode_map(cfg, &stream, 5);
+
+	uint32_t space_id = lua_tonumber(L, 4);
+	uint32_t index_id = lua_tonumber(L, 5);
+	int iterator = lua_tointeger(L, 6);
+	uint32_t offset = lua_tonumber(L, 7);
+
+	/* encode space_id */
+	luamp_encode_uint(cfg, &stream, IPROTO_SPACE_ID);
+	luamp_encode_uint(cfg, &stream, space_id);
+
+	/* encode index_id */
+	luamp_encode_uint(cfg, &stream, IPROTO_INDEX_ID);
+	luamp_encode_uint(cfg, &stream, index_id);
+
+	/* encode iterator */
+	luamp_encode_uint(cfg, &stream, IPROTO_ITERATOR);
+	luamp_encode_uint(cfg, &stream, iterator);
+
+	/* encode offset */
+	luamp_encode_uint(cfg, &stream, IPROTO_OFFSET);
+	luamp_encode_uint(cfg, &stream, offset);
+
+	/* encode key */
+	luamp_encode_uint(cfg, &stream, IPROTO_KEY);
+	luamp_convert_key(L, cfg, &stream, 8);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_cursor_fetch(lua_State *L)
+{
+	if (lua_gettop(L) < 5)
+		return luaL_error(L, "Usage netbox.encode_cursor_fetch(ibuf, "
+				  "sync, schema_version, cursor_id, limit)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_CURSOR_FETCH);
+
+	luamp_encode_map(cfg, &stream, 2);
+
+	uint64_t cursor_id = lua_tonumber(L, 4);
+	uint32_t limit = lua_tonumber(L, 5);
+
+	luamp_encode_uint(cfg, &stream, IPROTO_CURSOR_ID);
+	luamp_encode_uint(cfg, &stream, cursor_id);
+
+	luamp_encode_uint(cfg, &stream, IPROTO_LIMIT);
+	luamp_encode_uint(cfg, &stream, limit);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_cursor_close(lua_State *L)
+{
+	if (lua_gettop(L) < 4)
+		return luaL_error(L, "Usage netbox.encode_cursor_close(ibuf, "
+				  "sync, schema_version, cursor_id)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_CURSOR_CLOSE);
+
+	luamp_encode_map(cfg, &stream, 1);
+
+	uint64_t cursor_id = lua_tonumber(L, 4);
+	luamp_encode_uint(cfg, &stream, IPROTO_CURSOR_ID);
+	luamp_encode_uint(cfg, &stream, cursor_id);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
 static int
 netbox_encode_insert(lua_State *L)
 {
@@ -411,6 +507,174 @@ netbox_encode_upsert(lua_State *L)
 	return 0;
 }
 
+static int
+netbox_encode_batch(lua_State *L)
+{
+	if (lua_gettop(L) < 4)
+		return luaL_error(L, "Usage: netbox.encode_batch(ibuf, sync, "
+			"schema_version, requests)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_BATCH);
+
+	luamp_encode_map(cfg, &stream, 1);
+
+	/*
+	 * Every request is {type, space_id, tuple or key, ops},
+	 * checked and normalized by the caller.
+	 */
+	uint32_t count = lua_objlen(L, 4);
+	luamp_encode_uint(cfg, &stream, IPROTO_REQUESTS);
+	luamp_encode_array(cfg, &stream, count);
+	for (uint32_t i = 1; i <= count; i++) {
+		lua_rawgeti(L, 4, i);
+		int top = lua_gettop(L);
+		lua_rawgeti(L, top, 1);
+		lua_rawgeti(L, top, 2);
+		lua_rawgeti(L, top, 3);
+		lua_rawgeti(L, top, 4);
+		uint32_t type = lua_tonumber(L, top + 1);
+		uint32_t space_id = lua_tonumber(L, top + 2);
+
+		luamp_encode_array(cfg, &stream, 2);
+		luamp_encode_uint(cfg, &stream, type);
+		switch (type) {
+		case IPROTO_INSERT:
+		case IPROTO_REPLACE:
+			luamp_encode_map(cfg, &stream, 2);
+			luamp_encode_uint(cfg, &stream, IPROTO_TUPLE);
+			luamp_encode_tuple(L, cfg, &stream, top + 3);
+			break;
+		case IPROTO_DELETE:
+			luamp_encode_map(cfg, &stream, 2);
+			luamp_encode_uint(cfg, &stream, IPROTO_KEY);
+			luamp_convert_key(L, cfg, &stream, top + 3);
+			break;
+		case IPROTO_UPDATE:
+			luamp_encode_map(cfg, &stream, 4);
+			luamp_encode_uint(cfg, &stream, IPROTO_INDEX_BASE);
+			luamp_encode_uint(cfg, &stream, 1);
+			luamp_encode_uint(cfg, &stream, IPROTO_KEY);
+			luamp_convert_key(L, cfg, &stream, top + 3);
+			/* UPDATE ops are sent as IPROTO_TUPLE */
+			luamp_encode_uint(cfg, &stream, IPROTO_TUPLE);
+			luamp_encode_tuple(L, cfg, &stream, top + 4);
+			break;
+		case IPROTO_UPSERT:
+			luamp_encode_map(cfg, &stream, 4);
+			luamp_encode_uint(cfg, &stream, IPROTO_INDEX_BASE);
+			luamp_encode_uint(cfg, &stream, 1);
+			luamp_encode_uint(cfg, &stream, IPROTO_TUPLE);
+			luamp_encode_tuple(L, cfg, &stream, top + 3);
+			luamp_encode_uint(cfg, &stream, IPROTO_OPS);
+			luamp_encode_tuple(L, cfg, &stream, top + 4);
+			break;
+		default:
+			unreachable();
+		}
+		luamp_encode_uint(cfg, &stream, IPROTO_SPACE_ID);
+		luamp_encode_uint(cfg, &stream, space_id);
+		lua_settop(L, top - 1);
+	}
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_compress(lua_State *L)
+{
+	if (lua_gettop(L) < 4)
+		return luaL_error(L, "Usage: netbox.encode_compress(ibuf, "
+			"sync, schema_version, compression)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_COMPRESS);
+
+	luamp_encode_map(cfg, &stream, 1);
+	luamp_encode_uint(cfg, &stream, IPROTO_COMPRESSION);
+	luamp_encode_uint(cfg, &stream, lua_tointeger(L, 4));
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+/**
+ * Compress the last request written to the send buffer if it
+ * is not smaller than the threshold.
+ * Usage: compress_request(ibuf, offset, threshold), where
+ * offset is the position of the request relative to ibuf.rpos.
+ */
+static int
+netbox_compress_request(lua_State *L)
+{
+	struct ibuf *ibuf = (struct ibuf *) lua_topointer(L, 1);
+	size_t offset = lua_tointeger(L, 2);
+	size_t threshold = lua_tointeger(L, 3);
+	assert(offset <= ibuf_used(ibuf));
+	char *packet = ibuf->rpos + offset;
+	size_t size = ibuf->wpos - packet;
+	if (size < threshold)
+		return 0;
+	if (netbox_zctx == NULL) {
+		netbox_zctx = ZSTD_createCCtx();
+		if (netbox_zctx == NULL)
+			return luaL_error(L, "failed to create zstd context");
+	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	char *zpacket = (char *) region_alloc(region, xrow_compress_bound(size));
+	if (zpacket == NULL) {
+		diag_set(OutOfMemory, xrow_compress_bound(size),
+			 "region_alloc", "zpacket");
+		return luaT_error(L);
+	}
+	ssize_t zsize = xrow_compress_packet(netbox_zctx, packet, size,
+					     zpacket, NETBOX_COMPRESSION_LEVEL);
+	if (zsize > 0) {
+		/* The compressed request replaces the original one. */
+		memcpy(packet, zpacket, zsize);
+		ibuf->wpos = packet + zsize;
+	}
+	region_truncate(region, region_svp);
+	if (zsize < 0)
+		return luaT_error(L);
+	return 0;
+}
+
+/**
+ * Decompress a reply body to an ibuf.
+ * Usage: decompress(ibuf, body_rpos, body_end), returns the
+ * position and the end of the decompressed body.
+ */
+static int
+netbox_decompress(lua_State *L)
+{
+	struct ibuf *ibuf = (struct ibuf *) lua_topointer(L, 1);
+	uint32_t ctypeid;
+	const char *body = *(const char **) luaL_checkcdata(L, 2, &ctypeid);
+	const char *end = *(const char **) luaL_checkcdata(L, 3, &ctypeid);
+	if (netbox_zdctx == NULL) {
+		netbox_zdctx = ZSTD_createDCtx();
+		if (netbox_zdctx == NULL)
+			return luaL_error(L, "failed to create zstd context");
+	}
+	ssize_t size = xrow_decompressed_size(body, end);
+	if (size < 0)
+		return luaT_error(L);
+	ibuf_reset(ibuf);
+	char *out = (char *) ibuf_alloc(ibuf, size);
+	if (out == NULL) {
+		diag_set(OutOfMemory, size, "ibuf_alloc", "body");
+		return luaT_error(L);
+	}
+	if (xrow_decompress_body(netbox_zdctx, body, end, out, size) != 0)
+		return luaT_error(L);
+	*(const char **) luaL_pushcdata(L, ctypeid) = out;
+	*(const char **) luaL_pushcdata(L, ctypeid) = out + size;
+	return 2;
+}
+
 static int
 netbox_decode_greeting(lua_State *L)
 {
@@ -590,6 +854,13 @@ luaopen_net_box(struct lua_State *L)
 		{ "encode_call",    netbox_encode_call },
 		{ "encode_eval",    netbox_encode_eval },
 		{ "encode_select",  netbox_encode_select },
+		{ "encode_cursor_open",  netbox_encode_cursor_open },
+		{ "encode_cursor_fetch", netbox_encode_cursor_fetch },
+		{ "encode_cursor_close", netbox_encode_cursor_close },
+		{ "encode_batch",   netbox_encode_batch },
+		{ "encode_compress", netbox_encode_compress },
+		{ "compress_request", netbox_compress_request },
+		{ "decompress",     netbox_decompress },
 		{ "encode_insert",  netbox_encode_insert },
 		{ "encode_replace", netbox_encode_replace },
 		{ "encode_delete",  netbox_encode_delete },
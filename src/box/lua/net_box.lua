@@ -25,6 +25,9 @@ local check_primary_index = box.internal.check_primary_index
 local communicate     = internal.communicate
 local encode_auth     = internal.encode_auth
 local encode_select   = internal.encode_select
+local encode_compress = internal.encode_compress
+local compress_request = internal.compress_request
+local decompress      = internal.decompress
 local decode_greeting = internal.decode_greeting
 
 local sequence_mt      = { __serialize = 'sequence' }
@@ -36,6 +39,10 @@ local IPROTO_STATUS_KEY    = 0x00
 local IPROTO_ERRNO_MASK    = 0x7FFF
 local IPROTO_SYNC_KEY      = 0x01
 local IPROTO_SCHEMA_VERSION_KEY = 0x05
+local IPROTO_COMPRESSION_KEY = 0x07
+local IPROTO_COMPRESSION_ZSTD = 1
+-- Default min size of a packet to compress.
+local COMPRESSION_THRESHOLD = 1024
 local IPROTO_METADATA_KEY = 0x32
 local IPROTO_SQL_INFO_KEY = 0x43
 local IPROTO_SQL_ROW_COUNT_KEY = 0x44
@@ -44,6 +51,11 @@ local IPROTO_DATA_KEY      = 0x30
 local IPROTO_ERROR_KEY     = 0x31
 local IPROTO_GREETING_SIZE = 128
 
+-- Request types allowed in a batch, see remote:batch().
+local IPROTO_BATCH_TYPE = {
+    insert = 2, replace = 3, update = 4, delete = 5, upsert = 9
+}
+
 -- select errors from box.error
 local E_UNKNOWN              = box.error.UNKNOWN
 local E_NO_CONNECTION        = box.error.NO_CONNECTION
@@ -65,6 +77,10 @@ local method_codec           = {
     upsert  = internal.encode_upsert,
     select  = internal.encode_select,
     execute = internal.encode_execute,
+    cursor_open  = internal.encode_cursor_open,
+    cursor_fetch = internal.encode_cursor_fetch,
+    cursor_close = internal.encode_cursor_close,
+    batch        = internal.encode_batch,
     -- inject raw data into connection, used by console and tests
     inject = function(buf, id, schema_version, bytes)
         local ptr = buf:reserve(#bytes)
@@ -122,6 +138,8 @@ local function next_id(id) return band(id + 1, 0x7FFFFFFF) end
 --  'did_fetch_schema', schema_version, spaces, indices
 --  'reconnect_timeout'   -> get reconnect timeout if set and > 0,
 --                           else nil is returned.
+--  'compression_threshold' -> min size of a packet to compress if
+--                           compression is enabled, else nil.
 --
 -- Suggestion for callback writers: sleep a few secs before approving
 -- reconnect.
@@ -153,6 +171,11 @@ local function create_transport(host, port, user, password, callback)
     local connection
     local send_buf         = buffer.ibuf(buffer.READAHEAD)
     local recv_buf         = buffer.ibuf(buffer.READAHEAD)
+    -- decompressed body of the last received packet
+    local body_buf         = buffer.ibuf(buffer.READAHEAD)
+    -- min size of a request to compress, nil if compression
+    -- was not negotiated with the server
+    local compression_threshold
 
     -- STATE SWITCHING --
     local function set_state(new_state, new_errno, new_error, schema_version)
@@ -218,6 +241,7 @@ local function create_transport(host, port, user, password, callback)
             end
             send_buf:recycle()
             recv_buf:recycle()
+            body_buf:recycle()
             worker_fiber = nil
         end)
         return true
@@ -245,7 +269,11 @@ local function create_transport(host, port, user, password, callback)
             worker_fiber:wakeup()
         end
         local id = next_request_id
+        local offset = send_buf:size()
         method_codec[method](send_buf, id, schema_version, ...)
+        if compression_threshold ~= nil then
+            compress_request(send_buf, offset, compression_threshold)
+        end
         next_request_id = next_id(id)
         -- reserve space for 8 keys: client, method,
         -- schema_version, buffer, errno, response, metadata,
@@ -338,6 +366,11 @@ local function create_transport(host, port, user, password, callback)
                 local body_end = rpos + len
                 local hdr, body_rpos = decode(rpos)
                 recv_buf.rpos = body_end
+                if hdr[IPROTO_COMPRESSION_KEY] ~= nil and
+                   body_rpos < body_end then
+                    body_rpos, body_end = decompress(body_buf, body_rpos,
+                                                     body_end)
+                end
                 return nil, hdr, body_rpos, body_end
             end
         end
@@ -367,7 +400,8 @@ local function create_transport(host, port, user, password, callback)
     -- tail-recursive calls to each other. Yep, Lua optimizes
     -- such calls, and yep, this is the canonical way to implement
     -- a state machine in Lua.
-    local console_sm, iproto_auth_sm, iproto_schema_sm, iproto_sm, error_sm
+    local console_sm, iproto_auth_sm, iproto_compression_sm
+    local iproto_schema_sm, iproto_sm, error_sm
 
     --
     -- Protocol_sm is a core function of netbox. It calls all
@@ -436,8 +470,7 @@ local function create_transport(host, port, user, password, callback)
     iproto_auth_sm = function(salt)
         set_state('auth')
         if not user or not password then
-            set_state('fetch_schema')
-            return iproto_schema_sm()
+            return iproto_compression_sm()
         end
         encode_auth(send_buf, new_request_id(), nil, user, password, salt)
         local err, hdr, body_rpos, body_end = send_and_recv_iproto()
@@ -449,8 +482,28 @@ local function create_transport(host, port, user, password, callback)
             body, body_end = decode(body_rpos)
             return error_sm(E_NO_CONNECTION, body[IPROTO_ERROR_KEY])
         end
+        return iproto_compression_sm(hdr[IPROTO_SCHEMA_VERSION_KEY])
+    end
+
+    iproto_compression_sm = function(schema_version)
+        compression_threshold = nil
+        local threshold = callback('compression_threshold')
+        if threshold ~= nil then
+            encode_compress(send_buf, new_request_id(), nil,
+                            IPROTO_COMPRESSION_ZSTD)
+            local err, hdr = send_and_recv_iproto()
+            if err then
+                return error_sm(err, hdr)
+            end
+            -- A server which doesn't support compression
+            -- replies with an error, keep the connection
+            -- uncompressed then.
+            if hdr[IPROTO_STATUS_KEY] == 0 then
+                compression_threshold = threshold
+            end
+        end
         set_state('fetch_schema')
-        return iproto_schema_sm(hdr[IPROTO_SCHEMA_VERSION_KEY])
+        return iproto_schema_sm(schema_version)
     end
 
     iproto_schema_sm = function(schema_version)
@@ -524,6 +577,7 @@ local function create_transport(host, port, user, password, callback)
         if connection then connection:close(); connection = nil end
         send_buf:recycle()
         recv_buf:recycle()
+        body_buf:recycle()
         if state ~= 'closed' then
             if callback('reconnect_timeout') then
                 set_state('error_reconnect', err, msg)
@@ -663,6 +717,12 @@ local function connect(...)
             return not opts.console
         elseif what == 'fetch_connect_timeout' then
             return opts.connect_timeout or 10
+        elseif what == 'compression_threshold' then
+            if opts.compression == true then
+                return COMPRESSION_THRESHOLD
+            elseif type(opts.compression) == 'number' then
+                return opts.compression
+            end
         elseif what == 'did_fetch_schema' then
             remote:_install_schema(...)
         elseif what == 'reconnect_timeout' then
@@ -788,11 +848,16 @@ function remote_methods:_request(method, opts, ...)
             return res -- the length of xrow.body
         elseif not err then
             setmetatable(res, sequence_mt)
-            local postproc = method ~= 'eval' and method ~= 'call_17'
+            local postproc = method ~= 'eval' and method ~= 'call_17' and
+                             method ~= 'cursor_open'
             if postproc then
                 local tnew = box.tuple.new
                 for i, v in pairs(res) do
-                    res[i] = tnew(v)
+                    -- batch replies have nil for statements
+                    -- which return nothing
+                    if v ~= nil then
+                        res[i] = tnew(v)
+                    end
                 end
             end
             return res
@@ -1027,6 +1092,54 @@ function console_methods:eval(line, timeout)
     return res[1] or res
 end
 
+-- Execute several DML requests in one transaction on the
+-- server side, with a single WAL write. Every request is
+-- {'insert' | 'replace', space, tuple}, {'delete', space, key},
+-- {'update', space, key, ops} or {'upsert', space, tuple, ops};
+-- space is an id or a name. Returns a table with a result
+-- tuple (or nil) per request. If any request fails, none is
+-- applied.
+function remote_methods:batch(requests, opts)
+    check_remote_arg(self, 'batch')
+    if type(requests) ~= 'table' then
+        error("Use remote:batch({{'insert', space, tuple}, ...}, opts)")
+    end
+    local stmts = table_new(#requests, 0)
+    for i, r in ipairs(requests) do
+        local t = type(r) == 'table' and IPROTO_BATCH_TYPE[r[1]]
+        if not t then
+            error(string.format("batch request %d: expected "..
+                  "{'insert' | 'replace' | 'update' | 'delete' | "..
+                  "'upsert', space, ...}", i))
+        end
+        local space_id = r[2]
+        if type(space_id) ~= 'number' then
+            local space = self.space[space_id]
+            if space == nil then
+                box.error(box.error.NO_SUCH_SPACE, tostring(space_id))
+            end
+            space_id = space.id
+        end
+        stmts[i] = {t, space_id, r[3], r[4]}
+    end
+    return self:_request('batch', opts, stmts)
+end
+
+local cursor_methods = {}
+local cursor_mt = { __index = cursor_methods }
+
+-- Fetch the next batch of at most `limit` tuples, the server
+-- returns no more than 1000 at a time. An empty batch means
+-- the end of the result set. The cursor is closed on error.
+function cursor_methods:fetch(limit, opts)
+    limit = tonumber(limit) or 1000
+    return self.remote:_request('cursor_fetch', opts, self.id, limit)
+end
+
+function cursor_methods:close(opts)
+    self.remote:_request('cursor_close', opts, self.id)
+end
+
 local function one_tuple(tab)
     if type(tab) ~= 'table' then
         return tab
@@ -1053,6 +1166,11 @@ space_metatable = function(remote)
         return check_primary_index(self):select(key, opts)
     end
 
+    function methods:cursor(key, opts)
+        check_space_arg(self, 'cursor')
+        return check_primary_index(self):cursor(key, opts)
+    end
+
     function methods:delete(key, opts)
         check_space_arg(self, 'delete')
         return check_primary_index(self):delete(key, opts)
@@ -1099,6 +1217,20 @@ index_metatable = function(remote)
                                iterator, offset, limit, key)
     end
 
+    function methods:cursor(key, opts)
+        check_index_arg(self, 'cursor')
+        if opts and opts.buffer then
+            error("index:cursor() doesn't support `buffer` argument")
+        end
+        local key_is_nil = (key == nil or
+                            (type(key) == 'table' and #key == 0))
+        local iterator = check_iterator_type(opts, key_is_nil)
+        local offset = tonumber(opts and opts.offset) or 0
+        local res = remote:_request('cursor_open', opts, self.space.id,
+                                    self.id, iterator, offset, key)
+        return setmetatable({remote = remote, id = res[1]}, cursor_mt)
+    end
+
     function methods:get(key, opts)
         check_index_arg(self, 'get')
         if opts and opts.buffer then
@@ -160,6 +160,21 @@ local function sequence_resolve(name_or_id)
     end
 end
 
+local function func_resolve(name_or_id)
+    local _func = box.space[box.schema.FUNC_ID]
+    local tuple
+    if type(name_or_id) == 'string' then
+        tuple = _func.index.name:get{name_or_id}
+    elseif type(name_or_id) ~= 'nil' then
+        tuple = _func:get{name_or_id}
+    end
+    if tuple ~= nil then
+        return tuple[1], tuple
+    else
+        return nil
+    end
+end
+
 -- Revoke all privileges associated with the given object.
 local function revoke_object_privs(object_type, object_id)
     local _priv = box.space[box.schema.PRIV_ID]
@@ -553,6 +568,12 @@ local function update_index_parts(format, parts)
                 end
             end
         end
+        -- Support 'field[*]' shortcut for multikey parts
+        if type(part.field) == 'string' and part.field:sub(-3) == '[*]' then
+            part.field = part.field:sub(1, -4)
+            part.is_multikey = true
+            parts_can_be_simplified = false
+        end
         if type(part.field) ~= 'number' and type(part.field) ~= 'string' then
             box.error(box.error.ILLEGAL_PARAMS,
                       "options.parts[" .. i .. "]: field (name or number) is expected")
@@ -571,9 +592,14 @@ local function update_index_parts(format, parts)
             box.error(box.error.ILLEGAL_PARAMS,
                       "options.parts[" .. i .. "]: field (number) must be one-based")
         end
+        if part.is_multikey ~= nil and type(part.is_multikey) ~= 'boolean' then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "options.parts[" .. i .. "]: is_multikey (boolean) is expected")
+        end
         local fmt = format[part.field]
         if part.type == nil then
-            if fmt and fmt.type then
+            -- The format describes the array, not its elements
+            if fmt and fmt.type and not part.is_multikey then
                 part.type = fmt.type
             else
                 part.type = 'scalar'
@@ -617,6 +643,44 @@ local function simplify_index_parts(parts)
     return new_parts
 end
 
+--
+-- Convert a partial index filter into the _index format:
+-- an array of {zero-based field no, operator, value}.
+-- A single condition may be passed without wrapping.
+--
+local function update_index_filter(format, filter)
+    if #filter > 0 and type(filter[1]) ~= 'table' then
+        filter = {filter}
+    end
+    local result = {}
+    for i, cond in ipairs(filter) do
+        -- box.NULL value is allowed, so check the length
+        if type(cond) ~= 'table' or #cond ~= 3 or
+           type(cond[2]) ~= 'string' then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "options.filter[" .. i .. "]: {field, operator, value} is expected")
+        end
+        local field = cond[1]
+        if type(field) == 'string' then
+            for k, v in pairs(format) do
+                if v.name == field then
+                    field = k
+                    break
+                end
+            end
+            if type(field) == 'string' then
+                box.error(box.error.ILLEGAL_PARAMS,
+                          "options.filter[" .. i .. "]: field was not found by name '" .. field .. "'")
+            end
+        elseif type(field) ~= 'number' or field < 1 then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "options.filter[" .. i .. "]: field (name or one-based number) is expected")
+        end
+        table.insert(result, {field - 1, cond[2], cond[3]})
+    end
+    return result
+end
+
 -- Historically, some properties of an index
 -- are stored as tuple fields, others in a
 -- single field containing msgpack map.
@@ -642,6 +706,7 @@ local alter_index_template = {
     type = 'string',
     parts = 'table',
     sequence = 'boolean, number, string',
+    filter = 'table',
 }
 for k, v in pairs(index_options) do
     alter_index_template[k] = v
@@ -653,6 +718,7 @@ end
 --
 local create_index_template = table.deepcopy(alter_index_template)
 create_index_template.if_not_exists = "boolean"
+create_index_template.func = 'number, string'
 
 box.schema.index.create = function(space_id, name, options)
     check_param(space_id, 'space_id', 'number')
@@ -663,6 +729,16 @@ box.schema.index.create = function(space_id, name, options)
         box.error(box.error.NO_SUCH_SPACE, '#'..tostring(space_id))
     end
     local format = space:format()
+    local func_id
+    if options ~= nil and options.func ~= nil then
+        func_id = func_resolve(options.func)
+        if func_id == nil then
+            box.error(box.error.NO_SUCH_FUNCTION, tostring(options.func))
+        end
+        -- Parts of a functional index refer to the key returned
+        -- by the function, not to the tuple fields.
+        format = {}
+    end
 
     local options_defaults = {
         type = 'tree',
@@ -734,6 +810,9 @@ box.schema.index.create = function(space_id, name, options)
             run_count_per_level = options.run_count_per_level,
             run_size_ratio = options.run_size_ratio,
             bloom_fpr = options.bloom_fpr,
+            func = func_id,
+            filter = options.filter and
+                     update_index_filter(space:format(), options.filter),
     }
     local field_type_aliases = {
         num = 'unsigned'; -- Deprecated since 1.7.2
@@ -875,6 +954,10 @@ box.schema.index.alter = function(space_id, index_id, options)
         index_opts = tuple[OPTS]
         parts = tuple[PARTS]
     end
+    if index_opts.func ~= nil then
+        -- Parts of a functional index refer to the function result.
+        format = {}
+    end
     if options.name == nil then
         options.name = tuple[3]
     end
@@ -886,6 +969,9 @@ box.schema.index.alter = function(space_id, index_id, options)
             index_opts[k] = options[k]
         end
     end
+    if options.filter then
+        index_opts.filter = update_index_filter(space:format(), options.filter)
+    end
     if options.parts then
         local parts_can_be_simplified
         parts, parts_can_be_simplified =
@@ -1030,6 +1116,19 @@ local function check_space_exists(space)
     end
 end
 
+-- Insert tuples yielded by a luafun iterator into a space in
+-- one transaction. If the space is empty and all its secondary
+-- keys are non-unique trees, memtx builds the indexes once at
+-- the end or on the first read of the space, as long as the
+-- tuples come in primary key order.
+local function bulk_load(space, gen, param, state)
+    internal.begin_bulk_load(space.id)
+    for _, tuple in gen, param, state do
+        space:insert(tuple)
+    end
+    internal.end_bulk_load(space.id)
+end
+
 -- Helper function to check index:method() usage
 local function check_index_arg(index, method)
     if type(index) ~= 'table' or index.id == nil then
@@ -1398,6 +1497,18 @@ function box.schema.space.bless(space)
         check_space_arg(space, 'truncate')
         return internal.truncate(space.id)
     end
+    space_mt.bulk_load = function(space, ...)
+        check_space_arg(space, 'bulk_load')
+        check_space_exists(space)
+        box.begin()
+        local ok, err = pcall(bulk_load, space, fun.iter(...))
+        if not ok then
+            box.rollback()
+            pcall(internal.end_bulk_load, space.id)
+            error(err, 2)
+        end
+        box.commit()
+    end
     space_mt.format = function(space, format)
         check_space_arg(space, 'format')
         return box.schema.space.format(space.id, format)
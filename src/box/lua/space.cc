@@ -33,6 +33,7 @@
 #include "box/sql/sqliteLimit.h"
 #include "lua/utils.h"
 #include "lua/trigger.h"
+#include "lua/msgpack.h"
 
 extern "C" {
 	#include <lua.h>
@@ -264,6 +265,11 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 				lua_setfield(L, -2, "collation");
 			}
 
+			if (part->is_multikey) {
+				lua_pushboolean(L, true);
+				lua_setfield(L, -2, "is_multikey");
+			}
+
 			lua_settable(L, -3); /* index[k].parts[j] */
 		}
 
@@ -274,6 +280,33 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 			lua_setfield(L, -2, "sequence_id");
 		}
 
+		if (index_opts->func_id != 0) {
+			lua_pushnumber(L, index_opts->func_id);
+			lua_setfield(L, -2, "func_id");
+		}
+
+		if (index_opts->filter != NULL) {
+			lua_pushstring(L, "filter");
+			lua_newtable(L);
+			const char *filter = index_opts->filter;
+			uint32_t cond_count = mp_decode_array(&filter);
+			for (uint32_t j = 0; j < cond_count; j++) {
+				lua_createtable(L, 3, 0);
+				mp_decode_array(&filter);
+				lua_pushnumber(L, mp_decode_uint(&filter) +
+					       TUPLE_INDEX_BASE);
+				lua_rawseti(L, -2, 1);
+				uint32_t len;
+				const char *op = mp_decode_str(&filter, &len);
+				lua_pushlstring(L, op, len);
+				lua_rawseti(L, -2, 2);
+				luamp_decode(L, luaL_msgpack_default, &filter);
+				lua_rawseti(L, -2, 3);
+				lua_rawseti(L, -2, j + 1);
+			}
+			lua_settable(L, -3); /* space.index[k].filter */
+		}
+
 		if (space_is_vinyl(space)) {
 			lua_pushstring(L, "options");
 			lua_newtable(L);
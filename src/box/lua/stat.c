@@ -40,12 +40,11 @@
 
 #include "box/box.h"
 #include "box/iproto.h"
+#include "box/wal.h"
 #include "lua/utils.h"
 
 extern struct rmean *rmean_box;
 extern struct rmean *rmean_error;
-/** network statistics (iproto & cbus) */
-extern struct rmean *rmean_net;
 extern struct rmean *rmean_tx_wal_bus;
 
 static void
@@ -120,18 +119,193 @@ lbox_stat_reset(struct lua_State *L)
 	return 0;
 }
 
+static int
+set_queue_stat_item(const struct iproto_queue_stat *stat, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *) cb_ctx;
+
+	lua_pushstring(L, stat->name);
+	lua_newtable(L);
+
+	lua_pushstring(L, "depth");
+	lua_pushnumber(L, stat->depth);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "in_flight");
+	lua_pushnumber(L, stat->in_flight);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "total");
+	lua_pushnumber(L, stat->total);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "wait_time");
+	lua_pushnumber(L, stat->wait_time);
+	lua_settable(L, -3);
+
+	lua_settable(L, -3);
+	return 0;
+}
+
+/** Push box.stat.net.QUEUES table: statistics per request class. */
+static void
+push_queue_stat(struct lua_State *L)
+{
+	lua_newtable(L);
+	if (iproto_queue_stat_foreach(set_queue_stat_item, L) != 0)
+		luaT_error(L);
+}
+
+/** Push box.stat.net.COMPRESSION table. */
+static void
+push_compression_stat(struct lua_State *L)
+{
+	struct iproto_compression_stat stat;
+	if (iproto_compression_stat(&stat) != 0)
+		luaT_error(L);
+	lua_newtable(L);
+
+	lua_pushstring(L, "replies");
+	lua_pushnumber(L, stat.replies);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "requests");
+	lua_pushnumber(L, stat.requests);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "saved");
+	lua_pushnumber(L, stat.saved);
+	lua_settable(L, -3);
+}
+
+static int
+set_latency_stat_item(const struct iproto_latency_stat *stat, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *) cb_ctx;
+
+	lua_pushstring(L, stat->name);
+	lua_newtable(L);
+
+	lua_pushstring(L, "count");
+	lua_pushnumber(L, stat->count);
+	lua_settable(L, -3);
+
+	for (int i = 0; i < iproto_latency_stage_MAX; i++) {
+		lua_pushstring(L, iproto_latency_stage_strs[i]);
+		lua_newtable(L);
+
+		lua_pushstring(L, "p50");
+		lua_pushnumber(L, stat->p50[i]);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "p99");
+		lua_pushnumber(L, stat->p99[i]);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "p999");
+		lua_pushnumber(L, stat->p999[i]);
+		lua_settable(L, -3);
+
+		lua_settable(L, -3);
+	}
+
+	lua_settable(L, -3);
+	return 0;
+}
+
+/**
+ * Push box.stat.net.LATENCY table: latency percentiles of
+ * each stage of processing per request type.
+ */
+static void
+push_latency_stat(struct lua_State *L)
+{
+	lua_newtable(L);
+	if (iproto_latency_stat_foreach(set_latency_stat_item, L) != 0)
+		luaT_error(L);
+}
+
 static int
 lbox_stat_net_index(struct lua_State *L)
 {
-	luaL_checkstring(L, -1);
-	return rmean_foreach(rmean_net, seek_stat_item, L);
+	const char *key = luaL_checkstring(L, -1);
+	if (strcmp(key, "QUEUES") == 0) {
+		push_queue_stat(L);
+		return 1;
+	}
+	if (strcmp(key, "COMPRESSION") == 0) {
+		push_compression_stat(L);
+		return 1;
+	}
+	if (strcmp(key, "LATENCY") == 0) {
+		push_latency_stat(L);
+		return 1;
+	}
+	return iproto_rmean_foreach(seek_stat_item, L);
 }
 
 static int
 lbox_stat_net_call(struct lua_State *L)
 {
 	lua_newtable(L);
-	rmean_foreach(rmean_net, set_stat_item, L);
+	iproto_rmean_foreach(set_stat_item, L);
+	lua_pushstring(L, "QUEUES");
+	push_queue_stat(L);
+	lua_settable(L, -3);
+	lua_pushstring(L, "COMPRESSION");
+	push_compression_stat(L);
+	lua_settable(L, -3);
+	lua_pushstring(L, "LATENCY");
+	push_latency_stat(L);
+	lua_settable(L, -3);
+	return 1;
+}
+
+/** box.stat.wal(): statistics of WAL writes. */
+static int
+lbox_stat_wal(struct lua_State *L)
+{
+	struct wal_stat stat;
+	wal_stat(&stat);
+	lua_newtable(L);
+
+	lua_pushstring(L, "groups");
+	lua_pushnumber(L, stat.groups);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "entries");
+	lua_pushnumber(L, stat.entries);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "group_size");
+	lua_newtable(L);
+	lua_pushstring(L, "p50");
+	lua_pushnumber(L, stat.group_size_p50);
+	lua_settable(L, -3);
+	lua_pushstring(L, "p99");
+	lua_pushnumber(L, stat.group_size_p99);
+	lua_settable(L, -3);
+	lua_pushstring(L, "max");
+	lua_pushnumber(L, stat.group_size_max);
+	lua_settable(L, -3);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "fsyncs");
+	lua_pushnumber(L, stat.fsyncs);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "fsync_time");
+	lua_newtable(L);
+	lua_pushstring(L, "p50");
+	lua_pushnumber(L, stat.fsync_time_p50);
+	lua_settable(L, -3);
+	lua_pushstring(L, "p99");
+	lua_pushnumber(L, stat.fsync_time_p99);
+	lua_settable(L, -3);
+	lua_pushstring(L, "max");
+	lua_pushnumber(L, stat.fsync_time_max);
+	lua_settable(L, -3);
+	lua_settable(L, -3);
 	return 1;
 }
 
@@ -158,6 +332,9 @@ box_lua_stat_init(struct lua_State *L)
 
 	luaL_register_module(L, "box.stat", statlib);
 
+	lua_pushcfunction(L, lbox_stat_wal);
+	lua_setfield(L, -2, "wal");
+
 	lua_newtable(L);
 	luaL_register(L, NULL, lbox_stat_meta);
 	lua_setmetatable(L, -2);
@@ -32,16 +32,20 @@
 #include "memtx_space.h"
 #include "memtx_tuple.h"
 
+#include <fcntl.h>
 #include <small/small.h>
 #include <small/mempool.h>
 
 #include "coio_file.h"
+#include "tt_pthread.h"
 #include "tuple.h"
 #include "txn.h"
 #include "memtx_tree.h"
 #include "iproto_constants.h"
 #include "xrow.h"
 #include "xstream.h"
+#include "xlog_readahead.h"
+#include "memtx_snap_chain.h"
 #include "bootstrap.h"
 #include "replication.h"
 #include "schema.h"
@@ -126,6 +130,266 @@ memtx_build_secondary_keys(struct space *space, void *param)
 	return 0;
 }
 
+/**
+ * Tree indexes whose tuples are sorted in background
+ * threads before the trees are built on tx.
+ */
+struct memtx_sort_batch {
+	struct memtx_engine *memtx;
+	struct memtx_tree_index **indexes;
+	int count;
+	int capacity;
+	/** Thread each index is sorted by. */
+	int *thread_of;
+};
+
+/** A thread sorting its share of a batch. */
+struct memtx_sort_thread {
+	struct cord cord;
+	struct memtx_sort_batch *batch;
+	int id;
+	/** Number of tuples to sort. */
+	size_t load;
+};
+
+static int
+memtx_sort_batch_add(struct memtx_sort_batch *batch, struct index *index)
+{
+	if (index->def->type != TREE)
+		return 0;
+	/*
+	 * ICU collators keep state and can't be shared between
+	 * threads, so collated keys are sorted on tx.
+	 */
+	if (key_def_has_collation(index->def->cmp_def))
+		return 0;
+	if (batch->count == batch->capacity) {
+		int capacity = MAX(2 * batch->capacity, 16);
+		struct memtx_tree_index **indexes = realloc(batch->indexes,
+					capacity * sizeof(*indexes));
+		if (indexes == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*indexes),
+				 "realloc", "memtx sort batch");
+			return -1;
+		}
+		batch->indexes = indexes;
+		batch->capacity = capacity;
+	}
+	batch->indexes[batch->count++] = (struct memtx_tree_index *)index;
+	return 0;
+}
+
+static int
+memtx_sort_thread_f(va_list ap)
+{
+	struct memtx_sort_thread *thread =
+		va_arg(ap, struct memtx_sort_thread *);
+	struct memtx_sort_batch *batch = thread->batch;
+	for (int i = 0; i < batch->count; i++) {
+		if (batch->thread_of[i] == thread->id)
+			memtx_tree_index_sort_build(batch->indexes[i]);
+	}
+	return 0;
+}
+
+/** Order indexes by the number of tuples to sort, descending. */
+static int
+memtx_sort_batch_cmp(const void *a, const void *b)
+{
+	const struct memtx_tree_index *index_a =
+		*(struct memtx_tree_index * const *)a;
+	const struct memtx_tree_index *index_b =
+		*(struct memtx_tree_index * const *)b;
+	if (index_a->build_array_size > index_b->build_array_size)
+		return -1;
+	if (index_a->build_array_size < index_b->build_array_size)
+		return 1;
+	return 0;
+}
+
+/**
+ * Sort the build arrays of all indexes of a batch in
+ * memtx->build_threads threads. Indexes left unsorted,
+ * e.g. if a thread fails to start or the index has
+ * collated parts, are sorted by end_build() on tx as usual.
+ */
+static int
+memtx_sort_batch_run(struct memtx_sort_batch *batch)
+{
+	if (batch->count == 0)
+		return 0;
+	int thread_count = MIN(batch->memtx->build_threads, batch->count);
+	struct memtx_sort_thread *threads = calloc(thread_count,
+						   sizeof(*threads));
+	batch->thread_of = malloc(batch->count * sizeof(*batch->thread_of));
+	if (threads == NULL || batch->thread_of == NULL) {
+		diag_set(OutOfMemory, batch->count * sizeof(int),
+			 "malloc", "memtx sort threads");
+		free(threads);
+		return -1;
+	}
+	/* The largest index goes to the least loaded thread. */
+	qsort(batch->indexes, batch->count, sizeof(*batch->indexes),
+	      memtx_sort_batch_cmp);
+	for (int i = 0; i < batch->count; i++) {
+		int id = 0;
+		for (int j = 1; j < thread_count; j++) {
+			if (threads[j].load < threads[id].load)
+				id = j;
+		}
+		batch->thread_of[i] = id;
+		threads[id].load += batch->indexes[i]->build_array_size;
+	}
+	say_info("sorting %d keys in %d threads", batch->count, thread_count);
+	int started = 0;
+	for (; started < thread_count; started++) {
+		struct memtx_sort_thread *thread = &threads[started];
+		thread->batch = batch;
+		thread->id = started;
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "memtx.sort.%d", started);
+		if (cord_costart(&thread->cord, name,
+				 memtx_sort_thread_f, thread) != 0) {
+			diag_log();
+			break;
+		}
+	}
+	int rc = 0;
+	for (int i = 0; i < started; i++) {
+		if (cord_cojoin(&threads[i].cord) != 0)
+			rc = -1;
+	}
+	free(threads);
+	return rc;
+}
+
+static int
+memtx_add_primary_key_to_batch(struct space *space, void *param)
+{
+	struct memtx_sort_batch *batch = param;
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (space->engine != (struct engine *)batch->memtx ||
+	    space_index(space, 0) == NULL ||
+	    memtx_space->replace == memtx_space_replace_all_keys)
+		return 0;
+	return memtx_sort_batch_add(batch, space->index[0]);
+}
+
+/**
+ * Start building the secondary keys of a space: feed all
+ * of them in one pass over the primary key.
+ */
+static int
+memtx_begin_build_secondary_keys(struct space *space, void *param)
+{
+	struct memtx_sort_batch *batch = param;
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (space->engine != (struct engine *)batch->memtx ||
+	    space_index(space, 0) == NULL ||
+	    memtx_space->replace == memtx_space_replace_all_keys ||
+	    space->index_id_max == 0)
+		return 0;
+
+	struct index *pk = space->index[0];
+	ssize_t n_tuples = index_size(pk);
+	assert(n_tuples >= 0);
+	if (n_tuples > 0) {
+		say_info("Building secondary indexes in space '%s'...",
+			 space_name(space));
+	}
+	for (uint32_t j = 1; j < space->index_count; j++) {
+		struct index *index = space->index[j];
+		index_begin_build(index);
+		if (index_reserve(index, n_tuples * 1.2) < 0)
+			return -1;
+		if (memtx_sort_batch_add(batch, index) != 0)
+			return -1;
+	}
+
+	struct iterator *it = index_create_iterator(pk, ITER_ALL, NULL, 0);
+	if (it == NULL)
+		return -1;
+	int rc = 0;
+	struct tuple *tuple;
+	while ((rc = iterator_next(it, &tuple)) == 0 && tuple != NULL) {
+		for (uint32_t j = 1; j < space->index_count; j++) {
+			rc = index_build_next(space->index[j], tuple);
+			if (rc != 0)
+				break;
+		}
+		if (rc != 0)
+			break;
+	}
+	iterator_delete(it);
+	return rc;
+}
+
+static int
+memtx_end_build_secondary_keys(struct space *space, void *param)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (space->engine != param || space_index(space, 0) == NULL ||
+	    memtx_space->replace == memtx_space_replace_all_keys)
+		return 0;
+
+	if (space->index_id_max > 0) {
+		for (uint32_t j = 1; j < space->index_count; j++)
+			index_end_build(space->index[j]);
+		if (index_size(space->index[0]) > 0)
+			say_info("Space '%s': done", space_name(space));
+	}
+	memtx_space->replace = memtx_space_replace_all_keys;
+	return 0;
+}
+
+/**
+ * Finish the bulk build of the primary keys loaded from
+ * the snapshot. With several build threads, the keys of
+ * all spaces are sorted concurrently first.
+ */
+static int
+memtx_end_build_primary_keys(struct memtx_engine *memtx)
+{
+	int rc = 0;
+	if (memtx->build_threads > 1) {
+		struct memtx_sort_batch batch;
+		memset(&batch, 0, sizeof(batch));
+		batch.memtx = memtx;
+		rc = space_foreach(memtx_add_primary_key_to_batch, &batch);
+		if (rc == 0)
+			rc = memtx_sort_batch_run(&batch);
+		free(batch.indexes);
+		free(batch.thread_of);
+	}
+	if (rc == 0)
+		rc = space_foreach(memtx_end_build_primary_key, memtx);
+	return rc;
+}
+
+/**
+ * Build the secondary keys of all spaces. With several
+ * build threads, the keys of all spaces are sorted
+ * concurrently, and the trees are built afterwards.
+ */
+static int
+memtx_build_all_secondary_keys(struct memtx_engine *memtx)
+{
+	if (memtx->build_threads <= 1)
+		return space_foreach(memtx_build_secondary_keys, memtx);
+
+	struct memtx_sort_batch batch;
+	memset(&batch, 0, sizeof(batch));
+	batch.memtx = memtx;
+	int rc = space_foreach(memtx_begin_build_secondary_keys, &batch);
+	if (rc == 0)
+		rc = memtx_sort_batch_run(&batch);
+	if (rc == 0)
+		rc = space_foreach(memtx_end_build_secondary_keys, memtx);
+	free(batch.indexes);
+	free(batch.thread_of);
+	return rc;
+}
+
 static void
 memtx_engine_shutdown(struct engine *engine)
 {
@@ -147,6 +411,9 @@ static int
 memtx_engine_recover_snapshot_row(struct memtx_engine *memtx,
 				  struct xrow_header *row);
 
+static int
+memtx_engine_note_recovered_spaces(struct memtx_engine *memtx);
+
 int
 memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 			      const struct vclock *vclock)
@@ -158,16 +425,20 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 						    signature, NONE);
 
 	say_info("recovering from `%s'", filename);
-	struct xlog_cursor cursor;
-	if (xlog_cursor_open(&cursor, filename) < 0)
+	struct memtx_snap_cursor cursor;
+	if (memtx_snap_cursor_open(&cursor, &memtx->snap_dir,
+				   signature) != 0) {
+		memtx_snap_cursor_close(&cursor);
 		return -1;
-	INSTANCE_UUID = cursor.meta.instance_uuid;
+	}
+	INSTANCE_UUID = memtx_snap_cursor_meta(&cursor)->instance_uuid;
+	int delta_depth = cursor.chain.count - 1;
 
 	int rc;
 	struct xrow_header row;
 	uint64_t row_count = 0;
-	while ((rc = xlog_cursor_next(&cursor, &row,
-				      memtx->force_recovery)) == 0) {
+	while ((rc = memtx_snap_cursor_next(&cursor, &row,
+					    memtx->force_recovery)) == 0) {
 		row.lsn = signature;
 		rc = memtx_engine_recover_snapshot_row(memtx, &row);
 		if (rc < 0) {
@@ -183,18 +454,18 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 			fiber_yield_timeout(0);
 		}
 	}
-	xlog_cursor_close(&cursor, false);
+	memtx_snap_cursor_close(&cursor);
 	if (rc < 0)
 		return -1;
-
-	/**
-	 * We should never try to read snapshots with no EOF
-	 * marker - such snapshots are very likely corrupted and
-	 * should not be trusted.
+	/*
+	 * The next checkpoint may be based on this one, unless
+	 * some rows could have been skipped.
 	 */
-	if (!xlog_cursor_is_eof(&cursor))
-		panic("snapshot `%s' has no EOF marker", filename);
-
+	if (!memtx->force_recovery &&
+	    memtx_engine_note_recovered_spaces(memtx) == 0) {
+		memtx->delta_base = signature;
+		memtx->delta_depth = delta_depth;
+	}
 	return 0;
 }
 
@@ -263,7 +534,8 @@ memtx_engine_begin_final_recovery(struct engine *engine)
 
 	assert(memtx->state == MEMTX_INITIAL_RECOVERY);
 	/* End of the fast path: loaded the primary key. */
-	space_foreach(memtx_end_build_primary_key, memtx);
+	if (memtx_end_build_primary_keys(memtx) != 0)
+		return -1;
 
 	if (!memtx->force_recovery) {
 		/*
@@ -281,7 +553,7 @@ memtx_engine_begin_final_recovery(struct engine *engine)
 		 * unique keys.
 		 */
 		memtx->state = MEMTX_OK;
-		if (space_foreach(memtx_build_secondary_keys, memtx) != 0)
+		if (memtx_build_all_secondary_keys(memtx) != 0)
 			return -1;
 	}
 	return 0;
@@ -300,7 +572,7 @@ memtx_engine_end_recovery(struct engine *engine)
 	if (memtx->state != MEMTX_OK) {
 		assert(memtx->state == MEMTX_FINAL_RECOVERY);
 		memtx->state = MEMTX_OK;
-		if (space_foreach(memtx_build_secondary_keys, memtx) != 0)
+		if (memtx_build_all_secondary_keys(memtx) != 0)
 			return -1;
 	}
 	return 0;
@@ -384,7 +656,27 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 		index_count = space->index_count;
 	else if (memtx_space->replace == memtx_space_replace_primary_key)
 		index_count = 1;
-	else
+	else if (memtx_space->replace == memtx_space_replace_bulk_load) {
+		if (stmt->new_tuple != NULL &&
+		    stmt->new_tuple == memtx_space->bulk_load_last) {
+			/* The tuple is still in the build arrays. */
+			memtx_space_undo_bulk_load(space, stmt->new_tuple);
+			index_count = 0;
+		} else {
+			/*
+			 * The change was made before the bulk load
+			 * began, so the statements of the load have
+			 * been rolled back and there is nothing to
+			 * build.
+			 */
+			if (memtx_space_end_bulk_load(space) != 0) {
+				diag_log();
+				unreachable();
+				panic("failed to rollback change");
+			}
+			index_count = space->index_count;
+		}
+	} else
 		panic("transaction rolled back during snapshot recovery");
 
 	for (int i = 0; i < index_count; i++) {
@@ -398,10 +690,18 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 			panic("failed to rollback change");
 		}
 	}
-	/** Reset to old bsize, if it was changed. */
-	if (stmt->engine_savepoint != NULL)
+	if (index_count > 0 && stmt->new_tuple != NULL)
+		memtx_space_forget_func_keys(space, stmt->new_tuple);
+	/*
+	 * Reset to old bsize, if it was changed. A checkpoint
+	 * may have been started since the change, so the space
+	 * must be marked dirty again.
+	 */
+	if (stmt->engine_savepoint != NULL) {
 		memtx_space_update_bsize(space, stmt->new_tuple,
 					 stmt->old_tuple);
+		memtx_space->is_dirty = true;
+	}
 
 	if (stmt->new_tuple)
 		tuple_unref(stmt->new_tuple);
@@ -426,8 +726,11 @@ memtx_engine_commit(struct engine *engine, struct txn *txn)
 	(void)engine;
 	struct txn_stmt *stmt;
 	stailq_foreach_entry(stmt, &txn->stmts, next) {
-		if (stmt->old_tuple)
+		if (stmt->old_tuple) {
+			memtx_space_forget_func_keys(stmt->space,
+						     stmt->old_tuple);
 			tuple_unref(stmt->old_tuple);
+		}
 	}
 }
 
@@ -515,9 +818,53 @@ checkpoint_write_tuple(struct xlog *l, uint32_t space_id,
 struct checkpoint_entry {
 	struct space *space;
 	struct snapshot_iterator *iterator;
+	/** Set for system spaces, which are always written first. */
+	bool is_system;
+	/** Size of the space data, to balance writer threads. */
+	size_t size;
+	/** Writer thread of a user space, if written in parallel. */
+	int writer;
+	/** Set if the space has changed since the last checkpoint. */
+	bool is_dirty;
 	struct rlist link;
 };
 
+static_assert(MEMTX_INCREMENTAL_CHECKPOINTS_MAX < MEMTX_SNAP_CHAIN_MAX,
+	      "a checkpoint chain must fit in struct memtx_snap_chain");
+
+/** A growing array of space ids. */
+struct checkpoint_space_ids {
+	uint32_t *ids;
+	int count;
+	int capacity;
+};
+
+static int
+checkpoint_space_ids_add(struct checkpoint_space_ids *spaces, uint32_t id)
+{
+	if (spaces->count == spaces->capacity) {
+		int capacity = MAX(2 * spaces->capacity, 16);
+		uint32_t *ids = realloc(spaces->ids, capacity * sizeof(*ids));
+		if (ids == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*ids),
+				 "realloc", "space ids");
+			return -1;
+		}
+		spaces->ids = ids;
+		spaces->capacity = capacity;
+	}
+	spaces->ids[spaces->count++] = id;
+	return 0;
+}
+
+static int
+space_id_cmp(const void *a, const void *b)
+{
+	uint32_t id_a = *(const uint32_t *)a;
+	uint32_t id_b = *(const uint32_t *)b;
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
 struct checkpoint {
 	/**
 	 * List of MemTX spaces to snapshot, with consistent
@@ -525,6 +872,13 @@ struct checkpoint {
 	 */
 	struct rlist entries;
 	uint64_t snap_io_rate_limit;
+	/** Number of threads writing user spaces. */
+	int threads;
+	/**
+	 * Serializes writes of blocks encoded by writer
+	 * threads to the snapshot file.
+	 */
+	pthread_mutex_t mutex;
 	struct cord cord;
 	bool waiting_for_snap_thread;
 	/** The vclock of the snapshot file. */
@@ -535,15 +889,41 @@ struct checkpoint {
 	 * checkpoint already exists.
 	 */
 	bool touch;
+	/**
+	 * Set if the checkpoint is incremental: only system
+	 * spaces and the spaces changed since the checkpoint
+	 * with signature @a delta_base are written, the rest is
+	 * inherited from it.
+	 */
+	bool is_delta;
+	int64_t delta_base;
+	/** Spaces an incremental checkpoint doesn't inherit. */
+	uint32_t delta_spaces[XLOG_META_SPACES_MAX];
+	int delta_space_count;
+	/** User spaces stored in the checkpoint, sorted by id. */
+	struct checkpoint_space_ids spaces;
 };
 
 static int
 checkpoint_init(struct checkpoint *ckpt, const char *snap_dirname,
-		uint64_t snap_io_rate_limit)
+		uint64_t snap_io_rate_limit, bool direct_io, int threads,
+		int64_t delta_base)
 {
 	rlist_create(&ckpt->entries);
+	ckpt->is_delta = delta_base >= 0;
+	ckpt->delta_base = delta_base;
+	ckpt->delta_space_count = 0;
+	memset(&ckpt->spaces, 0, sizeof(ckpt->spaces));
+	ckpt->threads = threads;
+	tt_pthread_mutex_init(&ckpt->mutex, NULL);
 	ckpt->waiting_for_snap_thread = false;
 	xdir_create(&ckpt->dir, snap_dirname, SNAP, &INSTANCE_UUID);
+#ifdef O_DIRECT
+	if (direct_io)
+		ckpt->dir.open_wflags |= O_DIRECT;
+#else
+	(void) direct_io;
+#endif
 	ckpt->snap_io_rate_limit = snap_io_rate_limit;
 	/* May be used in abortCheckpoint() */
 	ckpt->vclock = malloc(sizeof(*ckpt->vclock));
@@ -565,8 +945,58 @@ checkpoint_destroy(struct checkpoint *ckpt)
 		entry->iterator->free(entry->iterator);
 	}
 	rlist_create(&ckpt->entries);
+	tt_pthread_mutex_destroy(&ckpt->mutex);
 	xdir_destroy(&ckpt->dir);
 	free(ckpt->vclock);
+	free(ckpt->spaces.ids);
+}
+
+/**
+ * Make an incremental checkpoint write space @a id in full.
+ * Falls back on a full checkpoint if there are too many
+ * such spaces to list.
+ */
+static void
+checkpoint_add_delta_space(struct checkpoint *ckpt, uint32_t id)
+{
+	if (!ckpt->is_delta)
+		return;
+	if (ckpt->delta_space_count == XLOG_META_SPACES_MAX) {
+		ckpt->is_delta = false;
+		return;
+	}
+	ckpt->delta_spaces[ckpt->delta_space_count++] = id;
+}
+
+/**
+ * Make an incremental checkpoint list the spaces stored in
+ * the previous checkpoint, @a prev, that don't exist anymore.
+ */
+static void
+checkpoint_add_dropped_spaces(struct checkpoint *ckpt,
+			      const uint32_t *prev, int prev_count)
+{
+	struct checkpoint_space_ids *spaces = &ckpt->spaces;
+	qsort(spaces->ids, spaces->count, sizeof(*spaces->ids),
+	      space_id_cmp);
+	for (int i = 0; i < prev_count; i++) {
+		if (bsearch(&prev[i], spaces->ids, spaces->count,
+			    sizeof(*spaces->ids), space_id_cmp) == NULL)
+			checkpoint_add_delta_space(ckpt, prev[i]);
+	}
+	qsort(ckpt->delta_spaces, ckpt->delta_space_count,
+	      sizeof(*ckpt->delta_spaces), space_id_cmp);
+}
+
+/**
+ * Check if an incremental checkpoint inherits a space from
+ * the checkpoint it is based on rather than writes it.
+ */
+static inline bool
+checkpoint_entry_is_inherited(struct checkpoint *ckpt,
+			      struct checkpoint_entry *entry)
+{
+	return ckpt->is_delta && !entry->is_system && !entry->is_dirty;
 }
 
 
@@ -577,10 +1007,20 @@ checkpoint_add_space(struct space *sp, void *data)
 		return 0;
 	if (!space_is_memtx(sp))
 		return 0;
+	struct checkpoint *ckpt = (struct checkpoint *)data;
+	struct memtx_space *memtx_space = (struct memtx_space *)sp;
+	bool is_dirty = memtx_space->is_dirty;
+	memtx_space->is_dirty = false;
+	if (!space_is_system(sp)) {
+		if (is_dirty)
+			checkpoint_add_delta_space(ckpt, space_id(sp));
+		if (checkpoint_space_ids_add(&ckpt->spaces,
+					     space_id(sp)) != 0)
+			return -1;
+	}
 	struct index *pk = space_index(sp, 0);
 	if (!pk)
 		return 0;
-	struct checkpoint *ckpt = (struct checkpoint *)data;
 	struct checkpoint_entry *entry;
 	entry = region_alloc_object(&fiber()->gc, struct checkpoint_entry);
 	if (entry == NULL) {
@@ -591,6 +1031,9 @@ checkpoint_add_space(struct space *sp, void *data)
 	rlist_add_tail_entry(&ckpt->entries, entry, link);
 
 	entry->space = sp;
+	entry->is_system = space_is_system(sp);
+	entry->size = space_bsize(sp);
+	entry->is_dirty = is_dirty;
 	entry->iterator = index_create_snapshot_iterator(pk);
 	if (entry->iterator == NULL)
 		return -1;
@@ -598,6 +1041,193 @@ checkpoint_add_space(struct space *sp, void *data)
 	return 0;
 };
 
+static int
+checkpoint_write_entry(struct xlog *l, struct checkpoint_entry *entry)
+{
+	uint32_t size;
+	const char *data;
+	struct snapshot_iterator *it = entry->iterator;
+	for (data = it->next(it, &size); data != NULL;
+	     data = it->next(it, &size)) {
+		if (checkpoint_write_tuple(l, space_id(entry->space),
+					   data, size) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+enum {
+	/**
+	 * Amount of encoded blocks a writer thread accumulates
+	 * before appending them to the snapshot file.
+	 */
+	CHECKPOINT_WRITER_BATCH = 1024 * 1024,
+};
+
+/** A thread encoding and writing a part of user spaces. */
+struct checkpoint_writer {
+	struct cord cord;
+	struct checkpoint *ckpt;
+	/** The snapshot file, shared by all writers. */
+	struct xlog *snap;
+	/** Entries of all writers, @sa checkpoint_entry::writer. */
+	struct checkpoint_entry **entries;
+	int entry_count;
+	/** Identifier of this writer. */
+	int id;
+	/** Total size of the entries assigned to this writer. */
+	size_t load;
+};
+
+/**
+ * Append the blocks encoded by a writer to the snapshot file.
+ * Blocks of different writers interleave in the file, which is
+ * fine for recovery: every block is self-contained, and user
+ * spaces are only required to follow system spaces.
+ */
+static int
+checkpoint_writer_flush(struct checkpoint_writer *writer,
+			struct ibuf *blocks, int64_t rows)
+{
+	if (ibuf_used(blocks) == 0)
+		return 0;
+	struct checkpoint *ckpt = writer->ckpt;
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	ssize_t written = xlog_write_raw(writer->snap, blocks->rpos,
+					 ibuf_used(blocks), rows);
+	tt_pthread_mutex_unlock(&ckpt->mutex);
+	ibuf_reset(blocks);
+	return written < 0 ? -1 : 0;
+}
+
+static int
+checkpoint_writer_f(va_list ap)
+{
+	struct checkpoint_writer *writer =
+		va_arg(ap, struct checkpoint_writer *);
+	struct ibuf blocks;
+	ibuf_create(&blocks, &cord()->slabc, CHECKPOINT_WRITER_BATCH);
+	struct xlog buf;
+	if (xlog_create_mem(&buf, writer->snap->filename, &blocks) != 0) {
+		ibuf_destroy(&blocks);
+		return -1;
+	}
+	xlog_copy_compression(&buf, writer->snap);
+	int rc = 0;
+	int64_t rows = 0;
+	for (int i = 0; i < writer->entry_count && rc == 0; i++) {
+		struct checkpoint_entry *entry = writer->entries[i];
+		if (entry->writer != writer->id)
+			continue;
+		uint32_t size;
+		const char *data;
+		struct snapshot_iterator *it = entry->iterator;
+		for (data = it->next(it, &size); data != NULL;
+		     data = it->next(it, &size)) {
+			rc = checkpoint_write_tuple(&buf,
+					space_id(entry->space), data, size);
+			if (rc == 0 &&
+			    ibuf_used(&blocks) >= CHECKPOINT_WRITER_BATCH) {
+				rc = checkpoint_writer_flush(writer, &blocks,
+							     buf.rows - rows);
+				rows = buf.rows;
+			}
+			if (rc != 0)
+				break;
+		}
+	}
+	if (rc == 0 && xlog_flush(&buf) < 0)
+		rc = -1;
+	if (rc == 0)
+		rc = checkpoint_writer_flush(writer, &blocks, buf.rows - rows);
+	tt_pthread_mutex_lock(&writer->ckpt->mutex);
+	xlog_merge_samples(writer->snap, &buf);
+	tt_pthread_mutex_unlock(&writer->ckpt->mutex);
+	xlog_close(&buf, false);
+	ibuf_destroy(&blocks);
+	return rc;
+}
+
+static int
+checkpoint_entry_cmp(const void *a, const void *b)
+{
+	size_t size_a = (*(struct checkpoint_entry **)a)->size;
+	size_t size_b = (*(struct checkpoint_entry **)b)->size;
+	return size_a > size_b ? -1 : size_a < size_b;
+}
+
+/**
+ * Write user spaces, starting from @a first entry, in
+ * several threads. Each thread encodes and compresses its
+ * spaces into tx blocks in memory and appends them to the
+ * snapshot file in batches.
+ */
+static int
+checkpoint_write_parallel(struct checkpoint *ckpt, struct xlog *snap,
+			  struct checkpoint_entry *first)
+{
+	int count = 0;
+	struct checkpoint_entry *entry;
+	for (entry = first; &entry->link != &ckpt->entries;
+	     entry = rlist_next_entry(entry, link)) {
+		if (!checkpoint_entry_is_inherited(ckpt, entry))
+			count++;
+	}
+	if (count == 0)
+		return 0;
+	int thread_count = MIN(ckpt->threads, count);
+	struct checkpoint_entry **entries = malloc(count * sizeof(*entries));
+	struct checkpoint_writer *writers = calloc(thread_count,
+						   sizeof(*writers));
+	if (entries == NULL || writers == NULL) {
+		diag_set(OutOfMemory, count * sizeof(*entries),
+			 "malloc", "checkpoint writers");
+		free(entries);
+		free(writers);
+		return -1;
+	}
+	int i = 0;
+	for (entry = first; &entry->link != &ckpt->entries;
+	     entry = rlist_next_entry(entry, link)) {
+		if (!checkpoint_entry_is_inherited(ckpt, entry))
+			entries[i++] = entry;
+	}
+	/* The largest space goes to the least loaded thread. */
+	qsort(entries, count, sizeof(*entries), checkpoint_entry_cmp);
+	for (i = 0; i < count; i++) {
+		int id = 0;
+		for (int j = 1; j < thread_count; j++) {
+			if (writers[j].load < writers[id].load)
+				id = j;
+		}
+		entries[i]->writer = id;
+		writers[id].load += entries[i]->size;
+	}
+	say_info("writing %d spaces in %d threads", count, thread_count);
+	int started = 0;
+	for (; started < thread_count; started++) {
+		struct checkpoint_writer *writer = &writers[started];
+		writer->ckpt = ckpt;
+		writer->snap = snap;
+		writer->entries = entries;
+		writer->entry_count = count;
+		writer->id = started;
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "snapshot.%d", started);
+		if (cord_costart(&writer->cord, name,
+				 checkpoint_writer_f, writer) != 0)
+			break;
+	}
+	int rc = started < thread_count ? -1 : 0;
+	for (i = 0; i < started; i++) {
+		if (cord_cojoin(&writers[i].cord) != 0)
+			rc = -1;
+	}
+	free(entries);
+	free(writers);
+	return rc;
+}
+
 static int
 checkpoint_f(va_list ap)
 {
@@ -608,42 +1238,96 @@ checkpoint_f(va_list ap)
 			return 0;
 		/*
 		 * Failed to touch an existing snapshot, create
-		 * a new one.
+		 * a new one. It can't be based on the snapshot
+		 * it replaces.
 		 */
 		ckpt->touch = false;
+		ckpt->is_delta = false;
 	}
 
 	struct xlog snap;
-	if (xdir_create_xlog(&ckpt->dir, &snap, ckpt->vclock) != 0)
+	int rc;
+	if (ckpt->is_delta) {
+		rc = xdir_create_delta_xlog(&ckpt->dir, &snap, ckpt->vclock,
+					    ckpt->delta_base,
+					    ckpt->delta_spaces,
+					    ckpt->delta_space_count);
+	} else {
+		rc = xdir_create_xlog(&ckpt->dir, &snap, ckpt->vclock);
+	}
+	if (rc != 0)
 		return -1;
 
 	snap.rate_limit = ckpt->snap_io_rate_limit;
 
-	say_info("saving snapshot `%s'", snap.filename);
+	if (ckpt->is_delta) {
+		say_info("saving incremental snapshot `%s', "
+			 "%d spaces changed", snap.filename,
+			 ckpt->delta_space_count);
+	} else {
+		say_info("saving snapshot `%s'", snap.filename);
+	}
 	struct checkpoint_entry *entry;
 	rlist_foreach_entry(entry, &ckpt->entries, link) {
-		uint32_t size;
-		const char *data;
-		struct snapshot_iterator *it = entry->iterator;
-		for (data = it->next(it, &size); data != NULL;
-		     data = it->next(it, &size)) {
-			if (checkpoint_write_tuple(&snap,
-					space_id(entry->space),
-					data, size) != 0) {
-				xlog_close(&snap, false);
-				return -1;
-			}
+		/*
+		 * System spaces are always written first and
+		 * in order, they are needed to recover the rest.
+		 */
+		if (ckpt->threads > 1 && !entry->is_system)
+			break;
+		if (checkpoint_entry_is_inherited(ckpt, entry))
+			continue;
+		if (checkpoint_write_entry(&snap, entry) != 0) {
+			xlog_close(&snap, false);
+			return -1;
 		}
 	}
 	if (xlog_flush(&snap) < 0) {
 		xlog_close(&snap, false);
 		return -1;
 	}
+	if (&entry->link != &ckpt->entries &&
+	    checkpoint_write_parallel(ckpt, &snap, entry) != 0) {
+		xlog_close(&snap, false);
+		return -1;
+	}
 	xlog_close(&snap, false);
 	say_info("done");
 	return 0;
 }
 
+static int
+recovered_space_add(struct space *sp, void *data)
+{
+	if (space_is_temporary(sp) || !space_is_memtx(sp))
+		return 0;
+	((struct memtx_space *)sp)->is_dirty = false;
+	if (space_is_system(sp))
+		return 0;
+	return checkpoint_space_ids_add(data, space_id(sp));
+}
+
+/**
+ * Mark all spaces loaded from a checkpoint clean and
+ * remember which of them it stores.
+ */
+static int
+memtx_engine_note_recovered_spaces(struct memtx_engine *memtx)
+{
+	struct checkpoint_space_ids spaces;
+	memset(&spaces, 0, sizeof(spaces));
+	if (space_foreach(recovered_space_add, &spaces) != 0) {
+		diag_log();
+		free(spaces.ids);
+		return -1;
+	}
+	qsort(spaces.ids, spaces.count, sizeof(*spaces.ids), space_id_cmp);
+	free(memtx->checkpoint_spaces);
+	memtx->checkpoint_spaces = spaces.ids;
+	memtx->checkpoint_space_count = spaces.count;
+	return 0;
+}
+
 static int
 memtx_engine_begin_checkpoint(struct engine *engine)
 {
@@ -657,15 +1341,36 @@ memtx_engine_begin_checkpoint(struct engine *engine)
 		return -1;
 	}
 
+	/*
+	 * Make an incremental checkpoint unless the chain of
+	 * the last one is already long enough.
+	 */
+	int64_t delta_base = -1;
+	if (memtx->delta_depth < memtx->incremental_checkpoints)
+		delta_base = memtx->delta_base;
+
 	if (checkpoint_init(memtx->checkpoint, memtx->snap_dir.dirname,
-			    memtx->snap_io_rate_limit) != 0)
+			    memtx->snap_io_rate_limit,
+			    memtx->snap_direct_io,
+			    memtx->checkpoint_threads, delta_base) != 0)
+		return -1;
+	if (xdir_copy_compression(&memtx->checkpoint->dir,
+				  &memtx->snap_dir) != 0) {
+		checkpoint_destroy(memtx->checkpoint);
+		memtx->checkpoint = NULL;
 		return -1;
+	}
 
 	if (space_foreach(checkpoint_add_space, memtx->checkpoint) != 0) {
 		checkpoint_destroy(memtx->checkpoint);
 		memtx->checkpoint = NULL;
+		/* Changes of some spaces may be lost now. */
+		memtx->delta_base = -1;
 		return -1;
 	}
+	checkpoint_add_dropped_spaces(memtx->checkpoint,
+				      memtx->checkpoint_spaces,
+				      memtx->checkpoint_space_count);
 
 	/* increment snapshot version; set tuple deletion to delayed mode */
 	memtx_tuple_begin_snapshot();
@@ -729,6 +1434,21 @@ memtx_engine_commit_checkpoint(struct engine *engine, struct vclock *vclock)
 			panic("can't rename .snap.inprogress");
 	}
 
+	/* The next checkpoint may be based on this one. */
+	struct checkpoint *ckpt = memtx->checkpoint;
+	if (!ckpt->touch) {
+		memtx->delta_base = vclock_sum(ckpt->vclock);
+		memtx->delta_depth = ckpt->is_delta ?
+				     memtx->delta_depth + 1 : 0;
+		/* Take the dictionary trained on the snapshot. */
+		if (xdir_copy_compression(&memtx->snap_dir, &ckpt->dir) != 0)
+			diag_log();
+	}
+	free(memtx->checkpoint_spaces);
+	memtx->checkpoint_spaces = ckpt->spaces.ids;
+	memtx->checkpoint_space_count = ckpt->spaces.count;
+	ckpt->spaces.ids = NULL;
+
 	struct vclock last;
 	if (xdir_last_vclock(&memtx->snap_dir, &last) < 0 ||
 	    vclock_compare(&last, vclock) != 0) {
@@ -768,6 +1488,8 @@ memtx_engine_abort_checkpoint(struct engine *engine)
 
 	checkpoint_destroy(memtx->checkpoint);
 	memtx->checkpoint = NULL;
+	/* Changes of some spaces may not be stored anywhere. */
+	memtx->delta_base = -1;
 }
 
 static int
@@ -781,7 +1503,20 @@ memtx_engine_collect_garbage(struct engine *engine, int64_t lsn)
 	 * file would result in a corrupted checkpoint on the list.
 	 * That said, we have to abort garbage collection if we
 	 * fail to delete a snap file.
+	 *
+	 * The oldest checkpoint to keep may be incremental, in
+	 * which case the snapshots it's based on must stay too.
 	 */
+	struct vclock *vclock = vclockset_first(&memtx->snap_dir.index);
+	while (vclock != NULL && vclock_sum(vclock) < lsn)
+		vclock = vclockset_next(&memtx->snap_dir.index, vclock);
+	if (vclock != NULL) {
+		struct memtx_snap_chain chain;
+		if (memtx_snap_chain_read(&memtx->snap_dir,
+					  vclock_sum(vclock), &chain) != 0)
+			return -1;
+		lsn = MIN(lsn, chain.signatures[chain.count - 1]);
+	}
 	if (xdir_collect_garbage(&memtx->snap_dir, lsn, true) != 0)
 		return -1;
 
@@ -793,9 +1528,17 @@ memtx_engine_backup(struct engine *engine, struct vclock *vclock,
 		    engine_backup_cb cb, void *cb_arg)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
-	char *filename = xdir_format_filename(&memtx->snap_dir,
-					      vclock_sum(vclock), NONE);
-	return cb(filename, cb_arg);
+	struct memtx_snap_chain chain;
+	if (memtx_snap_chain_read(&memtx->snap_dir, vclock_sum(vclock),
+				  &chain) != 0)
+		return -1;
+	for (int i = 0; i < chain.count; i++) {
+		char *filename = xdir_format_filename(&memtx->snap_dir,
+						      chain.signatures[i], NONE);
+		if (cb(filename, cb_arg) != 0)
+			return -1;
+	}
+	return 0;
 }
 
 /** Used to pass arguments to memtx_initial_join_f */
@@ -822,31 +1565,21 @@ memtx_initial_join_f(va_list ap)
 	 * safe to use in another thread.
 	 */
 	xdir_create(&dir, snap_dirname, SNAP, &INSTANCE_UUID);
-	struct xlog_cursor cursor;
-	int rc = xdir_open_cursor(&dir, checkpoint_lsn, &cursor);
-	xdir_destroy(&dir);
-	if (rc < 0)
-		return -1;
-
-	struct xrow_header row;
-	while ((rc = xlog_cursor_next(&cursor, &row, true)) == 0) {
-		rc = xstream_write(stream, &row);
-		if (rc < 0)
-			break;
+	struct memtx_snap_cursor cursor;
+	int rc = memtx_snap_cursor_open(&cursor, &dir, checkpoint_lsn);
+	if (rc == 0) {
+		struct xrow_header row;
+		/* TODO: replace panic on missing EOF with diag_set() */
+		while ((rc = memtx_snap_cursor_next(&cursor, &row,
+						    true)) == 0) {
+			rc = xstream_write(stream, &row);
+			if (rc < 0)
+				break;
+		}
 	}
-	xlog_cursor_close(&cursor, false);
-	if (rc < 0)
-		return -1;
-
-	/**
-	 * We should never try to read snapshots with no EOF
-	 * marker - such snapshots are very likely corrupted and
-	 * should not be trusted.
-	 */
-	/* TODO: replace panic with diag_set() */
-	if (!xlog_cursor_is_eof(&cursor))
-		panic("snapshot `%s' has no EOF marker", cursor.name);
-	return 0;
+	memtx_snap_cursor_close(&cursor);
+	xdir_destroy(&dir);
+	return rc < 0 ? -1 : 0;
 }
 
 static int
@@ -931,7 +1664,7 @@ static const struct engine_vtab memtx_engine_vtab = {
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 float alloc_factor)
+		 float alloc_factor, int build_threads)
 {
 	memtx_tuple_init(tuple_arena_max_size, objsize_min, alloc_factor);
 
@@ -953,6 +1686,8 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 
 	memtx->state = MEMTX_INITIALIZED;
 	memtx->force_recovery = force_recovery;
+	memtx->build_threads = build_threads;
+	memtx->delta_base = -1;
 
 	memtx->base.vtab = &memtx_engine_vtab;
 	memtx->base.name = "memtx";
@@ -965,6 +1700,33 @@ memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit)
 	memtx->snap_io_rate_limit = limit * 1024 * 1024;
 }
 
+void
+memtx_engine_set_snap_direct_io(struct memtx_engine *memtx, bool direct_io)
+{
+	memtx->snap_direct_io = direct_io;
+}
+
+void
+memtx_engine_set_checkpoint_threads(struct memtx_engine *memtx, int threads)
+{
+	memtx->checkpoint_threads = threads;
+}
+
+void
+memtx_engine_set_incremental_checkpoints(struct memtx_engine *memtx,
+					 int count)
+{
+	memtx->incremental_checkpoints = count;
+}
+
+void
+memtx_engine_set_compression(struct memtx_engine *memtx, int level,
+			     bool use_dict)
+{
+	memtx->snap_dir.compression_level = level;
+	memtx->snap_dir.use_dict = use_dict;
+}
+
 void
 memtx_engine_set_max_tuple_size(struct memtx_engine *memtx, size_t max_size)
 {
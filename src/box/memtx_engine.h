@@ -89,8 +89,39 @@ struct memtx_engine {
 	struct xdir snap_dir;
 	/** Limit disk usage of checkpointing (bytes per second). */
 	uint64_t snap_io_rate_limit;
+	/** Write snapshots bypassing the page cache. */
+	bool snap_direct_io;
+	/** Number of threads writing user spaces to a snapshot. */
+	int checkpoint_threads;
+	/**
+	 * Max number of incremental checkpoints made in a row
+	 * after a full one, 0 if all checkpoints are full.
+	 */
+	int incremental_checkpoints;
+	/**
+	 * Signature of the last checkpoint, which the next
+	 * incremental checkpoint may be based on, or -1 if there
+	 * is no such checkpoint.
+	 */
+	int64_t delta_base;
+	/** Number of incremental snapshots in the chain of @a delta_base. */
+	int delta_depth;
+	/**
+	 * Sorted ids of the user spaces stored in the last
+	 * checkpoint. An incremental checkpoint lists those of
+	 * them that have been dropped since, so as not to
+	 * inherit their data.
+	 */
+	uint32_t *checkpoint_spaces;
+	/** Number of entries in @a checkpoint_spaces. */
+	int checkpoint_space_count;
 	/** Skip invalid snapshot records if this flag is set. */
 	bool force_recovery;
+	/**
+	 * Number of threads sorting keys while indexes are
+	 * bulk built on recovery.
+	 */
+	int build_threads;
 	/** Memory pool for tree index iterator. */
 	struct mempool tree_iterator_pool;
 	/** Memory pool for rtree index iterator. */
@@ -104,7 +135,8 @@ struct memtx_engine {
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size,
-		 uint32_t objsize_min, float alloc_factor);
+		 uint32_t objsize_min, float alloc_factor,
+		 int build_threads);
 
 int
 memtx_engine_recover_snapshot(struct memtx_engine *memtx,
@@ -113,9 +145,49 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 void
 memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit);
 
+/**
+ * Enable or disable O_DIRECT for snapshot files. Takes effect
+ * on the next checkpoint.
+ */
+void
+memtx_engine_set_snap_direct_io(struct memtx_engine *memtx, bool direct_io);
+
+/**
+ * Set the number of threads writing user spaces to a snapshot.
+ * Takes effect on the next checkpoint.
+ */
+void
+memtx_engine_set_checkpoint_threads(struct memtx_engine *memtx, int threads);
+
+/**
+ * Set the max number of incremental checkpoints made in a row
+ * after a full one. Takes effect on the next checkpoint.
+ */
+void
+memtx_engine_set_incremental_checkpoints(struct memtx_engine *memtx,
+					 int count);
+
+/**
+ * Set the zstd level snapshots are compressed with and
+ * whether to compress them with a dictionary trained on
+ * the previous snapshot, @sa xdir::use_dict.
+ */
+void
+memtx_engine_set_compression(struct memtx_engine *memtx, int level,
+			     bool use_dict);
+
 void
 memtx_engine_set_max_tuple_size(struct memtx_engine *memtx, size_t max_size);
 
+enum {
+	/** Max number of key build threads. */
+	MEMTX_BUILD_THREADS_MAX = 64,
+	/** Max number of snapshot writer threads. */
+	MEMTX_CHECKPOINT_THREADS_MAX = 64,
+	/** Max number of incremental checkpoints in a row. */
+	MEMTX_INCREMENTAL_CHECKPOINTS_MAX = 64,
+};
+
 enum {
 	MEMTX_EXTENT_SIZE = 16 * 1024,
 	MEMTX_SLAB_SIZE = 4 * 1024 * 1024
@@ -157,12 +229,13 @@ memtx_index_extent_reserve(int num);
 static inline struct memtx_engine *
 memtx_engine_new_xc(const char *snap_dirname, bool force_recovery,
 		    uint64_t tuple_arena_max_size,
-		    uint32_t objsize_min, float alloc_factor)
+		    uint32_t objsize_min, float alloc_factor,
+		    int build_threads)
 {
 	struct memtx_engine *memtx;
 	memtx = memtx_engine_new(snap_dirname, force_recovery,
 				 tuple_arena_max_size,
-				 objsize_min, alloc_factor);
+				 objsize_min, alloc_factor, build_threads);
 	if (memtx == NULL)
 		diag_raise();
 	return memtx;
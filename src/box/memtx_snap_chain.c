@@ -0,0 +1,214 @@
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_snap_chain.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "diag.h"
+#include "fiber.h"
+#include "iproto_constants.h"
+#include "schema_def.h"
+#include "say.h"
+#include "trivia/util.h"
+#include "xrow.h"
+
+int
+memtx_snap_chain_read(struct xdir *dir, int64_t signature,
+		      struct memtx_snap_chain *chain)
+{
+	chain->count = 0;
+	while (true) {
+		if (chain->count == MEMTX_SNAP_CHAIN_MAX) {
+			diag_set(XlogError, "%s: snapshot chain is too long",
+				 xdir_format_filename(dir, signature, NONE));
+			return -1;
+		}
+		chain->signatures[chain->count++] = signature;
+		struct xlog_cursor cursor;
+		if (xdir_open_cursor(dir, signature, &cursor) != 0)
+			return -1;
+		bool is_delta = cursor.meta.is_delta;
+		int64_t base_signature = cursor.meta.base_signature;
+		xlog_cursor_close(&cursor, false);
+		if (!is_delta)
+			return 0;
+		if (base_signature >= signature) {
+			diag_set(XlogError, "%s: invalid base signature",
+				 xdir_format_filename(dir, signature, NONE));
+			return -1;
+		}
+		signature = base_signature;
+	}
+}
+
+static int
+cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+/** Open the file of the chain the cursor is at. */
+static int
+memtx_snap_cursor_open_file(struct memtx_snap_cursor *cursor)
+{
+	int64_t signature = cursor->chain.signatures[cursor->current];
+	if (xdir_open_cursor(cursor->dir, signature, &cursor->cursor) != 0)
+		return -1;
+	/* The chain was read from the same files a moment ago. */
+	bool is_base = cursor->current == cursor->chain.count - 1;
+	if (cursor->cursor.meta.is_delta == is_base) {
+		diag_set(XlogError, "%s: snapshot changed while being read",
+			 cursor->cursor.name);
+		xlog_cursor_close(&cursor->cursor, false);
+		return -1;
+	}
+	xlog_readahead_create(&cursor->readahead, &cursor->cursor);
+	xlog_readahead_start(&cursor->readahead);
+	return 0;
+}
+
+/** Close the file the cursor is at. */
+static void
+memtx_snap_cursor_close_file(struct memtx_snap_cursor *cursor)
+{
+	xlog_readahead_destroy(&cursor->readahead);
+	xlog_cursor_close(&cursor->cursor, false);
+}
+
+/**
+ * Add the spaces listed by the file the cursor is at to
+ * the spaces to skip in older files.
+ */
+static int
+memtx_snap_cursor_add_skip(struct memtx_snap_cursor *cursor)
+{
+	const struct xlog_meta *meta = &cursor->cursor.meta;
+	int count = cursor->skip_count + meta->space_count;
+	if (count > cursor->skip_capacity) {
+		int capacity = MAX(count, 2 * cursor->skip_capacity);
+		uint32_t *skip = realloc(cursor->skip,
+					 capacity * sizeof(*skip));
+		if (skip == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*skip),
+				 "realloc", "snapshot space list");
+			return -1;
+		}
+		cursor->skip = skip;
+		cursor->skip_capacity = capacity;
+	}
+	memcpy(cursor->skip + cursor->skip_count, meta->spaces,
+	       meta->space_count * sizeof(*meta->spaces));
+	cursor->skip_count = count;
+	qsort(cursor->skip, count, sizeof(*cursor->skip), cmp_u32);
+	return 0;
+}
+
+/**
+ * Check if a row of a file other than the newest one
+ * belongs to a space a newer file has the data of.
+ */
+static int
+memtx_snap_cursor_skip_row(struct memtx_snap_cursor *cursor,
+			   struct xrow_header *row, bool *skip)
+{
+	struct request request;
+	if (xrow_decode_dml(row, &request,
+			    dml_request_key_map(row->type)) != 0)
+		return -1;
+	uint32_t space_id = request.space_id;
+	*skip = (space_id > BOX_SYSTEM_ID_MIN &&
+		 space_id < BOX_SYSTEM_ID_MAX) ||
+		bsearch(&space_id, cursor->skip, cursor->skip_count,
+			sizeof(*cursor->skip), cmp_u32) != NULL;
+	return 0;
+}
+
+int
+memtx_snap_cursor_open(struct memtx_snap_cursor *cursor, struct xdir *dir,
+		       int64_t signature)
+{
+	memset(cursor, 0, sizeof(*cursor));
+	cursor->dir = dir;
+	if (memtx_snap_chain_read(dir, signature, &cursor->chain) != 0)
+		return -1;
+	return memtx_snap_cursor_open_file(cursor);
+}
+
+int
+memtx_snap_cursor_next(struct memtx_snap_cursor *cursor,
+		       struct xrow_header *row, bool force_recovery)
+{
+	while (true) {
+		int rc = xlog_readahead_next(&cursor->readahead, row,
+					     force_recovery);
+		if (rc < 0)
+			return -1;
+		if (rc == 0) {
+			if (cursor->current == 0)
+				return 0;
+			bool skip;
+			if (memtx_snap_cursor_skip_row(cursor, row,
+						       &skip) != 0)
+				return -1;
+			if (!skip)
+				return 0;
+			continue;
+		}
+		/*
+		 * We should never try to read snapshots with no
+		 * EOF marker - such snapshots are very likely
+		 * corrupted and should not be trusted.
+		 */
+		if (!xlog_cursor_is_eof(&cursor->cursor))
+			panic("snapshot `%s' has no EOF marker",
+			      cursor->cursor.name);
+		if (cursor->current == cursor->chain.count - 1)
+			return 1;
+		if (memtx_snap_cursor_add_skip(cursor) != 0)
+			return -1;
+		memtx_snap_cursor_close_file(cursor);
+		cursor->current++;
+		if (memtx_snap_cursor_open_file(cursor) != 0)
+			return -1;
+		say_info("reading `%s'", cursor->cursor.name);
+	}
+}
+
+void
+memtx_snap_cursor_close(struct memtx_snap_cursor *cursor)
+{
+	if (xlog_cursor_is_open(&cursor->cursor))
+		memtx_snap_cursor_close_file(cursor);
+	free(cursor->skip);
+}
@@ -0,0 +1,144 @@
+#ifndef TARANTOOL_BOX_MEMTX_SNAP_CHAIN_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_SNAP_CHAIN_H_INCLUDED
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "xlog.h"
+#include "xlog_readahead.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct xrow_header;
+
+/**
+ * A memtx checkpoint is either a full snapshot, or an
+ * incremental one, which has the data of the spaces changed
+ * since the previous checkpoint only, and is layered over the
+ * snapshot of that checkpoint, which may be incremental too.
+ * A chain is the list of files that make up a checkpoint.
+ */
+
+enum {
+	/** Max number of files in a chain, the full one included. */
+	MEMTX_SNAP_CHAIN_MAX = 65,
+};
+
+struct memtx_snap_chain {
+	/** Number of files, 1 for a full snapshot. */
+	int count;
+	/** Signatures of the files, from the newest to the full one. */
+	int64_t signatures[MEMTX_SNAP_CHAIN_MAX];
+};
+
+/**
+ * Read the chain of the checkpoint with signature @a signature
+ * from the meta of the snapshot files in @a dir.
+ *
+ * @retval 0 success
+ * @retval -1 error, a file is missing or corrupted
+ */
+int
+memtx_snap_chain_read(struct xdir *dir, int64_t signature,
+		      struct memtx_snap_chain *chain);
+
+/**
+ * Reads the rows of a checkpoint as if it was a single full
+ * snapshot: the system spaces and the spaces of the newest
+ * file first, then the spaces inherited from older files.
+ * Rows of system spaces and of the spaces listed by a newer
+ * file are skipped in older files.
+ */
+struct memtx_snap_cursor {
+	/** The snapshot directory. */
+	struct xdir *dir;
+	/** Files of the checkpoint. */
+	struct memtx_snap_chain chain;
+	/** Index of the file being read in @a chain. */
+	int current;
+	/** Cursor over the file being read. */
+	struct xlog_cursor cursor;
+	/** Reads @a cursor ahead in background, if enabled. */
+	struct xlog_readahead readahead;
+	/** Sorted ids of the spaces listed by the newer files. */
+	uint32_t *skip;
+	/** Number of entries in @a skip. */
+	int skip_count;
+	/** Allocated size of @a skip. */
+	int skip_capacity;
+};
+
+/**
+ * Open the checkpoint with signature @a signature in @a dir
+ * and the newest file of its chain for reading.
+ *
+ * @retval 0 success
+ * @retval -1 error
+ */
+int
+memtx_snap_cursor_open(struct memtx_snap_cursor *cursor, struct xdir *dir,
+		       int64_t signature);
+
+/**
+ * Return the meta of the newest file of the checkpoint.
+ * Valid until the cursor moves past this file.
+ */
+static inline const struct xlog_meta *
+memtx_snap_cursor_meta(struct memtx_snap_cursor *cursor)
+{
+	return &cursor->cursor.meta;
+}
+
+/**
+ * Fetch the next row of the checkpoint.
+ *
+ * Panics if a file has no EOF marker.
+ *
+ * @retval 0 success
+ * @retval 1 EOF of the last file
+ * @retval -1 error
+ */
+int
+memtx_snap_cursor_next(struct memtx_snap_cursor *cursor,
+		       struct xrow_header *row, bool force_recovery);
+
+/** Close the cursor. */
+void
+memtx_snap_cursor_close(struct memtx_snap_cursor *cursor);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_SNAP_CHAIN_H_INCLUDED */
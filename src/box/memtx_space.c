@@ -41,6 +41,8 @@
 #include "memtx_tuple.h"
 #include "column_mask.h"
 #include "sequence.h"
+#include "schema.h"
+#include "func.h"
 
 static void
 memtx_space_destroy(struct space *space)
@@ -143,6 +145,7 @@ memtx_space_replace_primary_key(struct space *space, struct tuple *old_tuple,
 			  new_tuple, mode, &old_tuple) != 0)
 		return -1;
 	memtx_space_update_bsize(space, old_tuple, new_tuple);
+	((struct memtx_space *)space)->is_dirty = true;
 	*result = old_tuple;
 	return 0;
 }
@@ -271,6 +274,7 @@ memtx_space_replace_all_keys(struct space *space, struct tuple *old_tuple,
 	}
 
 	memtx_space_update_bsize(space, old_tuple, new_tuple);
+	((struct memtx_space *)space)->is_dirty = true;
 	*result = old_tuple;
 	return 0;
 
@@ -286,6 +290,187 @@ rollback:
 			panic("failed to rollback change");
 		}
 	}
+	if (new_tuple != NULL)
+		memtx_space_forget_func_keys(space, new_tuple);
+	return -1;
+}
+
+void
+memtx_space_forget_func_keys(struct space *space, struct tuple *tuple)
+{
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct index *index = space->index[i];
+		if (index->def->opts.func_id == 0)
+			continue;
+		memtx_tree_index_forget_func_key(
+			(struct memtx_tree_index *)index, tuple);
+	}
+}
+
+/**
+ * Return true if a bulk load can append tuples to the given
+ * index with build_next() and sort them in
+ * memtx_space_end_bulk_load() rather than insert them one by
+ * one. This is the case for the primary key and non-unique
+ * tree indexes: the primary key can't get duplicates as the
+ * load must be ordered by it, while a duplicate in a unique
+ * secondary key must fail the offending statement.
+ */
+static inline bool
+memtx_space_index_is_bulk_loaded(struct index *index)
+{
+	return index->def->type == TREE &&
+	       (index->def->iid == 0 || !index->def->opts.is_unique);
+}
+
+/**
+ * Switch an empty space to bulk load mode for the rest of the
+ * current transaction. In this mode inserts go to
+ * memtx_space_replace_bulk_load() as long as they come in
+ * ascending primary key order, and a read of the space ends
+ * the bulk load first, @sa memtx_tree_index::is_bulk_loading.
+ *
+ * All indexes of the space must be bulk loaded, so that none
+ * of them has tuples the others haven't got. A space with
+ * triggers or a sequence is loaded the regular way too, as is
+ * a non-empty space.
+ */
+static int
+memtx_space_begin_bulk_load(struct space *space)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct txn *txn = in_txn();
+	struct index *pk = space_index(space, 0);
+	if (txn == NULL || pk == NULL ||
+	    memtx_space->replace != memtx_space_replace_all_keys ||
+	    index_size(pk) != 0 || space->sequence != NULL ||
+	    !rlist_empty(&space->before_replace) ||
+	    !rlist_empty(&space->on_replace))
+		return 0;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (!memtx_space_index_is_bulk_loaded(space->index[i]))
+			return 0;
+	}
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct index *index = space->index[i];
+		index_begin_build(index);
+		((struct memtx_tree_index *)index)->is_bulk_loading = true;
+	}
+	memtx_space->bulk_load_txn_id = txn->id;
+	memtx_space->bulk_load_last = NULL;
+	memtx_space->replace = memtx_space_replace_bulk_load;
+	return 0;
+}
+
+/**
+ * Reserve the extents the indexes take to build the trees of
+ * the tuples loaded so far, so that ending the bulk load
+ * can't fail half way.
+ */
+static int
+memtx_space_reserve_bulk_load(struct space *space)
+{
+	int count = 0;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		count += memtx_tree_index_build_extents(
+			(struct memtx_tree_index *)space->index[i]);
+	}
+	if (count == 0)
+		return 0;
+	return memtx_index_extent_reserve(count);
+}
+
+int
+memtx_space_end_bulk_load(struct space *space)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (memtx_space->replace != memtx_space_replace_bulk_load)
+		return 0;
+	if (memtx_space_reserve_bulk_load(space) != 0)
+		return -1;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct memtx_tree_index *index =
+			(struct memtx_tree_index *)space->index[i];
+		/* Tuples were appended in primary key order. */
+		if (i == 0)
+			index->build_array_is_sorted = true;
+		index->is_bulk_loading = false;
+		index_end_build(&index->base);
+	}
+	memtx_space->replace = memtx_space_replace_all_keys;
+	memtx_space->bulk_load_txn_id = 0;
+	memtx_space->bulk_load_last = NULL;
+	return 0;
+}
+
+void
+memtx_space_undo_bulk_load(struct space *space, struct tuple *tuple)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	assert(memtx_space->replace == memtx_space_replace_bulk_load);
+	assert(memtx_space->bulk_load_last == tuple);
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		memtx_tree_index_build_undo(
+			(struct memtx_tree_index *)space->index[i], tuple);
+	}
+	struct memtx_tree_index *pk =
+		(struct memtx_tree_index *)space->index[0];
+	memtx_space->bulk_load_last = pk->build_array_size == 0 ? NULL :
+		pk->build_array[pk->build_array_size - 1].tuple;
+}
+
+/**
+ * A short-cut version of replace() used by a bulk load.
+ * Appends the new tuple to the build arrays of all indexes.
+ * Ends the bulk load and falls back on replace_all_keys() on
+ * the first statement which is not an insert past the last
+ * loaded tuple or which comes from another transaction.
+ */
+int
+memtx_space_replace_bulk_load(struct space *space, struct tuple *old_tuple,
+			      struct tuple *new_tuple,
+			      enum dup_replace_mode mode,
+			      struct tuple **result)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct txn *txn = in_txn();
+	struct index *pk = space->index[0];
+	if (old_tuple != NULL || new_tuple == NULL || mode != DUP_INSERT ||
+	    txn == NULL || txn->id != memtx_space->bulk_load_txn_id ||
+	    (memtx_space->bulk_load_last != NULL &&
+	     tuple_compare(memtx_space->bulk_load_last, new_tuple,
+			   pk->def->key_def) >= 0)) {
+		if (memtx_space_end_bulk_load(space) != 0)
+			return -1;
+		return memtx_space_replace_all_keys(space, old_tuple,
+						    new_tuple, mode, result);
+	}
+
+	uint32_t i;
+	for (i = 0; i < space->index_count; i++) {
+		if (index_build_next(space->index[i], new_tuple) != 0)
+			goto rollback;
+	}
+	/*
+	 * Fail the statement rather than the end of the bulk
+	 * load if the indexes couldn't be built with it, like
+	 * replace_all_keys() does.
+	 */
+	if (memtx_space_reserve_bulk_load(space) != 0)
+		goto rollback;
+
+	memtx_space_update_bsize(space, NULL, new_tuple);
+	memtx_space->is_dirty = true;
+	memtx_space->bulk_load_last = new_tuple;
+	*result = NULL;
+	return 0;
+
+rollback:
+	for (; i > 0; i--) {
+		memtx_tree_index_build_undo(
+			(struct memtx_tree_index *)space->index[i - 1],
+			new_tuple);
+	}
 	return -1;
 }
 
@@ -623,6 +808,42 @@ memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 			return -1;
 		}
 	}
+	if (index_def->key_def->is_multikey && index_def->type != TREE) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 index_type_strs[index_def->type], "multikey parts");
+		return -1;
+	}
+	if (index_def->opts.filter != NULL && index_def->type != TREE) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 index_type_strs[index_def->type], "partial indexes");
+		return -1;
+	}
+	if (index_def->opts.func_id != 0) {
+		if (index_def->type != TREE) {
+			diag_set(ClientError, ER_UNSUPPORTED,
+				 index_type_strs[index_def->type],
+				 "functional indexes");
+			return -1;
+		}
+		/*
+		 * Indexes are recovered before functions, so
+		 * the function can only be checked afterwards.
+		 */
+		struct memtx_engine *memtx =
+			(struct memtx_engine *)space->engine;
+		struct func *func = func_by_id(index_def->opts.func_id);
+		if (func == NULL && memtx->state == MEMTX_OK) {
+			diag_set(ClientError, ER_NO_SUCH_FUNCTION,
+				 int2str(index_def->opts.func_id));
+			return -1;
+		}
+		if (func != NULL && func->def->language != FUNC_LANGUAGE_C) {
+			diag_set(ClientError, ER_FUNCTION_LANGUAGE,
+				 func_language_strs[func->def->language],
+				 func->def->name);
+			return -1;
+		}
+	}
 	switch (index_def->type) {
 	case HASH:
 		if (! index_def->opts.is_unique) {
@@ -916,6 +1137,9 @@ memtx_space_prepare_truncate(struct space *old_space,
 {
 	struct memtx_space *old_memtx_space = (struct memtx_space *)old_space;
 	struct memtx_space *new_memtx_space = (struct memtx_space *)new_space;
+	/* Don't carry over a bulk load of an aborted transaction. */
+	if (memtx_space_end_bulk_load(old_space) != 0)
+		return -1;
 	new_memtx_space->replace = old_memtx_space->replace;
 	return 0;
 }
@@ -960,8 +1184,8 @@ static void
 memtx_space_commit_truncate(struct space *old_space,
 			    struct space *new_space)
 {
-	(void)new_space;
 	memtx_space_prune(old_space);
+	((struct memtx_space *)new_space)->is_dirty = true;
 }
 
 static int
@@ -969,6 +1193,9 @@ memtx_space_prepare_alter(struct space *old_space, struct space *new_space)
 {
 	struct memtx_space *old_memtx_space = (struct memtx_space *)old_space;
 	struct memtx_space *new_memtx_space = (struct memtx_space *)new_space;
+	/* Don't carry over a bulk load of an aborted transaction. */
+	if (memtx_space_end_bulk_load(old_space) != 0)
+		return -1;
 	new_memtx_space->replace = old_memtx_space->replace;
 	bool is_empty = old_space->index_count == 0 ||
 			index_size(old_space->index[0]) == 0;
@@ -987,6 +1214,7 @@ memtx_space_commit_alter(struct space *old_space, struct space *new_space)
 		memtx_space_prune(old_space);
 	else
 		new_memtx_space->bsize = old_memtx_space->bsize;
+	new_memtx_space->is_dirty |= old_memtx_space->is_dirty;
 }
 
 /* }}} DDL */
@@ -1014,6 +1242,8 @@ static const struct space_vtab memtx_space_vtab = {
 	/* .commit_truncate = */ memtx_space_commit_truncate,
 	/* .prepare_alter = */ memtx_space_prepare_alter,
 	/* .commit_alter = */ memtx_space_commit_alter,
+	/* .begin_bulk_load = */ memtx_space_begin_bulk_load,
+	/* .end_bulk_load = */ memtx_space_end_bulk_load,
 };
 
 struct space *
@@ -1064,5 +1294,12 @@ memtx_space_new(struct memtx_engine *memtx,
 
 	memtx_space->bsize = 0;
 	memtx_space->replace = memtx_space_replace_no_keys;
+	/*
+	 * Spaces loaded from a snapshot are marked clean once
+	 * it's recovered, @sa memtx_engine_recover_snapshot().
+	 */
+	memtx_space->is_dirty = true;
+	memtx_space->bulk_load_txn_id = 0;
+	memtx_space->bulk_load_last = NULL;
 	return (struct space *)memtx_space;
 }
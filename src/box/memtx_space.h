@@ -48,6 +48,18 @@ struct memtx_space {
 	 */
 	int (*replace)(struct space *, struct tuple *, struct tuple *,
 		       enum dup_replace_mode, struct tuple **);
+	/**
+	 * Set if the space has changed since the last checkpoint
+	 * and so can't be inherited by an incremental one.
+	 */
+	bool is_dirty;
+	/**
+	 * Bulk load state, valid while replace is set to
+	 * memtx_space_replace_bulk_load(): the transaction
+	 * loading the space and the last tuple it inserted.
+	 */
+	int64_t bulk_load_txn_id;
+	struct tuple *bulk_load_last;
 };
 
 /**
@@ -76,6 +88,35 @@ memtx_space_replace_primary_key(struct space *, struct tuple *, struct tuple *,
 int
 memtx_space_replace_all_keys(struct space *, struct tuple *, struct tuple *,
 			     enum dup_replace_mode, struct tuple **);
+int
+memtx_space_replace_bulk_load(struct space *, struct tuple *, struct tuple *,
+			      enum dup_replace_mode, struct tuple **);
+
+/**
+ * Build the indexes filled by a bulk load and switch the
+ * space back to memtx_space_replace_all_keys(). Does nothing
+ * if the space is not being bulk loaded. Fails and leaves the
+ * bulk load going if the extents for the trees can't be
+ * reserved.
+ */
+int
+memtx_space_end_bulk_load(struct space *space);
+
+/**
+ * Forget the keys functional indexes of the space computed
+ * for a tuple which has been removed from the space by a
+ * committed statement or inserted by a rolled back one,
+ * @sa memtx_tree_index_forget_func_key().
+ */
+void
+memtx_space_forget_func_keys(struct space *space, struct tuple *tuple);
+
+/**
+ * Roll back the last statement of a bulk load: take its tuple
+ * back from the build arrays.
+ */
+void
+memtx_space_undo_bulk_load(struct space *space, struct tuple *tuple);
 
 struct space *
 memtx_space_new(struct memtx_engine *memtx,
@@ -30,12 +30,17 @@
  */
 #include "memtx_tree.h"
 #include "memtx_engine.h"
+#include "memtx_space.h"
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
 #include "memory.h"
 #include "fiber.h"
 #include "tuple.h"
+#include "assoc.h"
+#include "func.h"
+#include "port.h"
+#include "call.h" /* struct box_function_ctx */
 #include <third_party/qsort_arg.h>
 #include <small/mempool.h>
 
@@ -44,8 +49,9 @@
 static int
 memtx_tree_qcompare(const void* a, const void *b, void *c)
 {
-	return tuple_compare(*(struct tuple **)a,
-		*(struct tuple **)b, (struct key_def *)c);
+	return memtx_tree_compare((const struct memtx_tree_data *)a,
+				  (const struct memtx_tree_data *)b,
+				  (struct key_def *)c);
 }
 
 /* {{{ MemtxTree Iterators ****************************************/
@@ -56,7 +62,17 @@ struct tree_iterator {
 	struct memtx_tree_iterator tree_iterator;
 	enum iterator_type type;
 	struct memtx_tree_key_data key_data;
-	struct tuple *current_tuple;
+	struct memtx_tree_data current;
+	/**
+	 * A multikey index stores a tuple once per element of
+	 * the indexed array, so the same tuple may be met more
+	 * than once in a range. Tuples returned so far are
+	 * accumulated here to skip repeats; the hash holds
+	 * references to them. Created on demand.
+	 */
+	struct mh_i64ptr_t *returned;
+	/** The next method wrapped by the multikey one. */
+	iterator_next_f next_internal;
 	/** Memory pool the iterator was allocated from. */
 	struct mempool *pool;
 };
@@ -71,12 +87,46 @@ tree_iterator(struct iterator *it)
 	return (struct tree_iterator *) it;
 }
 
+/**
+ * Make an element the current one. The iterator references
+ * the tuple and, for a functional index, the computed key so
+ * that the position can be restored even if the element is
+ * deleted from the tree.
+ */
+static inline void
+tree_iterator_set_current(struct tree_iterator *it,
+			  const struct memtx_tree_data *res)
+{
+	it->current = *res;
+	tuple_ref(it->current.tuple);
+	if (it->index_def->key_def->for_func_index)
+		tuple_ref((struct tuple *)(uintptr_t)it->current.hint);
+}
+
+static inline void
+tree_iterator_reset_current(struct tree_iterator *it)
+{
+	tuple_unref(it->current.tuple);
+	if (it->index_def->key_def->for_func_index)
+		tuple_unref((struct tuple *)(uintptr_t)it->current.hint);
+	it->current.tuple = NULL;
+}
+
 static void
 tree_iterator_free(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	if (it->current_tuple != NULL)
-		tuple_unref(it->current_tuple);
+	if (it->current.tuple != NULL)
+		tree_iterator_reset_current(it);
+	if (it->returned != NULL) {
+		mh_int_t i;
+		mh_foreach(it->returned, i) {
+			struct tuple *tuple = (struct tuple *)
+				mh_i64ptr_node(it->returned, i)->val;
+			tuple_unref(tuple);
+		}
+		mh_i64ptr_delete(it->returned);
+	}
 	mempool_free(it->pool, it);
 }
 
@@ -91,25 +141,26 @@ tree_iterator_dummie(struct iterator *iterator, struct tuple **ret)
 static int
 tree_iterator_next(struct iterator *iterator, struct tuple **ret)
 {
-	struct tuple **res;
+	struct memtx_tree_data *res;
 	struct tree_iterator *it = tree_iterator(iterator);
-	assert(it->current_tuple != NULL);
-	struct tuple **check = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
-	if (check == NULL || *check != it->current_tuple)
+	assert(it->current.tuple != NULL);
+	struct memtx_tree_data *check =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	if (check == NULL || check->tuple != it->current.tuple ||
+	    check->hint != it->current.hint)
 		it->tree_iterator =
-			memtx_tree_upper_bound_elem(it->tree, it->current_tuple,
+			memtx_tree_upper_bound_elem(it->tree, it->current,
 						    NULL);
 	else
 		memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	tuple_unref(it->current_tuple);
-	it->current_tuple = NULL;
+	tree_iterator_reset_current(it);
 	res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (res == NULL) {
 		iterator->next = tree_iterator_dummie;
 		*ret = NULL;
 	} else {
-		*ret = it->current_tuple = *res;
-		tuple_ref(it->current_tuple);
+		tree_iterator_set_current(it, res);
+		*ret = it->current.tuple;
 	}
 	return 0;
 }
@@ -118,22 +169,24 @@ static int
 tree_iterator_prev(struct iterator *iterator, struct tuple **ret)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	assert(it->current_tuple != NULL);
-	struct tuple **check = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
-	if (check == NULL || *check != it->current_tuple)
+	assert(it->current.tuple != NULL);
+	struct memtx_tree_data *check =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	if (check == NULL || check->tuple != it->current.tuple ||
+	    check->hint != it->current.hint)
 		it->tree_iterator =
-			memtx_tree_lower_bound_elem(it->tree, it->current_tuple,
+			memtx_tree_lower_bound_elem(it->tree, it->current,
 						    NULL);
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	tuple_unref(it->current_tuple);
-	it->current_tuple = NULL;
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	tree_iterator_reset_current(it);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res) {
 		iterator->next = tree_iterator_dummie;
 		*ret = NULL;
 	} else {
-		*ret = it->current_tuple = *res;
-		tuple_ref(it->current_tuple);
+		tree_iterator_set_current(it, res);
+		*ret = it->current.tuple;
 	}
 	return 0;
 }
@@ -142,27 +195,27 @@ static int
 tree_iterator_next_equal(struct iterator *iterator, struct tuple **ret)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	assert(it->current_tuple != NULL);
-	struct tuple **check = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
-	if (check == NULL || *check != it->current_tuple)
+	assert(it->current.tuple != NULL);
+	struct memtx_tree_data *check =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	if (check == NULL || check->tuple != it->current.tuple ||
+	    check->hint != it->current.hint)
 		it->tree_iterator =
-			memtx_tree_upper_bound_elem(it->tree, it->current_tuple,
+			memtx_tree_upper_bound_elem(it->tree, it->current,
 						    NULL);
 	else
 		memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	tuple_unref(it->current_tuple);
-	it->current_tuple = NULL;
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
+	tree_iterator_reset_current(it);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	/* Use user key def to save a few loops. */
-	if (!res || memtx_tree_compare_key(*res, &it->key_data,
+	if (!res || memtx_tree_compare_key(res, &it->key_data,
 					   it->index_def->key_def) != 0) {
 		iterator->next = tree_iterator_dummie;
 		*ret = NULL;
 	} else {
-		*ret = it->current_tuple = *res;
-		tuple_ref(it->current_tuple);
+		tree_iterator_set_current(it, res);
+		*ret = it->current.tuple;
 	}
 	return 0;
 }
@@ -171,26 +224,73 @@ static int
 tree_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	assert(it->current_tuple != NULL);
-	struct tuple **check = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
-	if (check == NULL || *check != it->current_tuple)
+	assert(it->current.tuple != NULL);
+	struct memtx_tree_data *check =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	if (check == NULL || check->tuple != it->current.tuple ||
+	    check->hint != it->current.hint)
 		it->tree_iterator =
-			memtx_tree_lower_bound_elem(it->tree, it->current_tuple,
+			memtx_tree_lower_bound_elem(it->tree, it->current,
 						    NULL);
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	tuple_unref(it->current_tuple);
-	it->current_tuple = NULL;
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
+	tree_iterator_reset_current(it);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	/* Use user key def to save a few loops. */
-	if (!res || memtx_tree_compare_key(*res, &it->key_data,
+	if (!res || memtx_tree_compare_key(res, &it->key_data,
 					   it->index_def->key_def) != 0) {
 		iterator->next = tree_iterator_dummie;
 		*ret = NULL;
 	} else {
-		*ret = it->current_tuple = *res;
-		tuple_ref(it->current_tuple);
+		tree_iterator_set_current(it, res);
+		*ret = it->current.tuple;
+	}
+	return 0;
+}
+
+/**
+ * Remember that a tuple was returned by a multikey iterator.
+ * Sets *is_new to false if the tuple has already been returned.
+ */
+static int
+tree_iterator_mark_returned(struct tree_iterator *it, struct tuple *tuple,
+			    bool *is_new)
+{
+	if (it->returned == NULL) {
+		it->returned = mh_i64ptr_new();
+		if (it->returned == NULL) {
+			diag_set(OutOfMemory, sizeof(*it->returned),
+				 "mh_i64ptr_new", "returned");
+			return -1;
+		}
+	}
+	uint64_t key = (uintptr_t)tuple;
+	*is_new = mh_i64ptr_find(it->returned, key, NULL) ==
+		  mh_end(it->returned);
+	if (!*is_new)
+		return 0;
+	struct mh_i64ptr_node_t node = { key, tuple };
+	if (mh_i64ptr_put(it->returned, &node, NULL, NULL) ==
+	    mh_end(it->returned)) {
+		diag_set(OutOfMemory, 0, "mh_i64ptr_put", "returned");
+		return -1;
+	}
+	tuple_ref(tuple);
+	return 0;
+}
+
+static int
+tree_iterator_next_multikey(struct iterator *iterator, struct tuple **ret)
+{
+	struct tree_iterator *it = tree_iterator(iterator);
+	bool is_new = false;
+	while (!is_new) {
+		if (it->next_internal(iterator, ret) != 0)
+			return -1;
+		if (*ret == NULL)
+			return 0;
+		if (tree_iterator_mark_returned(it, *ret, &is_new) != 0)
+			return -1;
 	}
 	return 0;
 }
@@ -198,7 +298,7 @@ tree_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
 static void
 tree_iterator_set_next_method(struct tree_iterator *it)
 {
-	assert(it->current_tuple != NULL);
+	assert(it->current.tuple != NULL);
 	switch (it->type) {
 	case ITER_EQ:
 		it->base.next = tree_iterator_next_equal;
@@ -221,6 +321,10 @@ tree_iterator_set_next_method(struct tree_iterator *it)
 		/* The type was checked in initIterator */
 		assert(false);
 	}
+	if (it->index_def->key_def->is_multikey) {
+		it->next_internal = it->base.next;
+		it->base.next = tree_iterator_next_multikey;
+	}
 }
 
 static int
@@ -232,7 +336,7 @@ tree_iterator_start(struct iterator *iterator, struct tuple **ret)
 	const struct memtx_tree *tree = it->tree;
 	enum iterator_type type = it->type;
 	bool exact = false;
-	assert(it->current_tuple == NULL);
+	assert(it->current.tuple == NULL);
 	if (it->key_data.key == 0) {
 		if (iterator_type_is_reverse(it->type))
 			it->tree_iterator = memtx_tree_iterator_last(tree);
@@ -269,13 +373,18 @@ tree_iterator_start(struct iterator *iterator, struct tuple **ret)
 		}
 	}
 
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
-	*ret = it->current_tuple = *res;
-	tuple_ref(it->current_tuple);
+	tree_iterator_set_current(it, res);
+	*ret = it->current.tuple;
 	tree_iterator_set_next_method(it);
+	if (it->index_def->key_def->is_multikey) {
+		bool is_new;
+		if (tree_iterator_mark_returned(it, *ret, &is_new) != 0)
+			return -1;
+	}
 	return 0;
 }
 
@@ -300,10 +409,186 @@ memtx_tree_index_cmp_def(struct memtx_tree_index *index)
 		def->key_def : def->cmp_def;
 }
 
+/* {{{ Functional index keys ***************************************/
+
+/**
+ * Call the function of a functional index for a tuple and
+ * make the key stored in the tree element: the parts returned
+ * by the function followed by the primary key parts of the
+ * tuple, so that the key alone is enough for comparison.
+ * The function gets the tuple fields as arguments and must
+ * return the key parts as a tuple. The key is returned as a
+ * referenced runtime tuple.
+ */
+static struct tuple *
+memtx_tree_index_func_key_new(struct memtx_tree_index *index,
+			      struct tuple *tuple)
+{
+	struct index_def *def = index->base.def;
+	/*
+	 * The function is looked up on each call rather than
+	 * cached: on recovery functions are loaded after indexes
+	 * are created, and a drop of the function may be
+	 * committed after the index was checked against it.
+	 */
+	struct func *func = func_by_id(def->opts.func_id);
+	if (func == NULL) {
+		diag_set(ClientError, ER_NO_SUCH_FUNCTION,
+			 int2str(def->opts.func_id));
+		return NULL;
+	}
+	struct port port;
+	port_tuple_create(&port);
+	struct box_function_ctx ctx = { &port };
+	uint32_t data_size;
+	const char *data = tuple_data_range(tuple, &data_size);
+	if (func_call(func, &ctx, data, data + data_size) != 0) {
+		if (diag_last_error(diag_get()) == NULL) {
+			/* Stored procedure forget to set diag  */
+			diag_set(ClientError, ER_PROC_C, "unknown error");
+		}
+		port_destroy(&port);
+		return NULL;
+	}
+	struct port_tuple *ret = port_tuple(&port);
+	if (ret->size == 0) {
+		diag_set(ClientError, ER_PROC_C,
+			 tt_sprintf("function '%s' returned no key for "
+				    "index '%s'", func->def->name,
+				    def->name));
+		port_destroy(&port);
+		return NULL;
+	}
+	const char *parts = tuple_data(ret->first->tuple);
+	uint32_t part_count = mp_decode_array(&parts);
+	if (part_count != def->key_def->part_count) {
+		diag_set(ClientError, ER_EXACT_MATCH,
+			 def->key_def->part_count, part_count);
+		port_destroy(&port);
+		return NULL;
+	}
+	if (key_validate_parts(def->key_def, parts, part_count, true) != 0) {
+		port_destroy(&port);
+		return NULL;
+	}
+	const char *parts_end = parts;
+	for (uint32_t i = 0; i < part_count; i++)
+		mp_next(&parts_end);
+
+	struct key_def *cmp_def = def->cmp_def;
+	uint32_t size = mp_sizeof_array(cmp_def->part_count) +
+			(parts_end - parts);
+	for (uint32_t i = part_count; i < cmp_def->part_count; i++) {
+		const char *field = tuple_field(tuple,
+						cmp_def->parts[i].fieldno);
+		assert(field != NULL);
+		const char *field_end = field;
+		mp_next(&field_end);
+		size += field_end - field;
+	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	char *key = (char *)region_alloc(region, size);
+	if (key == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "key");
+		port_destroy(&port);
+		return NULL;
+	}
+	char *key_end = mp_encode_array(key, cmp_def->part_count);
+	memcpy(key_end, parts, parts_end - parts);
+	key_end += parts_end - parts;
+	for (uint32_t i = part_count; i < cmp_def->part_count; i++) {
+		const char *field = tuple_field(tuple,
+						cmp_def->parts[i].fieldno);
+		const char *field_end = field;
+		mp_next(&field_end);
+		memcpy(key_end, field, field_end - field);
+		key_end += field_end - field;
+	}
+	assert(key_end == key + size);
+	port_destroy(&port);
+	struct tuple *result = tuple_new(tuple_format_runtime, key, key_end);
+	region_truncate(region, region_svp);
+	if (result == NULL)
+		return NULL;
+	tuple_ref(result);
+	return result;
+}
+
+/** Remember the key computed for a tuple. */
+static int
+memtx_tree_index_func_key_put(struct memtx_tree_index *index,
+			      struct tuple *tuple, struct tuple *key)
+{
+	if (index->func_keys == NULL) {
+		index->func_keys = mh_i64ptr_new();
+		if (index->func_keys == NULL) {
+			diag_set(OutOfMemory, sizeof(*index->func_keys),
+				 "mh_i64ptr_new", "func_keys");
+			return -1;
+		}
+	}
+	struct mh_i64ptr_node_t node = { (uintptr_t)tuple, key };
+	if (mh_i64ptr_put(index->func_keys, &node, NULL, NULL) ==
+	    mh_end(index->func_keys)) {
+		diag_set(OutOfMemory, 0, "mh_i64ptr_put", "func_keys");
+		return -1;
+	}
+	return 0;
+}
+
+/** Look up the key computed for a tuple, NULL if none. */
+static struct tuple *
+memtx_tree_index_func_key_find(struct memtx_tree_index *index,
+			       struct tuple *tuple)
+{
+	if (index->func_keys == NULL)
+		return NULL;
+	mh_int_t k = mh_i64ptr_find(index->func_keys, (uintptr_t)tuple,
+				    NULL);
+	if (k == mh_end(index->func_keys))
+		return NULL;
+	return (struct tuple *)mh_i64ptr_node(index->func_keys, k)->val;
+}
+
+/** Forget and release the key computed for a tuple. */
+static void
+memtx_tree_index_func_key_delete(struct memtx_tree_index *index,
+				 struct tuple *tuple)
+{
+	assert(index->func_keys != NULL);
+	mh_int_t k = mh_i64ptr_find(index->func_keys, (uintptr_t)tuple,
+				    NULL);
+	assert(k != mh_end(index->func_keys));
+	struct tuple *key =
+		(struct tuple *)mh_i64ptr_node(index->func_keys, k)->val;
+	mh_i64ptr_del(index->func_keys, k, NULL);
+	tuple_unref(key);
+}
+
+void
+memtx_tree_index_forget_func_key(struct memtx_tree_index *index,
+				 struct tuple *tuple)
+{
+	if (memtx_tree_index_func_key_find(index, tuple) != NULL)
+		memtx_tree_index_func_key_delete(index, tuple);
+}
+
+/* }}} */
+
 static void
 memtx_tree_index_destroy(struct index *base)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	if (index->func_keys != NULL) {
+		mh_int_t i;
+		mh_foreach(index->func_keys, i) {
+			struct tuple *key = (struct tuple *)
+				mh_i64ptr_node(index->func_keys, i)->val;
+			tuple_unref(key);
+		}
+		mh_i64ptr_delete(index->func_keys);
+	}
 	memtx_tree_destroy(&index->tree);
 	free(index->build_array);
 	free(index);
@@ -316,10 +601,32 @@ memtx_tree_index_update_def(struct index *base)
 	index->tree.arg = memtx_tree_index_cmp_def(index);
 }
 
+/**
+ * End the bulk load of the space of an index, if any, before
+ * the index is read: the tuples loaded so far are in the build
+ * array, @sa memtx_space_begin_bulk_load().
+ */
+static inline int
+memtx_tree_index_end_bulk_load(struct memtx_tree_index *index)
+{
+	if (likely(!index->is_bulk_loading))
+		return 0;
+	struct space *space = space_by_id(index->base.def->space_id);
+	assert(space != NULL);
+	if (memtx_space_end_bulk_load(space) != 0)
+		return -1;
+	assert(!index->is_bulk_loading);
+	return 0;
+}
+
 static ssize_t
 memtx_tree_index_size(struct index *base)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	if (memtx_tree_index_end_bulk_load(index) != 0)
+		return -1;
+	if (base->def->key_def->is_multikey)
+		return index->tuple_count;
 	return memtx_tree_size(&index->tree);
 }
 
@@ -334,8 +641,10 @@ static int
 memtx_tree_index_random(struct index *base, uint32_t rnd, struct tuple **result)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	struct tuple **res = memtx_tree_random(&index->tree, rnd);
-	*result = res != NULL ? *res : NULL;
+	if (memtx_tree_index_end_bulk_load(index) != 0)
+		return -1;
+	struct memtx_tree_data *res = memtx_tree_random(&index->tree, rnd);
+	*result = res != NULL ? res->tuple : NULL;
 	return 0;
 }
 
@@ -355,11 +664,202 @@ memtx_tree_index_get(struct index *base, const char *key,
 	assert(base->def->opts.is_unique &&
 	       part_count == base->def->key_def->part_count);
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	if (memtx_tree_index_end_bulk_load(index) != 0)
+		return -1;
 	struct memtx_tree_key_data key_data;
 	key_data.key = key;
 	key_data.part_count = part_count;
-	struct tuple **res = memtx_tree_find(&index->tree, &key_data);
-	*result = res != NULL ? *res : NULL;
+	key_data.hint = key_hint(key, part_count, index->tree.arg);
+	struct memtx_tree_data *res = memtx_tree_find(&index->tree, &key_data);
+	*result = res != NULL ? res->tuple : NULL;
+	return 0;
+}
+
+/**
+ * Delete all entries of a tuple from a multikey index.
+ */
+static void
+memtx_tree_index_delete_multikey(struct memtx_tree_index *index,
+				 struct tuple *tuple)
+{
+	struct key_def *cmp_def = index->tree.arg;
+	uint32_t count = tuple_multikey_count(tuple, cmp_def);
+	for (uint32_t i = 0; i < count; i++) {
+		struct memtx_tree_data data;
+		data.tuple = tuple;
+		data.hint = i;
+		memtx_tree_delete(&index->tree, data);
+	}
+	if (count > 0)
+		index->tuple_count--;
+}
+
+/**
+ * Insert all entries of a tuple into a multikey index.
+ * Equal elements of the same array collapse into one entry.
+ * On failure, the entries inserted so far are removed and
+ * the displaced entries of other tuples are put back.
+ */
+static int
+memtx_tree_index_insert_multikey(struct memtx_tree_index *index,
+				 struct tuple *tuple)
+{
+	struct key_def *cmp_def = index->tree.arg;
+	uint32_t count = tuple_multikey_count(tuple, cmp_def);
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		struct memtx_tree_data data;
+		data.tuple = tuple;
+		data.hint = i;
+		struct memtx_tree_data dup_data;
+		dup_data.tuple = NULL;
+		if (memtx_tree_insert(&index->tree, data, &dup_data) != 0) {
+			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
+				 "memtx_tree_index", "replace");
+			goto rollback;
+		}
+		if (dup_data.tuple != NULL && dup_data.tuple != tuple) {
+			memtx_tree_delete(&index->tree, data);
+			memtx_tree_insert(&index->tree, dup_data, NULL);
+			struct index_def *def = index->base.def;
+			struct space *sp = space_cache_find(def->space_id);
+			if (sp != NULL)
+				diag_set(ClientError, ER_TUPLE_FOUND,
+					 def->name, space_name(sp));
+			goto rollback;
+		}
+	}
+	if (count > 0)
+		index->tuple_count++;
+	return 0;
+rollback:
+	for (uint32_t j = 0; j < i; j++) {
+		struct memtx_tree_data data;
+		data.tuple = tuple;
+		data.hint = j;
+		memtx_tree_delete(&index->tree, data);
+	}
+	return -1;
+}
+
+/**
+ * Replace a tuple in a multikey index. Unlike the regular
+ * replace, a tuple has many entries here, so the entries of
+ * the old tuple are removed before the new ones are inserted:
+ * otherwise equal elements of the old and the new tuple would
+ * be taken for a conflict.
+ */
+static int
+memtx_tree_index_replace_multikey(struct memtx_tree_index *index,
+				  struct tuple *old_tuple,
+				  struct tuple *new_tuple,
+				  struct tuple **result)
+{
+	if (old_tuple != NULL)
+		memtx_tree_index_delete_multikey(index, old_tuple);
+	if (new_tuple != NULL &&
+	    memtx_tree_index_insert_multikey(index, new_tuple) != 0) {
+		if (old_tuple != NULL) {
+			/*
+			 * Entries of the old tuple can't conflict
+			 * with anything since they were in the
+			 * index a moment ago.
+			 */
+			struct diag *diag = &fiber()->diag;
+			struct error *e = diag_last_error(diag);
+			error_ref(e);
+			int rc = memtx_tree_index_insert_multikey(index,
+								  old_tuple);
+			diag_add_error(diag, e);
+			error_unref(e);
+			if (rc != 0)
+				panic("failed to rollback multikey index");
+		}
+		return -1;
+	}
+	*result = old_tuple;
+	return 0;
+}
+
+/**
+ * Replace a tuple in a functional index. Same as the regular
+ * replace, but the new tuple key is computed by the index
+ * function and the old tuple key is taken from the cache.
+ *
+ * The key of a tuple taken out of the index stays cached till
+ * the statement is over, so that a rollback puts the tuple
+ * back without calling the function, which may fail, @sa
+ * memtx_tree_index_forget_func_key().
+ */
+static int
+memtx_tree_index_replace_func(struct memtx_tree_index *index,
+			      struct tuple *old_tuple,
+			      struct tuple *new_tuple,
+			      enum dup_replace_mode mode,
+			      struct tuple **result)
+{
+	if (new_tuple) {
+		/* A tuple put back by a rollback has its key. */
+		struct tuple *new_key =
+			memtx_tree_index_func_key_find(index, new_tuple);
+		bool is_cached = new_key != NULL;
+		if (!is_cached) {
+			new_key = memtx_tree_index_func_key_new(index,
+								new_tuple);
+			if (new_key == NULL)
+				return -1;
+		}
+		struct memtx_tree_data new_data;
+		new_data.tuple = new_tuple;
+		new_data.hint = (uintptr_t)new_key;
+		struct memtx_tree_data dup_data;
+		dup_data.tuple = NULL;
+
+		int tree_res = memtx_tree_insert(&index->tree,
+						 new_data, &dup_data);
+		if (tree_res) {
+			if (!is_cached)
+				tuple_unref(new_key);
+			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
+				 "memtx_tree_index", "replace");
+			return -1;
+		}
+
+		uint32_t errcode = replace_check_dup(old_tuple,
+						     dup_data.tuple, mode);
+		if (errcode) {
+			struct index_def *def = index->base.def;
+			struct space *sp = space_cache_find(def->space_id);
+			if (sp != NULL)
+				diag_set(ClientError, errcode, def->name,
+					 space_name(sp));
+		}
+		if (errcode || (!is_cached &&
+				memtx_tree_index_func_key_put(index, new_tuple,
+							      new_key) != 0)) {
+			memtx_tree_delete(&index->tree, new_data);
+			if (dup_data.tuple != NULL)
+				memtx_tree_insert(&index->tree, dup_data, NULL);
+			if (!is_cached)
+				tuple_unref(new_key);
+			return -1;
+		}
+		if (dup_data.tuple != NULL) {
+			*result = dup_data.tuple;
+			return 0;
+		}
+	}
+	if (old_tuple) {
+		struct tuple *old_key =
+			memtx_tree_index_func_key_find(index, old_tuple);
+		if (old_key != NULL) {
+			struct memtx_tree_data old_data;
+			old_data.tuple = old_tuple;
+			old_data.hint = (uintptr_t)old_key;
+			memtx_tree_delete(&index->tree, old_data);
+		}
+	}
+	*result = old_tuple;
 	return 0;
 }
 
@@ -369,12 +869,38 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 			 struct tuple **result)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = index->tree.arg;
+	const char *filter = base->def->opts.filter;
+	if (filter != NULL) {
+		/* Tuples not matching the filter are not indexed. */
+		if (old_tuple != NULL && !tuple_filter_match(old_tuple, filter))
+			old_tuple = NULL;
+		if (new_tuple != NULL && !tuple_filter_match(new_tuple, filter))
+			new_tuple = NULL;
+		if (old_tuple == NULL && new_tuple == NULL) {
+			*result = NULL;
+			return 0;
+		}
+	}
+	if (cmp_def->is_multikey) {
+		assert(mode == DUP_INSERT);
+		(void)mode;
+		return memtx_tree_index_replace_multikey(index, old_tuple,
+							 new_tuple, result);
+	}
+	if (cmp_def->for_func_index)
+		return memtx_tree_index_replace_func(index, old_tuple,
+						     new_tuple, mode, result);
 	if (new_tuple) {
-		struct tuple *dup_tuple = NULL;
+		struct memtx_tree_data new_data;
+		new_data.tuple = new_tuple;
+		new_data.hint = tuple_hint(new_tuple, cmp_def);
+		struct memtx_tree_data dup_data;
+		dup_data.tuple = NULL;
 
 		/* Try to optimistically replace the new_tuple. */
 		int tree_res = memtx_tree_insert(&index->tree,
-						 new_tuple, &dup_tuple);
+						 new_data, &dup_data);
 		if (tree_res) {
 			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
 				 "memtx_tree_index", "replace");
@@ -382,24 +908,27 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 		}
 
 		uint32_t errcode = replace_check_dup(old_tuple,
-						     dup_tuple, mode);
+						     dup_data.tuple, mode);
 		if (errcode) {
-			memtx_tree_delete(&index->tree, new_tuple);
-			if (dup_tuple)
-				memtx_tree_insert(&index->tree, dup_tuple, 0);
+			memtx_tree_delete(&index->tree, new_data);
+			if (dup_data.tuple != NULL)
+				memtx_tree_insert(&index->tree, dup_data, NULL);
 			struct space *sp = space_cache_find(base->def->space_id);
 			if (sp != NULL)
 				diag_set(ClientError, errcode, base->def->name,
 					 space_name(sp));
 			return -1;
 		}
-		if (dup_tuple) {
-			*result = dup_tuple;
+		if (dup_data.tuple != NULL) {
+			*result = dup_data.tuple;
 			return 0;
 		}
 	}
 	if (old_tuple) {
-		memtx_tree_delete(&index->tree, old_tuple);
+		struct memtx_tree_data old_data;
+		old_data.tuple = old_tuple;
+		old_data.hint = tuple_hint(old_tuple, cmp_def);
+		memtx_tree_delete(&index->tree, old_data);
 	}
 	*result = old_tuple;
 	return 0;
@@ -411,6 +940,8 @@ memtx_tree_index_create_iterator(struct index *base, enum iterator_type type,
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct memtx_engine *memtx = (struct memtx_engine *)base->engine;
+	if (memtx_tree_index_end_bulk_load(index) != 0)
+		return NULL;
 
 	assert(part_count == 0 || key != NULL);
 	if (type > ITER_GT) {
@@ -441,10 +972,13 @@ memtx_tree_index_create_iterator(struct index *base, enum iterator_type type,
 	it->type = type;
 	it->key_data.key = key;
 	it->key_data.part_count = part_count;
+	it->key_data.hint = key_hint(key, part_count, index->tree.arg);
 	it->index_def = base->def;
 	it->tree = &index->tree;
 	it->tree_iterator = memtx_tree_invalid_iterator();
-	it->current_tuple = NULL;
+	it->current.tuple = NULL;
+	it->returned = NULL;
+	it->next_internal = NULL;
 	return (struct iterator *)it;
 }
 
@@ -462,8 +996,9 @@ memtx_tree_index_reserve(struct index *base, uint32_t size_hint)
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	if (size_hint < index->build_array_alloc_size)
 		return 0;
-	struct tuple **tmp = (struct tuple **)realloc(index->build_array,
-						      size_hint * sizeof(*tmp));
+	struct memtx_tree_data *tmp =
+		(struct memtx_tree_data *)realloc(index->build_array,
+						  size_hint * sizeof(*tmp));
 	if (tmp == NULL) {
 		diag_set(OutOfMemory, size_hint * sizeof(*tmp),
 			 "memtx_tree_index", "reserve");
@@ -475,24 +1010,25 @@ memtx_tree_index_reserve(struct index *base, uint32_t size_hint)
 }
 
 static int
-memtx_tree_index_build_next(struct index *base, struct tuple *tuple)
+memtx_tree_index_build_array_append(struct memtx_tree_index *index,
+				    struct tuple *tuple, hint_t hint)
 {
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	if (index->build_array == NULL) {
-		index->build_array = (struct tuple **)malloc(MEMTX_EXTENT_SIZE);
+		index->build_array =
+			(struct memtx_tree_data *)malloc(MEMTX_EXTENT_SIZE);
 		if (index->build_array == NULL) {
 			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
 				 "memtx_tree_index", "build_next");
 			return -1;
 		}
 		index->build_array_alloc_size =
-			MEMTX_EXTENT_SIZE / sizeof(struct tuple*);
+			MEMTX_EXTENT_SIZE / sizeof(struct memtx_tree_data);
 	}
 	assert(index->build_array_size <= index->build_array_alloc_size);
 	if (index->build_array_size == index->build_array_alloc_size) {
 		index->build_array_alloc_size = index->build_array_alloc_size +
 					index->build_array_alloc_size / 2;
-		struct tuple **tmp = (struct tuple **)
+		struct memtx_tree_data *tmp = (struct memtx_tree_data *)
 			realloc(index->build_array,
 				index->build_array_alloc_size * sizeof(*tmp));
 		if (tmp == NULL) {
@@ -502,25 +1038,135 @@ memtx_tree_index_build_next(struct index *base, struct tuple *tuple)
 		}
 		index->build_array = tmp;
 	}
-	index->build_array[index->build_array_size++] = tuple;
+	struct memtx_tree_data *elem =
+		&index->build_array[index->build_array_size++];
+	elem->tuple = tuple;
+	elem->hint = hint;
 	return 0;
 }
 
-static void
-memtx_tree_index_end_build(struct index *base)
+static int
+memtx_tree_index_build_next(struct index *base, struct tuple *tuple)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = memtx_tree_index_cmp_def(index);
+	const char *filter = base->def->opts.filter;
+	if (filter != NULL && !tuple_filter_match(tuple, filter))
+		return 0;
+	if (cmp_def->for_func_index) {
+		struct tuple *key = memtx_tree_index_func_key_new(index, tuple);
+		if (key == NULL)
+			return -1;
+		if (memtx_tree_index_func_key_put(index, tuple, key) != 0) {
+			tuple_unref(key);
+			return -1;
+		}
+		if (memtx_tree_index_build_array_append(index, tuple,
+							(uintptr_t)key) != 0) {
+			memtx_tree_index_func_key_delete(index, tuple);
+			return -1;
+		}
+		return 0;
+	}
+	if (!cmp_def->is_multikey) {
+		return memtx_tree_index_build_array_append(index, tuple,
+						tuple_hint(tuple, cmp_def));
+	}
+	/*
+	 * Add all entries of the tuple or none, so that a bulk
+	 * load can take it back, @sa memtx_tree_index_build_undo().
+	 */
+	uint32_t count = tuple_multikey_count(tuple, cmp_def);
+	for (uint32_t i = 0; i < count; i++) {
+		if (memtx_tree_index_build_array_append(index, tuple,
+							i) != 0) {
+			index->build_array_size -= i;
+			return -1;
+		}
+	}
+	if (count > 0)
+		index->tuple_count++;
+	return 0;
+}
+
+void
+memtx_tree_index_build_undo(struct memtx_tree_index *index,
+			    struct tuple *tuple)
+{
+	struct key_def *cmp_def = memtx_tree_index_cmp_def(index);
+	const char *filter = index->base.def->opts.filter;
+	if (filter != NULL && !tuple_filter_match(tuple, filter))
+		return;
+	assert(!index->build_array_is_sorted);
+	while (index->build_array_size > 0 &&
+	       index->build_array[index->build_array_size - 1].tuple == tuple)
+		index->build_array_size--;
+	if (cmp_def->for_func_index)
+		memtx_tree_index_func_key_delete(index, tuple);
+	else if (cmp_def->is_multikey &&
+		 tuple_multikey_count(tuple, cmp_def) > 0)
+		index->tuple_count--;
+}
+
+int
+memtx_tree_index_build_extents(struct memtx_tree_index *index)
+{
+	if (index->build_array_size == 0)
+		return 0;
+	/*
+	 * bps_tree_build() fills the leaves up, and the inner
+	 * blocks are a small fraction of them, so twice the size
+	 * of the build array is plenty. Add the extents matras
+	 * needs to address the blocks.
+	 */
+	size_t count = DIV_ROUND_UP(2 * index->build_array_size *
+				    sizeof(struct memtx_tree_data),
+				    MEMTX_EXTENT_SIZE);
+	return count + count / (MEMTX_EXTENT_SIZE / sizeof(void *)) + 2;
+}
+
+void
+memtx_tree_index_sort_build(struct memtx_tree_index *index)
+{
 	struct key_def *cmp_def = memtx_tree_index_cmp_def(index);
 	qsort_arg(index->build_array, index->build_array_size,
-		  sizeof(struct tuple *),
+		  sizeof(struct memtx_tree_data),
 		  memtx_tree_qcompare, cmp_def);
-	memtx_tree_build(&index->tree, index->build_array,
-			 index->build_array_size);
+	if (cmp_def->is_multikey && index->build_array_size > 1) {
+		/*
+		 * Equal elements of the same array must be
+		 * stored once, like replace() does.
+		 */
+		size_t w = 0;
+		for (size_t r = 1; r < index->build_array_size; r++) {
+			if (memtx_tree_compare(&index->build_array[w],
+					       &index->build_array[r],
+					       cmp_def) != 0)
+				w++;
+			index->build_array[w] = index->build_array[r];
+		}
+		index->build_array_size = w + 1;
+	}
+	index->build_array_is_sorted = true;
+}
+
+static void
+memtx_tree_index_end_build(struct index *base)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	if (!index->build_array_is_sorted)
+		memtx_tree_index_sort_build(index);
+	if (memtx_tree_build(&index->tree, index->build_array,
+			     index->build_array_size) != 0) {
+		diag_log();
+		panic("failed to build index");
+	}
 
 	free(index->build_array);
 	index->build_array = NULL;
 	index->build_array_size = 0;
 	index->build_array_alloc_size = 0;
+	index->build_array_is_sorted = false;
 }
 
 struct tree_snapshot_iterator {
@@ -546,12 +1192,12 @@ tree_snapshot_iterator_next(struct snapshot_iterator *iterator, uint32_t *size)
 	assert(iterator->free == tree_snapshot_iterator_free);
 	struct tree_snapshot_iterator *it =
 		(struct tree_snapshot_iterator *)iterator;
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (res == NULL)
 		return NULL;
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return tuple_data_range(*res, size);
+	return tuple_data_range(res->tuple, size);
 }
 
 /**
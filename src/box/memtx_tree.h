@@ -30,17 +30,21 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include "index.h"
 #include "memtx_engine.h"
+#include "tuple_compare.h"
 
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
 
 struct memtx_engine;
+struct mh_i64ptr_t;
+struct func;
 
 /**
  * Struct that is used as a key in BPS tree definition.
@@ -51,12 +55,69 @@ struct memtx_tree_key_data
 	const char *key;
 	/** Number of msgpacked search fields */
 	uint32_t part_count;
+	/** Comparison hint of the key, @sa key_hint(). */
+	hint_t hint;
 };
 
+/**
+ * Struct that is used as an element in BPS tree definition.
+ */
+struct memtx_tree_data {
+	/** Tuple this element is linked to. */
+	struct tuple *tuple;
+	/**
+	 * Comparison hint of the tuple, @sa tuple_hint().
+	 * For a multikey index, position of the indexed
+	 * element in the array field instead. For a functional
+	 * index, pointer to the tuple holding the key computed
+	 * for the tuple, @sa memtx_tree_data_func_key().
+	 */
+	hint_t hint;
+};
+
+/**
+ * Return the key stored in an element of a functional index:
+ * the parts computed by the index function followed by the
+ * primary key parts of the tuple.
+ */
+static inline const char *
+memtx_tree_data_func_key(const struct memtx_tree_data *data)
+{
+	return tuple_data((struct tuple *)(uintptr_t)data->hint);
+}
+
+/**
+ * BPS tree element vs element comparator.
+ * Hints are compared first and tuples are compared only
+ * if the hints are equal.
+ * @param a - first element to compare.
+ * @param b - second element to compare.
+ * @param def - key definition.
+ * @retval 0  if a == b in terms of def.
+ * @retval <0 if a < b in terms of def.
+ * @retval >0 if a > b in terms of def.
+ */
+static inline int
+memtx_tree_compare(const struct memtx_tree_data *a,
+		   const struct memtx_tree_data *b,
+		   struct key_def *def)
+{
+	if (def->is_multikey)
+		return tuple_compare_multikey(a->tuple, a->hint,
+					      b->tuple, b->hint, def);
+	if (def->for_func_index)
+		return func_key_compare(memtx_tree_data_func_key(a),
+					memtx_tree_data_func_key(b), def);
+	if (a->hint != b->hint && a->hint != HINT_NONE &&
+	    b->hint != HINT_NONE)
+		return a->hint < b->hint ? -1 : 1;
+	return tuple_compare(a->tuple, b->tuple, def);
+}
+
 /**
  * BPS tree element vs key comparator.
  * Defined in header in order to allow compiler to inline it.
- * @param tuple - tuple to compare.
+ * @param element - element to compare.
  * @param key_data - key to compare with.
  * @param def - key definition.
  * @retval 0  if tuple == key in terms of def.
@@ -64,20 +125,33 @@ struct memtx_tree_key_data
  * @retval >0 if tuple > key in terms of def.
  */
 static inline int
-memtx_tree_compare_key(const struct tuple *tuple,
+memtx_tree_compare_key(const struct memtx_tree_data *element,
 		       const struct memtx_tree_key_data *key_data,
 		       struct key_def *def)
 {
-	return tuple_compare_with_key(tuple, key_data->key,
+	if (def->is_multikey)
+		return tuple_compare_with_key_multikey(element->tuple,
+						       element->hint,
+						       key_data->key,
+						       key_data->part_count,
+						       def);
+	if (def->for_func_index)
+		return func_key_compare_with_key(
+				memtx_tree_data_func_key(element),
+				key_data->key, key_data->part_count, def);
+	if (element->hint != key_data->hint && element->hint != HINT_NONE &&
+	    key_data->hint != HINT_NONE)
+		return element->hint < key_data->hint ? -1 : 1;
+	return tuple_compare_with_key(element->tuple, key_data->key,
 				      key_data->part_count, def);
 }
 
 #define BPS_TREE_NAME memtx_tree
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
-#define BPS_TREE_COMPARE(a, b, arg) tuple_compare(a, b, arg)
-#define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_tree_compare_key(a, b, arg)
-#define bps_tree_elem_t struct tuple *
+#define BPS_TREE_COMPARE(a, b, arg) memtx_tree_compare(&(a), &(b), arg)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_tree_compare_key(&(a), b, arg)
+#define bps_tree_elem_t struct memtx_tree_data
 #define bps_tree_key_t struct memtx_tree_key_data *
 #define bps_tree_arg_t struct key_def *
 
@@ -95,13 +169,66 @@ memtx_tree_compare_key(const struct tuple *tuple,
 struct memtx_tree_index {
 	struct index base;
 	struct memtx_tree tree;
-	struct tuple **build_array;
+	struct memtx_tree_data *build_array;
 	size_t build_array_size, build_array_alloc_size;
+	/** Set if build_array is sorted ahead of end_build(). */
+	bool build_array_is_sorted;
+	/**
+	 * Keys computed for the tuples of a functional index,
+	 * tuple pointer -> key tuple. Lets a tuple be found in
+	 * the tree on delete without calling the function.
+	 * NULL for regular indexes.
+	 */
+	struct mh_i64ptr_t *func_keys;
+	/**
+	 * Number of tuples in a multikey index, which stores
+	 * an entry per array element. A tuple with an empty
+	 * array has no entries and isn't counted.
+	 */
+	size_t tuple_count;
+	/**
+	 * Set while a bulk load appends tuples to the build
+	 * array rather than to the tree. A read of the index
+	 * ends the bulk load first, so that it sees them.
+	 */
+	bool is_bulk_loading;
 };
 
 struct memtx_tree_index *
 memtx_tree_index_new(struct memtx_engine *memtx, struct index_def *def);
 
+/**
+ * Sort the tuples added by build_next() so that end_build()
+ * only has to build the tree. Touches nothing but the build
+ * array and the tuples, so may be called from another thread.
+ */
+void
+memtx_tree_index_sort_build(struct memtx_tree_index *index);
+
+/**
+ * Forget the key a functional index computed for a tuple which
+ * has left the index for good: replace() keeps it for the case
+ * the statement is rolled back.
+ */
+void
+memtx_tree_index_forget_func_key(struct memtx_tree_index *index,
+				 struct tuple *tuple);
+
+/**
+ * Take a tuple added by build_next() back from the build
+ * array. It must be the last tuple added.
+ */
+void
+memtx_tree_index_build_undo(struct memtx_tree_index *index,
+			    struct tuple *tuple);
+
+/**
+ * Return the number of extents end_build() may take to build
+ * the tree of the tuples added by build_next() so far.
+ */
+int
+memtx_tree_index_build_extents(struct memtx_tree_index *index);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
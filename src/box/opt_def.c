@@ -44,6 +44,7 @@ const char *opt_type_strs[] = {
 	/* [OPT_STR]	= */ "string",
 	/* [OPT_STRPTR] = */ "string",
 	/* [OPT_ENUM]   = */ "enum",
+	/* [OPT_ARRAY]  = */ "array",
 };
 
 static int
@@ -135,6 +136,26 @@ opt_set(void *opts, const struct opt_def *def, const char **val,
 			unreachable();
 		};
 		break;
+	case OPT_ARRAY:
+		if (mp_typeof(**val) != MP_ARRAY)
+			return -1;
+		str = *val;
+		mp_next(val);
+		str_len = *val - str;
+		/* An empty array is stored as NULL. */
+		if (str_len > mp_sizeof_array(0)) {
+			ptr = (char *) region_alloc(region, str_len);
+			if (ptr == NULL) {
+				diag_set(OutOfMemory, str_len, "region",
+					 "opt array");
+				return -1;
+			}
+			memcpy(ptr, str, str_len);
+		} else {
+			ptr = NULL;
+		}
+		*(const char **)opt = ptr;
+		break;
 	default:
 		unreachable();
 	}
@@ -47,6 +47,7 @@ enum opt_type {
 	OPT_STR,	/* char[] */
 	OPT_STRPTR,	/* char*  */
 	OPT_ENUM,	/* enum */
+	OPT_ARRAY,	/* const char *, MsgPack array */
 	opt_type_MAX,
 };
 
@@ -97,7 +98,8 @@ opts_decode(void *opts, const struct opt_def *reg, const char **map,
  * @param data Option value.
  * @param errcode Code of error to set if something is wrong.
  * @param field_no Field number of an option in a parent element.
- * @param region Region to allocate OPT_STRPTR option.
+ * @param region Region to allocate OPT_STRPTR and OPT_ARRAY
+ *        options.
  * @param skip_unknown_options If true, do not set error, if an
  *        option is unknown. Useful, when it is neccessary to
  *        allow to store custom fields in options.
@@ -35,6 +35,7 @@
 #include "trigger.h"
 #include "fiber.h"
 #include "xlog.h"
+#include "xlog_readahead.h"
 #include "xrow.h"
 #include "xstream.h"
 #include "wal.h" /* wal_watcher */
@@ -190,12 +191,23 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 {
 	struct xrow_header row;
 	uint64_t row_count = 0;
-	while (xlog_cursor_next_xc(&r->cursor, &row,
-				   r->wal_dir.force_recovery) == 0) {
+	struct xlog_readahead readahead;
+	xlog_readahead_create(&readahead, &r->cursor);
+	auto readahead_guard = make_scoped_guard([&]{
+		xlog_readahead_destroy(&readahead);
+	});
+	/*
+	 * Rows can't be read ahead if we may stop in the
+	 * middle of the file.
+	 */
+	if (stop_vclock == NULL)
+		xlog_readahead_start(&readahead);
+	while (xlog_readahead_next_xc(&readahead, &row,
+				      r->wal_dir.force_recovery) == 0) {
 		/*
 		 * Read the next row from xlog file.
 		 *
-		 * xlog_cursor_next_xc() returns 1 when
+		 * xlog_readahead_next_xc() returns 1 when
 		 * it can not read more rows. This doesn't mean
 		 * the file is fully read: it's fully read only
 		 * when EOF marker has been read, see i.eof_read
@@ -304,6 +316,12 @@ recover_remaining_wals(struct recovery *r, struct xstream *stream,
 		recovery_close_log(r);
 
 		xdir_open_cursor_xc(&r->wal_dir, vclock_sum(clock), &r->cursor);
+		/*
+		 * Skip the part of the file we have already
+		 * seen without decoding it, if the file has
+		 * an index.
+		 */
+		xlog_cursor_seek_vclock(&r->cursor, &r->vclock);
 
 		say_info("recover from `%s'", r->cursor.name);
 
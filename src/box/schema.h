@@ -80,6 +80,9 @@ space_cache_find(uint32_t id)
 struct func *
 func_by_name(const char *name, uint32_t name_len);
 
+struct func *
+func_by_id(uint32_t fid);
+
 /** Call a visitor function on every space in the space cache. */
 int
 space_foreach(int (*func)(struct space *sp, void *udata), void *udata);
@@ -147,11 +150,6 @@ func_cache_replace(struct func_def *def);
 void
 func_cache_delete(uint32_t fid);
 
-struct func;
-
-struct func *
-func_by_id(uint32_t fid);
-
 static inline struct func *
 func_cache_find(uint32_t fid)
 {
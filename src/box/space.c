@@ -226,6 +226,20 @@ space_noop(struct space *space)
 	(void)space;
 }
 
+int
+generic_space_begin_bulk_load(struct space *space)
+{
+	(void)space;
+	return 0;
+}
+
+int
+generic_space_end_bulk_load(struct space *space)
+{
+	(void)space;
+	return 0;
+}
+
 void
 space_dump_def(const struct space *space, struct rlist *key_list)
 {
@@ -145,6 +145,19 @@ struct space_vtab {
 	 */
 	void (*commit_alter)(struct space *old_space,
 			     struct space *new_space);
+	/**
+	 * Called before a large batch of tuples is inserted
+	 * into the space in the current transaction, see
+	 * space:bulk_load(). The engine may load the batch
+	 * faster than row by row or ignore the call.
+	 */
+	int (*begin_bulk_load)(struct space *);
+	/**
+	 * Finish the bulk load started by begin_bulk_load().
+	 * Called before the transaction is committed. On
+	 * failure the transaction must be rolled back.
+	 */
+	int (*end_bulk_load)(struct space *);
 };
 
 struct space {
@@ -406,6 +419,18 @@ space_commit_alter(struct space *old_space, struct space *new_space)
 	new_space->vtab->commit_alter(old_space, new_space);
 }
 
+static inline int
+space_begin_bulk_load(struct space *space)
+{
+	return space->vtab->begin_bulk_load(space);
+}
+
+static inline int
+space_end_bulk_load(struct space *space)
+{
+	return space->vtab->end_bulk_load(space);
+}
+
 static inline bool
 space_is_memtx(struct space *space) { return space->engine->id == 0; }
 
@@ -415,6 +440,12 @@ space_is_vinyl(struct space *space) { return strcmp(space->engine->name, "vinyl"
 
 void space_noop(struct space *space);
 
+/*
+ * Virtual method stubs.
+ */
+int generic_space_begin_bulk_load(struct space *);
+int generic_space_end_bulk_load(struct space *);
+
 struct field_def;
 /**
  * Allocate and initialize a space.
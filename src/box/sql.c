@@ -447,7 +447,8 @@ int tarantoolSqlite3EphemeralCreate(BtCursor *pCur, uint32_t field_count,
 				 part /* filed no */,
 				 FIELD_TYPE_SCALAR,
 				 ON_CONFLICT_ACTION_NONE /* nullable_action */,
-				 aColl /* coll */);
+				 aColl /* coll */,
+				 false /* is_multikey */);
 	}
 
 	struct index_def *ephemer_index_def =
@@ -1458,6 +1459,7 @@ struct Enc {
 	char *(*encode_bool)(char *data, bool v);
 	char *(*encode_array)(char *data, uint32_t len);
 	char *(*encode_map)(char *data, uint32_t len);
+	char *(*encode_nil)(char *data);
 };
 
 /* no_encode_XXX functions estimate result size */
@@ -1487,6 +1489,12 @@ static char *no_encode_array_or_map(char *data, uint32_t len)
 	(void)len; return data + 5;
 }
 
+static char *no_encode_nil(char *data)
+{
+	/* MsgPack NIL is encoded in 1 byte. */
+	return data + 1;
+}
+
 /*
  * If buf==NULL, return Enc that will perform size estimation;
  * otherwize, return Enc that renders results in the provided buf.
@@ -1495,10 +1503,10 @@ static const struct Enc *get_enc(void *buf)
 {
 	static const struct Enc mp_enc = {
 		mp_encode_uint, mp_encode_str, mp_encode_bool,
-		mp_encode_array, mp_encode_map
+		mp_encode_array, mp_encode_map, mp_encode_nil
 	}, no_enc = {
 		no_encode_uint, no_encode_str, no_encode_bool,
-		no_encode_array_or_map, no_encode_array_or_map
+		no_encode_array_or_map, no_encode_array_or_map, no_encode_nil
 	};
 	return buf ? &mp_enc : &no_enc;
 }
@@ -1670,11 +1678,162 @@ int tarantoolSqlite3MakeIdxParts(SqliteIndex *pIndex, void *buf)
 	return (int)(p - base);
 }
 
+/*
+ * Split a term of a partial index WHERE clause into a column,
+ * a filter operator and a constant (NULL for IS [NOT] NULL).
+ * Only terms which compare the same way in SQL and in Tarantool
+ * are accepted: non-negative integers compared with numeric
+ * columns and strings compared with text columns using the
+ * default collation.
+ * Returns false if the term can't be evaluated by Tarantool.
+ */
+static bool
+sql_index_filter_term(Table *table, Expr *expr, int *column,
+		      enum index_filter_op *op, Expr **value)
+{
+	Expr *col = expr->pLeft;
+	Expr *val = expr->pRight;
+	int opcode = expr->op;
+	switch (opcode) {
+	case TK_ISNULL:
+	case TK_NOTNULL:
+		if (col->op != TK_COLUMN || col->iColumn < 0)
+			return false;
+		*column = col->iColumn;
+		*op = opcode == TK_ISNULL ? INDEX_FILTER_EQ : INDEX_FILTER_NE;
+		*value = NULL;
+		return true;
+	case TK_EQ:
+	case TK_NE:
+	case TK_LT:
+	case TK_LE:
+	case TK_GT:
+	case TK_GE:
+		break;
+	default:
+		return false;
+	}
+	if (col->op != TK_COLUMN) {
+		/* "constant <op> column", swap the operands. */
+		SWAP(col, val);
+		if (opcode == TK_LT)
+			opcode = TK_GT;
+		else if (opcode == TK_GT)
+			opcode = TK_LT;
+		else if (opcode == TK_LE)
+			opcode = TK_GE;
+		else if (opcode == TK_GE)
+			opcode = TK_LE;
+	}
+	if (col->op != TK_COLUMN || col->iColumn < 0)
+		return false;
+	struct Column *c = &table->aCol[col->iColumn];
+	int v;
+	if (sqlite3ExprIsInteger(val, &v)) {
+		if (v < 0 || !sqlite3IsNumericAffinity(c->affinity))
+			return false;
+	} else if (val->op == TK_STRING) {
+		if (c->affinity != SQLITE_AFF_TEXT ||
+		    (c->zColl != NULL &&
+		     sqlite3StrICmp(c->zColl, "binary") != 0))
+			return false;
+	} else {
+		return false;
+	}
+	*column = col->iColumn;
+	switch (opcode) {
+	case TK_EQ:
+		*op = INDEX_FILTER_EQ;
+		break;
+	case TK_NE:
+		*op = INDEX_FILTER_NE;
+		break;
+	case TK_LT:
+		*op = INDEX_FILTER_LT;
+		break;
+	case TK_LE:
+		*op = INDEX_FILTER_LE;
+		break;
+	case TK_GT:
+		*op = INDEX_FILTER_GT;
+		break;
+	default:
+		assert(opcode == TK_GE);
+		*op = INDEX_FILTER_GE;
+		break;
+	}
+	*value = val;
+	return true;
+}
+
+/*
+ * Count terms of a partial index WHERE clause.
+ * Returns -1 if the clause is not a conjunction of terms
+ * accepted by sql_index_filter_term().
+ */
+static int
+sql_index_filter_term_count(Table *table, Expr *expr)
+{
+	if (expr->op == TK_AND) {
+		int left = sql_index_filter_term_count(table, expr->pLeft);
+		int right = sql_index_filter_term_count(table, expr->pRight);
+		if (left < 0 || right < 0)
+			return -1;
+		return left + right;
+	}
+	int column;
+	enum index_filter_op op;
+	Expr *value;
+	if (!sql_index_filter_term(table, expr, &column, &op, &value))
+		return -1;
+	return 1;
+}
+
+/*
+ * Encode terms of a partial index WHERE clause as conditions
+ * of the "filter" index option.
+ */
+static char *
+sql_index_filter_encode(const struct Enc *enc, char *p, Table *table,
+			Expr *expr)
+{
+	if (expr->op == TK_AND) {
+		p = sql_index_filter_encode(enc, p, table, expr->pLeft);
+		return sql_index_filter_encode(enc, p, table, expr->pRight);
+	}
+	int column;
+	enum index_filter_op op;
+	Expr *value;
+	MAYBE_UNUSED bool is_term =
+		sql_index_filter_term(table, expr, &column, &op, &value);
+	assert(is_term);
+	const char *op_str = index_filter_op_strs[op];
+	int v;
+	p = enc->encode_array(p, 3);
+	p = enc->encode_uint(p, column);
+	p = enc->encode_str(p, op_str, strlen(op_str));
+	if (value == NULL)
+		p = enc->encode_nil(p);
+	else if (sqlite3ExprIsInteger(value, &v))
+		p = enc->encode_uint(p, v);
+	else
+		p = enc->encode_str(p, value->u.zToken,
+				    strlen(value->u.zToken));
+	return p;
+}
+
 /*
  * Format "opts" dictionary for _index entry.
  * Returns result size.
  * If buf==NULL estimate result size.
  *
+ * The WHERE clause of a partial index is passed to Tarantool
+ * as "filter" when it is simple enough, so that rows which
+ * don't satisfy it are not stored in the index. Otherwise the
+ * index contains all rows, which is still correct since the
+ * query planner only uses a partial index when the query
+ * implies its WHERE clause.
+ *
  * Ex: {
  *   "unique": "true",
  *   "sql": "CREATE INDEX student_by_name ON students(name)"
@@ -1684,10 +1843,13 @@ int tarantoolSqlite3MakeIdxOpts(SqliteIndex *index, const char *zSql, void *buf)
 {
 	const struct Enc *enc = get_enc(buf);
 	char *base = buf, *p;
+	Expr *where = index->pPartIdxWhere;
+	int filter_count = 0;
+	if (where != NULL)
+		filter_count = sql_index_filter_term_count(index->pTable,
+							   where);
 
-	(void)index;
-
-	p = enc->encode_map(base, 2);
+	p = enc->encode_map(base, filter_count > 0 ? 3 : 2);
 	/* Mark as unique pk and unique indexes */
 	p = enc->encode_str(p, "unique", 6);
 	/* If user didn't defined ON CONFLICT OPTIONS, all uniqueness checks
@@ -1700,6 +1862,11 @@ int tarantoolSqlite3MakeIdxOpts(SqliteIndex *index, const char *zSql, void *buf)
 	p = enc->encode_bool(p, IsUniqueIndex(index));
 	p = enc->encode_str(p, "sql", 3);
 	p = enc->encode_str(p, zSql, zSql ? strlen(zSql) : 0);
+	if (filter_count > 0) {
+		p = enc->encode_str(p, "filter", 6);
+		p = enc->encode_array(p, filter_count);
+		p = sql_index_filter_encode(enc, p, index->pTable, where);
+	}
 	return (int)(p - base);
 }
 
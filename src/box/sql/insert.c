@@ -1484,14 +1484,9 @@ sqlite3CompleteInsertion(Parse * pParse,	/* The parser context */
 	pIdx = pTab->pIndex;
 	/* Each table have pk on top of the indexes list */
 	assert(IsPrimaryKeyIndex(pIdx));
-	/* Partial indexes should be implemented somewhere in tarantool
-	 * codebase to check it during inserting values to the pk #2626
-	 *
-	 */
-	/*if( pIdx->pPartIdxWhere ){
-	 *  sqlite3VdbeAddOp2(v, OP_IsNull, aRegIdx[i], sqlite3VdbeCurrentAddr(v)+2);
-	 *  VdbeCoverage(v);
-	 *}
+	/* Secondary indexes are maintained by Tarantool, which also
+	 * skips rows not matching the "filter" of a partial index,
+	 * see tarantoolSqlite3MakeIdxOpts().
 	 */
 	pik_flags = OPFLAG_NCHANGE;
 	if (useSeekResult) {
@@ -242,6 +242,8 @@ static const struct space_vtab sysview_space_vtab = {
 	/* .commit_truncate = */ sysview_space_commit_truncate,
 	/* .prepare_alter = */ sysview_space_prepare_alter,
 	/* .commit_alter = */ sysview_space_commit_alter,
+	/* .begin_bulk_load = */ generic_space_begin_bulk_load,
+	/* .end_bulk_load = */ generic_space_end_bulk_load,
 };
 
 static void
@@ -513,6 +513,54 @@ tuple_field(const struct tuple *tuple, uint32_t fieldno)
 			       tuple_field_map(tuple), fieldno);
 }
 
+/**
+ * Get the field a key part refers to. If the part is multikey,
+ * get the element of the array field at the given position.
+ * @param tuple tuple
+ * @param part key part
+ * @param multikey_idx position of the element in the array,
+ *        ignored if the part is not multikey
+ * @retval pointer to MessagePack data
+ * @retval NULL when the field or the element is absent
+ */
+static inline const char *
+tuple_field_by_part(const struct tuple *tuple, const struct key_part *part,
+		    uint64_t multikey_idx)
+{
+	const char *field = tuple_field(tuple, part->fieldno);
+	if (field == NULL || !part->is_multikey)
+		return field;
+	if (mp_typeof(*field) != MP_ARRAY)
+		return NULL;
+	uint32_t count = mp_decode_array(&field);
+	if (multikey_idx >= count)
+		return NULL;
+	for (uint64_t i = 0; i < multikey_idx; i++)
+		mp_next(&field);
+	return field;
+}
+
+/**
+ * Get the number of keys a multikey key definition produces
+ * for a tuple, i.e. the size of the indexed array.
+ */
+static inline uint32_t
+tuple_multikey_count(const struct tuple *tuple, const struct key_def *key_def)
+{
+	assert(key_def->is_multikey);
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		const struct key_part *part = &key_def->parts[i];
+		if (!part->is_multikey)
+			continue;
+		const char *field = tuple_field(tuple, part->fieldno);
+		if (field == NULL || mp_typeof(*field) != MP_ARRAY)
+			return 0;
+		return mp_decode_array(&field);
+	}
+	unreachable();
+	return 0;
+}
+
 /**
  * Get tuple field by its name.
  * @param tuple Tuple to get field from.
@@ -32,7 +32,9 @@
 #include "tuple.h"
 #include "trivia/util.h" /* NOINLINE */
 #include <math.h>
+#include <limits.h>
 #include "coll_def.h"
+#include "index_def.h"
 
 /* {{{ tuple_compare */
 
@@ -1245,3 +1247,365 @@ tuple_compare_with_key_create(const struct key_def *def)
 }
 
 /* }}} tuple_compare_with_key */
+
+/* {{{ tuple_compare_multikey */
+
+int
+tuple_compare_multikey(const struct tuple *tuple_a, uint64_t multikey_idx_a,
+		       const struct tuple *tuple_b, uint64_t multikey_idx_b,
+		       const struct key_def *key_def)
+{
+	assert(key_def->is_multikey);
+	const struct key_part *part = key_def->parts;
+	const struct key_part *end;
+	if (key_def->is_nullable)
+		end = part + key_def->unique_part_count;
+	else
+		end = part + key_def->part_count;
+	const char *field_a, *field_b;
+	enum mp_type a_type, b_type;
+	bool was_null_met = false;
+	int rc;
+	for (; part < end; part++) {
+		field_a = tuple_field_by_part(tuple_a, part, multikey_idx_a);
+		field_b = tuple_field_by_part(tuple_b, part, multikey_idx_b);
+		a_type = field_a != NULL ? mp_typeof(*field_a) : MP_NIL;
+		b_type = field_b != NULL ? mp_typeof(*field_b) : MP_NIL;
+		if (a_type == MP_NIL) {
+			if (b_type != MP_NIL)
+				return -1;
+			was_null_met = true;
+		} else if (b_type == MP_NIL) {
+			return 1;
+		} else {
+			rc = tuple_compare_field_with_hint(field_a, a_type,
+							   field_b, b_type,
+							   part->type,
+							   part->coll);
+			if (rc != 0)
+				return rc;
+		}
+	}
+	/* @sa tuple_compare_slowpath() */
+	if (!was_null_met)
+		return 0;
+	end = key_def->parts + key_def->part_count;
+	for (; part < end; part++) {
+		field_a = tuple_field_by_part(tuple_a, part, multikey_idx_a);
+		field_b = tuple_field_by_part(tuple_b, part, multikey_idx_b);
+		assert(field_a != NULL && field_b != NULL);
+		rc = tuple_compare_field(field_a, field_b, part->type,
+					 part->coll);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
+
+int
+tuple_compare_with_key_multikey(const struct tuple *tuple,
+				uint64_t multikey_idx, const char *key,
+				uint32_t part_count,
+				const struct key_def *key_def)
+{
+	assert(key_def->is_multikey);
+	assert(key != NULL || part_count == 0);
+	assert(part_count <= key_def->part_count);
+	const struct key_part *part = key_def->parts;
+	const struct key_part *end = part + part_count;
+	for (; part < end; part++, mp_next(&key)) {
+		const char *field = tuple_field_by_part(tuple, part,
+							multikey_idx);
+		enum mp_type a_type = field != NULL ? mp_typeof(*field) :
+				      MP_NIL;
+		enum mp_type b_type = mp_typeof(*key);
+		if (a_type == MP_NIL) {
+			if (b_type != MP_NIL)
+				return -1;
+		} else if (b_type == MP_NIL) {
+			return 1;
+		} else {
+			int rc = tuple_compare_field_with_hint(field, a_type,
+							       key, b_type,
+							       part->type,
+							       part->coll);
+			if (rc != 0)
+				return rc;
+		}
+	}
+	return 0;
+}
+
+/* }}} tuple_compare_multikey */
+
+/* {{{ func_key_compare */
+
+int
+func_key_compare(const char *key_a, const char *key_b,
+		 const struct key_def *key_def)
+{
+	assert(key_def->for_func_index);
+	uint32_t part_count_a = mp_decode_array(&key_a);
+	uint32_t part_count_b = mp_decode_array(&key_b);
+	assert(part_count_a >= key_def->part_count);
+	assert(part_count_b >= key_def->part_count);
+	(void)part_count_a;
+	(void)part_count_b;
+	if (key_def->is_nullable) {
+		return key_compare_parts<true>(key_a, key_b,
+					       key_def->part_count, key_def);
+	}
+	return key_compare_parts<false>(key_a, key_b, key_def->part_count,
+					key_def);
+}
+
+int
+func_key_compare_with_key(const char *func_key, const char *key,
+			  uint32_t part_count, const struct key_def *key_def)
+{
+	assert(key_def->for_func_index);
+	assert(part_count <= key_def->part_count);
+	if (part_count == 0)
+		return 0;
+	mp_decode_array(&func_key);
+	if (key_def->is_nullable) {
+		return key_compare_parts<true>(func_key, key, part_count,
+					       key_def);
+	}
+	return key_compare_parts<false>(func_key, key, part_count, key_def);
+}
+
+/* }}} func_key_compare */
+
+/* {{{ tuple_filter_match */
+
+bool
+tuple_filter_match(const struct tuple *tuple, const char *filter)
+{
+	uint32_t count = mp_decode_array(&filter);
+	for (uint32_t i = 0; i < count; i++) {
+		mp_decode_array(&filter);
+		uint32_t fieldno = mp_decode_uint(&filter);
+		uint32_t len;
+		const char *str = mp_decode_str(&filter, &len);
+		enum index_filter_op op = STRN2ENUM(index_filter_op, str, len);
+		const char *value = filter;
+		mp_next(&filter);
+		const char *field = tuple_field(tuple, fieldno);
+		bool field_is_nil = field == NULL ||
+				    mp_typeof(*field) == MP_NIL;
+		if (mp_typeof(*value) == MP_NIL) {
+			/* Only '=' and '!=' accept nil. */
+			if (field_is_nil != (op == INDEX_FILTER_EQ))
+				return false;
+			continue;
+		}
+		/* A missing field doesn't compare to anything. */
+		if (field_is_nil)
+			return false;
+		int r = mp_compare_scalar(field, value);
+		bool match;
+		switch (op) {
+		case INDEX_FILTER_EQ:
+			match = r == 0;
+			break;
+		case INDEX_FILTER_NE:
+			match = r != 0;
+			break;
+		case INDEX_FILTER_LT:
+			match = r < 0;
+			break;
+		case INDEX_FILTER_LE:
+			match = r <= 0;
+			break;
+		case INDEX_FILTER_GT:
+			match = r > 0;
+			break;
+		case INDEX_FILTER_GE:
+			match = r >= 0;
+			break;
+		default:
+			unreachable();
+			match = false;
+		}
+		if (!match)
+			return false;
+	}
+	return true;
+}
+
+/* }}} tuple_filter_match */
+
+/* {{{ tuple_hint */
+
+/**
+ * A hint consists of the MsgPack class of the first key part
+ * value stored in the highest bits and a prefix of the value
+ * itself stored in the rest. The classes are ordered the same
+ * way as by scalar comparison, and a value of any class is
+ * mapped to a prefix independently of the field type, so hints
+ * of all types are comparable with each other and a compatible
+ * change of the field type doesn't invalidate hints stored in
+ * an index.
+ */
+enum {
+	HINT_CLASS_BITS = 3,
+	HINT_VALUE_BITS = sizeof(hint_t) * CHAR_BIT - HINT_CLASS_BITS,
+};
+
+#define EXP2_63 9223372036854775808.0  /* 2.0 ^ 63 */
+
+static inline hint_t
+hint_create(enum mp_class mp_class, uint64_t val)
+{
+	assert(mp_class <= MP_CLASS_BIN);
+	return ((hint_t)mp_class << HINT_VALUE_BITS) | (val >> HINT_CLASS_BITS);
+}
+
+/** Map a signed integer to an unsigned one preserving the order. */
+static inline uint64_t
+hint_int(int64_t val)
+{
+	return (uint64_t)val ^ ((uint64_t)1 << 63);
+}
+
+static inline uint64_t
+hint_uint(uint64_t val)
+{
+	return val > INT64_MAX ? UINT64_MAX : hint_int(val);
+}
+
+static inline hint_t
+hint_double(double val)
+{
+	if (isnan(val))
+		return HINT_NONE;
+	uint64_t v;
+	if (val < -EXP2_63)
+		v = 0;
+	else if (val >= EXP2_63)
+		v = UINT64_MAX;
+	else
+		v = hint_int((int64_t)floor(val));
+	return hint_create(MP_CLASS_NUMBER, v);
+}
+
+/**
+ * Take the first bytes of a string or of its sort key if
+ * the string is compared with a collation. A shorter prefix
+ * is padded with zeros, which keeps the order since a string
+ * is less than any longer string it is a prefix of.
+ */
+static inline uint64_t
+hint_str(const char *str, uint32_t len, struct coll *coll)
+{
+	unsigned char buf[sizeof(uint64_t)];
+	size_t size;
+	if (coll != NULL) {
+		size = coll->hint(str, len, (char *)buf, sizeof(buf), coll);
+	} else {
+		size = MIN(len, sizeof(buf));
+		memcpy(buf, str, size);
+	}
+	uint64_t val = 0;
+	for (size_t i = 0; i < sizeof(buf); i++) {
+		val <<= CHAR_BIT;
+		if (i < size)
+			val |= buf[i];
+	}
+	return val;
+}
+
+/**
+ * Compute the hint of a field value. An absent optional
+ * field is considered to be nil.
+ */
+static inline hint_t
+field_hint(const char *field, struct coll *coll)
+{
+	if (field == NULL)
+		return hint_create(MP_CLASS_NIL, 0);
+	uint32_t len;
+	const char *str;
+	switch (mp_typeof(*field)) {
+	case MP_NIL:
+		return hint_create(MP_CLASS_NIL, 0);
+	case MP_BOOL:
+		return hint_create(MP_CLASS_BOOL,
+				   mp_decode_bool(&field) ? UINT64_MAX : 0);
+	case MP_UINT:
+		return hint_create(MP_CLASS_NUMBER,
+				   hint_uint(mp_decode_uint(&field)));
+	case MP_INT:
+		return hint_create(MP_CLASS_NUMBER,
+				   hint_int(mp_decode_int(&field)));
+	case MP_FLOAT:
+		return hint_double(mp_decode_float(&field));
+	case MP_DOUBLE:
+		return hint_double(mp_decode_double(&field));
+	case MP_STR:
+		str = mp_decode_str(&field, &len);
+		return hint_create(MP_CLASS_STR, hint_str(str, len, coll));
+	case MP_BIN:
+		/* Collations are not applied to binary strings. */
+		str = mp_decode_bin(&field, &len);
+		return hint_create(MP_CLASS_BIN, hint_str(str, len, NULL));
+	default:
+		return HINT_NONE;
+	}
+}
+
+static hint_t
+tuple_hint_first_part(const struct tuple *tuple,
+		      const struct key_def *key_def)
+{
+	const struct key_part *part = &key_def->parts[0];
+	return field_hint(tuple_field(tuple, part->fieldno), part->coll);
+}
+
+static hint_t
+key_hint_first_part(const char *key, uint32_t part_count,
+		    const struct key_def *key_def)
+{
+	if (part_count == 0)
+		return HINT_NONE;
+	return field_hint(key, key_def->parts[0].coll);
+}
+
+static hint_t
+tuple_hint_none(const struct tuple *tuple, const struct key_def *key_def)
+{
+	(void)tuple;
+	(void)key_def;
+	return HINT_NONE;
+}
+
+static hint_t
+key_hint_none(const char *key, uint32_t part_count,
+	      const struct key_def *key_def)
+{
+	(void)key;
+	(void)part_count;
+	(void)key_def;
+	return HINT_NONE;
+}
+
+void
+tuple_hint_func_set(struct key_def *def)
+{
+	/*
+	 * Multikey indexes store the position of the indexed
+	 * array element in place of the hint, functional ones
+	 * store the computed key.
+	 */
+	if (def->part_count == 0 || def->is_multikey ||
+	    def->for_func_index) {
+		def->tuple_hint = tuple_hint_none;
+		def->key_hint = key_hint_none;
+		return;
+	}
+	def->tuple_hint = tuple_hint_first_part;
+	def->key_hint = key_hint_first_part;
+}
+
+/* }}} tuple_hint */
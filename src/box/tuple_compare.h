@@ -56,6 +56,61 @@ tuple_compare_create(const struct key_def *key_def);
 tuple_compare_with_key_t
 tuple_compare_with_key_create(const struct key_def *key_def);
 
+/**
+ * Compare tuples of a multikey key definition, each tuple
+ * taken with the array element at the given position.
+ * @sa tuple_compare()
+ */
+int
+tuple_compare_multikey(const struct tuple *tuple_a, uint64_t multikey_idx_a,
+		       const struct tuple *tuple_b, uint64_t multikey_idx_b,
+		       const struct key_def *key_def);
+
+/**
+ * Compare a tuple taken with the array element at the given
+ * position with a key of a multikey key definition.
+ * @sa tuple_compare_with_key()
+ */
+int
+tuple_compare_with_key_multikey(const struct tuple *tuple,
+				uint64_t multikey_idx, const char *key,
+				uint32_t part_count,
+				const struct key_def *key_def);
+
+/**
+ * Compare keys computed by the function of a functional index.
+ * The keys are MessagePack arrays of at least
+ * key_def->part_count parts which are compared by position.
+ */
+int
+func_key_compare(const char *key_a, const char *key_b,
+		 const struct key_def *key_def);
+
+/**
+ * Compare a key computed by the function of a functional index
+ * with a search key of part_count parts.
+ * @sa func_key_compare()
+ */
+int
+func_key_compare_with_key(const char *func_key, const char *key,
+			  uint32_t part_count, const struct key_def *key_def);
+
+/**
+ * Check if a tuple satisfies all conditions of a partial index
+ * filter.
+ * @sa index_opts::filter
+ */
+bool
+tuple_filter_match(const struct tuple *tuple, const char *filter);
+
+/**
+ * Initialize tuple_hint() and key_hint() functions for
+ * the key_def.
+ * @param key_def key definition to set up
+ */
+void
+tuple_hint_func_set(struct key_def *key_def);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -37,7 +37,8 @@ static intptr_t recycled_format_ids = FORMAT_ID_NIL;
 static uint32_t formats_size = 0, formats_capacity = 0;
 
 static const struct tuple_field tuple_field_default = {
-	FIELD_TYPE_ANY, TUPLE_OFFSET_SLOT_NIL, false, ON_CONFLICT_ACTION_DEFAULT
+	FIELD_TYPE_ANY, TUPLE_OFFSET_SLOT_NIL, false, ON_CONFLICT_ACTION_DEFAULT,
+	FIELD_TYPE_ANY
 };
 
 /**
@@ -62,6 +63,7 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 		format->fields[i].type = fields[i].type;
 		format->fields[i].offset_slot = TUPLE_OFFSET_SLOT_NIL;
 		format->fields[i].nullable_action = fields[i].nullable_action;
+		format->fields[i].multikey_type = FIELD_TYPE_ANY;
 	}
 	/* Initialize remaining fields */
 	for (uint32_t i = field_count; i < format->field_count; i++)
@@ -72,6 +74,9 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 	/* extract field type info */
 	for (uint16_t key_no = 0; key_no < key_count; ++key_no) {
 		const struct key_def *key_def = keys[key_no];
+		/* Functional index parts don't refer to tuple fields. */
+		if (key_def->for_func_index)
+			continue;
 		bool is_sequential = key_def_is_sequential(key_def);
 		const struct key_part *part = key_def->parts;
 		const struct key_part *parts_end = part + key_def->part_count;
@@ -122,12 +127,34 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 			 * fields. If a part type is compatible
 			 * with field's one, then the part type is
 			 * more strict and the part type must be
-			 * used in tuple_format.
+			 * used in tuple_format. A multikey part
+			 * indexes elements of an array field, so
+			 * the field itself must be an array.
 			 */
+			enum field_type part_type = part->is_multikey ?
+						    FIELD_TYPE_ARRAY :
+						    part->type;
+			if (part->is_multikey) {
+				enum field_type *mk_type =
+					&field->multikey_type;
+				if (field_type1_contains_type2(*mk_type,
+							       part->type)) {
+					*mk_type = part->type;
+				} else if (! field_type1_contains_type2(
+						part->type, *mk_type)) {
+					diag_set(ClientError,
+						 ER_INDEX_PART_TYPE_MISMATCH,
+						 tt_sprintf("%d", part->fieldno +
+							    TUPLE_INDEX_BASE),
+						 field_type_strs[*mk_type],
+						 field_type_strs[part->type]);
+					return -1;
+				}
+			}
 			if (field_type1_contains_type2(field->type,
-						       part->type)) {
-				field->type = part->type;
-			} else if (! field_type1_contains_type2(part->type,
+						       part_type)) {
+				field->type = part_type;
+			} else if (! field_type1_contains_type2(part_type,
 								field->type)) {
 				const char *name;
 				int fieldno = part->fieldno + TUPLE_INDEX_BASE;
@@ -145,7 +172,7 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 					errcode = ER_INDEX_PART_TYPE_MISMATCH;
 				diag_set(ClientError, errcode, name,
 					 field_type_strs[field->type],
-					 field_type_strs[part->type]);
+					 field_type_strs[part_type]);
 				return -1;
 			}
 			field->is_key_part = true;
@@ -229,6 +256,8 @@ tuple_format_alloc(struct key_def * const *keys, uint16_t key_count,
 	/* find max max field no */
 	for (uint16_t key_no = 0; key_no < key_count; ++key_no) {
 		const struct key_def *key_def = keys[key_no];
+		if (key_def->for_func_index)
+			continue;
 		const struct key_part *part = key_def->parts;
 		const struct key_part *pend = part + key_def->part_count;
 		for (; part < pend; part++) {
@@ -339,6 +368,9 @@ tuple_format1_can_store_format2_tuples(const struct tuple_format *format1,
 		const struct tuple_field *field2 = &format2->fields[i];
 		if (! field_type1_contains_type2(field1->type, field2->type))
 			return false;
+		if (! field_type1_contains_type2(field1->multikey_type,
+						 field2->multikey_type))
+			return false;
 		/*
 		 * Do not allow transition from nullable to non-nullable:
 		 * it would require a check of all data in the space.
@@ -362,6 +394,8 @@ tuple_format_eq(const struct tuple_format *a, const struct tuple_format *b)
 			return false;
 		if (a->fields[i].is_key_part != b->fields[i].is_key_part)
 			return false;
+		if (a->fields[i].multikey_type != b->fields[i].multikey_type)
+			return false;
 		if (tuple_field_is_nullable(a->fields + i) !=
 		    tuple_field_is_nullable(b->fields + i))
 			return false;
@@ -391,6 +425,28 @@ tuple_format_dup(struct tuple_format *src)
 	return format;
 }
 
+/**
+ * Check that all elements of an array field indexed by a multikey
+ * part are of the type the part requires.
+ */
+static int
+tuple_field_validate_multikey(const struct tuple_field *field,
+			      const char *pos, uint32_t fieldno)
+{
+	if (field->multikey_type == FIELD_TYPE_ANY ||
+	    mp_typeof(*pos) != MP_ARRAY)
+		return 0;
+	uint32_t count = mp_decode_array(&pos);
+	for (uint32_t i = 0; i < count; i++) {
+		if (key_mp_type_validate(field->multikey_type,
+					 mp_typeof(*pos), ER_FIELD_TYPE,
+					 fieldno, false))
+			return -1;
+		mp_next(&pos);
+	}
+	return 0;
+}
+
 /** @sa declaration for details. */
 int
 tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
@@ -423,6 +479,8 @@ tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 	if (key_mp_type_validate(field->type, mp_type, ER_FIELD_TYPE,
 				 TUPLE_INDEX_BASE, tuple_field_is_nullable(field)))
 		return -1;
+	if (tuple_field_validate_multikey(field, pos, TUPLE_INDEX_BASE) != 0)
+		return -1;
 	mp_next(&pos);
 	/* other fields...*/
 	++field;
@@ -442,6 +500,9 @@ tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 					 i + TUPLE_INDEX_BASE,
 					 tuple_field_is_nullable(field)))
 			return -1;
+		if (tuple_field_validate_multikey(field, pos,
+						  i + TUPLE_INDEX_BASE) != 0)
+			return -1;
 		if (field->offset_slot != TUPLE_OFFSET_SLOT_NIL) {
 			field_map[field->offset_slot] =
 				(uint32_t) (pos - tuple);
@@ -463,6 +524,8 @@ tuple_format_min_field_count(struct key_def * const *keys, uint16_t key_count,
 	}
 	for (uint32_t i = 0; i < key_count; ++i) {
 		const struct key_def *kd = keys[i];
+		if (kd->for_func_index)
+			continue;
 		for (uint32_t j = 0; j < kd->part_count; ++j) {
 			const struct key_part *kp = &kd->parts[j];
 			if (!key_part_is_nullable(kp) &&
@@ -98,6 +98,12 @@ struct tuple_field {
 	bool is_key_part;
 	/** Action to perform if NULL constraint failed. */
 	enum on_conflict_action nullable_action;
+	/**
+	 * Type of elements of an array field indexed by a
+	 * multikey part. ANY if the field is not indexed by
+	 * any multikey part.
+	 */
+	enum field_type multikey_type;
 };
 
 /**
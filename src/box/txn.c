@@ -277,6 +277,11 @@ txn_write_to_wal(struct txn *txn)
 		say_warn("too long WAL write: %d rows at LSN %lld: %.3f sec",
 			 txn->n_rows, res - txn->n_rows + 1, stop - start);
 	}
+	/* Account the wait to the request being executed, if any. */
+	double *wal_wait = (double *) fiber_get_key(fiber(),
+						    FIBER_KEY_WAL_WAIT);
+	if (wal_wait != NULL)
+		*wal_wait += stop - start;
 	/*
 	 * Use vclock_sum() from WAL writer as transaction signature.
 	 */
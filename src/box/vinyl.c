@@ -657,6 +657,21 @@ vinyl_space_check_index_def(struct space *space, struct index_def *index_def)
 		diag_set(ClientError, ER_NULLABLE_PRIMARY, space_name(space));
 		return -1;
 	}
+	if (index_def->key_def->is_multikey) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "multikey parts");
+		return -1;
+	}
+	if (index_def->opts.func_id != 0) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "functional indexes");
+		return -1;
+	}
+	if (index_def->opts.filter != NULL) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "partial indexes");
+		return -1;
+	}
 	/* Check that there are no ANY, ARRAY, MAP parts */
 	for (uint32_t i = 0; i < index_def->key_def->part_count; i++) {
 		struct key_part *part = &index_def->key_def->parts[i];
@@ -4161,6 +4176,8 @@ static const struct space_vtab vinyl_space_vtab = {
 	/* .commit_truncate = */ vinyl_space_commit_truncate,
 	/* .prepare_alter = */ vinyl_space_prepare_alter,
 	/* .commit_alter = */ vinyl_space_commit_alter,
+	/* .begin_bulk_load = */ generic_space_begin_bulk_load,
+	/* .end_bulk_load = */ generic_space_end_bulk_load,
 };
 
 static const struct index_vtab vinyl_index_vtab = {
@@ -837,7 +837,8 @@ vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
 	const char *data_end = data + readen;
 	char *rows = page->data;
 	char *rows_end = rows + page_info->unpacked_size;
-	if (xlog_tx_decode(data, data_end, rows, rows_end, zdctx) != 0)
+	if (xlog_tx_decode(data, data_end, rows, rows_end, zdctx,
+			   NULL) != 0)
 		goto error;
 
 	struct xrow_header xrow;
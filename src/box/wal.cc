@@ -38,21 +38,40 @@
 #include "xlog.h"
 #include "xrow.h"
 #include "vy_log.h"
+#include "histogram.h"
+#include "clock.h"
+#include "fiber_cond.h"
 #include "cbus.h"
 #include "coio_task.h"
 #include "replication.h"
+#include "error.h"
 
 
-const char *wal_mode_STRS[] = { "none", "write", "fsync", NULL };
+const char *wal_mode_STRS[] = { "none", "write", "fsync", "async", NULL };
 
 int wal_dir_lock = -1;
 
 static int64_t
 wal_write(struct journal *, struct journal_entry *);
 
+static int64_t
+wal_write_async(struct journal *, struct journal_entry *);
+
 static int64_t
 wal_write_in_wal_mode_none(struct journal *, struct journal_entry *);
 
+/** State of a preallocated WAL file slot. */
+enum wal_prealloc_state {
+	/** No file, or the file must be preallocated anew. */
+	WAL_PREALLOC_EMPTY,
+	/** A collected WAL recycled to the slot. */
+	WAL_PREALLOC_RECYCLED,
+	/** The file is being preallocated. */
+	WAL_PREALLOC_BUSY,
+	/** The file is ready to be used for a new WAL. */
+	WAL_PREALLOC_READY,
+};
+
 /* WAL thread. */
 struct wal_thread {
 	/** 'wal' thread doing the writes. */
@@ -82,6 +101,26 @@ struct wal_writer
 	 * the wal-tx bus and are rolled back "on arrival".
 	 */
 	struct stailq rollback;
+	/**
+	 * wal_mode = 'async': the vector clock of queued
+	 * requests. LSNs are assigned in tx, since a request
+	 * is committed before it reaches the WAL thread.
+	 */
+	struct vclock async_vclock;
+	/**
+	 * wal_mode = 'async': batches of requests sent to the
+	 * WAL thread and not returned yet, oldest first, linked
+	 * by wal_msg::in_async.
+	 */
+	struct stailq async_queue;
+	/** Size of the rows of the requests in async_queue. */
+	int64_t async_bytes;
+	/** wal_async_max_bytes: throttle writers at this size. */
+	int64_t async_max_bytes;
+	/** wal_async_max_lag: throttle writers at this age. */
+	double async_max_lag;
+	/** Signaled when a batch of async_queue is written. */
+	struct fiber_cond async_cond;
 	/* ----------------- wal ------------------- */
 	/** A setting from instance configuration - rows_per_wal */
 	int64_t wal_max_rows;
@@ -89,6 +128,50 @@ struct wal_writer
 	int64_t wal_max_size;
 	/** Another one - wal_mode */
 	enum wal_mode wal_mode;
+	/**
+	 * wal_commit_delay_us, in seconds. If not 0, the writer
+	 * works in group commit mode: written requests are
+	 * acknowledged in groups, after at most this delay, with
+	 * one fdatasync() per group in wal_mode = 'fsync'.
+	 */
+	double commit_delay;
+	/** wal_group_max_bytes: commit a group once it's this big. */
+	int64_t group_max_bytes;
+	/**
+	 * Written but not yet committed write requests,
+	 * linked by wal_msg::in_group.
+	 */
+	struct stailq group;
+	/** Number of bytes written by requests in the group. */
+	int64_t group_bytes;
+	/**
+	 * Offset in the current WAL and the vector clock the
+	 * group starts at, to cut the group off if it can't
+	 * be synced.
+	 */
+	off_t group_offset;
+	struct vclock group_vclock;
+	/** Commits the group when commit_delay passes. */
+	struct ev_timer commit_timer;
+	/** Statistics of group commit, see wal_stat(). */
+	int64_t group_count;
+	int64_t entry_count;
+	/** Distribution of the number of requests per group. */
+	struct histogram *group_size_hist;
+	/** Distribution of fdatasync() time, in microseconds. */
+	struct histogram *fsync_time_hist;
+	/** wal_prealloc_count: the number of preallocated files. */
+	int prealloc_count;
+	/** wal_prealloc_zero_fill */
+	bool prealloc_zero_fill;
+	/**
+	 * Slots of preallocated files, see wal_prealloc_filename().
+	 */
+	enum wal_prealloc_state prealloc[WAL_PREALLOC_MAX];
+	/** Fiber preallocating files, see wal_prealloc_f(). */
+	struct fiber *prealloc_fiber;
+	/** Signaled when a slot needs a file to be preallocated. */
+	struct fiber_cond prealloc_cond;
 	/** wal_dir, from the configuration file. */
 	struct xdir wal_dir;
 	/**
@@ -127,6 +210,20 @@ struct wal_msg: public cmsg {
 	 * be rolled back.
 	 */
 	struct stailq rollback;
+	/** Link in wal_writer::group. */
+	struct stailq_entry in_group;
+	/**
+	 * Set if the requests were committed before being
+	 * written, wal_mode = 'async'. Such a batch and its
+	 * requests are allocated on the heap and owned by WAL.
+	 */
+	bool is_async;
+	/** Link in wal_writer::async_queue. */
+	struct stailq_entry in_async;
+	/** Size of the rows of the requests, if is_async. */
+	int64_t bytes;
+	/** Time the first request was queued, if is_async. */
+	double queued;
 };
 
 /**
@@ -153,8 +250,25 @@ wal_write_to_disk(struct cmsg *msg);
 static void
 tx_schedule_commit(struct cmsg *msg);
 
+static void
+wal_commit_group(struct wal_writer *writer);
+
+static void
+wal_commit_timer_cb(ev_loop *loop, struct ev_timer *timer, int events);
+
+static void
+wal_prealloc_recycle(struct wal_writer *writer, int64_t lsn);
+
+/*
+ * A write request stays in WAL after it is written, until
+ * its group is committed. Then it is sent back to tx along
+ * wal_commit_route, see wal_commit_group().
+ */
 static struct cmsg_hop wal_request_route[] = {
-	{wal_write_to_disk, &wal_thread.tx_pipe},
+	{wal_write_to_disk, NULL},
+};
+
+static struct cmsg_hop wal_commit_route[] = {
 	{tx_schedule_commit, NULL},
 };
 
@@ -164,6 +278,9 @@ wal_msg_create(struct wal_msg *batch)
 	cmsg_init(batch, wal_request_route);
 	stailq_create(&batch->commit);
 	stailq_create(&batch->rollback);
+	batch->is_async = false;
+	batch->bytes = 0;
+	batch->queued = 0;
 }
 
 static struct wal_msg *
@@ -213,6 +330,35 @@ tx_schedule_queue(struct stailq *queue)
 		fiber_wakeup(req->fiber);
 }
 
+/**
+ * Free a batch of requests written in wal_mode = 'async' and
+ * let throttled writers proceed. There is nobody waiting for
+ * the requests: their transactions are already committed.
+ */
+static void
+tx_complete_async(struct wal_msg *batch)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (! stailq_empty(&batch->rollback)) {
+		/*
+		 * The transactions are committed, and there may
+		 * be newer ones that have seen their changes, so
+		 * they can't be rolled back.
+		 */
+		panic("failed to write committed transactions to WAL "
+		      "in wal_mode = 'async'");
+	}
+	assert(stailq_first_entry(&writer->async_queue, struct wal_msg,
+				  in_async) == batch);
+	stailq_shift(&writer->async_queue);
+	writer->async_bytes -= batch->bytes;
+	struct journal_entry *entry, *next;
+	stailq_foreach_entry_safe(entry, next, &batch->commit, fifo)
+		free(entry);
+	free(batch);
+	fiber_cond_broadcast(&writer->async_cond);
+}
+
 /**
  * Complete execution of a batch of WAL write requests:
  * schedule all committed requests, and, should there
@@ -223,6 +369,8 @@ static void
 tx_schedule_commit(struct cmsg *msg)
 {
 	struct wal_msg *batch = (struct wal_msg *) msg;
+	if (batch->is_async)
+		return tx_complete_async(batch);
 	/*
 	 * Move the rollback list to the writer first, since
 	 * wal_msg memory disappears after the first
@@ -263,22 +411,89 @@ static void
 wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 		  const char *wal_dirname, const struct tt_uuid *instance_uuid,
 		  struct vclock *vclock, int64_t wal_max_rows,
-		  int64_t wal_max_size)
+		  int64_t wal_max_size, double commit_delay,
+		  int64_t group_max_bytes, int prealloc_count,
+		  bool prealloc_zero_fill, bool direct_io,
+		  int64_t async_max_bytes, double async_max_lag,
+		  int compression_level, bool compression_dict)
 {
 	writer->wal_mode = wal_mode;
 	writer->wal_max_rows = wal_max_rows;
 	writer->wal_max_size = wal_max_size;
-	journal_create(&writer->base, wal_mode == WAL_NONE ?
-		       wal_write_in_wal_mode_none : wal_write, NULL);
+	writer->commit_delay = commit_delay;
+	writer->group_max_bytes = group_max_bytes;
+	int64_t (*write)(struct journal *, struct journal_entry *);
+	switch (wal_mode) {
+	case WAL_NONE:
+		write = wal_write_in_wal_mode_none;
+		break;
+	case WAL_ASYNC:
+		write = wal_write_async;
+		break;
+	default:
+		write = wal_write;
+		break;
+	}
+	journal_create(&writer->base, write, NULL);
 
 	xdir_create(&writer->wal_dir, wal_dirname, XLOG, instance_uuid);
 	xlog_clear(&writer->current_wal);
-	if (wal_mode == WAL_FSYNC)
+	/*
+	 * In group commit mode the WAL is synced once per
+	 * group, see wal_commit_group().
+	 */
+	if (wal_mode == WAL_FSYNC && commit_delay == 0)
 		writer->wal_dir.open_wflags |= O_SYNC;
+#ifdef O_DIRECT
+	if (direct_io)
+		writer->wal_dir.open_wflags |= O_DIRECT;
+#else
+	(void) direct_io;
+#endif
+	writer->wal_dir.compression_level = compression_level;
+	writer->wal_dir.use_dict = compression_dict;
+
+	stailq_create(&writer->group);
+	writer->group_bytes = 0;
+	writer->group_offset = 0;
+	vclock_create(&writer->group_vclock);
+	ev_timer_init(&writer->commit_timer, wal_commit_timer_cb, 0, 0);
+	writer->commit_timer.data = writer;
+	writer->group_count = 0;
+	writer->entry_count = 0;
+	static const int64_t group_size_buckets[] = {
+		1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024,
+	};
+	static const int64_t fsync_time_buckets[] = {
+		10, 20, 50, 100, 200, 500, 1000, 2000, 5000,
+		10000, 20000, 50000, 100000, 200000, 500000, 1000000,
+	};
+	writer->group_size_hist = histogram_new(group_size_buckets,
+					lengthof(group_size_buckets));
+	writer->fsync_time_hist = histogram_new(fsync_time_buckets,
+					lengthof(fsync_time_buckets));
+	if (writer->group_size_hist == NULL ||
+	    writer->fsync_time_hist == NULL)
+		panic("failed to allocate WAL statistics");
+
+	assert(prealloc_count <= WAL_PREALLOC_MAX);
+	writer->prealloc_count = prealloc_count;
+	writer->prealloc_zero_fill = prealloc_zero_fill;
+	for (int i = 0; i < WAL_PREALLOC_MAX; i++)
+		writer->prealloc[i] = WAL_PREALLOC_EMPTY;
+	writer->prealloc_fiber = NULL;
+	fiber_cond_create(&writer->prealloc_cond);
 
 	stailq_create(&writer->rollback);
 	cmsg_init(&writer->in_rollback, NULL);
 
+	stailq_create(&writer->async_queue);
+	writer->async_bytes = 0;
+	writer->async_max_bytes = async_max_bytes;
+	writer->async_max_lag = async_max_lag;
+	fiber_cond_create(&writer->async_cond);
+	vclock_copy(&writer->async_vclock, vclock);
+
 	/* Create and fill writer->vclock. */
 	vclock_create(&writer->vclock);
 	vclock_copy(&writer->vclock, vclock);
@@ -291,6 +506,8 @@ static void
 wal_writer_destroy(struct wal_writer *writer)
 {
 	xdir_destroy(&writer->wal_dir);
+	histogram_delete(writer->group_size_hist);
+	histogram_delete(writer->fsync_time_hist);
 }
 
 /** WAL thread routine. */
@@ -319,14 +536,21 @@ wal_thread_start()
 void
 wal_init(enum wal_mode wal_mode, const char *wal_dirname,
 	 const struct tt_uuid *instance_uuid, struct vclock *vclock,
-	 int64_t wal_max_rows, int64_t wal_max_size)
+	 int64_t wal_max_rows, int64_t wal_max_size, double commit_delay,
+	 int64_t group_max_bytes, int prealloc_count,
+	 bool prealloc_zero_fill, bool direct_io,
+	 int64_t async_max_bytes, double async_max_lag,
+	 int compression_level, bool compression_dict)
 {
 	assert(wal_max_rows > 1);
 
 	struct wal_writer *writer = &wal_writer_singleton;
 
 	wal_writer_create(writer, wal_mode, wal_dirname, instance_uuid,
-			  vclock, wal_max_rows, wal_max_size);
+			  vclock, wal_max_rows, wal_max_size, commit_delay,
+			  group_max_bytes, prealloc_count, prealloc_zero_fill,
+			  direct_io, async_max_bytes, async_max_lag,
+			  compression_level, compression_dict);
 
 	xdir_scan_xc(&writer->wal_dir);
 
@@ -364,6 +588,8 @@ wal_checkpoint_f(struct cmsg *data)
 {
 	struct wal_checkpoint *msg = (struct wal_checkpoint *) data;
 	struct wal_writer *writer = &wal_writer_singleton;
+	/* Checkpoint vclock must include only committed rows. */
+	wal_commit_group(writer);
 	if (writer->in_rollback.route != NULL) {
 		/* We're rolling back a failed write. */
 		msg->res = -1;
@@ -431,6 +657,84 @@ wal_checkpoint(struct vclock *vclock, bool rotate)
 	return msg.res;
 }
 
+static int
+wal_sync_f(struct cbus_call_msg *msg)
+{
+	(void) msg;
+	struct wal_writer *writer = &wal_writer_singleton;
+	wal_commit_group(writer);
+	if (writer->in_rollback.route != NULL) {
+		/* We're rolling back a failed write. */
+		diag_set(ClientError, ER_WAL_IO);
+		return -1;
+	}
+	if (xlog_is_open(&writer->current_wal) &&
+	    fdatasync(writer->current_wal.fd) != 0) {
+		diag_set(SystemError, "%s: fdatasync failed",
+			 writer->current_wal.filename);
+		return -1;
+	}
+	return 0;
+}
+
+int
+wal_sync(void)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (! journal_is_initialized(&writer->base) ||
+	    writer->wal_mode == WAL_NONE)
+		return 0;
+	/*
+	 * The requests queued so far are ahead of the call
+	 * in the pipe, and WAL processes them in order.
+	 */
+	struct cbus_call_msg msg;
+	bool cancellable = fiber_set_cancellable(false);
+	int rc = cbus_call(&wal_thread.wal_pipe, &wal_thread.tx_pipe, &msg,
+			   wal_sync_f, NULL, TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+	return rc;
+}
+
+struct wal_stat_msg: public cbus_call_msg
+{
+	struct wal_stat *stat;
+};
+
+static int
+wal_stat_f(struct cbus_call_msg *data)
+{
+	struct wal_stat *stat = ((struct wal_stat_msg *) data)->stat;
+	struct wal_writer *writer = &wal_writer_singleton;
+	stat->groups = writer->group_count;
+	stat->entries = writer->entry_count;
+	struct histogram *hist = writer->group_size_hist;
+	stat->group_size_p50 = histogram_percentile(hist, 50);
+	stat->group_size_p99 = histogram_percentile(hist, 99);
+	stat->group_size_max = hist->max;
+	hist = writer->fsync_time_hist;
+	stat->fsyncs = hist->total;
+	stat->fsync_time_p50 = histogram_percentile(hist, 50) / 1e6;
+	stat->fsync_time_p99 = histogram_percentile(hist, 99) / 1e6;
+	stat->fsync_time_max = hist->max / 1e6;
+	return 0;
+}
+
+void
+wal_stat(struct wal_stat *stat)
+{
+	memset(stat, 0, sizeof(*stat));
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->group_size_hist == NULL)
+		return; /* WAL is not initialized yet. */
+	struct wal_stat_msg msg;
+	msg.stat = stat;
+	bool cancellable = fiber_set_cancellable(false);
+	cbus_call(&wal_thread.wal_pipe, &wal_thread.tx_pipe, &msg,
+		  wal_stat_f, NULL, TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+}
+
 struct wal_gc_msg: public cbus_call_msg
 {
 	int64_t lsn;
@@ -440,6 +744,7 @@ static int
 wal_collect_garbage_f(struct cbus_call_msg *data)
 {
 	int64_t lsn = ((struct wal_gc_msg *)data)->lsn;
+	wal_prealloc_recycle(&wal_writer_singleton, lsn);
 	xdir_collect_garbage(&wal_writer_singleton.wal_dir, lsn, false);
 	return 0;
 }
@@ -461,6 +766,137 @@ wal_collect_garbage(int64_t lsn)
 static void
 wal_notify_watchers(struct wal_writer *writer, unsigned events);
 
+/** Format the name of the preallocated file in slot @a slot. */
+static const char *
+wal_prealloc_filename(struct wal_writer *writer, int slot)
+{
+	static __thread char filename[PATH_MAX + 1];
+	snprintf(filename, sizeof(filename), "%s/%d%s.prealloc",
+		 writer->wal_dir.dirname, slot,
+		 writer->wal_dir.filename_ext);
+	return filename;
+}
+
+/** Find a preallocated file slot in state @a state. */
+static int
+wal_prealloc_find(struct wal_writer *writer, enum wal_prealloc_state state)
+{
+	for (int i = 0; i < writer->prealloc_count; i++) {
+		if (writer->prealloc[i] == state)
+			return i;
+	}
+	return -1;
+}
+
+static ssize_t
+wal_prealloc_cb(va_list ap)
+{
+	const char *filename = va_arg(ap, const char *);
+	off_t size = va_arg(ap, off_t);
+	bool zero_fill = va_arg(ap, int);
+	return xlog_prealloc(filename, size, zero_fill);
+}
+
+/**
+ * A fiber of the WAL thread which fills empty and recycled
+ * slots with preallocated files, so that the WAL writer
+ * doesn't have to create and extend a new file on rotation.
+ * The files are preallocated in the coio thread pool.
+ */
+static int
+wal_prealloc_f(va_list ap)
+{
+	struct wal_writer *writer = va_arg(ap, struct wal_writer *);
+	while (! fiber_is_cancelled()) {
+		int slot = wal_prealloc_find(writer, WAL_PREALLOC_RECYCLED);
+		if (slot < 0)
+			slot = wal_prealloc_find(writer, WAL_PREALLOC_EMPTY);
+		if (slot < 0) {
+			fiber_cond_wait(&writer->prealloc_cond);
+			continue;
+		}
+		writer->prealloc[slot] = WAL_PREALLOC_BUSY;
+		char filename[PATH_MAX + 1];
+		snprintf(filename, sizeof(filename), "%s",
+			 wal_prealloc_filename(writer, slot));
+		if (coio_call(wal_prealloc_cb, filename,
+			      (off_t) writer->wal_max_size,
+			      (int) writer->prealloc_zero_fill) != 0) {
+			diag_log();
+			writer->prealloc[slot] = WAL_PREALLOC_EMPTY;
+			/* Don't retry too often, e.g. if out of space. */
+			fiber_sleep(1);
+			continue;
+		}
+		writer->prealloc[slot] = WAL_PREALLOC_READY;
+	}
+	return 0;
+}
+
+/**
+ * Create a new WAL file, from a preallocated one if there is
+ * one ready.
+ */
+static int
+wal_create_xlog(struct wal_writer *writer)
+{
+	if (writer->prealloc_count == 0)
+		goto create;
+	if (writer->prealloc_fiber == NULL) {
+		writer->prealloc_fiber = fiber_new("wal_prealloc",
+						   wal_prealloc_f);
+		if (writer->prealloc_fiber == NULL) {
+			diag_log();
+			goto create;
+		}
+		fiber_set_joinable(writer->prealloc_fiber, true);
+		fiber_start(writer->prealloc_fiber, writer);
+	}
+	int slot;
+	slot = wal_prealloc_find(writer, WAL_PREALLOC_READY);
+	if (slot < 0)
+		goto create;
+	writer->prealloc[slot] = WAL_PREALLOC_EMPTY;
+	fiber_cond_signal(&writer->prealloc_cond);
+	if (xdir_create_xlog_from(&writer->wal_dir, &writer->current_wal,
+				  &writer->vclock,
+				  wal_prealloc_filename(writer, slot)) == 0)
+		return 0;
+	diag_log();
+create:
+	return xdir_create_xlog(&writer->wal_dir, &writer->current_wal,
+				&writer->vclock);
+}
+
+/**
+ * Move WALs which are about to be collected as garbage to
+ * empty preallocated file slots instead of removing them.
+ */
+static void
+wal_prealloc_recycle(struct wal_writer *writer, int64_t lsn)
+{
+	struct xdir *dir = &writer->wal_dir;
+	struct vclock *vclock;
+	for (vclock = vclockset_first(&dir->index);
+	     vclock != NULL && vclock_sum(vclock) < lsn;
+	     vclock = vclockset_next(&dir->index, vclock)) {
+		int slot = wal_prealloc_find(writer, WAL_PREALLOC_EMPTY);
+		if (slot < 0)
+			break;
+		char *filename = xdir_format_filename(dir, vclock_sum(vclock),
+						      NONE);
+		const char *prealloc = wal_prealloc_filename(writer, slot);
+		if (rename(filename, prealloc) != 0) {
+			say_syserror("can't rename %s to %s",
+				     filename, prealloc);
+			break;
+		}
+		say_info("recycling %s", filename);
+		writer->prealloc[slot] = WAL_PREALLOC_RECYCLED;
+		fiber_cond_signal(&writer->prealloc_cond);
+	}
+}
+
 /**
  * If there is no current WAL, try to open it, and close the
  * previous WAL. We close the previous WAL only after opening
@@ -485,6 +921,8 @@ wal_opt_rotate(struct wal_writer *writer)
 	if (xlog_is_open(&writer->current_wal) &&
 	    (writer->current_wal.rows >= writer->wal_max_rows ||
 	     writer->current_wal.offset >= writer->wal_max_size)) {
+		/* The group must be synced to the old WAL. */
+		wal_commit_group(writer);
 		/*
 		 * We can not handle xlog_close()
 		 * failure in any reasonable way.
@@ -505,8 +943,7 @@ wal_opt_rotate(struct wal_writer *writer)
 	}
 	vclock_copy(vclock, &writer->vclock);
 
-	if (xdir_create_xlog(&writer->wal_dir, &writer->current_wal,
-			     &writer->vclock) != 0) {
+	if (wal_create_xlog(writer) != 0) {
 		diag_log();
 		free(vclock);
 		return -1;
@@ -566,21 +1003,121 @@ wal_writer_begin_rollback(struct wal_writer *writer)
 }
 
 static void
-wal_assign_lsn(struct wal_writer *writer, struct xrow_header **row,
+wal_assign_lsn(struct vclock *vclock, struct xrow_header **row,
 	       struct xrow_header **end)
 {
 	/** Assign LSN to all local rows. */
 	for ( ; row < end; row++) {
 		if ((*row)->replica_id == 0) {
-			(*row)->lsn = vclock_inc(&writer->vclock, instance_id);
+			(*row)->lsn = vclock_inc(vclock, instance_id);
 			(*row)->replica_id = instance_id;
 		} else {
-			vclock_follow(&writer->vclock, (*row)->replica_id,
+			vclock_follow(vclock, (*row)->replica_id,
 				      (*row)->lsn);
 		}
 	}
 }
 
+/**
+ * Roll back the whole group after a failure to sync it. Some
+ * rows of the group may have reached the disk and some may
+ * not, so they are all cut off the WAL and their LSNs are
+ * given back.
+ */
+static void
+wal_rollback_group(struct wal_writer *writer)
+{
+	struct xlog *l = &writer->current_wal;
+	if (xlog_truncate(l, writer->group_offset) != 0)
+		panic("failed to cut off rows which failed to sync");
+	vclock_copy(&writer->vclock, &writer->group_vclock);
+	struct wal_msg *msg;
+	stailq_foreach_entry(msg, &writer->group, in_group) {
+		struct journal_entry *entry;
+		stailq_foreach_entry(entry, &msg->commit, fifo)
+			entry->res = -1;
+		stailq_concat(&msg->rollback, &msg->commit);
+	}
+}
+
+/**
+ * Commit the group of written requests: sync the WAL in group
+ * commit mode and send the requests back to tx. If the WAL
+ * fails to sync, the whole group is rolled back.
+ */
+static void
+wal_commit_group(struct wal_writer *writer)
+{
+	ev_timer_stop(loop(), &writer->commit_timer);
+	if (stailq_empty(&writer->group))
+		return;
+
+	bool is_synced = true;
+	if (writer->wal_mode == WAL_FSYNC && writer->commit_delay > 0 &&
+	    writer->group_bytes > 0 && xlog_is_open(&writer->current_wal)) {
+		double start = clock_monotonic();
+		if (fdatasync(writer->current_wal.fd) != 0) {
+			diag_set(SystemError, "%s: fdatasync failed",
+				 writer->current_wal.filename);
+			diag_log();
+			diag_clear(diag_get());
+			wal_rollback_group(writer);
+			is_synced = false;
+		}
+		histogram_collect(writer->fsync_time_hist,
+				  (clock_monotonic() - start) * 1000000);
+	}
+
+	int64_t entry_count = 0;
+	struct wal_msg *msg, *next;
+	stailq_foreach_entry_safe(msg, next, &writer->group, in_group) {
+		struct journal_entry *entry;
+		stailq_foreach_entry(entry, &msg->commit, fifo)
+			entry_count++;
+		cmsg_init(msg, wal_commit_route);
+		cpipe_push(&wal_thread.tx_pipe, msg);
+	}
+	stailq_create(&writer->group);
+	writer->group_bytes = 0;
+	writer->group_count++;
+	writer->entry_count += entry_count;
+	histogram_collect(writer->group_size_hist, entry_count);
+	/*
+	 * Start the rollback only after the requests of the
+	 * group, so that it reaches tx after them.
+	 */
+	if (! is_synced && writer->in_rollback.route == NULL)
+		wal_writer_begin_rollback(writer);
+	wal_notify_watchers(writer, WAL_EVENT_WRITE);
+}
+
+static void
+wal_commit_timer_cb(ev_loop *loop, struct ev_timer *timer, int events)
+{
+	(void) loop;
+	(void) events;
+	wal_commit_group((struct wal_writer *) timer->data);
+}
+
+/**
+ * Add a processed write request @a msg, which wrote @a bytes to
+ * the WAL, to the group and commit the group if it's time to.
+ * Requests to be rolled back are sent to tx right away.
+ */
+static void
+wal_end_write(struct wal_writer *writer, struct wal_msg *msg, int64_t bytes)
+{
+	stailq_add_tail_entry(&writer->group, msg, in_group);
+	writer->group_bytes += bytes;
+	if (writer->commit_delay == 0 || ! stailq_empty(&msg->rollback) ||
+	    writer->group_bytes >= writer->group_max_bytes) {
+		wal_commit_group(writer);
+	} else if (! ev_is_active(&writer->commit_timer)) {
+		ev_timer_set(&writer->commit_timer, writer->commit_delay, 0);
+		ev_timer_start(loop(), &writer->commit_timer);
+	}
+}
+
 static void
 wal_write_to_disk(struct cmsg *msg)
 {
@@ -594,13 +1131,16 @@ wal_write_to_disk(struct cmsg *msg)
 	if (writer->in_rollback.route != NULL) {
 		/* We're rolling back a failed write. */
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
-		return;
+		return wal_end_write(writer, wal_msg, 0);
 	}
 
 	/* Xlog is only rotated between queue processing  */
 	if (wal_opt_rotate(writer) != 0) {
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
-		return wal_writer_begin_rollback(writer);
+		wal_end_write(writer, wal_msg, 0);
+		if (writer->in_rollback.route == NULL)
+			wal_writer_begin_rollback(writer);
+		return;
 	}
 
 	/*
@@ -625,6 +1165,11 @@ wal_write_to_disk(struct cmsg *msg)
 	 */
 
 	struct xlog *l = &writer->current_wal;
+	off_t start_offset = l->offset;
+	if (stailq_empty(&writer->group)) {
+		writer->group_offset = start_offset;
+		vclock_copy(&writer->group_vclock, &writer->vclock);
+	}
 
 	/*
 	 * Iterate over requests (transactions)
@@ -632,7 +1177,8 @@ wal_write_to_disk(struct cmsg *msg)
 	struct journal_entry *entry;
 	struct stailq_entry *last_committed = NULL;
 	stailq_foreach_entry(entry, &wal_msg->commit, fifo) {
-		wal_assign_lsn(writer, entry->rows, entry->rows + entry->n_rows);
+		wal_assign_lsn(&writer->vclock, entry->rows,
+			       entry->rows + entry->n_rows);
 		entry->res = vclock_sum(&writer->vclock);
 		int rc = xlog_write_entry(l, entry);
 		if (rc < 0)
@@ -663,16 +1209,23 @@ done:
 	struct stailq rollback;
 	stailq_cut_tail(&wal_msg->commit, last_committed, &rollback);
 
-	if (!stailq_empty(&rollback)) {
+	bool is_failed = !stailq_empty(&rollback);
+	if (is_failed) {
 		/* Update status of the successfully committed requests. */
 		stailq_foreach_entry(entry, &rollback, fifo)
 			entry->res = -1;
 		/* Rollback unprocessed requests */
 		stailq_concat(&wal_msg->rollback, &rollback);
-		wal_writer_begin_rollback(writer);
 	}
 	fiber_gc();
-	wal_notify_watchers(writer, WAL_EVENT_WRITE);
+	/*
+	 * The group, with the requests written before the
+	 * failure, is committed right away, and is sent to tx
+	 * ahead of the rollback.
+	 */
+	wal_end_write(writer, wal_msg, MAX(l->offset - start_offset, 0));
+	if (is_failed && writer->in_rollback.route == NULL)
+		wal_writer_begin_rollback(writer);
 }
 
 /** WAL thread main loop.  */
@@ -696,6 +1249,12 @@ wal_thread_f(va_list ap)
 	cbus_loop(&endpoint);
 
 	struct wal_writer *writer = &wal_writer_singleton;
+	wal_commit_group(writer);
+
+	if (writer->prealloc_fiber != NULL) {
+		fiber_cancel(writer->prealloc_fiber);
+		fiber_join(writer->prealloc_fiber);
+	}
 
 	if (xlog_is_open(&writer->current_wal))
 		xlog_close(&writer->current_wal, false);
@@ -780,12 +1339,162 @@ wal_write(struct journal *journal, struct journal_entry *entry)
 	return entry->res;
 }
 
+/**
+ * Copy a request to a single heap block, so that it outlives
+ * the transaction which created it.
+ */
+static struct journal_entry *
+wal_copy_entry(struct journal_entry *entry, int64_t *bytes)
+{
+	size_t body_size = 0;
+	for (int i = 0; i < entry->n_rows; i++) {
+		struct xrow_header *row = entry->rows[i];
+		for (int j = 0; j < row->bodycnt; j++)
+			body_size += row->body[j].iov_len;
+	}
+	size_t size = sizeof(*entry) +
+		entry->n_rows * (sizeof(struct xrow_header *) +
+				 sizeof(struct xrow_header)) + body_size;
+	struct journal_entry *copy = (struct journal_entry *) malloc(size);
+	if (copy == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "struct journal_entry");
+		return NULL;
+	}
+	copy->res = -1;
+	copy->fiber = NULL;
+	copy->n_rows = entry->n_rows;
+	struct xrow_header *rows = (struct xrow_header *)
+		(copy->rows + entry->n_rows);
+	char *data = (char *) (rows + entry->n_rows);
+	for (int i = 0; i < entry->n_rows; i++) {
+		struct xrow_header *row = entry->rows[i];
+		copy->rows[i] = &rows[i];
+		rows[i] = *row;
+		if (row->bodycnt == 0)
+			continue;
+		rows[i].bodycnt = 1;
+		rows[i].body[0].iov_base = data;
+		for (int j = 0; j < row->bodycnt; j++) {
+			memcpy(data, row->body[j].iov_base,
+			       row->body[j].iov_len);
+			data += row->body[j].iov_len;
+		}
+		rows[i].body[0].iov_len = data -
+			(char *) rows[i].body[0].iov_base;
+	}
+	*bytes = body_size;
+	return copy;
+}
+
+/**
+ * Whether requests queued in wal_mode = 'async' exceed
+ * wal_async_max_bytes or wal_async_max_lag.
+ */
+static bool
+wal_async_is_throttled(struct wal_writer *writer)
+{
+	if (stailq_empty(&writer->async_queue))
+		return false;
+	if (writer->async_bytes >= writer->async_max_bytes)
+		return true;
+	struct wal_msg *oldest = stailq_first_entry(&writer->async_queue,
+						    struct wal_msg, in_async);
+	return ev_monotonic_now(loop()) - oldest->queued >=
+		writer->async_max_lag;
+}
+
+/**
+ * WAL writer entry point in wal_mode = 'async': queue a copy
+ * of a request to be written to disk and return without
+ * waiting for the write. The request is committed as soon
+ * as it's queued, unless the queue is over the limits set by
+ * wal_async_max_bytes and wal_async_max_lag, in which case
+ * the caller waits until WAL catches up.
+ */
+int64_t
+wal_write_async(struct journal *journal, struct journal_entry *entry)
+{
+	struct wal_writer *writer = (struct wal_writer *) journal;
+
+	ERROR_INJECT_RETURN(ERRINJ_WAL_IO);
+
+	/*
+	 * Don't let spurious wakeups through, or the queue
+	 * would grow past the limits.
+	 */
+	bool cancellable = fiber_set_cancellable(false);
+	while (wal_async_is_throttled(writer))
+		fiber_cond_wait(&writer->async_cond);
+	fiber_set_cancellable(cancellable);
+
+	int64_t bytes;
+	struct journal_entry *copy = wal_copy_entry(entry, &bytes);
+	if (copy == NULL) {
+		diag_log();
+		return -1;
+	}
+
+	struct wal_msg *batch;
+	bool is_new_batch = false;
+	if (stailq_empty(&wal_thread.wal_pipe.input) ||
+	    (batch = wal_msg(stailq_first_entry(&wal_thread.wal_pipe.input,
+						struct cmsg, fifo))) == NULL ||
+	    ! batch->is_async) {
+		batch = (struct wal_msg *) malloc(sizeof(struct wal_msg));
+		if (batch == NULL) {
+			diag_set(OutOfMemory, sizeof(struct wal_msg),
+				 "malloc", "struct wal_msg");
+			diag_log();
+			free(copy);
+			return -1;
+		}
+		wal_msg_create(batch);
+		batch->is_async = true;
+		batch->queued = ev_monotonic_now(loop());
+		is_new_batch = true;
+	}
+	/*
+	 * LSNs are assigned only after all allocations, so
+	 * that a failed request doesn't leave a gap.
+	 */
+	wal_assign_lsn(&writer->async_vclock, copy->rows,
+		       copy->rows + copy->n_rows);
+	for (int i = 0; i < entry->n_rows; i++) {
+		entry->rows[i]->lsn = copy->rows[i]->lsn;
+		entry->rows[i]->replica_id = copy->rows[i]->replica_id;
+	}
+	stailq_add_tail_entry(&batch->commit, copy, fifo);
+	if (is_new_batch) {
+		stailq_add_tail_entry(&writer->async_queue, batch, in_async);
+		/*
+		 * Sic: first add a request, then push the batch,
+		 * since cpipe_push() may pass the batch to WAL
+		 * thread right away.
+		 */
+		cpipe_push(&wal_thread.wal_pipe, batch);
+	}
+	batch->bytes += bytes;
+	writer->async_bytes += bytes;
+	wal_thread.wal_pipe.n_input += copy->n_rows * XROW_IOVMAX;
+	cpipe_flush_input(&wal_thread.wal_pipe);
+
+	int64_t old_lsn = vclock_get(&replicaset.vclock, instance_id);
+	int64_t new_lsn = vclock_get(&writer->async_vclock, instance_id);
+	if (new_lsn > old_lsn) {
+		/* There were local writes, promote vclock. */
+		vclock_follow(&replicaset.vclock, instance_id, new_lsn);
+	}
+	entry->res = vclock_sum(&writer->async_vclock);
+	return entry->res;
+}
+
 int64_t
 wal_write_in_wal_mode_none(struct journal *journal,
 			   struct journal_entry *entry)
 {
 	struct wal_writer *writer = (struct wal_writer *) journal;
-	wal_assign_lsn(writer, entry->rows, entry->rows + entry->n_rows);
+	wal_assign_lsn(&writer->vclock, entry->rows,
+		       entry->rows + entry->n_rows);
 	int64_t old_lsn = vclock_get(&replicaset.vclock, instance_id);
 	int64_t new_lsn = vclock_get(&writer->vclock, instance_id);
 	if (new_lsn > old_lsn) {
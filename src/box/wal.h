@@ -40,7 +40,16 @@ struct fiber;
 struct vclock;
 struct wal_writer;
 
-enum wal_mode { WAL_NONE = 0, WAL_WRITE, WAL_FSYNC, WAL_MODE_MAX };
+/**
+ * WAL_ASYNC writes like WAL_WRITE, but a transaction is
+ * committed as soon as it's queued for writing, see wal_init().
+ */
+enum wal_mode { WAL_NONE = 0, WAL_WRITE, WAL_FSYNC, WAL_ASYNC, WAL_MODE_MAX };
+
+enum {
+	/** Max number of preallocated WAL files. */
+	WAL_PREALLOC_MAX = 16,
+};
 
 /** String constants for the supported modes. */
 extern const char *wal_mode_STRS[];
@@ -52,10 +61,40 @@ extern int wal_dir_lock;
 void
 wal_thread_start();
 
+/**
+ * Initialize WAL writer. If @a commit_delay is not 0, written
+ * requests are committed in groups: a group is committed when
+ * @a commit_delay seconds pass since its first request was
+ * written or when it grows to @a group_max_bytes, whichever
+ * comes first.
+ *
+ * If @a prealloc_count is not 0, the writer keeps that many
+ * files of @a wal_max_size bytes preallocated in background,
+ * zero-filled if @a prealloc_zero_fill is set, to use them for
+ * new WALs, and recycles collected WALs into them.
+ *
+ * If @a direct_io is set, WALs are written with O_DIRECT,
+ * bypassing the page cache.
+ *
+ * In @a wal_mode WAL_ASYNC, a write request returns as soon as
+ * it's queued to the WAL thread, and the transaction is lost
+ * if the instance crashes before it's written. Writers are
+ * throttled while the queued requests take @a async_max_bytes
+ * or more or the oldest of them was queued @a async_max_lag
+ * seconds ago or earlier. wal_sync() waits for the queue.
+ *
+ * WALs are compressed with zstd level @a compression_level and,
+ * if @a compression_dict is set, with a dictionary trained on
+ * the previous WAL, @sa xdir::use_dict.
+ */
 void
 wal_init(enum wal_mode wal_mode, const char *wal_dirname,
 	 const struct tt_uuid *instance_uuid, struct vclock *vclock,
-	 int64_t wal_max_rows, int64_t wal_max_size);
+	 int64_t wal_max_rows, int64_t wal_max_size, double commit_delay,
+	 int64_t group_max_bytes, int prealloc_count,
+	 bool prealloc_zero_fill, bool direct_io,
+	 int64_t async_max_bytes, double async_max_lag,
+	 int compression_level, bool compression_dict);
 
 void
 wal_thread_stop();
@@ -154,6 +193,18 @@ wal_mode();
 int
 wal_checkpoint(struct vclock *vclock, bool rotate);
 
+/**
+ * Wait until all transactions committed so far are written to
+ * the WAL and make them durable with fdatasync(). Needed in
+ * wal_mode = 'async', where a transaction is committed before
+ * it's written.
+ *
+ * @retval 0 success
+ * @retval -1 error, diagnostics area is set
+ */
+int
+wal_sync(void);
+
 /**
  * Remove WAL files that are not needed to recover
  * from snapshot with @lsn or newer.
@@ -161,6 +212,28 @@ wal_checkpoint(struct vclock *vclock, bool rotate);
 void
 wal_collect_garbage(int64_t lsn);
 
+/** Statistics of WAL writes, see wal_stat(). */
+struct wal_stat {
+	/** Number of committed groups of write requests. */
+	int64_t groups;
+	/** Number of committed write requests. */
+	int64_t entries;
+	/** Percentiles of the number of requests in a group. */
+	int64_t group_size_p50;
+	int64_t group_size_p99;
+	int64_t group_size_max;
+	/** Number of fdatasync() calls made in group commit mode. */
+	int64_t fsyncs;
+	/** Percentiles of fdatasync() time, in seconds. */
+	double fsync_time_p50;
+	double fsync_time_p99;
+	double fsync_time_max;
+};
+
+/** Collect statistics of WAL writes. */
+void
+wal_stat(struct wal_stat *stat);
+
 void
 wal_init_vy_log();
 
@@ -41,6 +41,9 @@
 #include <msgpuck.h>
 
 #include "coio_file.h"
+#include "third_party/base64.h"
+#include <zdict.h>
+#include <pmatomic.h>
 
 #include "error.h"
 #include "xrow.h"
@@ -59,6 +62,7 @@ static const log_magic_t row_marker = mp_bswap_u32(0xd5ba0bab); /* host byte ord
 static const log_magic_t zrow_marker = mp_bswap_u32(0xd5ba0bba); /* host byte order */
 static const log_magic_t eof_marker = mp_bswap_u32(0xd510aded); /* host byte order */
 static const char inprogress_suffix[] = ".inprogress";
+static const char index_suffix[] = ".index";
 
 enum {
 	/**
@@ -77,23 +81,71 @@ enum {
 	 * Maybe this should be a configuration option.
 	 */
 	XLOG_TX_COMPRESS_THRESHOLD = 2 * 1024,
+	/**
+	 * Same, for files compressed with a dictionary:
+	 * it makes compression of small blocks worthwhile.
+	 */
+	XLOG_TX_DICT_COMPRESS_THRESHOLD = 256,
+	/**
+	 * Size of a sample of rows taken from a tx block to
+	 * train the dictionary of the next file on, unless the
+	 * block is smaller.
+	 */
+	XLOG_DICT_SAMPLE_SIZE = 1024,
+	/** Max number of samples taken from a tx block. */
+	XLOG_DICT_BLOCK_SAMPLES = 8,
+	/** Max total size of the samples kept for a file. */
+	XLOG_DICT_SAMPLES_MAX = 128 * 1024,
+	/** Max number of samples kept for a file. */
+	XLOG_DICT_SAMPLE_SLOTS = XLOG_DICT_SAMPLES_MAX /
+				 XLOG_DICT_SAMPLE_SIZE,
+	/**
+	 * Min total size of the samples to train a dictionary
+	 * on. The dictionary is at most a quarter as big.
+	 */
+	XLOG_DICT_SAMPLES_MIN = 8 * 1024,
+	/**
+	 * Alignment of offsets, sizes and buffers of writes
+	 * to a file open with O_DIRECT. Large enough for any
+	 * logical block size in use.
+	 */
+	XLOG_DIRECT_ALIGN = 4096,
+	/**
+	 * Size of the staging buffer for direct writes. Larger
+	 * writes are split into chunks of this size.
+	 */
+	XLOG_DIRECT_BUF_SIZE = 2 * XLOG_TX_AUTOCOMMIT_THRESHOLD,
+	/**
+	 * Minimal distance between two tx blocks recorded in
+	 * the index of a file. A reader seeking with the index
+	 * decodes at most this many bytes of rows it skips.
+	 */
+	XLOG_INDEX_STEP = 64 * 1024,
 };
 
 /* {{{ struct xlog_meta */
 
 enum {
 	/*
-	 * The maximum length of xlog meta
+	 * The maximum length of xlog meta, enough for
+	 * the space list of an incremental snapshot and
+	 * a base64-encoded compression dictionary.
 	 *
 	 * @sa xlog_meta_parse()
 	 */
-	XLOG_META_LEN_MAX = 1024 + VCLOCK_STR_LEN_MAX
+	XLOG_META_LEN_MAX = 1024 + VCLOCK_STR_LEN_MAX +
+			    XLOG_META_SPACES_MAX * 11 +
+			    (XLOG_DICT_SIZE_MAX + 2) / 3 * 4,
 };
 
 #define INSTANCE_UUID_KEY "Instance"
 #define INSTANCE_UUID_KEY_V12 "Server"
 #define VCLOCK_KEY "VClock"
 #define VERSION_KEY "Version"
+#define BASE_KEY "Base"
+#define SPACES_KEY "Spaces"
+#define DICT_KEY "Dictionary"
+#define PADDED_KEY "Padded"
 
 static const char v13[] = "0.13";
 static const char v12[] = "0.12";
@@ -122,13 +174,63 @@ xlog_meta_format(const struct xlog_meta *meta, char *buf, int size)
 		"%s\n"
 		VERSION_KEY ": %s\n"
 		INSTANCE_UUID_KEY ": %s\n"
-		VCLOCK_KEY ": %s\n\n",
+		VCLOCK_KEY ": %s\n",
 		meta->filetype, v13, PACKAGE_VERSION, instance_uuid, vstr);
 	assert(total > 0);
 	free(vstr);
+	if (total < size) {
+		buf += total;
+		size -= total;
+	} else {
+		buf = NULL;
+		size = 0;
+	}
+	if (meta->is_delta) {
+		SNPRINT(total, snprintf, buf, size, BASE_KEY ": %lld\n",
+			(long long)meta->base_signature);
+		SNPRINT(total, snprintf, buf, size, SPACES_KEY ":");
+		for (int i = 0; i < meta->space_count; i++) {
+			SNPRINT(total, snprintf, buf, size, " %u",
+				(unsigned)meta->spaces[i]);
+		}
+		SNPRINT(total, snprintf, buf, size, "\n");
+	}
+	if (meta->dict != NULL) {
+		SNPRINT(total, snprintf, buf, size, DICT_KEY ": %.*s\n",
+			(int)meta->dict_len, meta->dict);
+	}
+	if (meta->is_padded)
+		SNPRINT(total, snprintf, buf, size, PADDED_KEY ": true\n");
+	SNPRINT(total, snprintf, buf, size, "\n");
 	return total;
 }
 
+/**
+ * Parse the list of space ids of an incremental snapshot.
+ */
+static int
+xlog_meta_parse_spaces(struct xlog_meta *meta, const char *val,
+		       const char *val_end)
+{
+	meta->space_count = 0;
+	while (val < val_end) {
+		if (*val == ' ') {
+			val++;
+			continue;
+		}
+		char *end;
+		unsigned long id = strtoul(val, &end, 10);
+		if (end == val || end > val_end || id > UINT32_MAX ||
+		    meta->space_count == XLOG_META_SPACES_MAX) {
+			diag_set(XlogError, "can't parse space list");
+			return -1;
+		}
+		meta->spaces[meta->space_count++] = id;
+		val = end;
+	}
+	return 0;
+}
+
 /**
  * Parse xlog meta from buffer, update buffer read
  * position in case of success
@@ -241,6 +343,43 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 			}
 		} else if (memcmp(key, VERSION_KEY, key_end - key) == 0) {
 			/* Ignore Version: for now */
+		} else if (memcmp(key, BASE_KEY, key_end - key) == 0) {
+			/*
+			 * Base: <signature>
+			 */
+			char *end;
+			long long base = strtoll(val, &end, 10);
+			if (val == val_end || end != val_end || base < 0) {
+				diag_set(XlogError, "can't parse base signature");
+				return -1;
+			}
+			meta->is_delta = true;
+			meta->base_signature = base;
+		} else if (memcmp(key, SPACES_KEY, key_end - key) == 0) {
+			/*
+			 * Spaces: <id> <id> ...
+			 */
+			if (xlog_meta_parse_spaces(meta, val, val_end) != 0)
+				return -1;
+		} else if (memcmp(key, DICT_KEY, key_end - key) == 0) {
+			/*
+			 * Dictionary: <base64>
+			 */
+			if (val == val_end) {
+				diag_set(XlogError, "can't parse dictionary");
+				return -1;
+			}
+			meta->dict = val;
+			meta->dict_len = val_end - val;
+		} else if (memcmp(key, PADDED_KEY, key_end - key) == 0) {
+			/*
+			 * Padded: true
+			 */
+			if (val_end - val != 4 || memcmp(val, "true", 4) != 0) {
+				diag_set(XlogError, "can't parse padding flag");
+				return -1;
+			}
+			meta->is_padded = true;
 		} else {
 			/*
 			 * Unknown key
@@ -271,6 +410,7 @@ xdir_create(struct xdir *dir, const char *dirname,
 	dir->instance_uuid = instance_uuid;
 	snprintf(dir->dirname, PATH_MAX, "%s", dirname);
 	dir->open_wflags = 0;
+	dir->compression_level = XLOG_COMPRESSION_LEVEL_DEFAULT;
 	switch (type) {
 	case SNAP:
 		dir->filetype = "SNAP";
@@ -311,6 +451,149 @@ vclockset_reset(vclockset_t *set)
 	}
 }
 
+/**
+ * Replace the dictionary for new files of a directory with
+ * @a dict of @a size bytes, allocated with malloc().
+ */
+static void
+xdir_set_dict(struct xdir *dir, char *dict, size_t size)
+{
+	free(dir->dict);
+	dir->dict = dict;
+	dir->dict_size = size;
+}
+
+/**
+ * Training of a dictionary for new files of a directory on
+ * the samples of the rows of a closed file. It is done in a
+ * background thread not to stall the thread closing the
+ * file, which is WAL on rotation.
+ */
+struct xdir_dict_job {
+	/** Thread training the dictionary. */
+	struct cord cord;
+	/** Name of the file the samples are taken from. */
+	char filename[PATH_MAX];
+	/** The samples, one after another. */
+	char *samples;
+	/** Sizes of the samples. */
+	size_t *sample_sizes;
+	/** Number of samples. */
+	unsigned sample_count;
+	/** The trained dictionary or NULL on failure. */
+	char *dict;
+	/** Size of @a dict. */
+	size_t dict_size;
+	/** Set by the thread once the training is over. */
+	bool is_done;
+};
+
+static void
+xdir_dict_job_delete(struct xdir_dict_job *job)
+{
+	free(job->samples);
+	free(job->sample_sizes);
+	free(job->dict);
+	free(job);
+}
+
+static void *
+xdir_dict_job_f(void *arg)
+{
+	struct xdir_dict_job *job = (struct xdir_dict_job *)arg;
+	size_t total = 0;
+	for (unsigned i = 0; i < job->sample_count; i++)
+		total += job->sample_sizes[i];
+	size_t capacity = MIN(total / 4, (size_t)XLOG_DICT_SIZE_MAX);
+	char *dict = (char *)malloc(capacity);
+	if (dict != NULL) {
+		size_t size = ZDICT_trainFromBuffer(dict, capacity,
+				job->samples, job->sample_sizes,
+				job->sample_count);
+		if (ZDICT_isError(size)) {
+			say_warn("%s: failed to train compression "
+				 "dictionary: %s", job->filename,
+				 ZDICT_getErrorName(size));
+			free(dict);
+			dict = NULL;
+		} else {
+			job->dict_size = size;
+		}
+	}
+	job->dict = dict;
+	pm_atomic_store(&job->is_done, true);
+	return NULL;
+}
+
+/**
+ * Take the dictionary trained in the background for new
+ * files of a directory, if the training is over. With
+ * @a wait set, wait for the training to end. On failure
+ * the directory keeps the old dictionary.
+ */
+static void
+xdir_collect_dict(struct xdir *dir, bool wait)
+{
+	struct xdir_dict_job *job = dir->dict_job;
+	if (job == NULL || (!wait && !pm_atomic_load(&job->is_done)))
+		return;
+	dir->dict_job = NULL;
+	if (cord_join(&job->cord) != 0)
+		diag_log();
+	if (job->dict != NULL) {
+		xdir_set_dict(dir, job->dict, job->dict_size);
+		job->dict = NULL;
+	}
+	xdir_dict_job_delete(job);
+}
+
+/**
+ * Start training a dictionary for new files of a directory
+ * on the samples of the rows of a log, @sa xdir_collect_dict().
+ * Skipped if there are too few samples or a dictionary is
+ * still being trained on the previous file.
+ */
+static void
+xdir_train_dict(struct xdir *dir, struct xlog *log)
+{
+	xdir_collect_dict(dir, false);
+	const size_t *sizes = (const size_t *)log->sample_sizes.rpos;
+	unsigned count = ibuf_used(&log->sample_sizes) / sizeof(*sizes);
+	size_t total = 0;
+	for (unsigned i = 0; i < count; i++)
+		total += sizes[i];
+	if (dir->dict_job != NULL || total < XLOG_DICT_SAMPLES_MIN)
+		return;
+	struct xdir_dict_job *job =
+		(struct xdir_dict_job *)calloc(1, sizeof(*job));
+	if (job == NULL)
+		return;
+	job->samples = (char *)malloc(total);
+	job->sample_sizes = (size_t *)malloc(count * sizeof(*sizes));
+	if (job->samples == NULL || job->sample_sizes == NULL) {
+		xdir_dict_job_delete(job);
+		return;
+	}
+	/* The samples are kept in slots, pack them. */
+	char *pos = job->samples;
+	for (unsigned i = 0; i < count; i++) {
+		memcpy(pos, log->samples.rpos + i * XLOG_DICT_SAMPLE_SIZE,
+		       sizes[i]);
+		pos += sizes[i];
+		job->sample_sizes[i] = sizes[i];
+	}
+	job->sample_count = count;
+	snprintf(job->filename, sizeof(job->filename), "%s",
+		 log->filename);
+	if (cord_start(&job->cord, "xlog.dict", xdir_dict_job_f,
+		       job) != 0) {
+		diag_log();
+		xdir_dict_job_delete(job);
+		return;
+	}
+	dir->dict_job = job;
+}
+
 /**
  * Destroy xdir object and free memory.
  */
@@ -319,6 +602,60 @@ xdir_destroy(struct xdir *dir)
 {
 	/** Free vclock objects allocated in xdir_scan(). */
 	vclockset_reset(&dir->index);
+	xdir_collect_dict(dir, true);
+	free(dir->dict);
+}
+
+/**
+ * Look up the dictionary for new files of a directory in the
+ * newest file, which is compressed with the dictionary trained
+ * on the file preceding it. This is as good as any, and saves
+ * compressing the first file without a dictionary.
+ */
+static void
+xdir_load_dict(struct xdir *dir)
+{
+	dir->dict_is_loaded = true;
+	struct vclock *vclock = vclockset_last(&dir->index);
+	if (vclock == NULL)
+		return;
+	struct xlog_cursor cursor;
+	if (xdir_open_cursor(dir, vclock_sum(vclock), &cursor) != 0) {
+		diag_log();
+		return;
+	}
+	if (cursor.dict != NULL) {
+		xdir_set_dict(dir, cursor.dict, cursor.dict_size);
+		cursor.dict = NULL;
+	}
+	xlog_cursor_close(&cursor, false);
+}
+
+int
+xdir_copy_compression(struct xdir *dir, struct xdir *src)
+{
+	xdir_collect_dict(src, false);
+	if (src->use_dict && !src->dict_is_loaded)
+		xdir_load_dict(src);
+	char *dict = NULL;
+	if (src->dict != NULL) {
+		dict = (char *)malloc(src->dict_size);
+		if (dict == NULL) {
+			diag_set(OutOfMemory, src->dict_size,
+				 "malloc", "dictionary");
+			return -1;
+		}
+		memcpy(dict, src->dict, src->dict_size);
+	}
+	xdir_set_dict(dir, dict, src->dict_size);
+	if (src->dict_job != NULL && dir->dict_job == NULL) {
+		dir->dict_job = src->dict_job;
+		src->dict_job = NULL;
+	}
+	dir->compression_level = src->compression_level;
+	dir->use_dict = src->use_dict;
+	dir->dict_is_loaded = src->dict_is_loaded;
+	return 0;
 }
 
 /**
@@ -615,6 +952,14 @@ xdir_collect_garbage(struct xdir *dir, int64_t signature, bool use_coio)
 				 filename);
 			return -1;
 		}
+		if (dir->type == XLOG) {
+			/* Remove the index of the file, if any. */
+			filename = tt_sprintf("%s%s", filename, index_suffix);
+			if (use_coio)
+				coio_unlink(filename);
+			else
+				unlink(filename);
+		}
 		vclockset_remove(&dir->index, vclock);
 		free(vclock);
 	}
@@ -660,6 +1005,10 @@ xlog_init(struct xlog *xlog)
 	xlog->is_autocommit = true;
 	obuf_create(&xlog->obuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
 	obuf_create(&xlog->zbuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	ibuf_create(&xlog->index, &cord()->slabc, XLOG_INDEX_STEP);
+	ibuf_create(&xlog->samples, &cord()->slabc, XLOG_DICT_SAMPLES_MAX);
+	ibuf_create(&xlog->sample_sizes, &cord()->slabc, 4096);
+	xlog->compression_level = XLOG_COMPRESSION_LEVEL_DEFAULT;
 	xlog->zctx = ZSTD_createCCtx();
 	if (xlog->zctx == NULL) {
 		diag_set(ClientError, ER_COMPRESSION,
@@ -681,16 +1030,114 @@ xlog_destroy(struct xlog *xlog)
 {
 	obuf_destroy(&xlog->obuf);
 	obuf_destroy(&xlog->zbuf);
+	ibuf_destroy(&xlog->index);
+	ibuf_destroy(&xlog->samples);
+	ibuf_destroy(&xlog->sample_sizes);
 	ZSTD_freeCCtx(xlog->zctx);
+	if (xlog->out == NULL)
+		ZSTD_freeCDict(xlog->cdict);
+	free(xlog->dbuf);
 	TRASH(xlog);
 	xlog->fd = -1;
 }
 
-int
-xlog_create(struct xlog *xlog, const char *name, int flags,
-	    const struct xlog_meta *meta)
+/**
+ * Write data to a file open with O_DIRECT at the current
+ * log offset, which is always block-aligned.
+ *
+ * The data is copied to the aligned staging buffer and
+ * written out in whole blocks. The last block is padded with
+ * zeros, which readers skip up to the next block boundary
+ * (see xlog_cursor_skip_padding()), and the next write starts
+ * at the next block. So a write never touches the blocks of
+ * the data written before, and a torn write can't damage
+ * them.
+ *
+ * @retval -1 error
+ * @retval >= 0 the number of bytes written, including the
+ *              padding
+ */
+static ssize_t
+xlog_writev_direct(struct xlog *log, const struct iovec *iov, int iovcnt)
+{
+	assert(log->is_direct);
+	assert(log->offset % XLOG_DIRECT_ALIGN == 0);
+	off_t offset = log->offset;
+	size_t used = 0;
+	for (int i = 0; i < iovcnt; i++) {
+		const char *data = (const char *)iov[i].iov_base;
+		size_t len = iov[i].iov_len;
+		while (len > 0) {
+			size_t chunk = MIN(len, XLOG_DIRECT_BUF_SIZE - used);
+			memcpy(log->dbuf + used, data, chunk);
+			used += chunk;
+			data += chunk;
+			len -= chunk;
+			if (used < XLOG_DIRECT_BUF_SIZE)
+				continue;
+			if (fio_pwriten(log->fd, log->dbuf, used, offset) < 0)
+				return -1;
+			offset += used;
+			used = 0;
+		}
+	}
+	size_t tail = used % XLOG_DIRECT_ALIGN;
+	if (tail > 0) {
+		size_t size = used - tail + XLOG_DIRECT_ALIGN;
+		memset(log->dbuf + used, 0, size - used);
+		used = size;
+	}
+	if (used > 0 && fio_pwriten(log->fd, log->dbuf, used, offset) < 0)
+		return -1;
+	return offset + used - log->offset;
+}
+
+/**
+ * Write data to an xlog file at the current log offset.
+ * Doesn't advance the offset.
+ *
+ * @retval -1 error
+ * @retval >= 0 the number of bytes written
+ */
+static ssize_t
+xlog_writev(struct xlog *log, struct iovec *iov, int iovcnt)
 {
-	char meta_buf[XLOG_META_LEN_MAX];
+	if (log->out != NULL) {
+		size_t size = 0;
+		for (int i = 0; i < iovcnt; i++)
+			size += iov[i].iov_len;
+		char *dst = (char *)ibuf_alloc(log->out, size);
+		if (dst == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+		for (int i = 0; i < iovcnt; i++) {
+			memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+			dst += iov[i].iov_len;
+		}
+		return size;
+	}
+	if (log->is_direct)
+		return xlog_writev_direct(log, iov, iovcnt);
+	return fio_writevn(log->fd, iov, iovcnt);
+}
+
+static ssize_t
+xlog_write(struct xlog *log, const void *buf, size_t count)
+{
+	struct iovec iov = { (void *)buf, count };
+	return xlog_writev(log, &iov, 1);
+}
+
+/**
+ * Create a new xlog file @a name, or, if @a prealloc is not NULL,
+ * turn preallocated file @a prealloc into one.
+ */
+static int
+xlog_create_file(struct xlog *xlog, const char *name, int flags,
+		 const struct xlog_meta *meta, const char *prealloc)
+{
+	char *meta_buf = NULL;
 	int meta_len;
 
 	/*
@@ -721,29 +1168,78 @@ xlog_create(struct xlog *xlog, const char *name, int flags,
 	 * may think that this is a corrupt file and stop
 	 * replication.
 	 */
+	if (prealloc != NULL) {
+		if (rename(prealloc, xlog->filename) != 0) {
+			say_syserror("can't rename %s to %s", prealloc,
+				     xlog->filename);
+			diag_set(SystemError, "failed to rename '%s' file",
+				 prealloc);
+			goto err_open;
+		}
+		flags &= ~(O_CREAT | O_EXCL);
+		xlog->is_preallocated = true;
+	}
 	xlog->fd = open(xlog->filename, flags, 0644);
+#ifdef O_DIRECT
+	if (xlog->fd < 0 && errno == EINVAL && (flags & O_DIRECT) != 0) {
+		/*
+		 * The file system doesn't support direct I/O.
+		 * The file may have been created nevertheless,
+		 * so don't insist on creating it.
+		 */
+		say_warn("%s: O_DIRECT is not supported, "
+			 "falling back to buffered writes", name);
+		flags &= ~(O_DIRECT | O_EXCL);
+		xlog->fd = open(xlog->filename, flags, 0644);
+	}
+#endif /* O_DIRECT */
 	if (xlog->fd < 0) {
 		say_syserror("open, [%s]", name);
 		diag_set(SystemError, "failed to create file '%s'", name);
 		goto err_open;
 	}
+#ifdef O_DIRECT
+	if ((flags & O_DIRECT) != 0) {
+		if (posix_memalign((void **)&xlog->dbuf, XLOG_DIRECT_ALIGN,
+				   XLOG_DIRECT_BUF_SIZE) != 0) {
+			xlog->dbuf = NULL;
+			diag_set(OutOfMemory, XLOG_DIRECT_BUF_SIZE,
+				 "posix_memalign", "xlog->dbuf");
+			goto err_write;
+		}
+		xlog->is_direct = true;
+	}
+#endif /* O_DIRECT */
+	xlog->meta.is_padded = xlog->is_preallocated || xlog->is_direct;
 
 	/* Format metadata */
-	meta_len = xlog_meta_format(&xlog->meta, meta_buf, sizeof(meta_buf));
+	meta_buf = (char *)malloc(XLOG_META_LEN_MAX);
+	if (meta_buf == NULL) {
+		diag_set(OutOfMemory, XLOG_META_LEN_MAX, "malloc", "meta");
+		goto err_write;
+	}
+	meta_len = xlog_meta_format(&xlog->meta, meta_buf, XLOG_META_LEN_MAX);
 	if (meta_len < 0)
 		goto err_write;
 	/* Formatted metadata must fit into meta_buf */
-	assert(meta_len < (int)sizeof(meta_buf));
+	assert(meta_len < XLOG_META_LEN_MAX);
 
 	/* Write metadata */
-	if (fio_writen(xlog->fd, meta_buf, meta_len) < 0) {
+	ssize_t written;
+	written = xlog_write(xlog, meta_buf, meta_len);
+	if (written < 0) {
 		diag_set(SystemError, "%s: failed to write xlog meta", name);
 		goto err_write;
 	}
+	free(meta_buf);
+	/* The dictionary text belongs to the caller. */
+	xlog->meta.dict = NULL;
+	xlog->meta.dict_len = 0;
 
-	xlog->offset = meta_len; /* first log starts after meta */
+	xlog->offset = written; /* first log starts after meta */
 	return 0;
 err_write:
+	free(meta_buf);
 	close(xlog->fd);
 	unlink(xlog->filename); /* try to remove incomplete file */
 err_open:
@@ -752,12 +1248,151 @@ err:
 	return -1;
 }
 
+int
+xlog_create(struct xlog *xlog, const char *name, int flags,
+	    const struct xlog_meta *meta)
+{
+	return xlog_create_file(xlog, name, flags, meta, NULL);
+}
+
+int
+xlog_create_mem(struct xlog *xlog, const char *name, struct ibuf *out)
+{
+	if (xlog_init(xlog) != 0) {
+		xlog_destroy(xlog);
+		return -1;
+	}
+	snprintf(xlog->filename, sizeof(xlog->filename), "%s", name);
+	xlog->fd = -1;
+	xlog->out = out;
+	xlog->sync_interval = 0;
+	return 0;
+}
+
+void
+xlog_copy_compression(struct xlog *xlog, const struct xlog *src)
+{
+	assert(xlog->out != NULL);
+	xlog->compression_level = src->compression_level;
+	xlog->cdict = src->cdict;
+	/*
+	 * An in-memory writer doesn't train a dictionary on
+	 * close, the samples are merged to @a src instead.
+	 */
+	xlog->dict_dir = src->dict_dir;
+}
+
+/**
+ * Allocate a sample of @a size bytes in the samples of
+ * the rows of a log. Once all slots are taken, the sample
+ * replaces a random one with a probability that gives each
+ * sample taken so far an equal chance to be kept.
+ *
+ * @retval NULL the sample isn't kept or out of memory
+ */
+static char *
+xlog_sample_alloc(struct xlog *log, size_t size)
+{
+	assert(size <= XLOG_DICT_SAMPLE_SIZE);
+	if (size == 0)
+		return NULL;
+	size_t slot = log->sample_count++;
+	if (slot >= XLOG_DICT_SAMPLE_SLOTS) {
+		slot = (size_t)rand() % log->sample_count;
+		if (slot >= XLOG_DICT_SAMPLE_SLOTS)
+			return NULL;
+	} else {
+		if (ibuf_alloc(&log->sample_sizes, sizeof(size_t)) == NULL) {
+			log->sample_count--;
+			return NULL;
+		}
+		if (ibuf_alloc(&log->samples, XLOG_DICT_SAMPLE_SIZE) == NULL) {
+			log->sample_sizes.wpos -= sizeof(size_t);
+			log->sample_count--;
+			return NULL;
+		}
+	}
+	((size_t *)log->sample_sizes.rpos)[slot] = size;
+	return log->samples.rpos + slot * XLOG_DICT_SAMPLE_SIZE;
+}
+
+void
+xlog_merge_samples(struct xlog *log, struct xlog *src)
+{
+	const size_t *sizes = (const size_t *)src->sample_sizes.rpos;
+	size_t count = ibuf_used(&src->sample_sizes) / sizeof(*sizes);
+	for (size_t i = 0; i < count; i++) {
+		char *sample = xlog_sample_alloc(log, sizes[i]);
+		if (sample != NULL) {
+			memcpy(sample, src->samples.rpos +
+			       i * XLOG_DICT_SAMPLE_SIZE, sizes[i]);
+		}
+	}
+}
+
+int
+xlog_prealloc(const char *filename, off_t size, bool zero_fill)
+{
+#ifndef HAVE_POSIX_FALLOCATE
+	zero_fill = true;
+#endif
+	/*
+	 * When zero-filling, overwrite the old content of
+	 * the file in place, so that its blocks stay allocated.
+	 */
+	int fd = open(filename, O_WRONLY | O_CREAT |
+		      (zero_fill ? 0 : O_TRUNC), 0644);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to create file '%s'", filename);
+		return -1;
+	}
+	if (ftruncate(fd, zero_fill ? size : 0) != 0) {
+		diag_set(SystemError, "failed to truncate file '%s'",
+			 filename);
+		goto err;
+	}
+#ifdef HAVE_POSIX_FALLOCATE
+	if (!zero_fill) {
+		errno = posix_fallocate(fd, 0, size);
+		if (errno != 0) {
+			diag_set(SystemError, "failed to allocate file '%s'",
+				 filename);
+			goto err;
+		}
+		goto sync;
+	}
+#endif /* HAVE_POSIX_FALLOCATE */
+	enum { ZERO_BLOCK_SIZE = 1 << 16 };
+	static __thread char zeros[ZERO_BLOCK_SIZE];
+	for (off_t offset = 0; offset < size; offset += ZERO_BLOCK_SIZE) {
+		size_t len = MIN(size - offset, ZERO_BLOCK_SIZE);
+		if (fio_writen(fd, zeros, len) < 0) {
+			diag_set(SystemError, "failed to write file '%s'",
+				 filename);
+			goto err;
+		}
+	}
+#ifdef HAVE_POSIX_FALLOCATE
+sync:
+#endif
+	if (fsync(fd) < 0) {
+		diag_set(SystemError, "failed to sync file '%s'", filename);
+		goto err;
+	}
+	close(fd);
+	return 0;
+err:
+	close(fd);
+	unlink(filename);
+	return -1;
+}
+
 int
 xlog_open(struct xlog *xlog, const char *name)
 {
 	char magic[sizeof(log_magic_t)];
-	char meta_buf[XLOG_META_LEN_MAX];
-	const char *meta = meta_buf;
+	char *meta_buf = NULL;
+	const char *meta;
 	int meta_len;
 	int rc;
 
@@ -772,13 +1407,19 @@ xlog_open(struct xlog *xlog, const char *name)
 		goto err_open;
 	}
 
-	meta_len = fio_read(xlog->fd, meta_buf, sizeof(meta_buf));
+	meta_buf = (char *)malloc(XLOG_META_LEN_MAX);
+	if (meta_buf == NULL) {
+		diag_set(OutOfMemory, XLOG_META_LEN_MAX, "malloc", "meta");
+		goto err_read;
+	}
+	meta_len = fio_read(xlog->fd, meta_buf, XLOG_META_LEN_MAX);
 	if (meta_len < 0) {
 		diag_set(SystemError, "failed to read file '%s'",
 			 xlog->filename);
 		goto err_read;
 	}
 
+	meta = meta_buf;
 	rc = xlog_meta_parse(&xlog->meta, &meta, meta + meta_len);
 	if (rc < 0)
 		goto err_read;
@@ -786,6 +1427,14 @@ xlog_open(struct xlog *xlog, const char *name)
 		diag_set(XlogError, "Unexpected end of file");
 		goto err_read;
 	}
+	free(meta_buf);
+	meta_buf = NULL;
+	if (xlog->meta.dict != NULL) {
+		/* Appended rows would need the same dictionary. */
+		diag_set(XlogError, "%s: can't append to a file "
+			 "compressed with a dictionary", xlog->filename);
+		goto err_read;
+	}
 
 	/*
 	 * If the file has eof marker, reposition the file pointer so
@@ -812,6 +1461,7 @@ no_eof:
 	}
 	return 0;
 err_read:
+	free(meta_buf);
 	close(xlog->fd);
 err_open:
 	xlog_destroy(xlog);
@@ -843,16 +1493,52 @@ xdir_touch_xlog(struct xdir *dir, const struct vclock *vclock)
  * In case of error, writes a message to the error log
  * and sets errno.
  */
-int
-xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
-		 const struct vclock *vclock)
+static int
+xdir_create_xlog_file(struct xdir *dir, struct xlog *xlog,
+		      const struct vclock *vclock, const char *prealloc,
+		      const struct xlog_meta *delta)
 {
 	char *filename;
 	int64_t signature = vclock_sum(vclock);
 	struct xlog_meta meta;
+	if (delta != NULL)
+		meta = *delta;
+	else
+		memset(&meta, 0, sizeof(meta));
 	assert(signature >= 0);
 	assert(!tt_uuid_is_nil(dir->instance_uuid));
 
+	/*
+	 * Compress the file with the dictionary for new files
+	 * of the directory, if any, and store the dictionary
+	 * in the meta for readers.
+	 */
+	ZSTD_CDict *cdict = NULL;
+	char *dict = NULL;
+	xdir_collect_dict(dir, false);
+	if (dir->use_dict && !dir->dict_is_loaded)
+		xdir_load_dict(dir);
+	if (dir->use_dict && dir->dict != NULL) {
+		int len = base64_bufsize(dir->dict_size, BASE64_NOWRAP);
+		dict = (char *)malloc(len);
+		cdict = ZSTD_createCDict(dir->dict, dir->dict_size,
+					 dir->compression_level);
+		if (dict != NULL && cdict != NULL) {
+			meta.dict_len = base64_encode(dir->dict,
+						      dir->dict_size, dict,
+						      len, BASE64_NOWRAP);
+			meta.dict = dict;
+		} else {
+			/* Not critical, go without the dictionary. */
+			say_warn("%s: failed to load compression "
+				 "dictionary", dir->dirname);
+			free(dict);
+			ZSTD_freeCDict(cdict);
+			dict = NULL;
+			cdict = NULL;
+		}
+	}
+
 	/*
 	* Check whether a file with this name already exists.
 	* We don't overwrite existing files.
@@ -864,15 +1550,39 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	meta.instance_uuid = *dir->instance_uuid;
 	vclock_copy(&meta.vclock, vclock);
 
-	if (xlog_create(xlog, filename, dir->open_wflags, &meta) != 0)
+	int rc = xlog_create_file(xlog, filename, dir->open_wflags, &meta,
+				  prealloc);
+	free(dict);
+	if (rc != 0) {
+		ZSTD_freeCDict(cdict);
 		return -1;
+	}
+	xlog->compression_level = dir->compression_level;
+	xlog->cdict = cdict;
+	if (dir->use_dict)
+		xlog->dict_dir = dir;
 
 	/* set sync interval from xdir settings */
 	xlog->sync_interval = dir->sync_interval;
-	/* free file cache if dir should be synced */
-	xlog->free_cache = dir->sync_interval != 0 ? true: false;
+	/*
+	 * Free file cache if dir should be synced, unless
+	 * the file bypasses it.
+	 */
+	xlog->free_cache = dir->sync_interval != 0 && !xlog->is_direct;
 	xlog->rate_limit = 0;
 
+	if (dir->type == XLOG) {
+		/*
+		 * Remove the index left from a file with the
+		 * same name, if any, and build a new one.
+		 */
+		unlink(tt_sprintf("%s%s", filename, index_suffix));
+		xlog->is_indexed = true;
+		xlog->index_offset = xlog->offset;
+		vclock_copy(&xlog->vclock, vclock);
+		vclock_copy(&xlog->tx_vclock, vclock);
+	}
+
 	/* Rename xlog file */
 	if (dir->suffix != INPROGRESS && xlog_rename(xlog)) {
 		int save_errno = errno;
@@ -884,6 +1594,35 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	return 0;
 }
 
+int
+xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
+		 const struct vclock *vclock)
+{
+	return xdir_create_xlog_file(dir, xlog, vclock, NULL, NULL);
+}
+
+int
+xdir_create_delta_xlog(struct xdir *dir, struct xlog *xlog,
+		       const struct vclock *vclock, int64_t base_signature,
+		       const uint32_t *spaces, int space_count)
+{
+	assert(space_count <= XLOG_META_SPACES_MAX);
+	struct xlog_meta meta;
+	memset(&meta, 0, sizeof(meta));
+	meta.is_delta = true;
+	meta.base_signature = base_signature;
+	memcpy(meta.spaces, spaces, space_count * sizeof(*spaces));
+	meta.space_count = space_count;
+	return xdir_create_xlog_file(dir, xlog, vclock, NULL, &meta);
+}
+
+int
+xdir_create_xlog_from(struct xdir *dir, struct xlog *xlog,
+		      const struct vclock *vclock, const char *filename)
+{
+	return xdir_create_xlog_file(dir, xlog, vclock, filename, NULL);
+}
+
 /**
  * Write a sequence of uncompressed xrow objects.
  *
@@ -934,13 +1673,13 @@ xlog_tx_write_plain(struct xlog *log)
 		return -1;
 	});
 
-	ssize_t written = fio_writevn(log->fd, log->obuf.iov, log->obuf.pos + 1);
+	ssize_t written = xlog_writev(log, log->obuf.iov, log->obuf.pos + 1);
 	if (written < 0) {
 		diag_set(SystemError, "failed to write to '%s' file",
 			 log->filename);
 		return -1;
 	}
-	return obuf_size(&log->obuf);
+	return written;
 }
 
 /**
@@ -956,9 +1695,16 @@ xlog_tx_write_zstd(struct xlog *log)
 
 	uint32_t crc32c = 0;
 	struct iovec *iov;
-	/* 3 is compression level. */
-	ZSTD_compressBegin(log->zctx, 3);
 	size_t offset = XLOG_FIXHEADER_SIZE;
+	size_t rc;
+	if (log->cdict != NULL)
+		rc = ZSTD_compressBegin_usingCDict(log->zctx, log->cdict);
+	else
+		rc = ZSTD_compressBegin(log->zctx, log->compression_level);
+	if (ZSTD_isError(rc)) {
+		diag_set(ClientError, ER_COMPRESSION, ZSTD_getErrorName(rc));
+		goto error;
+	}
 	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
 		/* Estimate max output buffer size. */
 		size_t zmax_size = ZSTD_compressBound(iov->iov_len - offset);
@@ -1024,8 +1770,7 @@ xlog_tx_write_zstd(struct xlog *log)
 	});
 
 	ssize_t written;
-	written = fio_writevn(log->fd, log->zbuf.iov,
-			      log->zbuf.pos + 1);
+	written = xlog_writev(log, log->zbuf.iov, log->zbuf.pos + 1);
 	if (written < 0) {
 		diag_set(SystemError, "failed to write to '%s' file",
 			 log->filename);
@@ -1044,40 +1789,28 @@ error:
 #define SYNC_ROUND_UP(size)	(SYNC_ROUND_DOWN(size + SYNC_MASK))
 
 /**
- * Writes xlog batch to file
+ * Account a tx block of @a rows rows written to the end of
+ * the log, or the failure to write it if @a written is
+ * negative, and sync or throttle the log as configured.
  */
 static ssize_t
-xlog_tx_write(struct xlog *log)
+xlog_tx_written(struct xlog *log, ssize_t written, int64_t rows)
 {
-	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
-		return 0;
-	ssize_t written;
-
-	if (obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
-		written = xlog_tx_write_zstd(log);
-	} else {
-		written = xlog_tx_write_plain(log);
-	}
-	ERROR_INJECT(ERRINJ_WAL_WRITE, {
-		diag_set(ClientError, ER_INJECTION, "xlog write injection");
-		written = -1;
-	});
-
-	obuf_reset(&log->obuf);
 	/*
 	 * Simplify recovery after a temporary write failure:
 	 * truncate the file to the best known good write
-	 * position.
+	 * position. An in-memory log never appends a block
+	 * partially, so there is nothing to cut off.
 	 */
 	if (written < 0) {
-		if (lseek(log->fd, log->offset, SEEK_SET) < 0 ||
-		    ftruncate(log->fd, log->offset) != 0)
+		if (log->out == NULL &&
+		    (lseek(log->fd, log->offset, SEEK_SET) < 0 ||
+		     ftruncate(log->fd, log->offset) != 0))
 			panic_syserror("failed to truncate xlog after write error");
 		return -1;
 	}
 	log->offset += written;
-	log->rows += log->tx_rows;
-	log->tx_rows = 0;
+	log->rows += rows;
 	if ((log->sync_interval && log->offset >=
 	    (off_t)(log->synced_size + log->sync_interval)) ||
 	    (log->rate_limit && log->offset >=
@@ -1119,6 +1852,181 @@ xlog_tx_write(struct xlog *log)
 	return written;
 }
 
+/**
+ * Account a tx block which was written at @a offset in the
+ * index of the log, or forget its rows if @a is_written is
+ * false. Not every block is indexed, see XLOG_INDEX_STEP.
+ */
+static void
+xlog_index_add(struct xlog *log, off_t offset, bool is_written)
+{
+	if (!is_written) {
+		vclock_copy(&log->tx_vclock, &log->vclock);
+		return;
+	}
+	if (offset - log->index_offset >= XLOG_INDEX_STEP) {
+		/*
+		 * The index is sparse anyway, so it's fine
+		 * to skip a block if we're out of memory.
+		 */
+		char *vclock = vclock_to_string(&log->vclock);
+		size_t size = vclock != NULL ? strlen(vclock) + 32 : 0;
+		char *entry = vclock != NULL ?
+			      ibuf_reserve(&log->index, size) : NULL;
+		if (entry != NULL) {
+			int len = snprintf(entry, size, "%lld %s\n",
+					   (long long)offset, vclock);
+			ibuf_alloc(&log->index, len);
+			log->index_offset = offset;
+		}
+		free(vclock);
+	}
+	vclock_copy(&log->vclock, &log->tx_vclock);
+}
+
+/**
+ * Write the index of a closed log of @a size bytes to the
+ * file named after the log with the .index suffix:
+ *
+ *     INDEX
+ *     VClock: <vclock of the log>
+ *     Size: <size of the log>
+ *
+ *     <offset of a tx block> <vclock of the rows before it>
+ *     ...
+ *     EOF
+ *
+ * A failure isn't an error: readers scan the log without
+ * the index.
+ */
+static void
+xlog_index_write(struct xlog *log, off_t size)
+{
+	char *vclock = vclock_to_string(&log->meta.vclock);
+	if (vclock == NULL)
+		return;
+	char header[VCLOCK_STR_LEN_MAX + 64];
+	int header_len = snprintf(header, sizeof(header),
+				  "INDEX\nVClock: %s\nSize: %lld\n\n",
+				  vclock, (long long)size);
+	free(vclock);
+	static const char footer[] = "EOF\n";
+	struct iovec iov[3];
+	iov[0].iov_base = header;
+	iov[0].iov_len = header_len;
+	iov[1].iov_base = log->index.rpos;
+	iov[1].iov_len = ibuf_used(&log->index);
+	iov[2].iov_base = (void *)footer;
+	iov[2].iov_len = strlen(footer);
+
+	const char *filename = tt_sprintf("%s%s", log->filename,
+					  index_suffix);
+	int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		say_syserror("%s: failed to create index", filename);
+		return;
+	}
+	if (fio_writevn(fd, iov, lengthof(iov)) < 0) {
+		say_syserror("%s: failed to write index", filename);
+		unlink(filename);
+	}
+	close(fd);
+}
+
+/**
+ * Copy @a size bytes at @a offset of the rows buffered for
+ * writing to @a dst.
+ */
+static void
+xlog_obuf_copy(struct xlog *log, size_t offset, char *dst, size_t size)
+{
+	struct iovec *iov = log->obuf.iov;
+	while (offset >= iov->iov_len)
+		offset -= (iov++)->iov_len;
+	while (size > 0) {
+		size_t len = MIN(iov->iov_len - offset, size);
+		memcpy(dst, (char *)iov->iov_base + offset, len);
+		dst += len;
+		size -= len;
+		offset = 0;
+		iov++;
+	}
+}
+
+/**
+ * Take samples of the rows buffered for writing, to train
+ * the dictionary of the next file on, @sa xdir::use_dict.
+ * Samples are spread evenly over every tx block, and kept
+ * at random once there are enough of them, so that they
+ * cover the whole file.
+ */
+static void
+xlog_tx_sample(struct xlog *log)
+{
+	size_t size = obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE;
+	size_t count = MIN(size / XLOG_DICT_SAMPLE_SIZE,
+			   (size_t)XLOG_DICT_BLOCK_SAMPLES);
+	count = MAX(count, (size_t)1);
+	size_t step = size / count;
+	for (size_t i = 0; i < count; i++) {
+		size_t len = MIN(size, (size_t)XLOG_DICT_SAMPLE_SIZE);
+		char *sample = xlog_sample_alloc(log, len);
+		if (sample == NULL)
+			continue;
+		xlog_obuf_copy(log, XLOG_FIXHEADER_SIZE + i * step,
+			       sample, len);
+	}
+}
+
+/**
+ * Writes xlog batch to file
+ */
+static ssize_t
+xlog_tx_write(struct xlog *log)
+{
+	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
+		return 0;
+	ssize_t written;
+	off_t offset = log->offset;
+	if (log->dict_dir != NULL)
+		xlog_tx_sample(log);
+
+	size_t threshold = log->cdict != NULL ?
+			   XLOG_TX_DICT_COMPRESS_THRESHOLD :
+			   XLOG_TX_COMPRESS_THRESHOLD;
+	if (obuf_size(&log->obuf) >= threshold) {
+		written = xlog_tx_write_zstd(log);
+	} else {
+		written = xlog_tx_write_plain(log);
+	}
+	ERROR_INJECT(ERRINJ_WAL_WRITE, {
+		diag_set(ClientError, ER_INJECTION, "xlog write injection");
+		written = -1;
+	});
+
+	obuf_reset(&log->obuf);
+	int64_t tx_rows = log->tx_rows;
+	log->tx_rows = 0;
+	if (log->is_indexed)
+		xlog_index_add(log, offset, written >= 0);
+	return xlog_tx_written(log, written, tx_rows);
+}
+
+ssize_t
+xlog_write_raw(struct xlog *log, const void *data, size_t size,
+	       int64_t rows)
+{
+	assert(log->out == NULL);
+	if (xlog_flush(log) < 0)
+		return -1;
+	ssize_t written = xlog_write(log, data, size);
+	if (written < 0) {
+		diag_set(SystemError, "failed to write to '%s' file",
+			 log->filename);
+	}
+	return xlog_tx_written(log, written, rows);
+}
+
 /*
  * Add a row to a log and possibly flush the log.
  *
@@ -1171,6 +2079,9 @@ xlog_write_row(struct xlog *log, const struct xrow_header *packet)
 	}
 	assert(iovcnt <= XROW_IOVMAX);
 	log->tx_rows++;
+	if (log->is_indexed &&
+	    packet->lsn > vclock_get(&log->tx_vclock, packet->replica_id))
+		vclock_follow(&log->tx_vclock, packet->replica_id, packet->lsn);
 
 	size_t row_size = obuf_size(&log->obuf) - page_offset;
 	if (log->is_autocommit &&
@@ -1219,6 +2130,8 @@ xlog_tx_rollback(struct xlog *log)
 	log->is_autocommit = true;
 	log->tx_rows = 0;
 	obuf_reset(&log->obuf);
+	if (log->is_indexed)
+		vclock_copy(&log->tx_vclock, &log->vclock);
 }
 
 /**
@@ -1265,6 +2178,24 @@ xlog_sync(struct xlog *l)
 	return 0;
 }
 
+int
+xlog_truncate(struct xlog *log, off_t offset)
+{
+	assert(log->out == NULL);
+	assert(offset <= log->offset);
+	assert(log->obuf.used == 0);
+	if (lseek(log->fd, offset, SEEK_SET) < 0 ||
+	    ftruncate(log->fd, offset) != 0) {
+		diag_set(SystemError, "failed to truncate '%s' file",
+			 log->filename);
+		return -1;
+	}
+	log->offset = offset;
+	log->synced_size = MIN(log->synced_size, (uint64_t)offset);
+	log->is_indexed = false;
+	return 0;
+}
+
 static int
 xlog_write_eof(struct xlog *l)
 {
@@ -1272,7 +2203,7 @@ xlog_write_eof(struct xlog *l)
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
 		return -1;
 	});
-	if (fio_writen(l->fd, &eof_marker, sizeof(eof_marker)) < 0) {
+	if (xlog_write(l, &eof_marker, sizeof(eof_marker)) < 0) {
 		diag_set(SystemError, "write() failed");
 		return -1;
 	}
@@ -1282,10 +2213,24 @@ xlog_write_eof(struct xlog *l)
 int
 xlog_close(struct xlog *l, bool reuse_fd)
 {
+	if (l->out != NULL) {
+		xlog_destroy(l);
+		return 0;
+	}
 	int rc = xlog_write_eof(l);
 	if (rc < 0)
 		say_error("%s: failed to write EOF marker: %s", l->filename,
 			  diag_last_error(diag_get())->errmsg);
+	if (l->is_preallocated || l->is_direct) {
+		/* Cut off the unused preallocated space or padding. */
+		off_t size = l->offset + (rc == 0 ? sizeof(eof_marker) : 0);
+		if (ftruncate(l->fd, size) != 0)
+			say_syserror("%s: ftruncate() failed", l->filename);
+	}
+	if (l->is_indexed && rc == 0 && !l->is_inprogress)
+		xlog_index_write(l, l->offset + sizeof(eof_marker));
+	if (l->dict_dir != NULL)
+		xdir_train_dict(l->dict_dir, l);
 
 	/*
 	 * Sync the file before closing, since
@@ -1401,6 +2346,19 @@ xlog_cursor_decompress(char **rows, char *rows_end, const char **data,
 	return input.pos == input.size ? 0: 1;
 }
 
+/**
+ * Prepare a decompression context for a zstd frame of a file
+ * compressed with dictionary @a ddict, which may be NULL.
+ */
+static inline void
+xlog_init_dstream(ZSTD_DStream *zdctx, const ZSTD_DDict *ddict)
+{
+	if (ddict != NULL)
+		ZSTD_initDStream_usingDDict(zdctx, ddict);
+	else
+		ZSTD_initDStream(zdctx);
+}
+
 /**
  * xlog fixheader struct
  */
@@ -1494,7 +2452,8 @@ xlog_fixheader_decode(struct xlog_fixheader *fixheader,
 
 int
 xlog_tx_decode(const char *data, const char *data_end,
-	       char *rows, char *rows_end, ZSTD_DStream *zdctx)
+	       char *rows, char *rows_end, ZSTD_DStream *zdctx,
+	       const ZSTD_DDict *ddict)
 {
 	/* Decode fixheader */
 	struct xlog_fixheader fixheader;
@@ -1533,7 +2492,7 @@ xlog_tx_decode(const char *data, const char *data_end,
 
 	/* Decompress zstd rows */
 	assert(fixheader.magic == zrow_marker);
-	ZSTD_initDStream(zdctx);
+	xlog_init_dstream(zdctx, ddict);
 	int rc = xlog_cursor_decompress(&rows, rows_end, &data, data_end,
 					zdctx);
 	if (rc < 0) {
@@ -1549,15 +2508,24 @@ xlog_tx_decode(const char *data, const char *data_end,
 	return 0;
 }
 
-/**
- * @retval -1 error
- * @retval 0 success
- * @retval >0 how many bytes we will have for continue
- */
 ssize_t
-xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
-		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx)
+xlog_tx_size(const char *data, const char *data_end, size_t *size)
+{
+	const char *rpos = data;
+	struct xlog_fixheader fixheader;
+	ssize_t to_load;
+	to_load = xlog_fixheader_decode(&fixheader, &rpos, data_end);
+	if (to_load != 0)
+		return to_load;
+	if ((data_end - rpos) < (ptrdiff_t)fixheader.len)
+		return fixheader.len - (data_end - rpos);
+	*size = rpos - data + fixheader.len;
+	return 0;
+}
+
+ssize_t
+xlog_tx_unpack(struct ibuf *rows, const char **data, const char *data_end,
+	       ZSTD_DStream *zdctx, const ZSTD_DDict *ddict)
 {
 	const char *rpos = *data;
 	struct xlog_fixheader fixheader;
@@ -1581,42 +2549,61 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 	}
 	data_end = rpos + fixheader.len;
 
-	ibuf_create(&tx_cursor->rows, &cord()->slabc,
-		    XLOG_TX_AUTOCOMMIT_THRESHOLD);
 	if (fixheader.magic == row_marker) {
-		void *dst = ibuf_alloc(&tx_cursor->rows, fixheader.len);
+		void *dst = ibuf_alloc(rows, fixheader.len);
 		if (dst == NULL) {
 			diag_set(OutOfMemory, fixheader.len,
 				 "runtime", "xlog rows buffer");
-			ibuf_destroy(&tx_cursor->rows);
 			return -1;
 		}
 		memcpy(dst, rpos, fixheader.len);
 		*data = (char *)rpos + fixheader.len;
 		assert(*data <= data_end);
-		tx_cursor->size = ibuf_used(&tx_cursor->rows);
 		return 0;
 	};
 
 	assert(fixheader.magic == zrow_marker);
-	ZSTD_initDStream(zdctx);
+	size_t used = ibuf_used(rows);
+	xlog_init_dstream(zdctx, ddict);
 	int rc;
 	do {
-		if (ibuf_reserve(&tx_cursor->rows,
-				 XLOG_TX_AUTOCOMMIT_THRESHOLD) == NULL) {
+		if (ibuf_reserve(rows, XLOG_TX_AUTOCOMMIT_THRESHOLD) == NULL) {
 			diag_set(OutOfMemory, XLOG_TX_AUTOCOMMIT_THRESHOLD,
 				  "runtime", "xlog output buffer");
-			ibuf_destroy(&tx_cursor->rows);
+			rows->wpos = rows->rpos + used;
 			return -1;
 		}
-	} while ((rc = xlog_cursor_decompress(&tx_cursor->rows.wpos,
-					      tx_cursor->rows.end, &rpos,
+	} while ((rc = xlog_cursor_decompress(&rows->wpos, rows->end, &rpos,
 					      data_end, zdctx)) == 1);
-	if (rc != 0)
+	if (rc != 0) {
+		/* Discard partially decompressed rows. */
+		rows->wpos = rows->rpos + used;
 		return -1;
+	}
 
 	*data = rpos;
 	assert(*data <= data_end);
+	return 0;
+}
+
+/**
+ * @retval -1 error
+ * @retval 0 success
+ * @retval >0 how many bytes we will have for continue
+ */
+ssize_t
+xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
+		      const char **data, const char *data_end,
+		      ZSTD_DStream *zdctx, const ZSTD_DDict *ddict)
+{
+	ibuf_create(&tx_cursor->rows, &cord()->slabc,
+		    XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	ssize_t rc = xlog_tx_unpack(&tx_cursor->rows, data, data_end,
+				    zdctx, ddict);
+	if (rc != 0) {
+		ibuf_destroy(&tx_cursor->rows);
+		return rc;
+	}
 	tx_cursor->size = ibuf_used(&tx_cursor->rows);
 	return 0;
 }
@@ -1675,6 +2662,33 @@ xlog_cursor_find_tx_magic(struct xlog_cursor *i)
 	return 0;
 }
 
+/**
+ * Skip zeros up to the next block boundary of a padded file,
+ * see xlog_meta::is_padded. A block which is not full is
+ * padded by a direct write, see xlog_writev_direct(). Zeros
+ * at a block boundary are unused space of the file.
+ *
+ * @retval 0 the cursor is past the padding
+ * @retval 1 there is no data past the padding so far
+ * @retval -1 error
+ */
+static int
+xlog_cursor_skip_padding(struct xlog_cursor *i)
+{
+	assert(i->meta.is_padded);
+	size_t skip = XLOG_DIRECT_ALIGN - xlog_cursor_pos(i) %
+		      XLOG_DIRECT_ALIGN;
+	if (skip == XLOG_DIRECT_ALIGN)
+		return 1;
+	int rc = xlog_cursor_ensure(i, skip + sizeof(log_magic_t));
+	if (rc != 0)
+		return rc;
+	if (load_u32(i->rbuf.rpos + skip) == 0)
+		return 1;
+	i->rbuf.rpos += skip;
+	return 0;
+}
+
 int
 xlog_cursor_next_tx(struct xlog_cursor *i)
 {
@@ -1687,6 +2701,29 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 		return -1;
 	if (rc > 0)
 		return 1;
+	/*
+	 * No magic starts with a zero byte. Check just one: a
+	 * block may end less than a magic short of a boundary.
+	 */
+	if (*i->rbuf.rpos == 0 && i->meta.is_padded) {
+		rc = xlog_cursor_skip_padding(i);
+		if (rc < 0)
+			return -1;
+	}
+	if (rc > 0) {
+		/*
+		 * Unused space of a preallocated file, see
+		 * xlog_prealloc(), or of the last block of a
+		 * direct write: this is the end of the data
+		 * written so far. Forget what was read past
+		 * it to re-read it once it's written. Zeros
+		 * in any other file are rejected as an invalid
+		 * magic below.
+		 */
+		i->read_offset -= ibuf_used(&i->rbuf);
+		i->rbuf.wpos = i->rbuf.rpos;
+		return 1;
+	}
 	if (load_u32(i->rbuf.rpos) == eof_marker) {
 		/* eof marker found */
 		goto eof_found;
@@ -1695,7 +2732,8 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 	ssize_t to_load;
 	while ((to_load = xlog_tx_cursor_create(&i->tx_cursor,
 						(const char **)&i->rbuf.rpos,
-						i->rbuf.wpos, i->zdctx)) > 0) {
+						i->rbuf.wpos, i->zdctx,
+						i->ddict)) > 0) {
 		/* not enough data in read buffer */
 		int rc = xlog_cursor_ensure(i, ibuf_used(&i->rbuf) + to_load);
 		if (rc < 0)
@@ -1775,6 +2813,34 @@ xlog_cursor_next(struct xlog_cursor *cursor,
 	return 0;
 }
 
+/**
+ * Decode the compression dictionary of a file just open by
+ * a cursor, if any, @sa xlog_meta::dict.
+ */
+static int
+xlog_cursor_load_dict(struct xlog_cursor *i)
+{
+	if (i->meta.dict == NULL)
+		return 0;
+	size_t capacity = i->meta.dict_len / 4 * 3 + 3;
+	i->dict = (char *)malloc(capacity);
+	if (i->dict == NULL) {
+		diag_set(OutOfMemory, capacity, "malloc", "dictionary");
+		return -1;
+	}
+	i->dict_size = base64_decode(i->meta.dict, i->meta.dict_len,
+				     i->dict, capacity);
+	i->meta.dict = NULL;
+	i->meta.dict_len = 0;
+	i->ddict = ZSTD_createDDict(i->dict, i->dict_size);
+	if (i->ddict == NULL) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 "failed to load dictionary");
+		return -1;
+	}
+	return 0;
+}
+
 int
 xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 {
@@ -1800,6 +2866,8 @@ xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 		diag_set(XlogError, "Unexpected end of file");
 		goto error;
 	}
+	if (xlog_cursor_load_dict(i) != 0)
+		goto error;
 	snprintf(i->name, PATH_MAX, "%s", name);
 	i->zdctx = ZSTD_createDStream();
 	if (i->zdctx == NULL) {
@@ -1810,6 +2878,8 @@ xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 	i->state = XLOG_CURSOR_ACTIVE;
 	return 0;
 error:
+	ZSTD_freeDDict(i->ddict);
+	free(i->dict);
 	ibuf_destroy(&i->rbuf);
 	return -1;
 }
@@ -1857,6 +2927,8 @@ xlog_cursor_openmem(struct xlog_cursor *i, const char *data, size_t size,
 		diag_set(XlogError, "Unexpected end of file");
 		goto error;
 	}
+	if (xlog_cursor_load_dict(i) != 0)
+		goto error;
 	snprintf(i->name, PATH_MAX, "%s", name);
 	i->zdctx = ZSTD_createDStream();
 	if (i->zdctx == NULL) {
@@ -1867,6 +2939,8 @@ xlog_cursor_openmem(struct xlog_cursor *i, const char *data, size_t size,
 	i->state = XLOG_CURSOR_ACTIVE;
 	return 0;
 error:
+	ZSTD_freeDDict(i->ddict);
+	free(i->dict);
 	ibuf_destroy(&i->rbuf);
 	return -1;
 }
@@ -1894,10 +2968,150 @@ xlog_cursor_reset(struct xlog_cursor *cursor)
 		diag_set(XlogError, "Unexpected end of file");
 		return -1;
 	}
+	/* The dictionary was decoded on open. */
+	cursor->meta.dict = NULL;
+	cursor->meta.dict_len = 0;
 	cursor->state = XLOG_CURSOR_ACTIVE;
 	return 0;
 }
 
+void
+xlog_cursor_seek(struct xlog_cursor *cursor, off_t offset)
+{
+	assert(xlog_cursor_is_open(cursor));
+	assert(cursor->fd >= 0);
+	if (cursor->state == XLOG_CURSOR_TX)
+		xlog_tx_cursor_destroy(&cursor->tx_cursor);
+	off_t rbuf_offset = cursor->read_offset -
+			    (cursor->rbuf.wpos - cursor->rbuf.buf);
+	if (offset >= rbuf_offset && offset <= cursor->read_offset) {
+		/* The position is still in the read buffer. */
+		cursor->rbuf.rpos = cursor->rbuf.buf + (offset - rbuf_offset);
+	} else {
+		ibuf_reset(&cursor->rbuf);
+		cursor->read_offset = offset;
+	}
+	cursor->state = XLOG_CURSOR_ACTIVE;
+}
+
+/**
+ * Find the offset to seek to in the log @a meta of @a size
+ * bytes with the index @a data, @sa xlog_index_write().
+ *
+ * @retval >0 offset of the last tx block preceded only by
+ *            rows included in @a vclock
+ * @retval  0 no such block
+ * @retval -1 the index is corrupted or stale
+ */
+static off_t
+xlog_index_lookup(char *data, const struct xlog_meta *meta, off_t size,
+		  const struct vclock *vclock)
+{
+	off_t found = 0;
+	off_t prev_offset = 0;
+	struct vclock prev_vclock;
+	vclock_copy(&prev_vclock, &meta->vclock);
+	char *line = data;
+	for (int i = 0; ; i++) {
+		char *end = strchr(line, '\n');
+		if (end == NULL)
+			return -1;
+		*end = '\0';
+		struct vclock entry_vclock;
+		vclock_create(&entry_vclock);
+		char *pos;
+		off_t offset;
+		switch (i) {
+		case 0:
+			if (strcmp(line, "INDEX") != 0)
+				return -1;
+			break;
+		case 1:
+			if (strncmp(line, VCLOCK_KEY ": ",
+				    strlen(VCLOCK_KEY ": ")) != 0 ||
+			    vclock_from_string(&entry_vclock, line +
+					       strlen(VCLOCK_KEY ": ")) != 0 ||
+			    vclock_compare(&entry_vclock, &meta->vclock) != 0)
+				return -1;
+			break;
+		case 2:
+			if (strncmp(line, "Size: ", strlen("Size: ")) != 0 ||
+			    strtoll(line + strlen("Size: "), &pos, 10) != size ||
+			    *pos != '\0')
+				return -1;
+			break;
+		case 3:
+			if (*line != '\0')
+				return -1;
+			break;
+		default:
+			if (strcmp(line, "EOF") == 0)
+				return end[1] == '\0' ? found : -1;
+			offset = strtoll(line, &pos, 10);
+			if (offset <= prev_offset || offset >= size ||
+			    *pos != ' ' ||
+			    vclock_from_string(&entry_vclock, pos + 1) != 0 ||
+			    vclock_compare(&prev_vclock, &entry_vclock) > 0)
+				return -1;
+			int cmp = vclock_compare(&entry_vclock, vclock);
+			if (cmp == 0 || cmp == -1)
+				found = offset;
+			prev_offset = offset;
+			vclock_copy(&prev_vclock, &entry_vclock);
+			break;
+		}
+		line = end + 1;
+	}
+}
+
+void
+xlog_cursor_seek_vclock(struct xlog_cursor *cursor,
+			const struct vclock *vclock)
+{
+	assert(cursor->state == XLOG_CURSOR_ACTIVE);
+	assert(cursor->fd >= 0);
+	const char *filename = tt_sprintf("%s%s", cursor->name,
+					  index_suffix);
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		if (errno != ENOENT)
+			say_syserror("%s: failed to open index", filename);
+		return;
+	}
+	char *data = NULL;
+	off_t offset = -1;
+	struct stat log_stat, index_stat;
+	if (fstat(cursor->fd, &log_stat) != 0 ||
+	    fstat(fd, &index_stat) != 0) {
+		say_syserror("%s: fstat failed", filename);
+		goto out;
+	}
+	data = (char *)malloc(index_stat.st_size + 1);
+	if (data == NULL) {
+		say_error("%s: failed to allocate %lld bytes for index",
+			  filename, (long long)index_stat.st_size + 1);
+		goto out;
+	}
+	if (fio_pread(fd, data, index_stat.st_size, 0) !=
+	    index_stat.st_size) {
+		say_syserror("%s: failed to read index", filename);
+		goto out;
+	}
+	data[index_stat.st_size] = '\0';
+	offset = xlog_index_lookup(data, &cursor->meta, log_stat.st_size,
+				   vclock);
+	if (offset < 0)
+		say_warn("%s: invalid index, ignoring", filename);
+	else if (offset > xlog_cursor_pos(cursor)) {
+		say_info("%s: skipping to offset %lld", cursor->name,
+			 (long long)offset);
+		xlog_cursor_seek(cursor, offset);
+	}
+out:
+	free(data);
+	close(fd);
+}
+
 void
 xlog_cursor_close(struct xlog_cursor *i, bool reuse_fd)
 {
@@ -1908,6 +3122,10 @@ xlog_cursor_close(struct xlog_cursor *i, bool reuse_fd)
 	if (i->state == XLOG_CURSOR_TX)
 		xlog_tx_cursor_destroy(&i->tx_cursor);
 	ZSTD_freeDStream(i->zdctx);
+	ZSTD_freeDDict(i->ddict);
+	free(i->dict);
+	i->ddict = NULL;
+	i->dict = NULL;
 	i->state = (i->state == XLOG_CURSOR_EOF ?
 		    XLOG_CURSOR_EOF_CLOSED : XLOG_CURSOR_CLOSED);
 	/*
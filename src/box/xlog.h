@@ -44,6 +44,7 @@
 
 struct iovec;
 struct xrow_header;
+struct xdir_dict_job;
 
 #if defined(__cplusplus)
 extern "C" {
@@ -135,6 +136,34 @@ struct xdir {
 	 * corresponding file cache will be marked as free
 	 */
 	uint64_t sync_interval;
+	/** zstd level to compress tx blocks of new files with. */
+	int compression_level;
+	/**
+	 * Whether to compress tx blocks of new files with a zstd
+	 * dictionary. The dictionary of a file is trained on the
+	 * rows of a file closed before it was created and is
+	 * stored in its meta, @sa xlog_meta::dict.
+	 */
+	bool use_dict;
+	/**
+	 * The dictionary for the next file, or NULL if there is
+	 * none yet. Allocated with malloc().
+	 */
+	char *dict;
+	/** Size of @a dict. */
+	size_t dict_size;
+	/**
+	 * Set once the dictionary of the newest file in the
+	 * directory was looked up, so that a dictionary isn't
+	 * lost on restart.
+	 */
+	bool dict_is_loaded;
+	/**
+	 * A dictionary being trained in a background thread on
+	 * the rows of the file closed last, or NULL. It replaces
+	 * @a dict once the training is over.
+	 */
+	struct xdir_dict_job *dict_job;
 };
 
 /**
@@ -150,6 +179,19 @@ xdir_create(struct xdir *dir, const char *dirname, enum xdir_type type,
 void
 xdir_destroy(struct xdir *dir);
 
+/**
+ * Copy the compression settings and the dictionary for new
+ * files of @a src to @a dir. If @a src uses a dictionary but
+ * hasn't got one yet, it's looked up in its newest file first.
+ * A dictionary still being trained for @a src is handed over
+ * to @a dir.
+ *
+ * @retval 0 success
+ * @retval -1 error, check diag
+ */
+int
+xdir_copy_compression(struct xdir *dir, struct xdir *src);
+
 /**
  * Scan or re-scan a directory and update directory
  * index with all log files (or snapshots) in the directory.
@@ -209,6 +251,18 @@ xdir_add_vclock(struct xdir *xdir, struct vclock *vclock)
 
 /* {{{ xlog meta */
 
+enum {
+	/**
+	 * Max number of spaces an incremental snapshot
+	 * can list in its meta.
+	 */
+	XLOG_META_SPACES_MAX = 256,
+	/** Max size of a compression dictionary of a file. */
+	XLOG_DICT_SIZE_MAX = 16 * 1024,
+	/** Default zstd level for tx blocks. */
+	XLOG_COMPRESSION_LEVEL_DEFAULT = 3,
+};
+
 /**
  * A xlog meta info
  */
@@ -229,6 +283,42 @@ struct xlog_meta {
 	 * is vector clock *at the time the snapshot is taken*.
 	 */
 	struct vclock vclock;
+	/**
+	 * Set if this is an incremental snapshot: it has only
+	 * the data of the spaces listed in @a spaces, and the
+	 * rest must be taken from the snapshot it is based on.
+	 */
+	bool is_delta;
+	/**
+	 * Text file header, incremental snapshots only:
+	 * the signature of the snapshot this one is based on.
+	 */
+	int64_t base_signature;
+	/**
+	 * Text file header, incremental snapshots only: ids
+	 * of the spaces whose data the file has in full.
+	 */
+	uint32_t spaces[XLOG_META_SPACES_MAX];
+	/** Number of entries in @a spaces. */
+	int space_count;
+	/**
+	 * Text file header: the zstd dictionary the tx blocks
+	 * of the file are compressed with, base64-encoded, or
+	 * NULL. Points to the buffer the meta is formatted from
+	 * or parsed from, so it's only valid while the file is
+	 * being created or opened.
+	 */
+	const char *dict;
+	/** Length of @a dict. */
+	size_t dict_len;
+	/**
+	 * Text file header: set if the file may have zeros
+	 * past the data written so far, because it was
+	 * preallocated or is written with O_DIRECT. A reader
+	 * takes zeros in place of a tx block for the end of
+	 * such a file and for corruption otherwise.
+	 */
+	bool is_padded;
 };
 
 /* }}} */
@@ -261,6 +351,22 @@ struct xlog {
 	char filename[PATH_MAX + 1];
 	/** Whether this file has .inprogress suffix. */
 	bool is_inprogress;
+	/**
+	 * Whether this file was preallocated with xlog_prealloc()
+	 * and so has unused space after the written data, which
+	 * is cut off on close.
+	 */
+	bool is_preallocated;
+	/**
+	 * Whether this file is open with O_DIRECT. If so, all
+	 * writes go through the aligned staging buffer @a dbuf
+	 * and are padded with zeros up to a block boundary.
+	 * Every write starts at a new block, so a block is
+	 * never written twice.
+	 */
+	bool is_direct;
+	/** Aligned staging buffer for direct writes. */
+	char *dbuf;
 	/*
 	 * If true, we can flush the data in this buffer whenever
 	 * we like, and it's usually when the buffer gets
@@ -277,6 +383,12 @@ struct xlog {
 	bool is_autocommit;
 	/** The current offset in the log file, for writing. */
 	off_t offset;
+	/**
+	 * If not NULL, the log isn't backed by a file, and
+	 * tx blocks are appended to this buffer instead,
+	 * @sa xlog_create_mem().
+	 */
+	struct ibuf *out;
 	/**
 	 * Output buffer, works as row accumulator for
 	 * compression.
@@ -311,6 +423,44 @@ struct xlog {
 	uint64_t rate_limit;
 	/** Time when xlog wast synced last time */
 	double sync_time;
+	/**
+	 * Whether to build a sparse index of the tx blocks of
+	 * the file, which is written next to it on close,
+	 * @sa xlog_cursor_seek_vclock().
+	 */
+	bool is_indexed;
+	/** Index entries "<offset> <vclock>\n" added so far. */
+	struct ibuf index;
+	/** Offset of the tx block indexed last. */
+	off_t index_offset;
+	/** Vector clock of the rows written to the file. */
+	struct vclock vclock;
+	/** Same, including the rows buffered for writing. */
+	struct vclock tx_vclock;
+	/** zstd level to compress tx blocks with. */
+	int compression_level;
+	/**
+	 * Compression dictionary of the file, or NULL if tx
+	 * blocks are compressed without one. In-memory writers
+	 * don't own it, @sa xlog_copy_compression().
+	 */
+	ZSTD_CDict *cdict;
+	/**
+	 * The directory to pass a dictionary trained on the
+	 * rows of the file to on close, @sa xdir::use_dict.
+	 * NULL if rows aren't sampled.
+	 */
+	struct xdir *dict_dir;
+	/**
+	 * Samples of the rows of the file, for training, in
+	 * slots of equal size. The slots are a reservoir, so
+	 * that the samples cover the whole file.
+	 */
+	struct ibuf samples;
+	/** Sizes of the samples, an array of size_t. */
+	struct ibuf sample_sizes;
+	/** Number of samples taken, kept or not. */
+	size_t sample_count;
 };
 
 /**
@@ -344,6 +494,43 @@ int
 xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 		 const struct vclock *vclock);
 
+/**
+ * Same as xdir_create_xlog(), but create an incremental
+ * snapshot, based on the snapshot with signature
+ * @a base_signature and having the data of @a space_count
+ * spaces @a spaces in full, @sa xlog_meta::is_delta.
+ */
+int
+xdir_create_delta_xlog(struct xdir *dir, struct xlog *xlog,
+		       const struct vclock *vclock, int64_t base_signature,
+		       const uint32_t *spaces, int space_count);
+
+/**
+ * Same as xdir_create_xlog(), but instead of creating a new
+ * file, take over @a filename, a file preallocated with
+ * xlog_prealloc(). The file is renamed.
+ */
+int
+xdir_create_xlog_from(struct xdir *dir, struct xlog *xlog,
+		      const struct vclock *vclock, const char *filename);
+
+/**
+ * Allocate @a size bytes of disk space for file @a filename,
+ * to be turned into an xlog with xdir_create_xlog_from() later,
+ * so that writes to the xlog don't have to extend the file.
+ * The file is created if it doesn't exist, otherwise its
+ * content is discarded. If @a zero_fill is set, the space is
+ * written with zeros, in place of the old content if any,
+ * otherwise it's only reserved, which is faster, but leaves
+ * the file system some metadata to update on the first write
+ * to each block.
+ *
+ * @retval 0 success
+ * @retval -1 error, check diag
+ */
+int
+xlog_prealloc(const char *filename, off_t size, bool zero_fill);
+
 /**
  * Create new xlog writer based on fd.
  * @param fd            file descriptor
@@ -371,6 +558,43 @@ int
 xlog_open(struct xlog *xlog, const char *name);
 
 
+/**
+ * Create an xlog writer that isn't backed by a file: tx
+ * blocks, framed and compressed exactly as they would be
+ * in a file, are appended to @a out as they are flushed.
+ * Such blocks can then be copied to a real xlog file with
+ * xlog_write_raw(), which lets several threads encode the
+ * data of a single file. The writer has no meta or EOF
+ * marker and is freed with xlog_close().
+ *
+ * @param xlog          xlog descriptor
+ * @param name          name to use in error messages
+ * @param out           buffer for tx blocks
+ *
+ * @retval 0 success
+ * @retval -1 error
+ */
+int
+xlog_create_mem(struct xlog *xlog, const char *name, struct ibuf *out);
+
+/**
+ * Make an in-memory xlog writer compress tx blocks with the
+ * level and the dictionary of @a src, so that the blocks can
+ * be appended to @a src. Rows written to @a xlog are sampled
+ * for the dictionary of the next file if @a src rows are,
+ * @sa xlog_merge_samples().
+ *
+ */
+void
+xlog_copy_compression(struct xlog *xlog, const struct xlog *src);
+
+/**
+ * Add the row samples taken by an in-memory xlog writer to
+ * the samples of @a log, @sa xlog_copy_compression().
+ */
+void
+xlog_merge_samples(struct xlog *log, struct xlog *src);
+
 /**
  * Reset an xlog object without opening it.
  * The object is in limbo state: it doesn't hold
@@ -406,6 +630,18 @@ xlog_rename(struct xlog *l);
 ssize_t
 xlog_write_row(struct xlog *log, const struct xrow_header *packet);
 
+/**
+ * Append tx blocks prepared by an in-memory xlog writer,
+ * @sa xlog_create_mem(), to a log, after flushing the rows
+ * buffered in it. @a rows is the number of rows in the blocks.
+ *
+ * @retval count of written bytes
+ * @retval -1 for error
+ */
+ssize_t
+xlog_write_raw(struct xlog *log, const void *data, size_t size,
+	       int64_t rows);
+
 /**
  * Prevent xlog row buffer offloading, should be use
  * at transaction start to write transaction in one xlog tx
@@ -446,6 +682,18 @@ xlog_flush(struct xlog *log);
 int
 xlog_sync(struct xlog *l);
 
+/**
+ * Cut off the data written to a log past @a offset, which
+ * must be the end of a tx block, e.g. rows which failed to
+ * sync. The index of the log is dropped, since it may refer
+ * to the data cut off.
+ *
+ * @retval 0 success
+ * @retval -1 error
+ */
+int
+xlog_truncate(struct xlog *log, off_t offset);
+
 /**
  * Close the log file and free xlog object.
  *
@@ -486,7 +734,32 @@ struct xlog_tx_cursor
 ssize_t
 xlog_tx_cursor_create(struct xlog_tx_cursor *cursor,
 		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx);
+		      ZSTD_DStream *zdctx, const ZSTD_DDict *ddict);
+
+/**
+ * Get the size of the xlog tx starting at @a data,
+ * including its fixheader, without decoding it.
+ *
+ * @retval 0 for Ok, @a size is set
+ * @retval -1 for error (invalid magic or fixheader)
+ * @retval >0 how many additional bytes should be read to frame tx
+ */
+ssize_t
+xlog_tx_size(const char *data, const char *data_end, size_t *size);
+
+/**
+ * Check and decompress the xlog tx starting at *data,
+ * appending its rows to @a rows. *data will be adjusted
+ * to end of tx. On error @a rows is left as it was.
+ * @a ddict is the dictionary of the file, may be NULL.
+ *
+ * @retval 0 for Ok
+ * @retval -1 for error
+ * @retval >0 how many additional bytes should be read to parse tx
+ */
+ssize_t
+xlog_tx_unpack(struct ibuf *rows, const char **data, const char *data_end,
+	       ZSTD_DStream *zdctx, const ZSTD_DDict *ddict);
 
 /**
  * Destroy xlog tx cursor and free all associated memory
@@ -524,13 +797,15 @@ xlog_tx_cursor_pos(struct xlog_tx_cursor *tx_cursor)
  * @param data_end the end of @a data buffer
  * @param[out] rows a buffer to store decoded rows
  * @param[out] rows_end the end of @a rows buffer
+ * @param zdctx decompression context
+ * @param ddict dictionary of the file or NULL
  * @retval  0 success
  * @retval -1 error, check diag
  */
 int
 xlog_tx_decode(const char *data, const char *data_end,
 	       char *rows, char *rows_end,
-	       ZSTD_DStream *zdctx);
+	       ZSTD_DStream *zdctx, const ZSTD_DDict *ddict);
 
 /* }}} */
 
@@ -569,6 +844,15 @@ struct xlog_cursor
 	struct xlog_tx_cursor tx_cursor;
 	/** ZSTD context for decompression */
 	ZSTD_DStream *zdctx;
+	/**
+	 * Dictionary the tx blocks of the file are compressed
+	 * with, or NULL, @sa xlog_meta::dict.
+	 */
+	ZSTD_DDict *ddict;
+	/** Same, raw, allocated with malloc(). */
+	char *dict;
+	/** Size of @a dict. */
+	size_t dict_size;
 };
 
 /**
@@ -636,6 +920,29 @@ xlog_cursor_openmem(struct xlog_cursor *cursor, const char *data, size_t size,
 int
 xlog_cursor_reset(struct xlog_cursor *cursor);
 
+/**
+ * Move the cursor to the beginning of the xlog tx at
+ * @a offset. The rows of the current tx, if any, are
+ * discarded.
+ * @param cursor cursor, must be open from a file
+ * @param offset file offset of a tx fixheader
+ */
+void
+xlog_cursor_seek(struct xlog_cursor *cursor, off_t offset);
+
+/**
+ * Move a cursor just open from a file to the last tx block
+ * preceded only by rows which are included in @a vclock,
+ * according to the index written next to the file when it
+ * was closed, @sa xlog::is_indexed. The cursor stays where
+ * it is if there is no index or no suitable block in it.
+ * @param cursor cursor, must be open from a file
+ * @param vclock vclock of the rows the caller skips
+ */
+void
+xlog_cursor_seek_vclock(struct xlog_cursor *cursor,
+			const struct vclock *vclock);
+
 /**
  * Close cursor
  * @param cursor cursor
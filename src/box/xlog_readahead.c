@@ -0,0 +1,589 @@
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "xlog_readahead.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cbus.h"
+#include "coio_file.h"
+#include "error.h"
+#include "fiber.h"
+#include "say.h"
+#include "trivia/util.h"
+#include "xrow.h"
+
+enum {
+	/** Amount of raw data read from the file at once. */
+	XLOG_READAHEAD_READ_SIZE = 1024 * 1024,
+	/** Max amount of raw data sent to a thread at once. */
+	XLOG_READAHEAD_CHUNK_SIZE = 256 * 1024,
+};
+
+/**
+ * An xlog reader thread: checks and decompresses tx blocks
+ * and decodes their rows.
+ */
+struct xlog_readahead_worker {
+	/** The thread. */
+	struct cord cord;
+	/** Pipe from tx to the thread. */
+	struct cpipe worker_pipe;
+	/** Pipe from the thread to tx. */
+	struct cpipe tx_pipe;
+	/** Decompression context, used by the thread only. */
+	ZSTD_DStream *zdctx;
+	/** Route of a chunk: decode, then return to tx. */
+	struct cmsg_hop decode_route[2];
+	/** Route of a consumed chunk: free in the thread. */
+	struct cmsg_hop release_route[1];
+};
+
+/**
+ * Position of a tx block in a chunk: where its raw data
+ * and its decompressed rows start, and the index of the
+ * first row of the next block.
+ */
+struct xlog_readahead_block {
+	size_t data_offset;
+	size_t rows_offset;
+	int row_end;
+};
+
+/** A run of whole tx blocks sent to a reader thread. */
+struct xlog_readahead_chunk {
+	/** Cbus message. */
+	struct cmsg base;
+	/** The read-ahead the chunk belongs to. */
+	struct xlog_readahead *ra;
+	/** The thread decoding the chunk. */
+	struct xlog_readahead_worker *worker;
+	/** Sequence number of the chunk in the file. */
+	int64_t seq;
+	/** File offset of the chunk. */
+	off_t offset;
+	/** Raw tx blocks, freed once decoded. */
+	char *data;
+	/** Size of the raw tx blocks. */
+	size_t size;
+	/**
+	 * Size of the tx blocks that were decoded, less than
+	 * size if a block failed to decode.
+	 */
+	size_t decoded_size;
+	/** Decompressed rows, allocated by the thread. */
+	struct ibuf rows_buf;
+	/** Decoded rows, pointing to rows_buf. */
+	struct xrow_header *rows;
+	/** Number of decoded rows. */
+	int row_count;
+	/** Number of rows allocated. */
+	int row_capacity;
+	/** Number of rows returned to the caller. */
+	int row_pos;
+	/** The tx blocks that were decoded. */
+	struct xlog_readahead_block *blocks;
+	/** Number of decoded tx blocks. */
+	int block_count;
+};
+
+static struct xlog_readahead_worker *worker_pool;
+static int worker_pool_size;
+static int next_worker;
+
+/** Reader thread function. */
+static int
+xlog_readahead_worker_f(va_list ap)
+{
+	struct xlog_readahead_worker *worker =
+		va_arg(ap, struct xlog_readahead_worker *);
+	worker->zdctx = ZSTD_createDStream();
+	if (worker->zdctx == NULL)
+		panic("failed to create zstd context");
+	struct cbus_endpoint endpoint;
+	cpipe_create(&worker->tx_pipe, "tx_prio");
+	cbus_endpoint_create(&endpoint, cord_name(cord()),
+			     fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&worker->tx_pipe);
+	ZSTD_freeDStream(worker->zdctx);
+	return 0;
+}
+
+/**
+ * Decode the rows of one tx block, stored in rows_buf
+ * between @a rows_offset and @a rows_end.
+ */
+static int
+xlog_readahead_decode_rows(struct xlog_readahead_chunk *chunk,
+			   size_t rows_offset, size_t rows_end)
+{
+	const char *pos = chunk->rows_buf.rpos + rows_offset;
+	const char *end = chunk->rows_buf.rpos + rows_end;
+	while (pos < end) {
+		if (chunk->row_count == chunk->row_capacity) {
+			int capacity = MAX(2 * chunk->row_capacity, 64);
+			struct xrow_header *rows = realloc(chunk->rows,
+					capacity * sizeof(*rows));
+			if (rows == NULL)
+				return -1;
+			chunk->rows = rows;
+			chunk->row_capacity = capacity;
+		}
+		if (xrow_header_decode(&chunk->rows[chunk->row_count],
+				       &pos, end) != 0) {
+			diag_clear(diag_get());
+			return -1;
+		}
+		chunk->row_count++;
+	}
+	return 0;
+}
+
+/** Decode a chunk in a reader thread. */
+static void
+xlog_readahead_decode_f(struct cmsg *base)
+{
+	struct xlog_readahead_chunk *chunk =
+		(struct xlog_readahead_chunk *)base;
+	struct xlog_readahead_worker *worker = chunk->worker;
+	ibuf_create(&chunk->rows_buf, &cord()->slabc,
+		    XLOG_READAHEAD_CHUNK_SIZE);
+	/*
+	 * Decompress all blocks first: rows point to rows_buf,
+	 * which may move while it grows.
+	 */
+	const char *pos = chunk->data;
+	const char *end = chunk->data + chunk->size;
+	struct xlog_readahead_block *blocks = NULL;
+	int block_count = 0, block_capacity = 0;
+	while (pos < end) {
+		if (block_count == block_capacity) {
+			int capacity = MAX(2 * block_capacity, 16);
+			struct xlog_readahead_block *tmp = realloc(blocks,
+					capacity * sizeof(*blocks));
+			if (tmp == NULL)
+				break;
+			blocks = tmp;
+			block_capacity = capacity;
+		}
+		struct xlog_readahead_block *block = &blocks[block_count];
+		block->data_offset = pos - chunk->data;
+		block->rows_offset = ibuf_used(&chunk->rows_buf);
+		if (xlog_tx_unpack(&chunk->rows_buf, &pos, end, worker->zdctx,
+				   chunk->ra->cursor->ddict) != 0) {
+			diag_clear(diag_get());
+			pos = chunk->data + block->data_offset;
+			break;
+		}
+		block_count++;
+	}
+	chunk->decoded_size = pos - chunk->data;
+	/*
+	 * Stop before a block with a broken row: the cursor
+	 * will read it again and report the error.
+	 */
+	int decoded = 0;
+	for (; decoded < block_count; decoded++) {
+		struct xlog_readahead_block *block = &blocks[decoded];
+		size_t rows_end = decoded + 1 < block_count ?
+				  blocks[decoded + 1].rows_offset :
+				  ibuf_used(&chunk->rows_buf);
+		int row_count = chunk->row_count;
+		if (xlog_readahead_decode_rows(chunk, block->rows_offset,
+					       rows_end) != 0) {
+			chunk->row_count = row_count;
+			chunk->decoded_size = block->data_offset;
+			break;
+		}
+		block->row_end = chunk->row_count;
+	}
+	chunk->blocks = blocks;
+	chunk->block_count = decoded;
+	free(chunk->data);
+	chunk->data = NULL;
+}
+
+/** Put a decoded chunk to the read-ahead window in tx. */
+static void
+xlog_readahead_deliver_f(struct cmsg *base)
+{
+	struct xlog_readahead_chunk *chunk =
+		(struct xlog_readahead_chunk *)base;
+	struct xlog_readahead *ra = chunk->ra;
+	int slot = chunk->seq % ra->window_size;
+	assert(ra->window[slot] == NULL);
+	ra->window[slot] = chunk;
+	ra->in_flight--;
+	fiber_cond_broadcast(&ra->cond);
+}
+
+/** Free a chunk in the thread that allocated its rows. */
+static void
+xlog_readahead_release_f(struct cmsg *base)
+{
+	struct xlog_readahead_chunk *chunk =
+		(struct xlog_readahead_chunk *)base;
+	ibuf_destroy(&chunk->rows_buf);
+	free(chunk->rows);
+	free(chunk->blocks);
+	free(chunk);
+}
+
+static void
+xlog_readahead_release(struct xlog_readahead_chunk *chunk)
+{
+	cmsg_init(&chunk->base, chunk->worker->release_route);
+	cpipe_push(&chunk->worker->worker_pipe, &chunk->base);
+}
+
+void
+xlog_readahead_init(int threads)
+{
+	assert(threads > 0 && threads <= XLOG_READAHEAD_THREADS_MAX);
+	assert(worker_pool == NULL);
+	worker_pool = calloc(threads, sizeof(*worker_pool));
+	if (worker_pool == NULL)
+		panic("failed to allocate xlog reader thread pool");
+	worker_pool_size = threads;
+	next_worker = 0;
+	for (int i = 0; i < worker_pool_size; i++) {
+		struct xlog_readahead_worker *worker = &worker_pool[i];
+		worker->decode_route[0].f = xlog_readahead_decode_f;
+		worker->decode_route[0].pipe = &worker->tx_pipe;
+		worker->decode_route[1].f = xlog_readahead_deliver_f;
+		worker->decode_route[1].pipe = NULL;
+		worker->release_route[0].f = xlog_readahead_release_f;
+		worker->release_route[0].pipe = NULL;
+
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "xlog.reader.%d", i);
+		if (cord_costart(&worker->cord, name,
+				 xlog_readahead_worker_f, worker) != 0)
+			panic("failed to start xlog reader thread");
+		cpipe_create(&worker->worker_pipe, name);
+	}
+	say_info("reading xlogs in %d threads", threads);
+}
+
+void
+xlog_readahead_free(void)
+{
+	if (worker_pool == NULL)
+		return;
+	for (int i = 0; i < worker_pool_size; i++) {
+		struct xlog_readahead_worker *worker = &worker_pool[i];
+		cbus_stop_loop(&worker->worker_pipe);
+		cpipe_destroy(&worker->worker_pipe);
+		if (cord_join(&worker->cord) != 0)
+			panic("failed to join xlog reader thread");
+	}
+	free(worker_pool);
+	worker_pool = NULL;
+	worker_pool_size = 0;
+}
+
+/**
+ * Send the first @a size bytes of the read buffer to a
+ * reader thread.
+ */
+static int
+xlog_readahead_send(struct xlog_readahead *ra, size_t size)
+{
+	struct xlog_readahead_chunk *chunk = calloc(1, sizeof(*chunk));
+	char *data = malloc(size);
+	if (chunk == NULL || data == NULL) {
+		free(chunk);
+		free(data);
+		return -1;
+	}
+	memcpy(data, ra->rbuf.rpos, size);
+	ra->rbuf.rpos += size;
+
+	struct xlog_readahead_worker *worker = &worker_pool[next_worker++];
+	next_worker %= worker_pool_size;
+
+	chunk->ra = ra;
+	chunk->worker = worker;
+	chunk->seq = ra->send_seq++;
+	chunk->offset = ra->read_offset;
+	chunk->data = data;
+	chunk->size = size;
+	ra->read_offset += size;
+	ra->in_flight++;
+	cmsg_init(&chunk->base, worker->decode_route);
+	cpipe_push(&worker->worker_pipe, &chunk->base);
+	return 0;
+}
+
+/**
+ * The reader fiber: reads the file and cuts it into chunks
+ * of whole tx blocks, until the EOF marker, the end of the
+ * data or anything it can't frame. The rest is left to the
+ * cursor.
+ */
+static int
+xlog_readahead_reader_f(va_list ap)
+{
+	struct xlog_readahead *ra = va_arg(ap, struct xlog_readahead *);
+	int fd = ra->cursor->fd;
+	bool is_eof = false;
+	size_t to_load = 0;
+	while (!ra->is_stopping) {
+		if (ra->send_seq - ra->recv_seq >= ra->window_size) {
+			fiber_cond_wait(&ra->cond);
+			continue;
+		}
+		const char *pos = ra->rbuf.rpos;
+		size_t size = 0;
+		bool is_broken = false;
+		while (size < XLOG_READAHEAD_CHUNK_SIZE) {
+			size_t block_size;
+			ssize_t rc = xlog_tx_size(pos, ra->rbuf.wpos,
+						  &block_size);
+			if (rc < 0) {
+				/* EOF marker, unused space or garbage. */
+				diag_clear(diag_get());
+				is_broken = true;
+				break;
+			}
+			if (rc > 0) {
+				to_load = rc;
+				break;
+			}
+			pos += block_size;
+			size += block_size;
+		}
+		if (size > 0) {
+			if (xlog_readahead_send(ra, size) != 0)
+				break;
+			continue;
+		}
+		if (is_broken || is_eof)
+			break;
+		/* Read more data. */
+		if (to_load < XLOG_READAHEAD_READ_SIZE)
+			to_load = XLOG_READAHEAD_READ_SIZE;
+		char *dst = ibuf_reserve(&ra->rbuf, to_load);
+		if (dst == NULL)
+			break;
+		off_t offset = ra->read_offset + ibuf_used(&ra->rbuf);
+		ssize_t n = coio_pread(fd, dst, to_load, offset);
+		if (n < 0) {
+			/* The cursor will retry and report the error. */
+			diag_clear(diag_get());
+			break;
+		}
+		ibuf_alloc(&ra->rbuf, n);
+		is_eof = ((size_t)n < to_load);
+		to_load = 0;
+	}
+	ra->is_reader_done = true;
+	fiber_cond_broadcast(&ra->cond);
+	return 0;
+}
+
+void
+xlog_readahead_create(struct xlog_readahead *ra, struct xlog_cursor *cursor)
+{
+	memset(ra, 0, sizeof(*ra));
+	ra->cursor = cursor;
+}
+
+void
+xlog_readahead_start(struct xlog_readahead *ra)
+{
+	struct xlog_cursor *cursor = ra->cursor;
+	assert(!ra->is_running);
+	/*
+	 * The threads are owned by tx. A file cursor can only
+	 * be moved between tx blocks.
+	 */
+	if (worker_pool == NULL || !cord_is_main() || cursor->fd < 0 ||
+	    cursor->state != XLOG_CURSOR_ACTIVE)
+		return;
+	ra->reader = fiber_new("xlog_readahead", xlog_readahead_reader_f);
+	if (ra->reader == NULL) {
+		diag_log();
+		return;
+	}
+	fiber_set_joinable(ra->reader, true);
+	ibuf_create(&ra->rbuf, &cord()->slabc, XLOG_READAHEAD_READ_SIZE);
+	fiber_cond_create(&ra->cond);
+	ra->read_offset = xlog_cursor_pos(cursor);
+	ra->resume_offset = ra->read_offset;
+	ra->send_seq = ra->recv_seq = 0;
+	ra->in_flight = 0;
+	ra->window_size = 2 * worker_pool_size;
+	ra->is_stopping = ra->is_reader_done = false;
+	ra->current = NULL;
+	ra->is_running = true;
+	fiber_start(ra->reader, ra);
+}
+
+/**
+ * Find where the next row of a chunk is in the file: the
+ * offset of its tx block and the number of rows of the block
+ * returned before it.
+ */
+static off_t
+xlog_readahead_chunk_pos(struct xlog_readahead_chunk *chunk, int *skip)
+{
+	int row_begin = 0;
+	for (int i = 0; i < chunk->block_count; i++) {
+		struct xlog_readahead_block *block = &chunk->blocks[i];
+		if (block->row_end > chunk->row_pos) {
+			*skip = chunk->row_pos - row_begin;
+			return chunk->offset + block->data_offset;
+		}
+		row_begin = block->row_end;
+	}
+	*skip = 0;
+	return chunk->offset + chunk->decoded_size;
+}
+
+/**
+ * Move the cursor to the tx block at @a offset and read
+ * the first @a skip rows of the block.
+ */
+static int
+xlog_readahead_resume(struct xlog_cursor *cursor, off_t offset, int skip)
+{
+	xlog_cursor_seek(cursor, offset);
+	if (skip == 0)
+		return 0;
+	struct xrow_header row;
+	if (xlog_cursor_next_tx(cursor) != 0)
+		goto error;
+	for (int i = 0; i < skip; i++) {
+		if (xlog_cursor_next_row(cursor, &row) != 0)
+			goto error;
+	}
+	return 0;
+error:
+	if (diag_is_empty(diag_get())) {
+		diag_set(XlogError, "%s: failed to reread rows at %lld",
+			 cursor->name, (long long)offset);
+	}
+	return -1;
+}
+
+/**
+ * Stop the pipeline and move the cursor right after the
+ * last returned row.
+ */
+static int
+xlog_readahead_stop(struct xlog_readahead *ra)
+{
+	if (!ra->is_running)
+		return 0;
+	ra->is_stopping = true;
+	fiber_cond_broadcast(&ra->cond);
+	fiber_join(ra->reader);
+	ra->reader = NULL;
+	/* Chunks in flight refer to the window: wait for them. */
+	while (ra->in_flight > 0)
+		fiber_cond_wait(&ra->cond);
+	off_t offset = ra->resume_offset;
+	int skip = 0;
+	if (ra->current != NULL) {
+		offset = xlog_readahead_chunk_pos(ra->current, &skip);
+		xlog_readahead_release(ra->current);
+	}
+	for (int i = 0; i < ra->window_size; i++) {
+		if (ra->window[i] != NULL)
+			xlog_readahead_release(ra->window[i]);
+		ra->window[i] = NULL;
+	}
+	ra->current = NULL;
+	ibuf_destroy(&ra->rbuf);
+	fiber_cond_destroy(&ra->cond);
+	ra->is_running = false;
+	return xlog_readahead_resume(ra->cursor, offset, skip);
+}
+
+void
+xlog_readahead_destroy(struct xlog_readahead *ra)
+{
+	if (xlog_readahead_stop(ra) != 0)
+		diag_log();
+}
+
+/**
+ * Fetch the next decoded row.
+ * @retval 0 for Ok
+ * @retval 1 if the pipeline has nothing more to return
+ */
+static int
+xlog_readahead_next_row(struct xlog_readahead *ra, struct xrow_header *row)
+{
+	while (true) {
+		struct xlog_readahead_chunk *chunk = ra->current;
+		if (chunk != NULL) {
+			if (chunk->row_pos < chunk->row_count) {
+				*row = chunk->rows[chunk->row_pos++];
+				return 0;
+			}
+			ra->resume_offset = chunk->offset +
+					    chunk->decoded_size;
+			if (chunk->decoded_size < chunk->size)
+				return 1; /* let the cursor report it */
+			ra->current = NULL;
+			xlog_readahead_release(chunk);
+		}
+		int slot = ra->recv_seq % ra->window_size;
+		while (ra->window[slot] == NULL) {
+			if (ra->is_reader_done && ra->in_flight == 0)
+				return 1;
+			if (fiber_is_cancelled())
+				return 1;
+			fiber_cond_wait(&ra->cond);
+		}
+		ra->current = ra->window[slot];
+		ra->window[slot] = NULL;
+		ra->recv_seq++;
+		fiber_cond_broadcast(&ra->cond);
+	}
+}
+
+int
+xlog_readahead_next(struct xlog_readahead *ra, struct xrow_header *row,
+		    bool force_recovery)
+{
+	if (ra->is_running) {
+		if (xlog_readahead_next_row(ra, row) == 0)
+			return 0;
+		if (xlog_readahead_stop(ra) != 0)
+			return -1;
+	}
+	return xlog_cursor_next(ra->cursor, row, force_recovery);
+}
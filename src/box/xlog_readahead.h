@@ -0,0 +1,177 @@
+#ifndef TARANTOOL_BOX_XLOG_READAHEAD_H_INCLUDED
+#define TARANTOOL_BOX_XLOG_READAHEAD_H_INCLUDED
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "fiber_cond.h"
+#include "xlog.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct fiber;
+struct xrow_header;
+struct xlog_readahead_chunk;
+
+enum {
+	/** Max number of xlog reader threads. */
+	XLOG_READAHEAD_THREADS_MAX = 64,
+	/** Max number of chunks read ahead of the consumer. */
+	XLOG_READAHEAD_WINDOW_MAX = 2 * XLOG_READAHEAD_THREADS_MAX,
+};
+
+/**
+ * Read-ahead pipeline for recovery.
+ *
+ * Rows of an xlog are framed in tx blocks, each checksummed
+ * and compressed on its own. A reader fiber reads the file
+ * with coio, cuts it into chunks of whole tx blocks and sends
+ * them to the xlog reader threads, which check, decompress and
+ * decode the rows. Decoded chunks come back to tx over cbus
+ * and are returned to the caller in file order.
+ *
+ * The pipeline stops at the EOF marker, at the end of the data
+ * written so far and at the first tx block it fails to read or
+ * decode. The cursor is then moved right after the last row
+ * returned, and the remaining rows are read by the cursor
+ * itself, so the EOF check and error handling, including
+ * force_recovery, work exactly as without read-ahead.
+ */
+struct xlog_readahead {
+	/** The cursor the rows are read from. */
+	struct xlog_cursor *cursor;
+	/** True while the pipeline is running. */
+	bool is_running;
+	/** Set to tell the reader fiber to stop. */
+	bool is_stopping;
+	/** Set when the reader fiber has nothing more to read. */
+	bool is_reader_done;
+	/** The fiber reading the file and sending out chunks. */
+	struct fiber *reader;
+	/** Raw data read from the file but not sent out yet. */
+	struct ibuf rbuf;
+	/** File offset of the first byte in rbuf. */
+	off_t read_offset;
+	/**
+	 * File offset following the chunks fully returned to
+	 * the caller. The cursor is moved there on stop unless
+	 * a chunk is partly returned.
+	 */
+	off_t resume_offset;
+	/** Sequence number of the next chunk to send out. */
+	int64_t send_seq;
+	/** Sequence number of the next chunk to return rows from. */
+	int64_t recv_seq;
+	/** Number of chunks sent out and not returned to tx. */
+	int in_flight;
+	/** Number of chunks allowed to be read ahead. */
+	int window_size;
+	/** Decoded chunks, indexed by seq % window_size. */
+	struct xlog_readahead_chunk *window[XLOG_READAHEAD_WINDOW_MAX];
+	/** The chunk rows are returned from. */
+	struct xlog_readahead_chunk *current;
+	/** Signaled when a chunk arrives or leaves the window. */
+	struct fiber_cond cond;
+};
+
+/**
+ * Start @a threads xlog reader threads. Read-ahead is
+ * used by recovery while the threads are running.
+ */
+void
+xlog_readahead_init(int threads);
+
+/** Stop the xlog reader threads. */
+void
+xlog_readahead_free(void);
+
+/**
+ * Create a read-ahead object for a cursor. The rows are read
+ * by the cursor itself until xlog_readahead_start() is called.
+ */
+void
+xlog_readahead_create(struct xlog_readahead *ra, struct xlog_cursor *cursor);
+
+/**
+ * Start reading ahead from the current cursor position.
+ * Does nothing if there are no xlog reader threads or the
+ * cursor is not positioned at the beginning of a tx.
+ */
+void
+xlog_readahead_start(struct xlog_readahead *ra);
+
+/**
+ * Stop reading ahead, if started, and position the cursor
+ * right after the last returned row: at the tx block of the
+ * next row, with the rows of the block returned before it
+ * read again and skipped. A failure to reread them is logged.
+ */
+void
+xlog_readahead_destroy(struct xlog_readahead *ra);
+
+/**
+ * Fetch the next row. The row is valid until the next call.
+ *
+ * @retval 0 for Ok
+ * @retval 1 for EOF
+ * @retval -1 for error
+ *
+ * @sa xlog_cursor_next()
+ */
+int
+xlog_readahead_next(struct xlog_readahead *ra, struct xrow_header *row,
+		    bool force_recovery);
+
+#if defined(__cplusplus)
+} /* extern C */
+
+#include "exception.h"
+
+/**
+ * @copydoc xlog_readahead_next
+ */
+static inline int
+xlog_readahead_next_xc(struct xlog_readahead *ra, struct xrow_header *row,
+		       bool force_recovery)
+{
+	int rc = xlog_readahead_next(ra, row, force_recovery);
+	if (rc == -1)
+		diag_raise();
+	return rc;
+}
+
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_XLOG_READAHEAD_H_INCLUDED */
@@ -31,6 +31,7 @@
 #include "xrow.h"
 
 #include <msgpuck.h>
+#include <zstd.h>
 #include <small/region.h>
 #include <small/obuf.h>
 #include "third_party/base64.h"
@@ -89,6 +90,9 @@ error:
 		case IPROTO_SCHEMA_VERSION:
 			header->schema_version = mp_decode_uint(pos);
 			break;
+		case IPROTO_COMPRESSION:
+			header->compression = mp_decode_uint(pos);
+			break;
 		default:
 			/* unknown header */
 			mp_next(pos);
@@ -411,11 +415,19 @@ iproto_reply_map_key(struct obuf *buf, uint32_t size, uint8_t key)
 void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t schema_version, uint32_t count)
+{
+	iproto_reply_select_spliced(buf, svp, sync, schema_version, count, 0);
+}
+
+void
+iproto_reply_select_spliced(struct obuf *buf, struct obuf_svp *svp,
+			    uint64_t sync, uint32_t schema_version,
+			    uint32_t count, size_t spliced_size)
 {
 	char *pos = (char *) obuf_svp_to_ptr(buf, svp);
 	iproto_header_encode(pos, IPROTO_OK, sync, schema_version,
-			        obuf_size(buf) - svp->used -
-				IPROTO_HEADER_LEN);
+			     obuf_size(buf) - svp->used + spliced_size -
+			     IPROTO_HEADER_LEN);
 
 	struct iproto_body_bin body = iproto_body_bin;
 	body.v_data_len = mp_bswap_u32(count);
@@ -711,6 +723,260 @@ error:
 	return 0;
 }
 
+int
+xrow_decode_cursor(const struct xrow_header *row,
+		   struct cursor_request *request)
+{
+	if (row->bodycnt == 0) {
+		diag_set(ClientError, ER_INVALID_MSGPACK,
+			 "missing request body");
+		return -1;
+	}
+
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	assert((end - data) > 0);
+
+	if (mp_typeof(*data) != MP_MAP || mp_check_map(data, end) > 0) {
+error:
+		diag_set(ClientError, ER_INVALID_MSGPACK, "packet body");
+		return -1;
+	}
+
+	memset(request, 0, sizeof(*request));
+	request->header = row;
+
+	const uint64_t body_bmap = iproto_key_bit(IPROTO_CURSOR_ID) |
+		iproto_key_bit(IPROTO_SPACE_ID) |
+		iproto_key_bit(IPROTO_INDEX_ID) |
+		iproto_key_bit(IPROTO_ITERATOR) |
+		iproto_key_bit(IPROTO_OFFSET) |
+		iproto_key_bit(IPROTO_LIMIT) |
+		iproto_key_bit(IPROTO_KEY);
+	uint64_t key_map;
+	if (row->type == IPROTO_CURSOR_OPEN) {
+		key_map = iproto_key_bit(IPROTO_SPACE_ID) |
+			  iproto_key_bit(IPROTO_KEY);
+	} else if (row->type == IPROTO_CURSOR_FETCH) {
+		key_map = iproto_key_bit(IPROTO_CURSOR_ID) |
+			  iproto_key_bit(IPROTO_LIMIT);
+	} else {
+		key_map = iproto_key_bit(IPROTO_CURSOR_ID);
+	}
+
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if ((end - data) < 1 || mp_typeof(*data) != MP_UINT)
+			goto error;
+
+		uint64_t key = mp_decode_uint(&data);
+		const char *value = data;
+		if (mp_check(&data, end) != 0)
+			goto error;
+		if (key > IPROTO_KEY ||
+		    (body_bmap & iproto_key_bit(key)) == 0)
+			continue; /* unknown key */
+		if (iproto_key_type[key] != mp_typeof(*value))
+			goto error;
+		key_map &= ~iproto_key_bit(key);
+
+		switch (key) {
+		case IPROTO_CURSOR_ID:
+			request->cursor_id = mp_decode_uint(&value);
+			break;
+		case IPROTO_SPACE_ID:
+			request->space_id = mp_decode_uint(&value);
+			break;
+		case IPROTO_INDEX_ID:
+			request->index_id = mp_decode_uint(&value);
+			break;
+		case IPROTO_ITERATOR:
+			request->iterator = mp_decode_uint(&value);
+			break;
+		case IPROTO_OFFSET:
+			request->offset = mp_decode_uint(&value);
+			break;
+		case IPROTO_LIMIT:
+			request->limit = mp_decode_uint(&value);
+			break;
+		case IPROTO_KEY:
+			request->key = value;
+			request->key_end = data;
+			break;
+		default:
+			unreachable();
+		}
+	}
+	if (data != end) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "packet end");
+		return -1;
+	}
+	if (key_map) {
+		enum iproto_key key = (enum iproto_key) bit_ctz_u64(key_map);
+		diag_set(ClientError, ER_MISSING_REQUEST_FIELD,
+			 iproto_key_name(key));
+		return -1;
+	}
+	return 0;
+}
+
+/** Statement types allowed in a BATCH request. */
+static inline bool
+iproto_type_is_batch_stmt(uint64_t type)
+{
+	return type == IPROTO_INSERT || type == IPROTO_REPLACE ||
+	       type == IPROTO_UPDATE || type == IPROTO_DELETE ||
+	       type == IPROTO_UPSERT;
+}
+
+int
+xrow_decode_batch(const struct xrow_header *row,
+		  struct batch_request *request)
+{
+	if (row->bodycnt == 0) {
+		diag_set(ClientError, ER_INVALID_MSGPACK,
+			 "missing request body");
+		return -1;
+	}
+
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	assert((end - data) > 0);
+
+	if (mp_typeof(*data) != MP_MAP || mp_check_map(data, end) > 0) {
+error:
+		diag_set(ClientError, ER_INVALID_MSGPACK, "packet body");
+		return -1;
+	}
+
+	memset(request, 0, sizeof(*request));
+	request->header = row;
+
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if ((end - data) < 1 || mp_typeof(*data) != MP_UINT)
+			goto error;
+
+		uint64_t key = mp_decode_uint(&data);
+		const char *value = data;
+		if (mp_check(&data, end) != 0)
+			goto error;
+		if (key != IPROTO_REQUESTS)
+			continue; /* unknown key */
+		if (mp_typeof(*value) != MP_ARRAY)
+			goto error;
+		request->count = mp_decode_array(&value);
+		request->requests = value;
+		request->requests_end = data;
+	}
+	if (data != end) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "packet end");
+		return -1;
+	}
+	if (request->requests == NULL) {
+		diag_set(ClientError, ER_MISSING_REQUEST_FIELD,
+			 iproto_key_name(IPROTO_REQUESTS));
+		return -1;
+	}
+	/* Check that every statement is a [type, {body}] pair. */
+	data = request->requests;
+	for (uint32_t i = 0; i < request->count; i++) {
+		if (mp_typeof(*data) != MP_ARRAY ||
+		    mp_decode_array(&data) != 2 ||
+		    mp_typeof(*data) != MP_UINT)
+			goto bad_stmt;
+		uint64_t type = mp_decode_uint(&data);
+		if (!iproto_type_is_batch_stmt(type) ||
+		    mp_typeof(*data) != MP_MAP)
+			goto bad_stmt;
+		mp_next(&data);
+	}
+	assert(data == request->requests_end);
+	return 0;
+bad_stmt:
+	diag_set(ClientError, ER_ILLEGAL_PARAMS,
+		 "batch statement must be [type, {body}], where type "
+		 "is INSERT, REPLACE, UPDATE, DELETE or UPSERT");
+	return -1;
+}
+
+int
+xrow_decode_batch_stmt(const char **pos, struct xrow_header *row,
+		       struct request *request)
+{
+	const char *data = *pos;
+	uint32_t size = mp_decode_array(&data);
+	assert(size == 2);
+	(void) size;
+	memset(row, 0, sizeof(*row));
+	row->type = mp_decode_uint(&data);
+	assert(iproto_type_is_batch_stmt(row->type));
+	row->bodycnt = 1;
+	row->body[0].iov_base = (void *) data;
+	mp_next(&data);
+	row->body[0].iov_len = data - (const char *) row->body[0].iov_base;
+	*pos = data;
+	return xrow_decode_dml(row, request, dml_request_key_map(row->type));
+}
+
+int
+xrow_decode_compress(const struct xrow_header *row, uint32_t *compression)
+{
+	if (row->bodycnt == 0) {
+		diag_set(ClientError, ER_INVALID_MSGPACK,
+			 "missing request body");
+		return -1;
+	}
+
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	assert((end - data) > 0);
+
+	if (mp_typeof(*data) != MP_MAP || mp_check_map(data, end) > 0) {
+error:
+		diag_set(ClientError, ER_INVALID_MSGPACK, "packet body");
+		return -1;
+	}
+
+	*compression = IPROTO_COMPRESSION_NONE;
+	bool has_compression = false;
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if ((end - data) < 1 || mp_typeof(*data) != MP_UINT)
+			goto error;
+
+		uint64_t key = mp_decode_uint(&data);
+		const char *value = data;
+		if (mp_check(&data, end) != 0)
+			goto error;
+		if (key != IPROTO_COMPRESSION)
+			continue; /* unknown key */
+		if (mp_typeof(*value) != MP_UINT)
+			goto error;
+		uint64_t algo = mp_decode_uint(&value);
+		if (algo >= iproto_compression_MAX) {
+			diag_set(ClientError, ER_ILLEGAL_PARAMS,
+				 "unknown compression algorithm");
+			return -1;
+		}
+		*compression = algo;
+		has_compression = true;
+	}
+	if (data != end) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "packet end");
+		return -1;
+	}
+	if (!has_compression) {
+		diag_set(ClientError, ER_MISSING_REQUEST_FIELD,
+			 iproto_key_name(IPROTO_COMPRESSION));
+		return -1;
+	}
+	return 0;
+}
+
 int
 xrow_decode_auth(const struct xrow_header *row, struct auth_request *request)
 {
@@ -1054,6 +1320,107 @@ xrow_encode_timestamp(struct xrow_header *row, uint32_t replica_id, double tm)
 	row->tm = tm;
 }
 
+size_t
+xrow_compress_bound(size_t size)
+{
+	/* Fixheader, IPROTO_COMPRESSION and MP_BIN header. */
+	return ZSTD_compressBound(size) + 16;
+}
+
+ssize_t
+xrow_compress_packet(struct ZSTD_CCtx_s *zctx, const char *packet,
+		     size_t size, char *out, int level)
+{
+	/* Fixheader. */
+	const char *pos = packet;
+	const char *end = packet + size;
+	assert(mp_typeof(*pos) == MP_UINT);
+	mp_decode_uint(&pos);
+	/* Header. */
+	const char *header = pos;
+	assert(mp_typeof(*pos) == MP_MAP);
+	uint32_t header_size = mp_decode_map(&pos);
+	const char *header_keys = pos;
+	pos = header;
+	mp_next(&pos);
+	const char *header_end = pos;
+	/* Body. */
+	const char *body = pos;
+	size_t body_size = end - body;
+	if (body_size == 0)
+		return 0;
+
+	/*
+	 * Fixheader and MP_BIN header are encoded with 32-bit
+	 * length to know the layout before compression.
+	 */
+	char *data = out + 5;
+	data = mp_encode_map(data, header_size + 1);
+	memcpy(data, header_keys, header_end - header_keys);
+	data += header_end - header_keys;
+	data = mp_encode_uint(data, IPROTO_COMPRESSION);
+	data = mp_encode_uint(data, IPROTO_COMPRESSION_ZSTD);
+	char *bin = data;
+	data += 5;
+	size_t zsize = ZSTD_compressCCtx(zctx, data, ZSTD_compressBound(body_size),
+					 body, body_size, level);
+	if (ZSTD_isError(zsize)) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 ZSTD_getErrorName(zsize));
+		return -1;
+	}
+	data += zsize;
+	if ((size_t)(data - out) >= size)
+		return 0;
+	*bin = 0xc6;
+	mp_store_u32(bin + 1, zsize);
+	*out = 0xce;
+	mp_store_u32(out + 1, data - out - 5);
+	return data - out;
+}
+
+ssize_t
+xrow_decompressed_size(const char *body, const char *end)
+{
+	const char *pos = body;
+	if (mp_typeof(*pos) != MP_BIN || mp_check(&pos, end) != 0) {
+error:
+		diag_set(ClientError, ER_INVALID_MSGPACK, "compressed body");
+		return -1;
+	}
+	pos = body;
+	uint32_t len = mp_decode_binl(&pos);
+	unsigned long long size = ZSTD_getFrameContentSize(pos, len);
+	if (size == ZSTD_CONTENTSIZE_UNKNOWN ||
+	    size == ZSTD_CONTENTSIZE_ERROR || size == 0 ||
+	    size > IPROTO_BODY_LEN_MAX)
+		goto error;
+	return size;
+}
+
+int
+xrow_decompress_body(struct ZSTD_DCtx_s *zctx, const char *body,
+		     const char *end, char *out, size_t out_size)
+{
+	(void) end;
+	const char *pos = body;
+	uint32_t len = mp_decode_binl(&pos);
+	assert(pos + len == end);
+	size_t size = ZSTD_decompressDCtx(zctx, out, out_size, pos, len);
+	if (ZSTD_isError(size)) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 ZSTD_getErrorName(size));
+		return -1;
+	}
+	pos = out;
+	if (size != out_size || mp_typeof(*out) != MP_MAP ||
+	    mp_check(&pos, out + size) != 0 || pos != out + size) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "compressed body");
+		return -1;
+	}
+	return 0;
+}
+
 void
 greeting_encode(char *greetingbuf, uint32_t version_id,
 		const struct tt_uuid *uuid, const char *salt, uint32_t salt_len)
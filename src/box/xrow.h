@@ -42,6 +42,8 @@ extern "C" {
 #endif
 
 struct vclock;
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
 
 enum {
 	XROW_HEADER_IOVMAX = 1,
@@ -76,6 +78,11 @@ struct xrow_header {
 
 	int bodycnt;
 	uint32_t schema_version;
+	/**
+	 * Compression of the body, enum iproto_compression.
+	 * Only set in iproto requests.
+	 */
+	uint32_t compression;
 	struct iovec body[XROW_BODY_IOVMAX];
 };
 
@@ -197,6 +204,94 @@ struct call_request {
 int
 xrow_decode_call(const struct xrow_header *row, struct call_request *request);
 
+/**
+ * CURSOR_OPEN/CURSOR_FETCH/CURSOR_CLOSE request.
+ */
+struct cursor_request {
+	/** Request header */
+	const struct xrow_header *header;
+	/** Cursor id for FETCH and CLOSE requests. */
+	uint64_t cursor_id;
+	/** Space, index and search key for OPEN request. */
+	uint32_t space_id;
+	uint32_t index_id;
+	uint32_t iterator;
+	uint32_t offset;
+	const char *key;
+	const char *key_end;
+	/**
+	 * Max number of tuples to return by FETCH request.
+	 * Mandatory, the server caps it at a batch size of
+	 * its own.
+	 */
+	uint32_t limit;
+};
+
+/**
+ * Decode CURSOR_OPEN/CURSOR_FETCH/CURSOR_CLOSE request from
+ * MessagePack.
+ * @param row request header.
+ * @param[out] request Request to decode.
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_cursor(const struct xrow_header *row,
+		   struct cursor_request *request);
+
+/**
+ * BATCH request: several DML requests executed in a single
+ * transaction. The body is {IPROTO_REQUESTS: [[type, body], ...]},
+ * where type is INSERT, REPLACE, UPDATE, DELETE or UPSERT and
+ * body is the map the corresponding standalone request would
+ * have.
+ */
+struct batch_request {
+	/** Request header */
+	const struct xrow_header *header;
+	/** Number of statements in the batch. */
+	uint32_t count;
+	/** MessagePack encoded statements, without array header. */
+	const char *requests;
+	const char *requests_end;
+};
+
+/**
+ * Decode BATCH request from MessagePack. Only the structure of
+ * the batch is checked, statement bodies are decoded one by one
+ * with xrow_decode_batch_stmt().
+ * @param row request header.
+ * @param[out] request Request to decode.
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_batch(const struct xrow_header *row,
+		  struct batch_request *request);
+
+/**
+ * Decode the next statement of a BATCH request.
+ * @param[in,out] pos Position in batch_request::requests.
+ * @param[out] row Header of the statement. Must outlive
+ *             @a request, since it is written to WAL as is.
+ * @param[out] request DML request.
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_batch_stmt(const char **pos, struct xrow_header *row,
+		       struct request *request);
+
+/**
+ * Decode COMPRESS request: {IPROTO_COMPRESSION: algorithm}.
+ * @param row request header.
+ * @param[out] compression enum iproto_compression.
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_compress(const struct xrow_header *row, uint32_t *compression);
+
 /**
  * AUTH request
  */
@@ -386,6 +481,16 @@ void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t schema_version, uint32_t count);
 
+/**
+ * Same as iproto_reply_select(), but the result set is followed
+ * by @a spliced_size bytes of tuple data which are not stored in
+ * @a buf and are inserted into the output stream by the caller.
+ */
+void
+iproto_reply_select_spliced(struct obuf *buf, struct obuf_svp *svp,
+			    uint64_t sync, uint32_t schema_version,
+			    uint32_t count, size_t spliced_size);
+
 /**
  * Write header of the key to a preallocated buffer by svp.
  * @param buf Buffer to write to.
@@ -452,6 +557,56 @@ void
 iproto_write_error(int fd, const struct error *e, uint32_t schema_version,
 		   uint64_t sync);
 
+/**
+ * Max size of an iproto packet of @a size bytes compressed
+ * with xrow_compress_packet().
+ */
+size_t
+xrow_compress_bound(size_t size);
+
+/**
+ * Compress the body of an encoded iproto packet with zstd.
+ * IPROTO_COMPRESSION is added to the packet header and the body
+ * is replaced with MP_BIN holding a zstd frame of the original
+ * body.
+ * @param zctx zstd compression context.
+ * @param packet Fixheader, header and body of the packet.
+ * @param size Size of the packet.
+ * @param[out] out Buffer of xrow_compress_bound(size) bytes.
+ * @param level zstd compression level.
+ * @retval > 0 size of the compressed packet.
+ * @retval   0 compression doesn't pay off, send the packet as is.
+ * @retval  -1 error, diag is set.
+ */
+ssize_t
+xrow_compress_packet(struct ZSTD_CCtx_s *zctx, const char *packet,
+		     size_t size, char *out, int level);
+
+/**
+ * Return the size of a body compressed by xrow_compress_packet().
+ * @param body MP_BIN holding the compressed body.
+ * @param end End of the packet.
+ * @retval >= 0 size of the decompressed body.
+ * @retval   -1 error, diag is set.
+ */
+ssize_t
+xrow_decompressed_size(const char *body, const char *end);
+
+/**
+ * Decompress a body compressed by xrow_compress_packet() and
+ * check that it is a valid MessagePack map.
+ * @param zctx zstd decompression context.
+ * @param body MP_BIN holding the compressed body.
+ * @param end End of the packet.
+ * @param[out] out Buffer of xrow_decompressed_size() bytes.
+ * @param out_size Size of @a out.
+ * @retval  0 on success
+ * @retval -1 error, diag is set.
+ */
+int
+xrow_decompress_body(struct ZSTD_DCtx_s *zctx, const char *body,
+		     const char *end, char *out, size_t out_size);
+
 enum {
 	/* Maximal length of protocol name in handshake */
 	GREETING_PROTOCOL_LEN_MAX = 32,
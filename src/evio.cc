@@ -41,7 +41,7 @@
 #include <trivia/util.h>
 
 static void
-evio_setsockopt_server(int fd, int family, int type);
+evio_setsockopt_server(int fd, int family, int type, bool reuseport);
 
 /** Note: this function does not throw. */
 void
@@ -122,7 +122,7 @@ evio_setsockopt_client(int fd, int family, int type)
 
 /** Set options for server sockets. */
 static void
-evio_setsockopt_server(int fd, int family, int type)
+evio_setsockopt_server(int fd, int family, int type, bool reuseport)
 {
 	int on = 1;
 	/* In case this throws, the socket is not leaked. */
@@ -130,6 +130,14 @@ evio_setsockopt_server(int fd, int family, int type)
 	/* Allow reuse local adresses. */
 	sio_setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
 		       &on, sizeof(on));
+	if (reuseport && family != AF_UNIX) {
+#ifdef SO_REUSEPORT
+		sio_setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+			       &on, sizeof(on));
+#else
+		say_warn("SO_REUSEPORT is not supported by the system");
+#endif
+	}
 
 	/* Send all buffered messages on socket before take
 	 * control out from close(2) or shutdown(2). */
@@ -158,11 +166,14 @@ evio_service_accept_cb(ev_loop * /* loop */, ev_io *watcher,
 {
 	struct evio_service *service = (struct evio_service *) watcher->data;
 
-	while (1) {
+	for (int i = 0; i < EVIO_ACCEPT_BATCH; i++) {
 		/*
-		 * Accept all pending connections from backlog during event
-		 * loop iteration. Significally speed up acceptor with enabled
-		 * io_collect_interval.
+		 * Accept pending connections from backlog in batches
+		 * during event loop iteration. Significally speed up
+		 * acceptor with enabled io_collect_interval. The rest
+		 * of the backlog, if any, is accepted on the next
+		 * iteration, so that a connection storm doesn't
+		 * starve established connections.
 		 */
 		int fd = -1;
 		try {
@@ -236,7 +247,8 @@ evio_service_bind_addr(struct evio_service *service)
 
 	auto fd_guard = make_scoped_guard([=]{ close(fd); });
 
-	evio_setsockopt_server(fd, service->addr.sa_family, SOCK_STREAM);
+	evio_setsockopt_server(fd, service->addr.sa_family, SOCK_STREAM,
+			       service->reuseport);
 
 	if (sio_bind(fd, &service->addr, service->addr_len)) {
 		assert(errno == EADDRINUSE);
@@ -356,6 +368,37 @@ evio_service_bind(struct evio_service *service, const char *uri)
 		  evio_service_name(service));
 }
 
+void
+evio_service_attach(struct evio_service *dst,
+		    const struct evio_service *src)
+{
+	assert(! ev_is_active(&dst->ev));
+	assert(src->ev.fd >= 0);
+
+	snprintf(dst->host, sizeof(dst->host), "%s", src->host);
+	snprintf(dst->serv, sizeof(dst->serv), "%s", src->serv);
+	memcpy(&dst->addrstorage, &src->addrstorage, src->addr_len);
+	dst->addr_len = src->addr_len;
+	dst->reuseport = src->reuseport;
+	dst->is_attached = true;
+
+	if (dst->reuseport && dst->addr.sa_family != AF_UNIX) {
+		/*
+		 * Bind to the address actually bound by @a src,
+		 * which matters if the port is ephemeral.
+		 */
+		dst->addr_len = sizeof(dst->addrstorage);
+		if (getsockname(src->ev.fd, &dst->addr, &dst->addr_len) != 0)
+			tnt_raise(SocketError, src->ev.fd, "getsockname");
+		return evio_service_bind_addr(dst);
+	}
+
+	int fd = dup(src->ev.fd);
+	if (fd < 0)
+		tnt_raise(SocketError, src->ev.fd, "dup");
+	ev_io_set(&dst->ev, fd, EV_READ);
+}
+
 /** It's safe to stop a service which is not started yet. */
 void
 evio_service_stop(struct evio_service *service)
@@ -369,7 +412,8 @@ evio_service_stop(struct evio_service *service)
 	if (service->ev.fd >= 0) {
 		close(service->ev.fd);
 		ev_io_set(&service->ev, -1, 0);
-		if (service->addr.sa_family == AF_UNIX) {
+		if (service->addr.sa_family == AF_UNIX &&
+		    !service->is_attached) {
 			unlink(((struct sockaddr_un *) &service->addr)->sun_path);
 		}
 	}
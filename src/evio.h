@@ -38,6 +38,15 @@
 #include "tarantool_ev.h"
 #include "sio.h"
 #include "uri.h"
+
+enum {
+	/**
+	 * Max number of connections accepted in one event loop
+	 * iteration, to not stall the loop on a connection storm.
+	 */
+	EVIO_ACCEPT_BATCH = 64,
+};
+
 /**
  * Exception-aware way to add a listening socket to the event
  * loop. Callbacks are invoked on bind and accept events.
@@ -76,6 +85,21 @@ struct evio_service
 		struct sockaddr_storage addrstorage;
 	};
 	socklen_t addr_len;
+	/**
+	 * Set SO_REUSEPORT on the acceptor socket: a socket of
+	 * each service bound to the same address gets its share
+	 * of incoming connections from the kernel. Must be set
+	 * before the service is bound. Has no effect for UNIX
+	 * sockets.
+	 */
+	bool reuseport;
+	/**
+	 * Set if the service was attached to the address of
+	 * another service with evio_service_attach(). Only the
+	 * service which bound a UNIX socket unlinks its path
+	 * when stopped.
+	 */
+	bool is_attached;
 
 	/**
 	 * A callback invoked on every accepted client socket.
@@ -104,6 +128,18 @@ evio_service_init(ev_loop *loop,
 void
 evio_service_bind(struct evio_service *service, const char *uri);
 
+/**
+ * Make @a dst service accept connections on the address already
+ * bound by @a src service. If @a src is bound with SO_REUSEPORT,
+ * @a dst binds its own socket to the same address, and the
+ * kernel balances connections between the two. Otherwise the
+ * socket is duplicated. Either way each service may be stopped
+ * independently.
+ */
+void
+evio_service_attach(struct evio_service *dst,
+		    const struct evio_service *src);
+
 /**
  * Listen on bounded socket
  *
@@ -108,6 +108,23 @@ fio_pread(int fd, void *buf, size_t count, off_t offset);
 int
 fio_writen(int fd, const void *buf, size_t count);
 
+/**
+ * Write the given buffer at the given offset, re-trying
+ * for partial writes. Doesn't change the file offset.
+ * In case of a non-transient error, writes a message to
+ * the error log.
+ *
+ * @param fd		file descriptor.
+ * @param buf		pointer to a buffer.
+ * @param count		buffer size.
+ * @param offset	file offset.
+ *
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+fio_pwriten(int fd, const void *buf, size_t count, off_t offset);
+
 /**
  * A simple wrapper around writev().
  * Re-tries write in case of EINTR.
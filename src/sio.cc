@@ -107,6 +107,9 @@ sio_option_name(int option)
 	CASE_OPTION(SO_LINGER);
 	CASE_OPTION(SO_ERROR);
 	CASE_OPTION(SO_REUSEADDR);
+#ifdef SO_REUSEPORT
+	CASE_OPTION(SO_REUSEPORT);
+#endif
 	CASE_OPTION(TCP_NODELAY);
 #ifdef __linux__
 	CASE_OPTION(TCP_KEEPCNT);
@@ -177,7 +180,10 @@ int
 sio_setfl(int fd, int flag, int on)
 {
 	int flags = sio_getfl(fd);
-	flags = fcntl(fd, F_SETFL, on ? flags | flag : flags & ~flag);
+	int new_flags = on ? flags | flag : flags & ~flag;
+	if (new_flags == flags)
+		return flags;
+	flags = fcntl(fd, F_SETFL, new_flags);
 	if (flags < 0)
 		tnt_raise(SocketError, fd, "fcntl(..., F_SETFL, ...)");
 	return flags;
@@ -245,7 +251,12 @@ int
 sio_accept(int fd, struct sockaddr *addr, socklen_t *addrlen)
 {
 	/* Accept a connection. */
+#ifdef HAVE_ACCEPT4
+	/* Save a syscall on setting O_NONBLOCK, see sio_setfl(). */
+	int newfd = accept4(fd, addr, addrlen, SOCK_NONBLOCK);
+#else
 	int newfd = accept(fd, addr, addrlen);
+#endif
 	if (newfd < 0 &&
 	    (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
 		tnt_raise(SocketError, fd, "accept");
@@ -97,6 +97,10 @@
  * Defined if this platform has GNU specific memmem().
  */
 #cmakedefine HAVE_MEMMEM 1
+/*
+ * Defined if this platform has Linux specific accept4().
+ */
+#cmakedefine HAVE_ACCEPT4 1
 /*
  * Defined if this platform has GNU specific memrchr().
  */
@@ -166,9 +170,12 @@
 #cmakedefine HAVE_PTHREAD_YIELD 1
 #cmakedefine HAVE_SCHED_YIELD 1
 #cmakedefine HAVE_POSIX_FADVISE 1
+#cmakedefine HAVE_POSIX_FALLOCATE 1
 #cmakedefine HAVE_MREMAP 1
 
 #cmakedefine HAVE_PRCTL_H 1
+/** io_uring(7) - Linux */
+#cmakedefine HAVE_LINUX_IO_URING_H 1
 
 #cmakedefine HAVE_UUIDGEN 1
 #cmakedefine HAVE_CLOCK_GETTIME 1
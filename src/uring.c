@@ -0,0 +1,315 @@
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "uring.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "trivia/config.h"
+#include "trivia/util.h"
+#include "diag.h"
+#include "say.h"
+
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup) && \
+    defined(IORING_FEAT_FAST_POLL)
+
+static inline int
+sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+	return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline int
+sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+		   unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, NULL, 0);
+}
+
+static void *
+uring_mmap(int fd, size_t size, off_t offset)
+{
+	void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, fd, offset);
+	if (ptr == MAP_FAILED) {
+		diag_set(SystemError, "failed to map io_uring");
+		return NULL;
+	}
+	return ptr;
+}
+
+int
+uring_create(struct uring *ring, unsigned entries)
+{
+	memset(ring, 0, sizeof(*ring));
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ring->fd = sys_io_uring_setup(entries, &params);
+	if (ring->fd < 0) {
+		diag_set(SystemError, "io_uring_setup");
+		return -1;
+	}
+	/*
+	 * The operations never block as they are issued with
+	 * MSG_DONTWAIT, see uring_prep_msg(). Fast poll is only
+	 * checked as a mark of a kernel recent enough to run
+	 * socket operations inline rather than in a worker
+	 * thread, which would make batching them pointless.
+	 */
+	if ((params.features & IORING_FEAT_FAST_POLL) == 0) {
+		errno = ENOTSUP;
+		diag_set(SystemError, "io_uring does not support fast poll");
+		goto error;
+	}
+	ring->sq_ring_size = params.sq_off.array +
+			     params.sq_entries * sizeof(unsigned);
+	ring->sq_ring = uring_mmap(ring->fd, ring->sq_ring_size,
+				   IORING_OFF_SQ_RING);
+	if (ring->sq_ring == NULL)
+		goto error;
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = uring_mmap(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+	if (ring->sqes == NULL)
+		goto error;
+	ring->cq_ring_size = params.cq_off.cqes +
+			     params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->cq_ring = uring_mmap(ring->fd, ring->cq_ring_size,
+				   IORING_OFF_CQ_RING);
+	if (ring->cq_ring == NULL)
+		goto error;
+
+	char *sq = (char *) ring->sq_ring;
+	ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+	ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+	ring->sq_entries = (unsigned *) (sq + params.sq_off.ring_entries);
+	ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+	ring->sqe_tail = *ring->sq_tail;
+
+	char *cq = (char *) ring->cq_ring;
+	ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+	ring->cqes = cq + params.cq_off.cqes;
+	return 0;
+error:
+	uring_destroy(ring);
+	return -1;
+}
+
+void
+uring_destroy(struct uring *ring)
+{
+	if (ring->cq_ring != NULL)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sqes != NULL)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->sq_ring != NULL)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+}
+
+/** Get a free submission queue entry, NULL if the queue is full. */
+static struct io_uring_sqe *
+uring_get_sqe(struct uring *ring)
+{
+	unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	if (ring->sqe_tail - head >= *ring->sq_entries)
+		return NULL;
+	struct io_uring_sqe *sqe = (struct io_uring_sqe *) ring->sqes;
+	sqe += ring->sqe_tail & *ring->sq_mask;
+	ring->sqe_tail++;
+	memset(sqe, 0, sizeof(*sqe));
+	return sqe;
+}
+
+static int
+uring_prep_msg(struct uring *ring, int op, int fd,
+	       const struct msghdr *msg, uint64_t data)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(ring);
+	if (sqe == NULL)
+		return -1;
+	sqe->opcode = op;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t) msg;
+	sqe->len = 1;
+	sqe->msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+	sqe->user_data = data;
+	return 0;
+}
+
+int
+uring_prep_recvmsg(struct uring *ring, int fd, struct msghdr *msg,
+		   uint64_t data)
+{
+	return uring_prep_msg(ring, IORING_OP_RECVMSG, fd, msg, data);
+}
+
+int
+uring_prep_sendmsg(struct uring *ring, int fd, const struct msghdr *msg,
+		   uint64_t data)
+{
+	return uring_prep_msg(ring, IORING_OP_SENDMSG, fd, msg, data);
+}
+
+int
+uring_submit(struct uring *ring)
+{
+	unsigned tail = *ring->sq_tail;
+	unsigned to_submit = ring->sqe_tail - tail;
+	if (to_submit == 0)
+		return 0;
+	unsigned mask = *ring->sq_mask;
+	for (; tail != ring->sqe_tail; tail++)
+		ring->sq_array[tail & mask] = tail & mask;
+	__atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+	int rc = 0;
+	unsigned submitted = 0;
+	while (submitted < to_submit) {
+		int n = sys_io_uring_enter(ring->fd, to_submit - submitted,
+					   0, 0);
+		if (n >= 0) {
+			submitted += n;
+			continue;
+		}
+		if (errno == EINTR)
+			continue;
+		/*
+		 * Out of resources (EAGAIN) or anything else:
+		 * drop the entries the kernel hasn't consumed.
+		 * It only reads them in io_uring_enter(), so
+		 * they can be taken back.
+		 */
+		diag_set(SystemError, "io_uring_enter");
+		tail = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+		__atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+		ring->sqe_tail = tail;
+		rc = -1;
+		break;
+	}
+	/*
+	 * The completion queue is empty by now, see uring_next(),
+	 * and the operations don't block, so waiting for all of
+	 * them to complete doesn't take long.
+	 */
+	while (submitted > 0 &&
+	       __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) -
+	       *ring->cq_head < submitted) {
+		if (sys_io_uring_enter(ring->fd, 0, submitted,
+				       IORING_ENTER_GETEVENTS) < 0 &&
+		    errno != EINTR) {
+			/* The buffers can't be released in flight. */
+			panic_syserror("io_uring_enter");
+		}
+	}
+	return rc;
+}
+
+bool
+uring_next(struct uring *ring, uint64_t *data, int *res)
+{
+	unsigned head = *ring->cq_head;
+	if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+		return false;
+	struct io_uring_cqe *cqe = (struct io_uring_cqe *) ring->cqes;
+	cqe += head & *ring->cq_mask;
+	*data = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+#else /* !io_uring */
+
+int
+uring_create(struct uring *ring, unsigned entries)
+{
+	(void) entries;
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+	errno = ENOSYS;
+	diag_set(SystemError, "io_uring is not supported");
+	return -1;
+}
+
+void
+uring_destroy(struct uring *ring)
+{
+	(void) ring;
+}
+
+int
+uring_prep_recvmsg(struct uring *ring, int fd, struct msghdr *msg,
+		   uint64_t data)
+{
+	(void) ring; (void) fd; (void) msg; (void) data;
+	unreachable();
+	return -1;
+}
+
+int
+uring_prep_sendmsg(struct uring *ring, int fd, const struct msghdr *msg,
+		   uint64_t data)
+{
+	(void) ring; (void) fd; (void) msg; (void) data;
+	unreachable();
+	return -1;
+}
+
+int
+uring_submit(struct uring *ring)
+{
+	(void) ring;
+	return 0;
+}
+
+bool
+uring_next(struct uring *ring, uint64_t *data, int *res)
+{
+	(void) ring; (void) data; (void) res;
+	return false;
+}
+
+#endif /* !io_uring */
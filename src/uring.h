@@ -0,0 +1,152 @@
+#ifndef TARANTOOL_URING_H_INCLUDED
+#define TARANTOOL_URING_H_INCLUDED
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct msghdr;
+
+/**
+ * A minimal io_uring(7) submission/completion ring, talking
+ * to the kernel with raw system calls.
+ *
+ * The ring is used to batch socket system calls: operations
+ * are prepared one by one and then submitted with a single
+ * io_uring_enter(2). Only non-blocking operations are
+ * supported (recvmsg() and sendmsg() with MSG_DONTWAIT), so
+ * uring_submit() returns when all of them have completed,
+ * and no operation ever outlives the batch it was submitted
+ * in.
+ *
+ * The ring is not thread-safe.
+ */
+struct uring {
+	/** File descriptor of the ring, -1 if not created. */
+	int fd;
+	/** Submission queue ring mapping. */
+	void *sq_ring;
+	size_t sq_ring_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_entries;
+	unsigned *sq_array;
+	/** Submission queue entries mapping. */
+	void *sqes;
+	size_t sqes_size;
+	/** Tail of prepared, but not yet submitted, entries. */
+	unsigned sqe_tail;
+	/** Completion queue ring mapping. */
+	void *cq_ring;
+	size_t cq_ring_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	void *cqes;
+};
+
+/**
+ * Create a ring with at least @a entries submission queue
+ * entries. Fails if io_uring is not supported by the system
+ * or lacks features needed for socket I/O.
+ *
+ * @retval  0 success
+ * @retval -1 error, the diagnostics area is set
+ */
+int
+uring_create(struct uring *ring, unsigned entries);
+
+/** Destroy a ring. */
+void
+uring_destroy(struct uring *ring);
+
+/**
+ * Prepare a recvmsg(2) of @a msg from socket @a fd.
+ * @a data is passed back along with the result.
+ *
+ * @retval  0 success
+ * @retval -1 the submission queue is full
+ */
+int
+uring_prep_recvmsg(struct uring *ring, int fd, struct msghdr *msg,
+		   uint64_t data);
+
+/**
+ * Prepare a sendmsg(2) of @a msg to socket @a fd.
+ * @a data is passed back along with the result.
+ *
+ * @retval  0 success
+ * @retval -1 the submission queue is full
+ */
+int
+uring_prep_sendmsg(struct uring *ring, int fd, const struct msghdr *msg,
+		   uint64_t data);
+
+/**
+ * Submit all prepared operations and wait for them to
+ * complete. The buffers referenced by the operations must
+ * stay valid until then. Results of the previous batch
+ * must be popped with uring_next() before.
+ *
+ * On failure, e.g. if the kernel is out of resources, the
+ * operations which weren't submitted are dropped and never
+ * complete, while the submitted ones are waited for as usual.
+ *
+ * @retval  0 success
+ * @retval -1 error, the diagnostics area is set
+ */
+int
+uring_submit(struct uring *ring);
+
+/**
+ * Pop the next completed operation.
+ *
+ * @param[out] data  data of the operation
+ * @param[out] res   result of the operation, -errno on error
+ *
+ * @retval true   an operation was popped
+ * @retval false  no completed operations
+ */
+bool
+uring_next(struct uring *ring, uint64_t *data, int *res);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_URING_H_INCLUDED */
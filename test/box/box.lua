@@ -1,6 +1,12 @@
 #!/usr/bin/env tarantool
 os = require('os')
 
+-- Functional indexes call test modules on recovery.
+local build_path = os.getenv("BUILDDIR")
+if build_path ~= nil then
+    package.cpath = build_path..'/test/box/?.so;'..build_path..'/test/box/?.dylib;'..package.cpath
+end
+
 box.cfg{
     listen              = os.getenv("LISTEN"),
     memtx_memory        = 107374182,
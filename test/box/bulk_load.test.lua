@@ -0,0 +1,106 @@
+--
+-- space:bulk_load() inserts a batch of tuples in one transaction.
+-- Memtx builds the indexes of an empty space at the end of the
+-- load if all its secondary keys are non-unique trees.
+--
+s = box.schema.space.create('test')
+pk = s:create_index('pk')
+sk = s:create_index('sk', {unique = false, parts = {2, 'unsigned'}})
+uk = s:create_index('uk', {parts = {3, 'string'}})
+hk = s:create_index('hk', {type = 'hash', parts = {3, 'string'}})
+
+tuples = {}
+for i = 1, 1000 do table.insert(tuples, {i, i % 10, 'k' .. i}) end
+s:bulk_load(tuples)
+s:count()
+sk:count(5)
+pk:min()
+pk:max()
+sk:select(3, {limit = 3})
+uk:get('k500')
+hk:get('k500')
+s:bsize() > 0
+
+-- Loading into a non-empty space is done row by row.
+s:bulk_load({{1001, 1, 'k1001'}, {0, 1, 'k0'}})
+s:count()
+sk:select(1, {limit = 3})
+
+-- Tuples may come from another space.
+s2 = box.schema.space.create('test2')
+_ = s2:create_index('pk')
+_ = s2:create_index('sk', {unique = false, parts = {2, 'unsigned'}})
+s2:bulk_load(s:pairs())
+s2:count()
+s2.index.sk:count(5)
+s2:drop()
+s:truncate()
+
+-- Out of order tuples fall back on regular inserts.
+s:bulk_load({{3, 1, 'c'}, {1, 2, 'a'}, {2, 1, 'b'}})
+s:select()
+sk:select(1)
+uk:select()
+s:truncate()
+
+-- Any error rolls the whole load back.
+s:bulk_load({{1, 1, 'a'}, {2, 1, 'b'}, {2, 1, 'c'}})
+s:count()
+s:bulk_load({{1, 1, 'a'}, {2, 1, 'a'}})
+s:count()
+sk:count()
+s:bulk_load({{1, 1, 'a'}, {2, 'x', 'b'}})
+s:count()
+function fail(old, new) if new[1] == 3 then error('fail', 0) end end
+_ = s:on_replace(fail)
+s:bulk_load({{1, 1, 'a'}, {2, 1, 'b'}, {3, 1, 'c'}})
+s:on_replace(nil, fail)
+s:count()
+sk:count()
+uk:count()
+
+-- The space is usable after a failed load.
+s:bulk_load({{1, 1, 'a'}, {2, 1, 'b'}, {3, 1, 'c'}})
+s:insert{4, 1, 'd'}
+sk:select(1)
+s:truncate()
+
+-- A load is a transaction of its own.
+box.begin() ok, err = pcall(s.bulk_load, s, {{1, 1, 'a'}}) box.rollback()
+ok, tostring(err)
+s:count()
+s:bulk_load({})
+s:count()
+
+s:drop()
+
+-- Reads during a load see the tuples loaded so far.
+fun = require('fun')
+s = box.schema.space.create('test')
+pk = s:create_index('pk')
+sk = s:create_index('sk', {unique = false, parts = {2, 'unsigned'}})
+function read() return {s:count(), pk:max(), s:get{3}, sk:select(1), s:update(2, {{'=', 2, 7}})} end
+s:bulk_load(fun.range(10):map(function(i) if i == 6 then seen = read() end return {i, i % 2} end))
+seen
+s:count()
+sk:count(1)
+sk:select(7)
+s:truncate()
+s:bulk_load(fun.range(10):map(function(i) if i == 4 then seen = sk:count(0) end return {i, i % 2} end))
+seen
+sk:count(0)
+s:truncate()
+
+-- A failed load is rolled back.
+ok, err = pcall(s.bulk_load, s, fun.range(10):map(function(i) if i == 8 then error('stop', 0) end return {i, i % 2} end))
+ok, err
+s:count()
+sk:count()
+ok, err = pcall(s.bulk_load, s, fun.range(10):map(function(i) if i == 8 then seen = s:count() error('stop', 0) end return {i, i % 2} end))
+ok, err, seen
+s:count()
+sk:count()
+pk:select()
+_ = s:insert{1, 1}
+sk:select()
+s:drop()
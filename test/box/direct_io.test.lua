@@ -0,0 +1,44 @@
+test_run = require('test_run').new()
+
+--
+-- WAL and snapshot files written with O_DIRECT.
+--
+test_run:cmd('create server direct_io with script = "box/lua/direct_io.lua"')
+test_run:cmd("start server direct_io")
+test_run:cmd('switch direct_io')
+box.cfg.wal_direct_io
+box.cfg.snap_direct_io
+fio = require('fio')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 25 do s:insert{i, string.rep('x', i * 100)} end
+-- Closed WALs have no padding after the EOF marker.
+xlogs = fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog'))
+f = fio.open(xlogs[#xlogs - 1])
+size = f:stat().size
+f:pread(4, size - 4) == '\xd5\x10\xad\xed'
+-- Every write starts at a new block, so does the EOF marker.
+(size - 4) % 4096
+f:close()
+box.snapshot()
+box.cfg{snap_direct_io = false}
+for i = 26, 50 do s:insert{i, string.rep('x', i * 100)} end
+box.snapshot()
+-- The data is recovered.
+test_run:cmd('restart server direct_io')
+box.space.test:count()
+box.space.test:get(50)[2]:len()
+-- A tx block may end less than a magic short of a block
+-- boundary. Rows of every length around the block size make
+-- sure some do, and the file is still read up to the end.
+digest = require('digest')
+s = box.space.test
+for i = 1, 200 do s:replace{i, digest.urandom(3900 + i)} end
+test_run:cmd('restart server direct_io')
+box.space.test:count()
+box.space.test:get(200)[2]:len()
+box.space.test:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server direct_io")
+test_run:cmd("cleanup server direct_io")
+box.cfg{wal_direct_io = true}
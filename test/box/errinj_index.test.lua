@@ -123,4 +123,27 @@ for i = 5001,5010 do table.insert(res, (s:get{i})) end
 res
 s:drop()
 
+--
+-- A bulk load fails like row by row inserts if the indexes
+-- can't be built with a tuple or on a read, and its rollback
+-- leaves the space empty.
+--
+fun = require('fun')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+sk = s:create_index('sk', {unique = false, parts = {2, 'unsigned'}})
+mk = s:create_index('mk', {unique = false, parts = {{3, 'unsigned', path = '[*]'}}})
+function tuple(i) return {i, i % 10, {i, i + 1}} end
+ok, err = pcall(s.bulk_load, s, fun.range(1000):map(function(i) if i == 500 then errinj.set("ERRINJ_INDEX_ALLOC", true) end return tuple(i) end))
+ok, tostring(err)
+errinj.set("ERRINJ_INDEX_ALLOC", false)
+s:count(), sk:count(), mk:count(), s:select()
+ok, err = pcall(s.bulk_load, s, fun.range(1000):map(function(i) if i == 500 then errinj.set("ERRINJ_INDEX_ALLOC", true) s:count() end return tuple(i) end))
+ok, tostring(err)
+errinj.set("ERRINJ_INDEX_ALLOC", false)
+s:count(), sk:count(), mk:count(), s:select()
+s:bulk_load(fun.range(1000):map(tuple))
+s:count(), sk:count(5), mk:count(500)
+s:drop()
+
 errinj = nil
@@ -0,0 +1,87 @@
+build_path = os.getenv("BUILDDIR")
+package.cpath = build_path..'/test/box/?.so;'..build_path..'/test/box/?.dylib;'..package.cpath
+
+env = require('test_run')
+test_run = env.new()
+
+--
+-- Functional indexes: keys are computed by a stored C function.
+--
+box.schema.func.create('function1.sum_key', {language = "C"})
+box.schema.func.create('lua_key')
+s = box.schema.space.create('test')
+pk = s:create_index('pk')
+
+-- Unsupported configurations.
+s:create_index('idx', {func = 'no_such_function', parts = {{1, 'unsigned'}}})
+s:create_index('idx', {func = 'lua_key', parts = {{1, 'unsigned'}}})
+s:create_index('idx', {type = 'hash', func = 'function1.sum_key', parts = {{1, 'unsigned'}}})
+s:create_index('idx', {func = 'function1.sum_key', parts = {{1, 'unsigned', is_multikey = true}}})
+s2 = box.schema.space.create('test2')
+s2:create_index('pk', {func = 'function1.sum_key', parts = {{1, 'unsigned'}}})
+s2:drop()
+box.schema.func.drop('lua_key')
+
+s:insert{1, 10, 5}
+s:insert{2, 3, 3}
+s:insert{3, 7, 7}
+idx = s:create_index('idx', {unique = false, func = 'function1.sum_key', parts = {{1, 'unsigned'}}})
+idx.func_id == box.space._func.index.name:get{'function1.sum_key'}[1]
+idx:select()
+idx:select(14)
+idx:select(14, {iterator = 'LT'})
+idx:select(6, {iterator = 'GT'})
+idx:count()
+
+-- Updates move the tuple in the functional index.
+s:replace{2, 20, 0}
+idx:select()
+s:update(3, {{'=', 3, 100}})
+idx:select()
+s:delete(1)
+idx:select()
+
+-- Function errors abort the statement.
+s:insert{4, 'abc', 1}
+s:select{}
+idx:select()
+
+-- A rollback puts a tuple back without calling the function.
+box.schema.func.create('function1.sum_key_break', {language = "C"})
+box.schema.user.grant('guest', 'execute', 'function', 'function1.sum_key_break')
+c = require('net.box').connect(box.cfg.listen)
+_ = c:call('function1.sum_key_break', {true})
+s:insert{4, 1, 1}
+box.begin() s:delete{2} s:delete{3} box.rollback()
+idx:select()
+s:delete{3}
+idx:select()
+_ = c:call('function1.sum_key_break', {false})
+s:insert{3, 7, 100}
+idx:select()
+c:close()
+box.schema.func.drop('function1.sum_key_break')
+
+-- Unique functional index.
+uidx = s:create_index('uidx', {func = 'function1.sum_key', parts = {{1, 'unsigned'}}})
+s:insert{5, 10, 10}
+s:insert{6, 5, 5}
+uidx:select()
+uidx:get{20}
+
+-- Functional indexes are rebuilt on recovery.
+test_run:cmd('restart server default')
+s = box.space.test
+s.index.idx:select()
+s.index.uidx:select()
+s:insert{7, 1, 1}
+s.index.uidx:get{2}
+
+-- A function used by an index can not be altered.
+fid = box.space._func.index.name:get{'function1.sum_key'}[1]
+box.space._func:update(fid, {{'=', 4, 1}})
+
+-- A function used by an index can not be dropped.
+box.schema.func.drop('function1.sum_key')
+s:drop()
+box.schema.func.drop('function1.sum_key')
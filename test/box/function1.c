@@ -177,3 +177,62 @@ test_yield(box_function_ctx_t *ctx, const char *args, const char *args_end)
 	printf("ok - yield\n");
 	return 0;
 }
+
+/* Set by sum_key_break() to make sum_key() fail. */
+static bool sum_key_is_broken = false;
+
+/*
+ * Make sum_key() fail if the argument is true, to check that
+ * a rollback doesn't call it.
+ */
+int
+sum_key_break(box_function_ctx_t *ctx, const char *args, const char *args_end)
+{
+	(void) ctx;
+	(void) args_end;
+	uint32_t arg_count = mp_decode_array(&args);
+	sum_key_is_broken = arg_count > 0 && mp_typeof(*args) == MP_BOOL &&
+			    mp_decode_bool(&args);
+	return 0;
+}
+
+/*
+ * Functional index key: the sum of the second and the third
+ * tuple fields.
+ */
+int
+sum_key(box_function_ctx_t *ctx, const char *args, const char *args_end)
+{
+	if (sum_key_is_broken) {
+		return box_error_set(__FILE__, __LINE__, ER_PROC_C, "%s",
+			"sum_key is broken");
+	}
+	uint32_t arg_count = mp_decode_array(&args);
+	if (arg_count < 3) {
+		return box_error_set(__FILE__, __LINE__, ER_PROC_C, "%s",
+			"invalid argument count");
+	}
+	mp_next(&args);
+	if (mp_typeof(*args) != MP_UINT) {
+		return box_error_set(__FILE__, __LINE__, ER_PROC_C, "%s",
+			"second tuple field must be uint");
+	}
+	uint64_t a = mp_decode_uint(&args);
+	if (mp_typeof(*args) != MP_UINT) {
+		return box_error_set(__FILE__, __LINE__, ER_PROC_C, "%s",
+			"third tuple field must be uint");
+	}
+	uint64_t b = mp_decode_uint(&args);
+
+	char tuple_buf[16];
+	char *d = tuple_buf;
+	d = mp_encode_array(d, 1);
+	d = mp_encode_uint(d, a + b);
+	assert(d <= tuple_buf + sizeof(tuple_buf));
+
+	box_tuple_format_t *fmt = box_tuple_format_default();
+	box_tuple_t *tuple = box_tuple_new(fmt, tuple_buf, d);
+	if (tuple == NULL)
+		return -1;
+	return box_return_tuple(ctx, tuple);
+}
@@ -0,0 +1,25 @@
+net_box = require('net.box')
+
+--
+-- A batch executes several DML requests in one transaction.
+--
+box.schema.user.grant('guest', 'read,write', 'universe')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+c = net_box.connect(box.cfg.listen)
+c:batch({{'insert', 'test', {1, 1}}, {'insert', s.id, {2, 2}}, {'replace', 'test', {3, 3}}})
+c:batch({{'update', 'test', {1}, {{'+', 2, 10}}}, {'delete', 'test', {2}}, {'delete', 'test', {20}}, {'upsert', 'test', {3, 3}, {{'+', 2, 1}}}})
+s:select()
+c:batch({})
+-- The batch is atomic.
+c:batch({{'insert', 'test', {4}}, {'insert', 'test', {1}}})
+c:batch({{'replace', 'test', {5}}, {'insert', 1000, {1}}})
+s:select()
+-- Statements of a batch are logged as separate rows.
+lsn = box.info.lsn
+c:batch({{'insert', 'test', {4}}, {'insert', 'test', {5}}, {'insert', 'test', {6}}})
+box.info.lsn - lsn
+c.space.test:select()
+c:close()
+s:drop()
+box.schema.user.revoke('guest', 'read,write', 'universe')
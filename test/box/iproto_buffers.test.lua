@@ -0,0 +1,28 @@
+net_box = require('net.box')
+fiber = require('fiber')
+
+--
+-- Input buffers of a connection are returned to the network
+-- thread as soon as its input is drained, even if a request of
+-- the connection still waits for a reply.
+--
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+cond = fiber.cond()
+mem = nil
+function hold(arg) mem = mem or box.info.memory().net cond:wait() return #arg end
+conns = {}
+for i = 1, 8 do conns[i] = net_box.connect(box.cfg.listen) end
+done = 0
+for i = 1, 8 do fiber.create(function() conns[i]:call('hold', {string.rep('x', 1000000)}) done = done + 1 end) end
+while mem == nil do fiber.sleep(0.01) end
+mem > 1000000
+-- All requests are in progress, but no input is pinned.
+deadline = fiber.clock() + 10
+while box.info.memory().net > mem / 2 and fiber.clock() < deadline do fiber.sleep(0.01) end
+box.info.memory().net < mem / 2
+cond:broadcast()
+while done < 8 do fiber.sleep(0.01) end
+-- Idle connections don't pin input either.
+box.info.memory().net < mem / 2
+for i = 1, 8 do conns[i]:close() end
+box.schema.user.revoke('guest', 'read,write,execute', 'universe')
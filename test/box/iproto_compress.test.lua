@@ -0,0 +1,58 @@
+net_box = require('net.box')
+
+--
+-- Compression of large requests and replies negotiated by
+-- a client with IPROTO_COMPRESS.
+--
+box.schema.user.grant('guest', 'read,write', 'universe')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.cfg.iproto_compression_threshold
+c = net_box.connect(box.cfg.listen, {compression = true})
+c.state
+function stat() return box.stat.net.COMPRESSION end
+replies = stat().replies
+requests = stat().requests
+saved = stat().saved
+-- Small packets are sent as is.
+c.space.test:insert{1, 'a'}
+stat().replies - replies
+stat().requests - requests
+-- Large ones are compressed.
+t = c.space.test:insert{2, string.rep('x', 10000)}
+#t[2]
+stat().replies - replies
+stat().requests - requests
+#c.space.test:get{2}[2]
+stat().replies - replies
+stat().saved - saved > 20000
+#c:eval('return box.space.test:get{2}')[2]
+stat().replies - replies
+-- The threshold is dynamic.
+box.cfg{iproto_compression_threshold = 100000}
+#c.space.test:get{2}[2]
+stat().replies - replies
+box.cfg{iproto_compression_threshold = 1024}
+box.cfg{iproto_compression_threshold = -1}
+-- Connections without compression are not affected.
+c2 = net_box.connect(box.cfg.listen)
+#c2.space.test:get{2}[2]
+stat().replies - replies
+c2:close()
+c:close()
+box.stat.reset()
+stat().saved
+-- A binary body is only accepted with IPROTO_COMPRESSION set.
+socket = require('socket')
+uri = require('uri')
+msgpack = require('msgpack')
+listen = uri.parse(box.cfg.listen)
+function request(header, body) sock:write(msgpack.encode(#header + #body) .. header .. body) local len = msgpack.decode(sock:read(5)) local resp = sock:read(len) local _, pos = msgpack.decode(resp) return (msgpack.decode(resp, pos))[0x31] end
+sock = socket.tcp_connect(listen.host, listen.service)
+#sock:read(128)
+request(msgpack.encode({[0] = 64}), '\xc4\x01\x00')
+request(msgpack.encode({[0] = 64, [7] = 1}), '\xc4\x01\x00')
+request(msgpack.encode({[0] = 64, [7] = 5}), '\xc4\x01\x00')
+sock:close()
+s:drop()
+box.schema.user.revoke('guest', 'read,write', 'universe')
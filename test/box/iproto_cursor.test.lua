@@ -0,0 +1,55 @@
+net_box = require('net.box')
+
+--
+-- Server-side cursors read a result set in batches.
+--
+box.schema.user.grant('guest', 'read,write', 'universe')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {unique = false, parts = {2, 'unsigned'}})
+for i = 1, 10 do s:replace{i, i % 3} end
+c = net_box.connect(box.cfg.listen)
+cur = c.space.test:cursor()
+cur:fetch(4)
+cur:fetch(4)
+cur:fetch(4)
+cur:fetch(4)
+cur:close()
+cur:fetch(4)
+cur:close()
+-- Key, iterator and offset.
+cur = c.space.test.index.sk:cursor({1}, {iterator = 'GE', offset = 2})
+cur:fetch(100)
+cur:close()
+cur = c.space.test.index.pk:cursor({5}, {iterator = 'LT'})
+cur:fetch(2)
+cur:fetch(2)
+cur:close()
+-- The cursor sees changes made between batches.
+cur = c.space.test:cursor()
+cur:fetch(2)
+s:delete{3}
+s:replace{11, 0}
+#cur:fetch(100)
+cur:close()
+-- A batch is capped by the server.
+for i = 12, 1500 do s:replace{i, i % 3} end
+cur = c.space.test:cursor()
+#cur:fetch(5000)
+cur:close()
+-- Errors.
+c.space.test.index.sk:cursor({'x'})
+t = {}
+for i = 1, 64 do t[i] = c.space.test:cursor() end
+c.space.test:cursor()
+t[1]:close()
+c.space.test:cursor() ~= nil
+-- Cursors are closed on disconnect.
+c:close()
+c = net_box.connect(box.cfg.listen)
+t = {}
+for i = 1, 64 do t[i] = c.space.test:cursor() end
+#t
+c:close()
+s:drop()
+box.schema.user.revoke('guest', 'read,write', 'universe')
@@ -0,0 +1,32 @@
+net_box = require('net.box')
+socket = require('socket')
+uri = require('uri')
+
+--
+-- box.cfg.iproto_reuseport binds the listening socket with
+-- SO_REUSEPORT, so other sockets may listen on the same port.
+--
+box.cfg.iproto_reuseport
+listen = uri.parse(box.cfg.listen)
+test_run = require('test_run').new()
+test_run:cmd("setopt delimiter ';'")
+function bind_reuseport()
+    local s = socket('AF_INET', 'SOCK_STREAM', 'tcp')
+    s:setsockopt('SOL_SOCKET', 'SO_REUSEPORT', true)
+    local ok = s:bind(listen.host, listen.service)
+    s:close()
+    return ok
+end;
+test_run:cmd("setopt delimiter ''");
+bind_reuseport()
+box.cfg{iproto_reuseport = true}
+bind_reuseport()
+c = net_box.connect(box.cfg.listen)
+c:ping()
+c:close()
+box.cfg{iproto_reuseport = false}
+bind_reuseport()
+c = net_box.connect(box.cfg.listen)
+c:ping()
+c:close()
+box.cfg{iproto_reuseport = 'yes'}
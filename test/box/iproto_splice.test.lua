@@ -0,0 +1,39 @@
+net_box = require('net.box')
+fiber = require('fiber')
+
+--
+-- Large SELECT replies are sent right from tuple memory.
+--
+box.schema.user.grant('guest', 'read,write', 'universe')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 100 do s:replace{i, string.rep('x', 1000)} end
+c = net_box.connect(box.cfg.listen)
+res = c.space.test:select()
+#res
+res[1][1], res[100][1], #res[100][2]
+res = nil
+-- Large and small replies are not reordered.
+test_run = require('test_run').new()
+test_run:cmd("setopt delimiter ';'")
+ok = true
+for i = 1, 10 do
+    if #c.space.test:select() ~= 100 or
+       c.space.test:get{i}[1] ~= i or
+       #c.space.test:select({}, {limit = 1}) ~= 1 then
+        ok = false
+    end
+end;
+test_run:cmd("setopt delimiter ''");
+ok
+-- Concurrent large replies on the same connection.
+done = 0
+for i = 1, 10 do fiber.create(function() ok = ok and #c.space.test:select() == 100 done = done + 1 end) end
+while done < 10 do fiber.sleep(0.01) end
+ok
+-- Tuples referenced by a reply outlive their deletion.
+s:truncate()
+c.space.test:select()
+c:close()
+s:drop()
+box.schema.user.revoke('guest', 'read,write', 'universe')
@@ -0,0 +1,41 @@
+test_run = require('test_run').new()
+
+--
+-- Several network threads serve connections concurrently.
+--
+test_run:cmd('create server iproto_threads with script = "box/lua/iproto_threads.lua"')
+test_run:cmd("start server iproto_threads")
+test_run:cmd('switch iproto_threads')
+box.cfg.iproto_threads
+box.cfg{iproto_threads = 2}
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+net_box = require('net.box')
+fiber = require('fiber')
+test_run:cmd("setopt delimiter ';'")
+conns = {}
+for i = 1, 16 do
+    conns[i] = net_box.connect(box.cfg.listen)
+end;
+done = 0
+for i = 1, 16 do
+    fiber.create(function()
+        local c = conns[i]
+        for j = 1, 100 do
+            c.space.test:replace{i * 1000 + j, i}
+            c.space.test:get{i * 1000 + j}
+        end
+        done = done + 1
+    end)
+end;
+test_run:cmd("setopt delimiter ''");
+while done < 16 do fiber.sleep(0.01) end
+s:count()
+box.stat.net.SENT.total > 0
+box.stat.net.RECEIVED.total > 0
+box.info.memory().net > 0
+for i = 1, 16 do conns[i]:close() end
+s:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server iproto_threads")
+test_run:cmd("cleanup server iproto_threads")
@@ -0,0 +1,48 @@
+test_run = require('test_run').new()
+
+--
+-- Socket I/O of the network threads batched with io_uring.
+-- Falls back to evio if io_uring is not supported, so the
+-- results are the same either way.
+--
+test_run:cmd('create server iproto_uring with script = "box/lua/iproto_uring.lua"')
+test_run:cmd("start server iproto_uring")
+test_run:cmd('switch iproto_uring')
+box.cfg.io_backend
+box.cfg{io_backend = 'evio'}
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+net_box = require('net.box')
+fiber = require('fiber')
+test_run:cmd("setopt delimiter ';'")
+conns = {}
+for i = 1, 8 do
+    conns[i] = net_box.connect(box.cfg.listen)
+end;
+-- Several fibers per connection make requests pipelined.
+done = 0
+for i = 1, 32 do
+    fiber.create(function()
+        local c = conns[i % 8 + 1]
+        for j = 1, 50 do
+            c.space.test:replace{i * 1000 + j, string.rep('x', j * 100)}
+            c.space.test:get{i * 1000 + j}
+        end
+        done = done + 1
+    end)
+end;
+test_run:cmd("setopt delimiter ''");
+while done < 32 do fiber.sleep(0.01) end
+s:count()
+-- A big reply and a big request.
+#conns[1].space.test:select()
+_ = conns[1].space.test:replace{0, string.rep('y', 1024 * 1024)}
+#conns[2].space.test:get{0}[2]
+box.stat.net.SENT.total > 0
+box.stat.net.RECEIVED.total > 0
+for i = 1, 8 do conns[i]:close() end
+s:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server iproto_uring")
+test_run:cmd("cleanup server iproto_uring")
+box.cfg{io_backend = 'uring'}
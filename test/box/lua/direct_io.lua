@@ -0,0 +1,11 @@
+#!/usr/bin/env tarantool
+os = require('os')
+
+box.cfg{
+    listen              = os.getenv("LISTEN"),
+    rows_per_wal        = 10,
+    wal_direct_io       = true,
+    snap_direct_io      = true,
+}
+
+require('console').listen(os.getenv('ADMIN'))
@@ -0,0 +1,10 @@
+#!/usr/bin/env tarantool
+os = require('os')
+
+box.cfg{
+    listen              = os.getenv("LISTEN"),
+    rows_per_wal        = 1000,
+    recovery_read_threads = 2,
+}
+
+require('console').listen(os.getenv('ADMIN'))
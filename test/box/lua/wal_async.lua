@@ -0,0 +1,11 @@
+#!/usr/bin/env tarantool
+os = require('os')
+
+box.cfg{
+    listen              = os.getenv("LISTEN"),
+    wal_mode            = 'async',
+    wal_async_max_bytes = 64 * 1024,
+    wal_async_max_lag   = 0.5,
+}
+
+require('console').listen(os.getenv('ADMIN'))
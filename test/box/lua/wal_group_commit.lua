@@ -0,0 +1,11 @@
+#!/usr/bin/env tarantool
+os = require('os')
+
+box.cfg{
+    listen              = os.getenv("LISTEN"),
+    wal_mode            = 'fsync',
+    wal_commit_delay_us = 10000,
+    wal_group_max_bytes = 64 * 1024,
+}
+
+require('console').listen(os.getenv('ADMIN'))
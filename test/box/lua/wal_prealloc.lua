@@ -0,0 +1,12 @@
+#!/usr/bin/env tarantool
+os = require('os')
+
+box.cfg{
+    listen              = os.getenv("LISTEN"),
+    rows_per_wal        = 10,
+    wal_max_size        = 64 * 1024,
+    wal_prealloc_count  = 2,
+    checkpoint_count    = 1,
+}
+
+require('console').listen(os.getenv('ADMIN'))
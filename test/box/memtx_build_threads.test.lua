@@ -0,0 +1,34 @@
+test_run = require('test_run').new()
+
+--
+-- Keys of all spaces sorted in several threads on recovery.
+--
+test_run:cmd('create server build with script = "box/lua/memtx_build_threads.lua"')
+test_run:cmd("start server build")
+test_run:cmd('switch build')
+box.cfg.memtx_build_threads
+s1 = box.schema.space.create('test1')
+_ = s1:create_index('pk')
+_ = s1:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+_ = s1:create_index('hash', {type = 'hash', parts = {3, 'string'}})
+s2 = box.schema.space.create('test2')
+_ = s2:create_index('pk', {parts = {2, 'string'}})
+_ = s2:create_index('sk', {parts = {1, 'integer'}})
+for i = 1, 1000 do s1:insert{i, i % 7, tostring(i)} end
+for i = 1, 500 do s2:insert{-i, tostring(i)} end
+box.snapshot()
+for i = 1001, 1100 do s1:insert{i, i % 7, tostring(i)} end
+test_run:cmd('restart server build')
+s1 = box.space.test1
+s2 = box.space.test2
+s1.index.sk:count(3)
+s1.index.sk:select(6, {limit = 3})
+s1.index.hash:get('1100')
+s2.index.sk:select({}, {limit = 3})
+s2.index.pk:select({}, {limit = 3})
+s1:drop()
+s2:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server build")
+test_run:cmd("cleanup server build")
+box.cfg{memtx_build_threads = 2}
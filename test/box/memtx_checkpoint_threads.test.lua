@@ -0,0 +1,33 @@
+test_run = require('test_run').new()
+
+--
+-- User spaces written to a snapshot in several threads.
+--
+test_run:cmd('create server ckpt with script = "box/lua/memtx_checkpoint_threads.lua"')
+test_run:cmd("start server ckpt")
+test_run:cmd('switch ckpt')
+box.cfg.memtx_checkpoint_threads
+for i = 1, 5 do local s = box.schema.space.create('test' .. i) s:create_index('pk') end
+for i = 1, 5 do for j = 1, 1000 * i do box.space['test' .. i]:insert{j, string.rep('x', i)} end end
+s = box.schema.space.create('empty')
+_ = s:create_index('pk')
+box.snapshot()
+test_run:cmd('restart server ckpt')
+t = {} for i = 1, 5 do table.insert(t, box.space['test' .. i]:count()) end
+t
+box.space.test5:get(5000)
+box.space.test3:select({}, {limit = 2})
+box.space.empty:count()
+-- One writer thread is the same as no extra threads.
+box.cfg{memtx_checkpoint_threads = 1}
+box.space.test1:insert{1001, 'y'}
+box.snapshot()
+test_run:cmd('restart server ckpt')
+box.space.test1:count()
+box.space.test1:get(1001)
+box.cfg{memtx_checkpoint_threads = 0}
+box.cfg{memtx_checkpoint_threads = 65}
+box.cfg.memtx_checkpoint_threads
+test_run:cmd("switch default")
+test_run:cmd("stop server ckpt")
+test_run:cmd("cleanup server ckpt")
@@ -0,0 +1,74 @@
+test_run = require('test_run').new()
+
+--
+-- Incremental memtx checkpoints: only the spaces changed
+-- since the previous checkpoint are written.
+--
+test_run:cmd('create server incr with script = "box/lua/memtx_incremental_checkpoints.lua"')
+test_run:cmd("start server incr")
+test_run:cmd('switch incr')
+fio = require('fio')
+test_run:cmd("setopt delimiter ';'")
+function last_snap_meta()
+    local files = fio.glob('*.snap')
+    table.sort(files)
+    local f = fio.open(files[#files])
+    local meta = f:read(1024)
+    f:close()
+    return meta:match('Base: %d+') ~= nil, meta:match('Spaces:[^\n]*')
+end;
+test_run:cmd("setopt delimiter ''");
+box.cfg.memtx_incremental_checkpoints
+for _, name in ipairs({'a', 'b', 'c'}) do local s = box.schema.space.create(name) s:create_index('pk') for i = 1, 100 do s:insert{i, name} end end
+-- The first checkpoint is always full.
+box.snapshot()
+last_snap_meta()
+box.space.a:replace{1, 'aa'}
+box.space.b:drop()
+d = box.schema.space.create('d')
+_ = d:create_index('pk')
+_ = d:insert{1, 'd'}
+e = box.schema.space.create('e', {temporary = true})
+_ = e:create_index('pk')
+_ = e:insert{1, 'e'}
+box.snapshot()
+last_snap_meta()
+test_run:cmd('restart server incr')
+box.space.a:count()
+box.space.a:get(1)
+box.space.b
+box.space.c:count()
+box.space.c:get(100)
+box.space.d:select()
+box.space.e:count()
+-- A checkpoint can be based on an incremental one.
+box.cfg{checkpoint_count = 1}
+box.space.c:delete{100}
+box.snapshot()
+last_snap_meta()
+-- The files the last checkpoint is based on are kept.
+#fio.glob('*.snap')
+test_run:cmd('restart server incr')
+box.space.a:get(1)
+box.space.c:count()
+box.space.d:count()
+-- The chain is long enough, the next checkpoint is full.
+box.space.d:insert{2, 'd'}
+box.snapshot()
+last_snap_meta()
+#fio.glob('*.snap')
+test_run:cmd('restart server incr')
+box.space.a:count()
+box.space.c:count()
+box.space.d:count()
+-- Nothing is inherited with incremental checkpoints disabled.
+box.cfg{memtx_incremental_checkpoints = 0}
+box.space.d:insert{3, 'd'}
+box.snapshot()
+last_snap_meta()
+box.cfg{memtx_incremental_checkpoints = -1}
+box.cfg{memtx_incremental_checkpoints = 65}
+box.cfg.memtx_incremental_checkpoints
+test_run:cmd("switch default")
+test_run:cmd("stop server incr")
+test_run:cmd("cleanup server incr")
@@ -0,0 +1,55 @@
+--
+-- Partial indexes: only tuples matching the filter are indexed.
+--
+format = {{'id', 'unsigned'}, {'status', 'string'}, {'prio', 'unsigned', is_nullable = true}}
+s = box.schema.space.create('test', {format = format})
+pk = s:create_index('pk')
+
+-- Unsupported configurations.
+s:create_index('i', {type = 'hash', parts = {'id'}, filter = {'status', '=', 'pending'}})
+s:create_index('i', {parts = {'prio'}, filter = {'status', 'like', 'p%'}})
+s:create_index('i', {parts = {'prio'}, filter = {'status', '<', box.NULL}})
+s:create_index('i', {parts = {'prio'}, filter = {'status', '=', {1}}})
+s:create_index('i', {parts = {'prio'}, filter = {'nope', '=', 1}})
+s2 = box.schema.space.create('test2')
+s2:create_index('pk', {filter = {2, '=', 1}})
+s2:drop()
+
+s:insert{1, 'pending', 3}
+s:insert{2, 'done', 1}
+s:insert{3, 'pending', 2}
+idx = s:create_index('pending', {unique = false, parts = {'prio'}, filter = {'status', '=', 'pending'}})
+idx.filter
+idx:select()
+idx:count()
+idx:len()
+
+-- Tuples enter and leave the index on update.
+s:insert{4, 'pending', 1}
+s:update(1, {{'=', 2, 'done'}})
+s:update(2, {{'=', 2, 'pending'}})
+idx:select()
+s:delete(3)
+idx:select()
+
+-- All conditions must hold, missing fields match only nil.
+urgent = s:create_index('urgent', {parts = {'id'}, filter = {{'status', '!=', 'done'}, {'prio', '<', 2}}})
+s:insert{5, 'new'}
+urgent:select()
+noprio = s:create_index('noprio', {parts = {'id'}, filter = {'prio', '=', box.NULL}})
+noprio:select()
+
+-- Uniqueness is checked among indexed tuples only.
+s:create_index('uniq', {parts = {'prio'}, filter = {'status', '=', 'pending'}})
+s:update(4, {{'=', 2, 'done'}})
+uniq = s:create_index('uniq', {parts = {'prio'}, filter = {'status', '=', 'pending'}})
+s:insert{6, 'done', 1}
+s:insert{7, 'pending', 1}
+uniq:select()
+
+-- Dropping the filter rebuilds the index over all tuples.
+s.index.pending:alter({filter = {}})
+s.index.pending.filter
+s.index.pending:count()
+
+s:drop()
@@ -0,0 +1,28 @@
+test_run = require('test_run').new()
+
+--
+-- Snapshot and WALs read and decoded in background threads
+-- on recovery.
+--
+test_run:cmd('create server readahead with script = "box/lua/recovery_readahead.lua"')
+test_run:cmd("start server readahead")
+test_run:cmd('switch readahead')
+box.cfg.recovery_read_threads
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 5000 do s:insert{i, string.rep('x', i % 500)} end
+box.snapshot()
+-- Big transactions are compressed.
+box.begin() for i = 5001, 10000 do s:insert{i, string.rep('y', i % 500)} end box.commit()
+for i = 1, 10000, 2 do s:delete{i} end
+test_run:cmd('restart server readahead')
+s = box.space.test
+s:count()
+s:get(10000)[2] == string.rep('y', 10000 % 500)
+s:get(4998)[2] == string.rep('x', 4998 % 500)
+s:get(9999)
+s:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server readahead")
+test_run:cmd("cleanup server readahead")
+box.cfg{recovery_read_threads = 2}
@@ -21,10 +21,33 @@ box.stat.net.RECEIVED.total > 0
 -- box.stat.net.EVENTS.total > 0
 -- box.stat.net.LOCKS.total > 0
 
+-- request queues
+queues = box.stat.net.QUEUES
+queues.read.total > 0
+queues.read.depth, queues.read.in_flight
+queues.read.wait_time >= 0
+queues.call.total
+box.stat.net().QUEUES.write ~= nil
+
+-- request latency
+cn.space.tweedledum:replace{1}
+latency = box.stat.net.LATENCY
+latency.SELECT.count > 0
+latency.REPLACE.count
+latency.REPLACE.total.p50 > 0
+latency.REPLACE.total.p99 >= latency.REPLACE.total.p50
+latency.REPLACE.wal.p999 >= latency.REPLACE.wal.p50
+latency.REPLACE.flush.p50 >= 0
+latency.SELECT.wal.p999 <= 1e-6 -- no WAL writes
+latency.DELETE
+box.stat.net().LATENCY.SELECT ~= nil
+
 -- reset
 box.stat.reset()
 box.stat.net.SENT.total
 box.stat.net.RECEIVED.total
+box.stat.net.QUEUES.read.total
+box.stat.net.LATENCY.SELECT
 
 space:drop()
 cn:close()
@@ -0,0 +1,70 @@
+--
+-- Tree index elements store a hint of the first key part,
+-- which is compared before the tuples. Check that the order
+-- of all kinds of values is preserved.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {parts = {1, 'scalar'}})
+_ = s:insert{'abcdefgh2'}
+_ = s:insert{100}
+_ = s:insert{true}
+_ = s:insert{-1.5}
+_ = s:insert{'b'}
+_ = s:insert{18446744073709551615ULL}
+_ = s:insert{0.5}
+_ = s:insert{'abcdefgh'}
+_ = s:insert{-9223372036854775808LL}
+_ = s:insert{1}
+_ = s:insert{false}
+_ = s:insert{'a'}
+_ = s:insert{-10}
+_ = s:insert{'abcdefgh1'}
+_ = s:insert{0}
+s:select()
+s:select({'abcdefgh'}, {iterator = 'GT'})
+s:select({1}, {iterator = 'LE'})
+s:get{'abcdefgh1'}
+s:get{1.5}
+s:get{1}
+s:drop()
+
+-- Collations.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {unique = false, parts = {{2, 'string', collation = 'unicode_ci'}}})
+_ = s:insert{1, 'ABE'}
+_ = s:insert{2, 'aBc0'}
+_ = s:insert{3, 'abd'}
+_ = s:insert{4, 'Abc'}
+_ = s:insert{5, 'abc'}
+s.index.sk:select()
+s.index.sk:select{'ABC'}
+s.index.sk:select({'abd'}, {iterator = 'LT'})
+s:drop()
+
+-- NULLs and absent fields.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {unique = false, parts = {{2, 'integer', is_nullable = true}}})
+_ = s:insert{1, 5}
+_ = s:insert{2}
+_ = s:insert{3, -5}
+_ = s:insert{4, box.NULL}
+s.index.sk:select()
+s.index.sk:select{box.NULL}
+s.index.sk:select({0}, {iterator = 'LT'})
+s:drop()
+
+-- Hints do not depend on the field type, so the type can
+-- be changed without rebuilding the index.
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {parts = {1, 'unsigned'}})
+for i = 1, 10 do s:insert{i * 10} end
+s.index.pk:alter({parts = {1, 'scalar'}})
+_ = s:insert{'x'}
+_ = s:insert{-1}
+_ = s:insert{15.5}
+s:select()
+s:get{15.5}
+s:select({20}, {iterator = 'LT'})
+s:drop()
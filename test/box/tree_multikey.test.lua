@@ -0,0 +1,73 @@
+--
+-- A multikey part indexes every element of an array field.
+--
+s = box.schema.space.create('test')
+s:format({{'id', 'unsigned'}, {'tags', 'array'}})
+_ = s:create_index('pk')
+sk = s:create_index('sk', {unique = false, parts = {{'tags[*]', 'string'}}})
+sk.parts[1].fieldno, sk.parts[1].type, sk.parts[1].is_multikey
+_ = s:insert{1, {'a', 'b', 'c'}}
+_ = s:insert{2, {'c', 'd'}}
+_ = s:insert{3, {}}
+_ = s:insert{4, {'b', 'b'}}
+sk:select()
+sk:select{'b'}
+sk:select{'c'}
+sk:select({'b'}, {iterator = 'GT'})
+sk:select({'c'}, {iterator = 'LE'})
+sk:count()
+sk:count{'b'}
+-- Length is the number of tuples, not of elements.
+sk:len()
+-- Updates move all the entries of a tuple.
+_ = s:replace{2, {'e'}}
+sk:select{'c'}
+sk:select{'e'}
+_ = s:delete{1}
+sk:select()
+sk:len()
+-- Elements must be of the part type.
+s:insert{5, {'a', 1}}
+s:insert{5, 'a'}
+s:drop()
+
+-- Unique multikey index.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+sk = s:create_index('sk', {parts = {{2, 'unsigned', is_multikey = true}}})
+_ = s:insert{1, {10, 20}}
+_ = s:insert{2, {30, 30}}
+s:insert{3, {40, 20}}
+sk:len()
+sk:select()
+sk:get{20}
+sk:get{40}
+_ = s:replace{1, {20, 40}}
+sk:select()
+s:replace{2, {10}}
+sk:select()
+s:drop()
+
+-- Multikey index can be built over existing data.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:insert{1, {3, 1, 3}}
+_ = s:insert{2, {2, 1}}
+sk = s:create_index('sk', {unique = false, parts = {{2, 'unsigned', is_multikey = true}}})
+sk:select()
+sk:select{1}
+sk:len()
+s:drop()
+
+-- Restrictions.
+s = box.schema.space.create('test')
+s:create_index('pk', {parts = {{1, 'unsigned', is_multikey = true}}})
+_ = s:create_index('pk')
+s:create_index('sk', {type = 'hash', parts = {{2, 'unsigned', is_multikey = true}}})
+s:create_index('sk', {parts = {{2, 'unsigned', is_multikey = true}, {3, 'unsigned', is_multikey = true}}})
+s:create_index('sk', {parts = {{2, 'unsigned', is_multikey = true, is_nullable = true}}})
+s:drop()
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+s:create_index('sk', {parts = {{2, 'unsigned', is_multikey = true}}})
+s:drop()
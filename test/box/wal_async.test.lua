@@ -0,0 +1,50 @@
+test_run = require('test_run').new()
+
+--
+-- Async commit: a transaction is committed as soon as it's
+-- queued to WAL, box.wal.sync() waits until it's written.
+--
+test_run:cmd('create server wal_async with script = "box/lua/wal_async.lua"')
+test_run:cmd("start server wal_async")
+test_run:cmd('switch wal_async')
+box.cfg.wal_mode
+box.cfg.wal_async_max_bytes
+box.cfg.wal_async_max_lag
+fiber = require('fiber')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.wal.sync()
+stat = box.stat.wal()
+test_run:cmd("setopt delimiter ';'")
+function insert(from, to, data)
+    local csw = fiber.info()[fiber.id()].csw
+    for i = from, to do
+        s:insert{i, data}
+    end
+    return fiber.info()[fiber.id()].csw - csw
+end;
+test_run:cmd("setopt delimiter ''");
+-- Commit doesn't yield.
+insert(1, 100)
+lsn = box.info.lsn
+box.wal.sync()
+box.stat.wal().entries - stat.entries
+box.info.lsn == lsn
+-- Writers are throttled when the queue is too big.
+insert(101, 200, string.rep('x', 1024)) > 0
+box.wal.sync()
+s:count()
+-- Synced rows survive restart.
+test_run:cmd('restart server wal_async')
+box.space.test:count()
+box.space.test:get(200)[2]:len()
+box.space.test:drop()
+box.wal.sync()
+test_run:cmd("switch default")
+test_run:cmd("stop server wal_async")
+test_run:cmd("cleanup server wal_async")
+-- box.wal.sync() is a no-op in the other modes.
+box.wal.sync()
+-- Options are static.
+box.cfg{wal_async_max_bytes = 1}
+box.cfg{wal_async_max_lag = 1}
@@ -0,0 +1,45 @@
+test_run = require('test_run').new()
+
+--
+-- Group commit: with wal_commit_delay_us set, concurrent
+-- transactions are synced to the WAL with one fdatasync().
+--
+test_run:cmd('create server wal_group_commit with script = "box/lua/wal_group_commit.lua"')
+test_run:cmd("start server wal_group_commit")
+test_run:cmd('switch wal_group_commit')
+box.cfg.wal_commit_delay_us
+box.cfg.wal_group_max_bytes
+fiber = require('fiber')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+stat = box.stat.wal()
+done = 0
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 100 do
+    fiber.create(function()
+        s:insert{i}
+        done = done + 1
+    end)
+end;
+test_run:cmd("setopt delimiter ''");
+while done < 100 do fiber.sleep(0.01) end
+s:count()
+box.stat.wal().entries - stat.entries
+box.stat.wal().groups - stat.groups < 100
+box.stat.wal().group_size.max > 1
+box.stat.wal().fsyncs - stat.fsyncs == box.stat.wal().groups - stat.groups
+box.stat.wal().fsync_time.p99 >= box.stat.wal().fsync_time.p50
+-- A group is committed as soon as it's big enough.
+stat = box.stat.wal()
+_ = s:insert{1000, string.rep('x', box.cfg.wal_group_max_bytes)}
+box.stat.wal().groups - stat.groups
+-- Committed rows survive restart.
+test_run:cmd('restart server wal_group_commit')
+box.space.test:count()
+box.space.test:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server wal_group_commit")
+test_run:cmd("cleanup server wal_group_commit")
+-- Options are static.
+box.cfg{wal_commit_delay_us = 1000}
+box.cfg{wal_group_max_bytes = 1}
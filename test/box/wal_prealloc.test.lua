@@ -0,0 +1,34 @@
+test_run = require('test_run').new()
+
+--
+-- WAL files preallocated in background and recycled.
+--
+test_run:cmd('create server wal_prealloc with script = "box/lua/wal_prealloc.lua"')
+test_run:cmd("start server wal_prealloc")
+test_run:cmd('switch wal_prealloc')
+box.cfg.wal_prealloc_count
+box.cfg.wal_prealloc_zero_fill
+fio = require('fio')
+fiber = require('fiber')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 50 do s:insert{i} end
+function prealloc_files() return fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog.prealloc')) end
+while #prealloc_files() < 2 do fiber.sleep(0.01) end
+fio.stat(prealloc_files()[1]).size
+-- Closed WALs are cut to the written size.
+xlogs = fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog'))
+fio.stat(xlogs[#xlogs - 1]).size < box.cfg.wal_max_size
+-- Garbage collection keeps the pool size.
+box.snapshot()
+for i = 51, 100 do s:insert{i} end
+box.snapshot()
+#prealloc_files() <= 2
+-- The data is recovered.
+test_run:cmd('restart server wal_prealloc')
+box.space.test:count()
+box.space.test:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server wal_prealloc")
+test_run:cmd("cleanup server wal_prealloc")
+box.cfg{wal_prealloc_count = 1}
@@ -0,0 +1,28 @@
+test_run = require('test_run').new()
+
+-- Rows not matching a simple WHERE clause of a partial index
+-- are not stored in the index.
+box.sql.execute("CREATE TABLE t1 (id INT PRIMARY KEY, status TEXT, prio INT)")
+box.sql.execute("CREATE INDEX i1 ON t1 (prio) WHERE status = 'pending'")
+box.space.T1.index.I1.filter ~= nil
+box.sql.execute("INSERT INTO t1 VALUES (1, 'pending', 3)")
+box.sql.execute("INSERT INTO t1 VALUES (2, 'done', 1)")
+box.sql.execute("INSERT INTO t1 VALUES (3, 'pending', 2)")
+box.sql.execute("INSERT INTO t1 VALUES (4, NULL, 5)")
+box.space.T1.index.I1:select()
+
+-- The index is used only when the query implies its WHERE
+-- clause.
+box.sql.execute("SELECT id FROM t1 WHERE status = 'pending' ORDER BY prio")
+box.sql.execute("SELECT id FROM t1 WHERE prio < 3")
+box.sql.execute("UPDATE t1 SET status = 'done' WHERE id = 1")
+box.space.T1.index.I1:select()
+box.sql.execute("SELECT id FROM t1 WHERE status = 'pending' ORDER BY prio")
+
+-- A WHERE clause Tarantool can't evaluate keeps all rows in
+-- the index.
+box.sql.execute("CREATE INDEX i2 ON t1 (prio) WHERE prio + 1 > 2")
+box.space.T1.index.I2.filter
+box.space.T1.index.I2:count()
+
+box.sql.execute("DROP TABLE t1")
@@ -171,6 +171,48 @@ test_percentile(void)
 	footer();
 }
 
+static void
+test_add(void)
+{
+	header();
+
+	size_t n_buckets;
+	int64_t *buckets = gen_buckets(&n_buckets);
+
+	size_t data_len;
+	int64_t *data = gen_rand_data(&data_len);
+
+	struct histogram *hist = histogram_new(buckets, n_buckets);
+	struct histogram *hist1 = histogram_new(buckets, n_buckets);
+	struct histogram *hist2 = histogram_new(buckets, n_buckets);
+	for (size_t i = 0; i < data_len; i++) {
+		histogram_collect(hist, data[i]);
+		histogram_collect(i % 2 == 0 ? hist1 : hist2, data[i]);
+	}
+	histogram_add(hist1, hist2);
+
+	fail_if(hist1->total != hist->total);
+	fail_if(hist1->max != hist->max);
+	for (size_t b = 0; b < n_buckets; b++)
+		fail_if(hist1->buckets[b].count != hist->buckets[b].count);
+	for (int permille = 5; permille < 1000; permille += 5) {
+		fail_if(histogram_permille(hist1, permille) !=
+			histogram_permille(hist, permille));
+	}
+	for (int pct = 5; pct < 100; pct += 5) {
+		fail_if(histogram_permille(hist, pct * 10) !=
+			histogram_percentile(hist, pct));
+	}
+
+	histogram_delete(hist2);
+	histogram_delete(hist1);
+	histogram_delete(hist);
+	free(data);
+	free(buckets);
+
+	footer();
+}
+
 int
 main()
 {
@@ -178,4 +220,5 @@ main()
 	test_counts();
 	test_discard();
 	test_percentile();
+	test_add();
 }
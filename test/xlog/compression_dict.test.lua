@@ -0,0 +1,56 @@
+test_run = require('test_run').new()
+
+--
+-- WALs and snapshots can be compressed with a zstd dictionary
+-- trained on the rows of an older file. The dictionary is
+-- stored in the meta of the file it's used for.
+--
+test_run:cmd('create server dict with script = "xlog/compression_dict.lua"')
+test_run:cmd("start server dict")
+test_run:cmd('switch dict')
+fio = require('fio')
+fiber = require('fiber')
+box.cfg.xlog_compression_dict
+box.cfg.xlog_compression_level
+-- Options are static.
+box.cfg{xlog_compression_dict = false}
+box.cfg{xlog_compression_level = 5}
+has_dict = function(path) local f = fio.open(path) local data = f:read(64 * 1024) f:close() return data:match('\nDictionary: [%w+/=]+\n') ~= nil end
+last = function(dir, pattern) local files = fio.glob(fio.pathjoin(dir, pattern)) table.sort(files) return files[#files] end
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 500 do s:insert{i, 'row ' .. i .. string.rep(' some text', 40)} end
+-- The first WAL has no dictionary yet.
+wal1 = last(box.cfg.wal_dir, '*.xlog')
+has_dict(wal1)
+box.snapshot()
+-- The dictionary is trained in the background, so a file
+-- created before it's ready gets the one of an older file.
+fill = function() for i = 501, 1000 do s:replace{i, 'row ' .. i .. string.rep(' some text', 40)} end end
+next_wal = function() fill() wal2 = last(box.cfg.wal_dir, '*.xlog') if has_dict(wal2) then return true end box.snapshot() return false end
+while not next_wal() do fiber.sleep(0.01) end
+wal1 ~= wal2
+-- Rows are small, but the dictionary makes them compressible.
+fio.stat(wal2).size < fio.stat(wal1).size / 2
+-- Snapshots are compressed with a dictionary too.
+next_snap = function() s:replace{1, 'row 1' .. string.rep(' some text', 40)} box.snapshot() return has_dict(last(box.cfg.memtx_dir, '*.snap')) end
+while not next_snap() do fiber.sleep(0.01) end
+for i = 1001, 1100 do s:insert{i, 'row ' .. i .. string.rep(' some text', 40)} end
+test_run:cmd("restart server dict")
+fio = require('fio')
+has_dict = function(path) local f = fio.open(path) local data = f:read(64 * 1024) f:close() return data:match('\nDictionary: [%w+/=]+\n') ~= nil end
+last = function(dir, pattern) local files = fio.glob(fio.pathjoin(dir, pattern)) table.sort(files) return files[#files] end
+s = box.space.test
+s:count()
+s:get(1100)[2] == 'row 1100' .. string.rep(' some text', 40)
+-- The dictionary is looked up in the last file on restart.
+s:insert{1101}
+has_dict(last(box.cfg.wal_dir, '*.xlog'))
+-- The files can be read with the xlog module.
+xlog = require('xlog')
+count = 0
+for _, row in xlog.pairs(last(box.cfg.memtx_dir, '*.snap')) do if row.BODY.space_id == s.id then count = count + 1 end end
+count
+test_run:cmd('switch default')
+test_run:cmd("stop server dict")
+test_run:cmd("cleanup server dict")
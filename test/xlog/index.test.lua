@@ -0,0 +1,53 @@
+test_run = require('test_run').new()
+
+--
+-- A closed xlog has a sparse index of its tx blocks, which
+-- lets a replica catch up from the middle of the file without
+-- decoding the rows it already has.
+--
+test_run:cmd('create server master with script = "xlog/index.lua"')
+test_run:cmd("start server master")
+test_run:cmd('switch master')
+fio = require('fio')
+fiber = require('fiber')
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.snapshot()
+test_run:cmd("create server replica with rpl_master=master, script='xlog/replica.lua'")
+test_run:cmd("start server replica")
+for i = 1, 100 do s:insert{i, string.rep('x', 1024)} end
+test_run:cmd('switch replica')
+fiber = require('fiber')
+while box.space.test:count() < 100 do fiber.sleep(0.01) end
+test_run:cmd('switch master')
+test_run:cmd("stop server replica")
+for i = 101, 200 do s:insert{i, string.rep('x', 1024)} end
+-- The index is written when the xlog is closed, the current
+-- one has none yet.
+#fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog.index'))
+box.snapshot()
+files = fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog.index'))
+f = fio.open(files[#files])
+index = f:read(f:stat().size)
+f:close()
+index:match('^INDEX\nVClock: {[^\n]*}\nSize: %d+\n\n') ~= nil
+index:match('\nEOF\n$') ~= nil
+select(2, index:gsub('\n%d+ {1: %d+}', '')) > 1
+test_run:cmd("start server replica")
+test_run:cmd('switch replica')
+while box.space.test:count() < 200 do fiber.sleep(0.01) end
+box.space.test:get(200)[1]
+test_run:cmd('switch default')
+test_run:grep_log('master', 'skipping to offset')
+-- The index is removed along with the xlog.
+test_run:cmd('switch master')
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+box.space._cluster:delete(2) ~= nil
+box.cfg{checkpoint_count = 1}
+box.snapshot()
+#fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog.index'))
+test_run:cmd("switch default")
+test_run:cmd("stop server master")
+test_run:cmd("cleanup server master")